@@ -13,8 +13,10 @@
 #include "vtlib/core/Building3d.h"
 #include "vtlib/core/PagedLodGrid.h"
 #include "vtlib/core/PickEngines.h"
+#include "vtlib/core/Profiler.h"
 #include "vtlib/core/TiledGeom.h"
 #include "vtlib/core/MapOverviewEngine.h"
+#include "vtlib/core/TrafficSim.h"
 #include "vtdata/vtLog.h"
 #include "vtdata/PolyChecker.h"
 #include "vtdata/DataPath.h"
@@ -87,6 +89,7 @@ Enviro::Enviro() : vtTerrainScene()
 	m_bSelectedStruct = false;
 	m_bSelectedPlant = false;
 	m_bSelectedVehicle = false;
+	m_iSelTrafficVehicle = -1;
 	m_pControlEng = NULL;
 
 	// HUD
@@ -98,6 +101,10 @@ Enviro::Enviro() : vtTerrainScene()
 	m_bCreatedCompass = false;
 	m_bDragCompass = false;
 
+	m_pProfilerGeom = NULL;
+	m_pProfilerText = NULL;
+	m_fProfilerUpdate = 0.0f;
+
 	m_pWindowBoxMesh = NULL;
 
 	m_pMapOverview = NULL;
@@ -290,6 +297,8 @@ void Enviro::DoControl()
 			m_fMessageTime = 0.0f;
 		}
 	}
+	if (m_pProfilerGeom && m_pProfilerGeom->GetEnabled())
+		UpdateProfilerOverlay();
 	if (m_state == AS_Initializing)
 	{
 		m_iInitStep++;
@@ -1025,6 +1034,9 @@ void Enviro::SwitchToTerrain(vtTerrain *pTerrain)
 	m_pPanoFlyer->SetHeightField(pHF);
 	// also the height constraint engine
 	m_pHeightEngine->SetHeightField(pHF);
+	// flyers find the ground from its cache
+	m_pTFlyer->SetGroundCache(&m_pHeightEngine->GetGroundCache());
+	m_pVFlyer->SetGroundCache(&m_pHeightEngine->GetGroundCache());
 	m_pHeightEngine->SetMinGroundOffset(param.GetValueFloat(STR_MINHEIGHT));
 
 	bool bAllowRoll = param.GetValueBool(STR_ALLOW_ROLL);
@@ -1708,8 +1720,7 @@ void Enviro::OnMouseSelectCursorPick(vtMouseEvent &event)
 		{
 			for (uint j = 0; j < fset->NumEntities(); j++)
 			{
-				vtFeature *feat = fset->GetFeature(j);
-				vtVisual *viz = ab_layer->GetViz(feat);
+				vtVisual *viz = ab_layer->GetViz(j);
 				if (viz)
 					fset->Select(j, false);
 			}
@@ -1762,10 +1773,21 @@ void Enviro::OnMouseSelectCursorPick(vtMouseEvent &event)
 	if (dist4 > g_Options.m_fSelectionCutoff)
 		vehicle = -1;
 
-	bool click_struct = (result1 && dist1 < dist2 && dist1 < dist3 && dist1 < dist4);
-	bool click_plant = (result2 && dist2 < dist1 && dist2 < dist3 && dist2 < dist4);
-	bool click_route = (result3 && dist3 < dist1 && dist3 < dist2 && dist3 < dist4);
-	bool click_vehicle = (vehicle!=-1 && dist4 < dist1 && dist4 < dist2 && dist4 < dist3);
+	// Check the vehicles of the traffic simulation
+	DeselectTraffic();
+	vtTrafficSim *pTraffic = FindTraffic(pTerr);
+	int traffic_vehicle = -1;
+	float fTrafficDist = 1E9f;
+	if (pTraffic)
+		traffic_vehicle = pTraffic->FindClosestVehicle(wpos,
+			g_Options.m_fSelectionCutoff, fTrafficDist);
+	double dist5 = fTrafficDist;
+
+	bool click_struct = (result1 && dist1 < dist2 && dist1 < dist3 && dist1 < dist4 && dist1 < dist5);
+	bool click_plant = (result2 && dist2 < dist1 && dist2 < dist3 && dist2 < dist4 && dist2 < dist5);
+	bool click_route = (result3 && dist3 < dist1 && dist3 < dist2 && dist3 < dist4 && dist3 < dist5);
+	bool click_vehicle = (vehicle!=-1 && dist4 < dist1 && dist4 < dist2 && dist4 < dist3 && dist4 < dist5);
+	bool click_traffic = (traffic_vehicle!=-1 && dist5 < dist1 && dist5 < dist2 && dist5 < dist3 && dist5 < dist4);
 
 	if (click_struct)
 	{
@@ -1856,10 +1878,48 @@ void Enviro::OnMouseSelectCursorPick(vtMouseEvent &event)
 			m_bDragging = true;
 		m_bSelectedVehicle = true;
 	}
+	else if (click_traffic)
+	{
+		VTLOG(" traffic vehicle is closest.\n");
+		// Stop the vehicle while it is selected
+		pTraffic->SetVehicleEnabled(traffic_vehicle, false);
+		pTraffic->GetVehicle(traffic_vehicle)->ShowBounds(true);
+		m_pSelTraffic = pTraffic;
+		m_iSelTrafficVehicle = traffic_vehicle;
+	}
 	else
 		VTLOG(" nothing.\n");
 }
 
+/**
+ * Find the traffic simulation (see CreateTraffic) of a terrain, if it has one.
+ */
+vtTrafficSim *Enviro::FindTraffic(vtTerrain *pTerrain)
+{
+	vtEngine *pGroup = pTerrain->GetEngineGroup();
+	for (uint i = 0; i < pGroup->NumChildren(); i++)
+	{
+		vtTrafficSim *pSim = dynamic_cast<vtTrafficSim*>(pGroup->GetChild(i));
+		if (pSim)
+			return pSim;
+	}
+	return NULL;
+}
+
+/**
+ * Let the selected traffic vehicle, if any, drive on.
+ */
+void Enviro::DeselectTraffic()
+{
+	if (m_pSelTraffic.valid())
+	{
+		m_pSelTraffic->SetVehicleEnabled(m_iSelTrafficVehicle, true);
+		m_pSelTraffic->GetVehicle(m_iSelTrafficVehicle)->ShowBounds(false);
+	}
+	m_pSelTraffic = NULL;
+	m_iSelTrafficVehicle = -1;
+}
+
 void Enviro::OnMouseLeftDownTerrainSelect(vtMouseEvent &event)
 {
 	if (g_Options.m_bDirectPicking)
@@ -1930,8 +1990,7 @@ void Enviro::OnMouseLeftUpBox(vtMouseEvent &event)
 			FBox3 bbox;
 			for (uint j = 0; j < fset->NumEntities(); j++)
 			{
-				vtFeature *feat = fset->GetFeature(j);
-				vtVisual *viz = alay->GetViz(feat);
+				vtVisual *viz = alay->GetViz(j);
 				if (!viz)
 					continue;
 
@@ -1940,10 +1999,8 @@ void Enviro::OnMouseLeftUpBox(vtMouseEvent &event)
 					fset->Select(j, false);
 
 				bool bSelected = false;
-				for (uint k = 0; k < viz->m_meshes.size(); k++)
+				if (alay->GetFeatureBound(j, bbox))
 				{
-					vtMesh *mesh = viz->m_meshes[k];
-					mesh->GetBoundBox(bbox);
 					FPoint3 center = bbox.Center();
 
 					// Account for potential vertical exaggeration
@@ -2075,6 +2132,7 @@ void Enviro::OnMouseMoveTerrain(vtMouseEvent &event)
 				}
 			}
 			st_layer->SetModified();
+			pTerr->InvalidateCultureRegistry();
 		}
 		if (m_bDragging)
 		{
@@ -2084,6 +2142,7 @@ void Enviro::OnMouseMoveTerrain(vtMouseEvent &event)
 				if (vlay)
 					vlay->OffsetSelectedPlants(ground_delta);
 				vlay->SetModified();
+				pTerr->InvalidateCultureRegistry();
 			}
 			if (m_bSelectedUtil)
 			{
@@ -2397,6 +2456,7 @@ void Enviro::FinishLinear()
 	// Construct it and add it to the terrain
 	fence->CreateNode(pTerr);
 	pTerr->AddNodeToStructGrid(fence->GetGeom());
+	pTerr->InvalidateCultureRegistry();
 
 	// update count shown in layer view
 	RefreshLayerView();
@@ -2476,6 +2536,7 @@ void Enviro::FinishBuilding()
 	// Construct it and add it to the terrain
 	pbuilding->CreateNode(pTerr);
 	pTerr->AddNodeToStructGrid(pbuilding->GetContainer());
+	pTerr->InvalidateCultureRegistry();
 	RefreshLayerView();
 }
 
@@ -2946,6 +3007,53 @@ void Enviro::UpdateCompass()
 	}
 }
 
+/**
+ * The profiler overlay shows the frame rate and the most expensive zones of
+ * the recent frames, as text in the upper left of the window.  Showing it
+ * also turns on the profiler.
+ */
+void Enviro::ShowProfilerOverlay(bool bShow)
+{
+	if (bShow && !m_pProfilerGeom && m_pArial)
+	{
+		m_pProfilerGeom = new vtGeode;
+		m_pProfilerGeom->setName("Profiler");
+		m_pHUD->GetContainer()->addChild(m_pProfilerGeom);
+		m_pProfilerText = new vtTextMesh(m_pArial, 14);
+		m_pProfilerText->SetColor(RGBAf(1,1,0.5f,1));
+		m_pProfilerGeom->AddTextMesh(m_pProfilerText, 0);
+	}
+	if (bShow && !m_pProfilerGeom)
+		VTLOG1("Profiler: no font for the overlay, profiling without it.\n");
+	if (m_pProfilerGeom)
+		m_pProfilerGeom->SetEnabled(bShow);
+	vtProfiler::SetEnabled(bShow);
+	m_fProfilerUpdate = 0.0f;
+}
+
+// The profiler may be on without an overlay (if there is no font), so the
+//  state is that of the profiler itself.
+bool Enviro::GetShowProfilerOverlay()
+{
+	return vtProfiler::IsEnabled();
+}
+
+void Enviro::UpdateProfilerOverlay()
+{
+	// Changing the text is not free, so only do it a few times a second
+	const float fNow = vtGetTime();
+	if (fNow - m_fProfilerUpdate < 0.25f)
+		return;
+	m_fProfilerUpdate = fNow;
+
+	vtString str;
+	vtProfiler::GetSummary(str, 12);
+	m_pProfilerText->SetText(str);
+
+	const IPoint2 size = vtGetScene()->GetWindowSize();
+	m_pProfilerText->SetPosition(FPoint3(3, (float) size.y - 16, 0));
+}
+
 void Enviro::SetHUDMessageText(const char *message)
 {
 	// The HUD always has a place to put status messages to the user.
@@ -3288,6 +3396,63 @@ void Enviro::CreateSomeTestVehicles(vtTerrain *pTerrain)
 }
 
 
+/**
+ * Put a number of vehicles on the roads of a terrain, driven by a single
+ * traffic simulation engine.
+ */
+void Enviro::CreateTraffic(vtTerrain *pTerrain, int iVehicles)
+{
+	vtRoadMap3d *pRoadMap = pTerrain->GetRoadMap();
+	if (!pRoadMap)
+	{
+		VTLOG1("CreateTraffic: terrain has no roads.\n");
+		return;
+	}
+
+	vtTrafficSimPtr pSim = new vtTrafficSim(pRoadMap, pTerrain->GetHeightField());
+	if (!pSim->HasLanes())
+	{
+		VTLOG1("CreateTraffic: road map has no lanes.\n");
+		return;
+	}
+
+	// Cycle through the four-wheel land vehicles in the content catalog
+	vtStringArray vnames;
+	vtContentManager3d &con = vtGetContent();
+	for (uint i = 0; i < con.NumItems(); i++)
+	{
+		vtItem *item = con.GetItem(i);
+		const char *type = item->GetValueString("type");
+		int wheels = item->GetValueInt("num_wheels");
+		if (type && vtString(type) == "ground vehicle" && wheels == 4)
+			vnames.push_back(item->m_name);
+	}
+	if (vnames.empty())
+	{
+		VTLOG1("CreateTraffic: no four-wheeled ground vehicles in the content.\n");
+		return;
+	}
+
+	clock_t tm = clock();
+	for (int i = 0; i < iVehicles; i++)
+	{
+		RGBf color((i % 5) / 4.0f, ((i / 5) % 5) / 4.0f, ((i / 25) % 5) / 4.0f);
+		Vehicle *car = m_VehicleManager.CreateVehicle(vnames[i % vnames.size()], color);
+		if (!car)
+			continue;
+		pTerrain->addNode(car);
+
+		// Vary the speeds a little, from 80% to 120%
+		pSim->AddVehicle(car, 0.8f + (i % 9) * 0.05f);
+	}
+	VTLOG("CreateTraffic: %d vehicles, %.3f seconds\n", pSim->NumVehicles(),
+		(float)(clock() - tm) / CLOCKS_PER_SEC);
+
+	pSim->setName("Traffic");
+	pTerrain->AddEngine(pSim);
+}
+
+
 ////////////////////////////////////////////////////////////////////////
 // Import
 
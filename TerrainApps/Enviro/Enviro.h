@@ -16,6 +16,7 @@
 #include "vtlib/core/AnimPath.h"
 #include "vtlib/core/Elastic.h"
 #include "vtlib/core/NavEngines.h"
+#include "vtlib/core/TrafficSim.h"
 #include "vtlib/core/Vehicles.h"
 #include "EnviroEnum.h"
 #include "PlantingOptions.h"
@@ -88,6 +89,8 @@ public:
 	bool GetShowElevationLegend();
 	void ShowCompass(bool bShow);
 	bool GetShowCompass();
+	void ShowProfilerOverlay(bool bShow);
+	bool GetShowProfilerOverlay();
 	void ShowMapOverview(bool bShow);
 	bool GetShowMapOverview();
 	void TextureHasChanged();
@@ -225,6 +228,12 @@ public:
 	VehicleManager m_VehicleManager;
 	VehicleSet m_Vehicles;
 
+	// traffic
+	vtTrafficSim *FindTraffic(vtTerrain *pTerrain);
+	void DeselectTraffic();
+	vtTrafficSimPtr m_pSelTraffic;
+	int m_iSelTrafficVehicle;
+
 	// import
 	bool ImportModelFromKML(const char *kmlfile);
 
@@ -243,6 +252,7 @@ public:
 
 	// UI
 	void UpdateCompass();
+	void UpdateProfilerOverlay();
 	void SetHUDMessageText(const char *message);
 	void ShowVerticalLine(bool bShow);
 	bool GetShowVerticalLine();
@@ -306,6 +316,7 @@ public:
 	vtGroup *m_pDemoGroup;
 	vtGeode *m_pDemoTrails;
 	void CreateSomeTestVehicles(vtTerrain *pTerrain);
+	void CreateTraffic(vtTerrain *pTerrain, int iVehicles);
 	void MakeOverlayGlobe(vtImage *image, bool progress_callback(int) = NULL);
 
 protected:
@@ -428,6 +439,10 @@ protected:
 	bool		m_bDragCompass;
 	float		m_fDragAngle;
 
+	vtGeode		*m_pProfilerGeom;
+	vtTextMesh	*m_pProfilerText;
+	float		m_fProfilerUpdate;
+
 	vtMesh		*m_pWindowBoxMesh;
 
 	// mapoverviewengine
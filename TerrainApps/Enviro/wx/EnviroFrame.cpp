@@ -674,10 +674,15 @@ void EnviroFrame::OnChar(wxKeyEvent& event)
 							dyn->SetElevation(ipos.x + x, ipos.y + y, val + 40);
 						}
 
-					// Update the (entire) shading and culture
+					// Update the (entire) shading, and the culture in the
+					//  area around the changed heixels
 					pTerr->ReshadeTexture(vtGetTS()->GetSunLightTransform());
-					DRECT area;
-					area.SetToZero();
+					const DRECT &ext = dyn->GetEarthExtents();
+					const DPoint2 &spacing = dyn->GetSpacing();
+					DRECT area(ext.left + (ipos.x - 5) * spacing.x,
+						ext.bottom + (ipos.y + 4) * spacing.y,
+						ext.left + (ipos.x + 4) * spacing.x,
+						ext.bottom + (ipos.y - 5) * spacing.y);
 					pTerr->RedrapeCulture(area);
 				}
 			}
@@ -1239,7 +1244,7 @@ bool EnviroFrame::LoadTerrainLayer(vtString &fname)
 	bool success = false;
 
 	vtString ext = GetExtension(fname);
-	if (!ext.CompareNoCase(".vtst"))
+	if (!ext.CompareNoCase(".vtst") || !ext.CompareNoCase(".vtsb"))
 	{
 		MakeRelativeToDataPath(fname, "BuildingData");
 
@@ -131,6 +131,8 @@ protected:
 	void OnViewFullscreen(wxCommandEvent& event);
 	void OnViewTopDown(wxCommandEvent& event);
 	void OnViewStats(wxCommandEvent& event);
+	void OnViewProfiler(wxCommandEvent& event);
+	void OnViewProfilerTrace(wxCommandEvent& event);
 	void OnViewElevLegend(wxCommandEvent& event);
 	void OnViewCompass(wxCommandEvent& event);
 	void OnViewMapOverView(wxCommandEvent& event);
@@ -154,6 +156,7 @@ protected:
 	void OnUpdateViewFullscreen(wxUpdateUIEvent& event);
 	void OnUpdateViewTopDown(wxUpdateUIEvent& event);
 	void OnUpdateViewFramerate(wxUpdateUIEvent& event);
+	void OnUpdateViewProfiler(wxUpdateUIEvent& event);
 	void OnUpdateViewElevLegend(wxUpdateUIEvent& event);
 	void OnUpdateViewCompass(wxUpdateUIEvent& event);
 	void OnUpdateViewMapOverView(wxUpdateUIEvent& event);
@@ -15,6 +15,7 @@
 
 #include "vtlib/vtlib.h"
 #include "vtlib/core/Terrain.h"
+#include "vtlib/core/PagedLodGrid.h"
 #include "vtdata/FileFilters.h"
 #include "vtdata/vtLog.h"
 #include "vtui/Helper.h"
@@ -321,10 +322,15 @@ bool EnviroGUI::SaveStructures(bool bAskFilename)
 		wxString default_file(StartOfFilename(fname), wxConvUTF8);
 		wxString default_dir(ExtractPath(fname, false), wxConvUTF8);
 
+		wxString filter = FSTRING_VTST;
+		AddType(filter, FSTRING_VTSB);
+
 		EnableContinuousRendering(false);
 		wxFileDialog saveFile(NULL, _("Save Built Structures Data"),
-			default_dir, default_file, FSTRING_VTST,
+			default_dir, default_file, filter,
 			wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+		if (GetExtension(fname).CompareNoCase(".vtsb") == 0)
+			saveFile.SetFilterIndex(1);
 		bool bResult = (saveFile.ShowModal() == wxID_OK);
 		EnableContinuousRendering(true);
 		if (!bResult)
@@ -336,9 +342,27 @@ bool EnviroGUI::SaveStructures(bool bAskFilename)
 		fname = str.mb_str(wxConvUTF8);
 		st_layer->SetFilename(fname);
 	}
+
+	// A binary layer which is paged might not have read all its blocks yet.
+	//  Read the rest, so that they are not lost from the file.
+	if (st_layer->HasUnreadBlocks())
+	{
+		const uint previous = st_layer->size();
+		st_layer->ReadBinaryBlocks(NULL);
+		vtPagedStructureLodGrid *pGrid = GetCurrentTerrain()->GetStructureLodGrid();
+		if (pGrid)
+		{
+			for (uint i = previous; i < st_layer->size(); i++)
+				pGrid->AppendToGrid(st_layer, i);
+		}
+	}
+
 	bool success = false;
 	try {
-		success = st_layer->WriteXML(fname);
+		if (GetExtension(fname).CompareNoCase(".vtsb") == 0)
+			success = st_layer->WriteBinary(fname);
+		else
+			success = st_layer->WriteXML(fname);
 	}
 	catch (xh_io_exception &e)
 	{
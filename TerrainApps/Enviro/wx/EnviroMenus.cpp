@@ -22,6 +22,7 @@
 #include "vtlib/vtlib.h"
 #include "vtlib/core/Contours.h"
 #include "vtlib/core/Fence3d.h"
+#include "vtlib/core/Profiler.h"
 #include "vtlib/core/SkyDome.h"
 #include "vtlib/vtosg/SaveImageOSG.h"
 
@@ -133,6 +134,9 @@ EVT_UPDATE_UI(ID_VIEW_FULLSCREEN,	EnviroFrame::OnUpdateViewFullscreen)
 EVT_MENU(ID_VIEW_TOPDOWN,			EnviroFrame::OnViewTopDown)
 EVT_UPDATE_UI(ID_VIEW_TOPDOWN,		EnviroFrame::OnUpdateViewTopDown)
 EVT_MENU(ID_VIEW_STATS,				EnviroFrame::OnViewStats)
+EVT_MENU(ID_VIEW_PROFILER,			EnviroFrame::OnViewProfiler)
+EVT_UPDATE_UI(ID_VIEW_PROFILER,		EnviroFrame::OnUpdateViewProfiler)
+EVT_MENU(ID_VIEW_PROFILER_TRACE,	EnviroFrame::OnViewProfilerTrace)
 EVT_MENU(ID_VIEW_ELEV_LEGEND,		EnviroFrame::OnViewElevLegend)
 EVT_UPDATE_UI(ID_VIEW_ELEV_LEGEND,	EnviroFrame::OnUpdateViewElevLegend)
 EVT_MENU(ID_VIEW_COMPASS,			EnviroFrame::OnViewCompass)
@@ -360,6 +364,8 @@ void EnviroFrame::CreateMenus()
 	m_pViewMenu->AppendCheckItem(ID_VIEW_FULLSCREEN, _("Fullscreen\tCtrl+F"));
 	m_pViewMenu->AppendCheckItem(ID_VIEW_TOPDOWN, _("Top-Down Camera\tCtrl+T"));
 	m_pViewMenu->Append(ID_VIEW_STATS, _("Rendering Statistics\tx"));
+	m_pViewMenu->AppendCheckItem(ID_VIEW_PROFILER, _("Profiler Overlay"));
+	m_pViewMenu->Append(ID_VIEW_PROFILER_TRACE, _("Save Profiler Trace..."));
 	m_pViewMenu->AppendCheckItem(ID_VIEW_ELEV_LEGEND, _("Elevation Legend"));
 	m_pViewMenu->AppendCheckItem(ID_VIEW_COMPASS, _("Compass"));
 	m_pViewMenu->AppendCheckItem(ID_VIEW_MAP_OVERVIEW, _("Overview"));
@@ -647,6 +653,31 @@ void EnviroFrame::OnViewStats(wxCommandEvent& event)
 #endif
 }
 
+void EnviroFrame::OnViewProfiler(wxCommandEvent& event)
+{
+	g_App.ShowProfilerOverlay(!g_App.GetShowProfilerOverlay());
+}
+
+void EnviroFrame::OnUpdateViewProfiler(wxUpdateUIEvent& event)
+{
+	event.Check(g_App.GetShowProfilerOverlay());
+}
+
+void EnviroFrame::OnViewProfilerTrace(wxCommandEvent& event)
+{
+	EnableContinuousRendering(false);
+	wxFileDialog saveFile(NULL, _("Save Profiler Trace"), _T(""), _T(""),
+		_("Chrome Trace Files (*.json)|*.json"), wxFD_SAVE);
+	bool bResult = (saveFile.ShowModal() == wxID_OK);
+	EnableContinuousRendering(true);
+	if (!bResult)
+		return;
+
+	vtString fname = (const char*)saveFile.GetPath().mb_str(wxConvUTF8);
+	if (!vtProfiler::WriteChromeTrace(fname))
+		wxMessageBox(_("Couldn't write file."));
+}
+
 void EnviroFrame::OnViewElevLegend(wxCommandEvent& event)
 {
 	g_App.ShowElevationLegend(!g_App.GetShowElevationLegend());
@@ -1715,11 +1746,11 @@ void EnviroFrame::OnTerrainDistribVehicles(wxCommandEvent& event)
 
 	wxString msg;
 	msg.Printf(_("There are %d types of ground vehicle available."), numv);
-	int num = wxGetNumberFromUser(msg, _("Vehicles:"), _("Distribute Vehicles"), 10, 1, 99);
+	int num = wxGetNumberFromUser(msg, _("Vehicles:"), _("Distribute Vehicles"), 10, 1, 20000);
 	if (num == -1)
 		return;
 
-	g_App.CreateSomeTestVehicles(pTerr);
+	g_App.CreateTraffic(pTerr, num);
 }
 
 void EnviroFrame::OnTerrainWriteElevation(wxCommandEvent& event)
@@ -1769,7 +1800,6 @@ void EnviroFrame::OnTerrainWriteElevation(wxCommandEvent& event)
 
 void EnviroFrame::OnTerrainAddContour(wxCommandEvent& event)
 {
-#if SUPPORT_QUIKGRID
 	vtTerrain *pTerr = g_App.GetCurrentTerrain();
 	if (!pTerr)
 		return;
@@ -1826,7 +1856,6 @@ void EnviroFrame::OnTerrainAddContour(wxCommandEvent& event)
 
 	// and show it in the layers dialog
 	m_pLayerDlg->RefreshTreeContents();	// full refresh
-#endif
 }
 
 void EnviroFrame::OnUpdateIsDynTerrain(wxUpdateUIEvent& event)
@@ -33,13 +33,12 @@ void FeatureTableDlg3d::RefreshViz()
 	m_pLayer->RefreshFeatureVisuals();
 }
 
-void FeatureTableDlg3d::OnFeatureDelete(vtFeature *f)
+void FeatureTableDlg3d::OnFeatureDelete(uint iIndex)
 {
-	//vtFeature *f = m_pFeatures->GetFeature(iIndex);
 	if (!m_pLayer)
 		return;
 
-	m_pLayer->DeleteFeature(f);
+	m_pLayer->DeleteFeature(iIndex);
 }
 
 void FeatureTableDlg3d::OnFieldEdited(uint iIndex)
@@ -1040,6 +1040,7 @@ void TParamsDlg::OnListDblClickStructure( wxCommandEvent &event )
 		wxString path(vtGetDataPath()[i], wxConvUTF8);
 		path += _T("BuildingData");
 		AddFilenamesToArray(strings, path, _T("*.vtst*"));
+		AddFilenamesToArray(strings, path, _T("*.vtsb"));
 	}
 
 	wxString result = wxGetSingleChoice(_("One of the following to add:"),
@@ -34,6 +34,8 @@ enum
 	ID_VIEW_FULLSCREEN,
 	ID_VIEW_TOPDOWN,
 	ID_VIEW_STATS,
+	ID_VIEW_PROFILER,
+	ID_VIEW_PROFILER_TRACE,
 	ID_VIEW_ELEV_LEGEND,
 	ID_VIEW_COMPASS,
 	ID_VIEW_MAP_OVERVIEW,
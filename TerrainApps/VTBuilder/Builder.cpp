@@ -18,6 +18,7 @@
 #include "vtdata/DataPath.h"
 #include "vtdata/MaterialDescriptor.h"
 #include <float.h>	// for FLT_MIN
+#include <algorithm>
 
 #include "Builder.h"
 #include "Tin2d.h"
@@ -42,6 +43,10 @@
 #include "SampleImageDlg.h"
 #include "vtui/ProjectionDlg.h"
 
+// Vegetation is generated in square tiles of this many samples on a side,
+//  each of which can be planted on its own thread.
+#define VEG_TILE_SAMPLES	64
+
 /** This singleton contains all the global options for the whole application. */
 vtTagArray g_Options;
 
@@ -323,6 +328,7 @@ Builder::LoadResult Builder::LoadLayer(const wxString &fname_in)
 			delete pEL;
 	}
 	if (ext.CmpNoCase(_T("vtst")) == 0 ||
+		ext.CmpNoCase(_T("vtsb")) == 0 ||
 		fname.Right(8).CmpNoCase(_T(".vtst.gz")) == 0)
 	{
 		bNative = true;
@@ -681,6 +687,7 @@ void Builder::SetOptionDefaults()
 	g_Options.SetValueInt(TAG_MAX_MEM_GRID, 128, true);
 	g_Options.SetValueBool(TAG_DRAW_RAW_SIMPLE, false, true);
 	g_Options.SetValueBool(TAG_DRAW_TIN_SIMPLE, false, true);
+	g_Options.SetValueBool(TAG_LAZY_MIPMAPS, false, true);
 	g_Options.SetValueInt(TAG_GAP_FILL_METHOD, 1, true);	// Fast.
 
 	// status bar options
@@ -1566,6 +1573,115 @@ void Builder::AreaSampleImages(BuilderView *pView)
 //////////////////////////
 // Vegetation ops
 
+// The plants generated in one tile of the area, and the state of the
+//  density accumulators of all the biotypes in that tile.
+struct VegTile
+{
+	std::vector<DPoint2> m_pos;
+	std::vector<float> m_size;
+	std::vector<int> m_density;		// index of the density that was planted
+	std::vector<float> m_amount;	// per density
+	std::vector<float> m_phase;		// per density, starting amount
+	std::vector<int> m_planted;		// per density
+};
+
+/**
+ * Generate the plants in one tile of the sampling grid.  The tile has its
+ * own random number generator and accumulators, so the result depends only
+ * on the tile and the seed, not on which thread or in what order the tiles
+ * are generated.
+ *
+ * \param first_density The index of the first density of each biotype in
+ *		the tile's accumulators, which are the densities of all the
+ *		biotypes, one after another.
+ */
+static void GenerateVegTile(const VegGenOptions &opt, const vtBioRegion &region,
+	const std::vector<uint> &first_density, const DRECT &area,
+	uint i0, uint i1, uint j0, uint j1, uint seed, VegTile &tile)
+{
+	vtRandom rng(seed);
+	uint i, j, k, n;
+
+	// The randomized positions of the samples
+	const uint num = (i1 - i0) * (j1 - j0);
+	std::vector<DPoint2> points(num);
+	n = 0;
+	for (i = i0; i < i1; i++)
+	{
+		for (j = j0; j < j1; j++)
+		{
+			points[n].x = area.left + (i * opt.m_fSampling) + rng.Offset(opt.m_fSampling * 0.5f);
+			points[n].y = area.bottom + (j * opt.m_fSampling) + rng.Offset(opt.m_fSampling * 0.5f);
+			n++;
+		}
+	}
+
+	// Look up the density and the biotype of all the samples at once
+	std::vector<float> density(num, 1.0f);
+	if (opt.m_pDensityLayer)
+		opt.m_pDensityLayer->FindDensities(&points[0], num, &density[0]);
+
+	std::vector<int> biotype(num, opt.m_iSingleBiotype != -1 ? opt.m_iSingleBiotype : 0);
+	if (opt.m_iSingleBiotype == -1 && opt.m_pBiotypeLayer != NULL)
+		opt.m_pBiotypeLayer->FindBiotypes(&points[0], num, &biotype[0]);
+
+	// Start each accumulator at a random phase, so that the tiles don't all
+	//  plant their first plant at the same place.
+	//  The phase is remembered so that the merge can take it back out.
+	const uint num_densities = first_density.back();
+	tile.m_phase.resize(num_densities);
+	tile.m_planted.assign(num_densities, 0);
+	for (k = 0; k < num_densities; k++)
+		tile.m_phase[k] = rng.Unit();
+	tile.m_amount = tile.m_phase;
+
+	const float square_meters = opt.m_fSampling * opt.m_fSampling;
+	for (n = 0; n < num; n++)
+	{
+		if (density[n] <= 0.0f || biotype[n] == -1)
+			continue;
+
+		const vtBioType *bio = region.m_Types[biotype[n]];
+		const uint first = first_density[biotype[n]];
+		const float factor = density[n] * square_meters * opt.m_fScarcity;
+
+		// the amount of each species present accumulates until it
+		//  exceeds 1, at which time we produce a plant instance
+		for (k = 0; k < bio->m_Densities.GetSize(); k++)
+			tile.m_amount[first + k] += (bio->m_Densities[k]->m_plant_per_m2 * factor);
+
+		int planted = -1;
+		for (k = 0; k < bio->m_Densities.GetSize(); k++)
+		{
+			if (tile.m_amount[first + k] > 1.0f)	// time to plant
+			{
+				tile.m_amount[first + k] -= 1.0f;
+				tile.m_planted[first + k]++;
+				planted = first + k;
+				break;
+			}
+		}
+		if (planted == -1)
+			continue;
+
+		// Now determine size
+		float size;
+		if (opt.m_fFixedSize != -1.0f)
+		{
+			size = opt.m_fFixedSize;
+		}
+		else
+		{
+			const vtPlantSpecies *ps = bio->m_Densities[planted - first]->m_pSpecies;
+			float range = opt.m_fRandomTo - opt.m_fRandomFrom;
+			size = (opt.m_fRandomFrom + rng.Random(range)) * ps->GetMaxHeight();
+		}
+		tile.m_pos.push_back(points[n]);
+		tile.m_size.push_back(size);
+		tile.m_density.push_back(planted);
+	}
+}
+
 /**
  * Generate vegetation in a given area, and writes it to a VF file.
  * All options are given in the VegGenOptions object passed in.
@@ -1618,19 +1734,14 @@ void Builder::GenerateVegetationPhase2(const char *vf_file, DRECT area,
 	// Avoid trouble with '.' and ',' in Europe
 	ScopedLocale normal_numbers(LC_NUMERIC, "C");
 
-	uint i, j, k;
-	DPoint2 p, p2;
+	uint i, k;
 
 	uint x_trees = (uint)(area.Width() / opt.m_fSampling);
 	uint y_trees = (uint)(area.Height() / opt.m_fSampling);
 
-	int bio_type=0;
-	float density_scale;
-
 	vtPlantInstanceArray pia;
 	vtPlantDensity *pd;
 	vtBioType *bio;
-	vtPlantSpecies *ps;
 
 	// inherit projection from the main frame
 	vtProjection proj;
@@ -1640,100 +1751,68 @@ void Builder::GenerateVegetationPhase2(const char *vf_file, DRECT area,
 	m_BioRegion.ResetAmounts();
 	pia.SetSpeciesList(&m_SpeciesList);
 
-	// Iterate over the whole area, creating plant instances
-	for (i = 0; i < x_trees; i ++)
+	// Number the densities of all the biotypes, one after another
+	std::vector<uint> first_density;
+	std::vector<vtPlantDensity *> densities;
+	std::vector<short> species_ids;
+	for (i = 0; i < m_BioRegion.m_Types.GetSize(); i++)
 	{
+		first_density.push_back(densities.size());
+		bio = m_BioRegion.m_Types[i];
+		for (k = 0; k < bio->m_Densities.GetSize(); k++)
+		{
+			pd = bio->m_Densities[k];
+			densities.push_back(pd);
+			species_ids.push_back(m_SpeciesList.FindSpeciesId(pd->m_pSpecies));
+		}
+	}
+	first_density.push_back(densities.size());
+
+	// Iterate over the area a column of tiles at a time, generating the
+	//  tiles of each column in parallel, then adding their plants in order.
+	const uint tiles_x = (x_trees + VEG_TILE_SAMPLES - 1) / VEG_TILE_SAMPLES;
+	const uint tiles_y = (y_trees + VEG_TILE_SAMPLES - 1) / VEG_TILE_SAMPLES;
+	std::vector<VegTile> tiles(tiles_y);
+	for (uint tx = 0; tx < tiles_x; tx++)
+	{
+		const uint i0 = tx * VEG_TILE_SAMPLES;
 		wxString str;
-		str.Printf(_("column %d/%d, plants: %d"), i, x_trees, pia.NumEntities());
-		if (UpdateProgressDialog(i * 100 / x_trees, str))
+		str.Printf(_("column %d/%d, plants: %d"), i0, x_trees, pia.NumEntities());
+		if (UpdateProgressDialog(i0 * 100 / x_trees, str))
 		{
 			// user cancel
 			CloseProgressDialog();
 			return;
 		}
+		const uint i1 = std::min(i0 + VEG_TILE_SAMPLES, x_trees);
 
-		p.x = area.left + (i * opt.m_fSampling);
-		for (j = 0; j < y_trees; j ++)
+		int ty;
+#pragma omp parallel for schedule(dynamic, 1)
+		for (ty = 0; ty < (int) tiles_y; ty++)
 		{
-			p.y = area.bottom + (j * opt.m_fSampling);
-
-			// randomize the position slightly
-			p2.x = p.x + random_offset(opt.m_fSampling * 0.5f);
-			p2.y = p.y + random_offset(opt.m_fSampling * 0.5f);
-
-			// Density
-			if (opt.m_pDensityLayer)
-			{
-				density_scale = opt.m_pDensityLayer->FindDensity(p2);
-				if (density_scale <= 0.0f)
-					continue;
-			}
-			else
-				density_scale = 1.0f;
-
-			// Species
-			if (opt.m_iSingleSpecies != -1)
-			{
-				// use our single species biotype
-				bio_type = opt.m_iSingleBiotype;
-			}
-			else
-			{
-				if (opt.m_iSingleBiotype != -1)
-				{
-					bio_type = opt.m_iSingleBiotype;
-				}
-				else if (opt.m_pBiotypeLayer != NULL)
-				{
-					bio_type = opt.m_pBiotypeLayer->FindBiotype(p2);
-					if (bio_type == -1)
-						continue;
-				}
-			}
-			// look at veg_type to decide which BioType to use
-			bio = m_BioRegion.m_Types[bio_type];
-
-			float square_meters = opt.m_fSampling * opt.m_fSampling;
-			float factor = density_scale * square_meters * opt.m_fScarcity;
-
-			// the amount of each species present accumulates until it
-			//  exceeds 1, at which time we produce a plant instance
-			for (k = 0; k < bio->m_Densities.GetSize(); k++)
-			{
-				pd = bio->m_Densities[k];
-
-				pd->m_amount += (pd->m_plant_per_m2 * factor);
-			}
-
-			ps = NULL;
-			for (k = 0; k < bio->m_Densities.GetSize(); k++)
-			{
-				pd = bio->m_Densities[k];
-				if (pd->m_amount > 1.0f)	// time to plant
-				{
-					pd->m_amount -= 1.0f;
-					pd->m_iNumPlanted++;
-					ps = pd->m_pSpecies;
-					break;
-				}
-			}
-			if (ps == NULL)
-				continue;
+			const uint j0 = ty * VEG_TILE_SAMPLES;
+			const uint j1 = std::min(j0 + VEG_TILE_SAMPLES, y_trees);
+			GenerateVegTile(opt, m_BioRegion, first_density, area,
+				i0, i1, j0, j1, tx * tiles_y + ty, tiles[ty]);
+		}
 
-			// Now determine size
-			float size;
-			if (opt.m_fFixedSize != -1.0f)
+		for (ty = 0; ty < (int) tiles_y; ty++)
+		{
+			VegTile &tile = tiles[ty];
+			for (k = 0; k < tile.m_pos.size(); k++)
 			{
-				size = opt.m_fFixedSize;
+				const int d = tile.m_density[k];
+				if (species_ids[d] != -1)
+					pia.AddPlant(tile.m_pos[k], tile.m_size[k], species_ids[d]);
 			}
-			else
+			// Without its starting phase, each tile's leftover amount is
+			//  what it accumulated but did not plant, as in a single pass.
+			for (k = 0; k < densities.size(); k++)
 			{
-				float range = opt.m_fRandomTo - opt.m_fRandomFrom;
-				size = (opt.m_fRandomFrom + random(range)) * ps->GetMaxHeight();
+				densities[k]->m_iNumPlanted += tile.m_planted[k];
+				densities[k]->m_amount += (tile.m_amount[k] - tile.m_phase[k]);
 			}
-
-			// Finally, add the plant
-			pia.AddPlant(p2, size, ps);
+			tile = VegTile();
 		}
 	}
 	pia.WriteVF(vf_file);
@@ -1573,6 +1573,22 @@ bool vtElevLayer::WriteElevationTileset(TilingOptions &opts, BuilderView *pView)
 	bool bFloat = m_pGrid->IsFloatMode();
 	bool bJPEG = (opts.bUseTextureCompression && opts.eCompressionType == TC_JPEG);
 
+	// Keep a manifest of what each tile was built from, so that a later run
+	//  (or a resumed one) only needs to rebuild the tiles which changed.
+	TileHash options_hash;
+	opts.AddToHash(options_hash);
+	options_hash.Add(area);
+	options_hash.Add(bFloat ? 1 : 0);
+	options_hash.Add(g_Options.GetValueInt(TAG_GAP_FILL_METHOD));
+
+	const vtString manifest_fname = TilesetManifest::FilenameFor(opts.fname);
+	TilesetManifest manifest(opts.cols, opts.rows);
+	if (opts.bIncremental)
+		manifest.Read(manifest_fname, options_hash.m_value);
+	manifest.Begin(manifest_fname, options_hash.m_value);
+	const vtString sources = (const char *) GetLayerFilename().mb_str(wxConvUTF8);
+	opts.iTilesSkipped = 0;
+
 	int i, j, lod;
 	int total = opts.rows * opts.cols, done = 0;
 	for (j = 0; j < opts.rows; j++)
@@ -1605,6 +1621,8 @@ bool vtElevLayer::WriteElevationTileset(TilingOptions &opts, BuilderView *pView)
 			bool bAllInvalid = true;
 			bool bAllZero = true;
 			int iNumInvalid = 0;
+			TileHash tile_hash;
+			tile_hash.Add(tile_area);
 			DPoint2 p;
 			int x, y;
 			for (y = base_tilesize; y >= 0; y--)
@@ -1616,6 +1634,7 @@ bool vtElevLayer::WriteElevationTileset(TilingOptions &opts, BuilderView *pView)
 
 					float fvalue = m_pGrid->GetFilteredValue(p);
 					base_lod.SetFValue(x, y, fvalue);
+					tile_hash.Add(fvalue);
 
 					if (fvalue == INVALID_ELEVATION)
 						iNumInvalid++;
@@ -1636,18 +1655,35 @@ bool vtElevLayer::WriteElevationTileset(TilingOptions &opts, BuilderView *pView)
 			// Increment whether we omit or not
 			done++;
 
-			// If there is no real data there, omit this tile
-			if (bAllInvalid)
-				continue;
+			TilesetManifest::Entry entry;
+			entry.m_hash = tile_hash.m_value;
+			entry.m_area = tile_area;
+			entry.m_sources = sources;
 
-			// Omit all-zero tiles (flat sea-level) if desired
-			if (opts.bOmitFlatTiles && bAllZero)
+			// If there is no real data there, omit this tile.  Also omit
+			//  all-zero tiles (flat sea-level) if desired.
+			if (bAllInvalid || (opts.bOmitFlatTiles && bAllZero))
+			{
+				entry.m_bOmitted = true;
+				manifest.Record(col, row, entry);
 				continue;
+			}
 
 			// Now we know this tile will be included, so note the LODs present
 			int base_tile_exponent = vt_log2(base_tilesize);
 			lod_existence_map.set(i, j, base_tile_exponent, base_tile_exponent-(opts.numlods-1));
 
+			// If this tile was already written from exactly the same heixels,
+			//  and its files are still there, we don't need to write it again.
+			if (manifest.IsCurrent(col, row, entry.m_hash) &&
+				vtFileExists(MakeFilenameDB(dirname, col, row, 0)) &&
+				(!opts.bCreateDerivedImages ||
+				 vtFileExists(MakeFilenameDB(dirname_image, col, row, 0))))
+			{
+				opts.iTilesSkipped++;
+				continue;
+			}
+
 			if (iNumInvalid > 0)
 			{
 				UpdateProgressDialog2(done*99/total, 0, _("Filling gaps"));
@@ -1793,8 +1829,13 @@ bool vtElevLayer::WriteElevationTileset(TilingOptions &opts, BuilderView *pView)
 					// what should we do if writing a tile fails?
 				}
 			}
+			// All the LODs of this tile are written
+			manifest.Record(col, row, entry);
 		}
 	}
+	manifest.End();
+	if (opts.iTilesSkipped > 0)
+		VTLOG("Kept %d unchanged tiles from the previous tileset.\n", opts.iTilesSkipped);
 
 	// Write .ini file
 	if (!WriteTilesetHeader(opts.fname, opts.cols, opts.rows, opts.lod0size,
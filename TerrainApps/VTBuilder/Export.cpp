@@ -46,6 +46,17 @@
 #endif
 
 
+// If a previous export left a tileset manifest at the same location, offer
+//  to only rebuild the tiles whose source data has changed.
+static bool AskIncremental(const vtString &fname)
+{
+	if (!vtFileExists(TilesetManifest::FilenameFor(fname)))
+		return false;
+	int res = wxMessageBox(_("A tileset already exists at this location.  Only rebuild the tiles which have changed?"),
+		_("Tiled output"), wxYES_NO);
+	return (res == wxYES);
+}
+
 void Builder::ExportASC()
 {
 	// check spacing
@@ -364,6 +375,7 @@ void Builder::ElevExportTiles(BuilderView *pView)
 		return;
 
 	dlg.GetTilingOptions(tileopts);
+	tileopts.bIncremental = AskIncremental(tileopts.fname);
 
 	// Also write derived image tiles?
 	int res = wxMessageBox(_("Also derive and export color-mapped image tiles?"), _("Tiled output"), wxYES_NO | wxCANCEL);
@@ -404,6 +416,8 @@ void Builder::ElevExportTiles(BuilderView *pView)
 
 	if (tileopts.iNoDataFilled != 0)
 		DisplayAndLog("Filled %d unknown heixels in output tiles.", tileopts.iNoDataFilled);
+	if (tileopts.iTilesSkipped != 0)
+		DisplayAndLog("Kept %d unchanged tiles.", tileopts.iTilesSkipped);
 }
 
 void Builder::ExportBitmap(vtElevLayer *pEL, RenderOptions &ropt)
@@ -530,6 +544,12 @@ void Builder::ImageExportTiles(BuilderView *pView)
 
 	dlg.GetTilingOptions(m_tileopts);
 
+	// An image which has been changed in memory can't be compared with
+	//  what was written previously.
+	m_tileopts.bIncremental = false;
+	if (!pIL->GetModified())
+		m_tileopts.bIncremental = AskIncremental(m_tileopts.fname);
+
 	OpenProgressDialog(_("Writing tiles"),
 		wxString::FromUTF8((const char *) m_tileopts.fname), true);
 
@@ -541,6 +561,9 @@ void Builder::ImageExportTiles(BuilderView *pView)
 		DisplayAndLog("Successfully wrote to '%s'", (const char *) m_tileopts.fname);
 	else
 		DisplayAndLog("Did not successfully write to '%s'", (const char *) m_tileopts.fname);
+
+	if (m_tileopts.iTilesSkipped != 0)
+		DisplayAndLog("Kept %d unchanged tiles.", m_tileopts.iTilesSkipped);
 }
 
 void Builder::ImageExportPPM()
@@ -19,11 +19,11 @@
 
 #include "vtdata/config_vtdata.h"
 #include "vtdata/ChunkLOD.h"
+#include "vtdata/ContourGenerator.h"
 #include "vtdata/DataPath.h"
 #include "vtdata/ElevationGrid.h"
 #include "vtdata/FileFilters.h"
 #include "vtdata/Icosa.h"
-#include "vtdata/QuikGrid.h"
 #include "vtdata/TripDub.h"
 #include "vtdata/Version.h"
 #include "vtdata/vtDIB.h"
@@ -1136,6 +1136,7 @@ void MainFrame::OnLayerOpen(wxCommandEvent &event)
 	AddType(filter, FSTRING_UTL);	// utility towers
 	AddType(filter, FSTRING_VTST);	// structures
 	AddType(filter, FSTRING_VTSTGZ);// compressed structures
+	AddType(filter, FSTRING_VTSB);	// binary structures
 	AddType(filter, FSTRING_VF);	// vegetation files
 	AddType(filter, FSTRING_TIF);	// image files
 	AddType(filter, FSTRING_IMG);	// image or elevation file
@@ -2331,7 +2332,6 @@ void MainFrame::OnElevContours(wxCommandEvent& event)
 	VTLOG("OnElevContours: using grid of size %d x %d, spacing %lf * %lf\n",
 		size.x, size.y, grid->GetSpacing().x, grid->GetSpacing().y);
 
-#if SUPPORT_QUIKGRID
 	ContourDlg dlg(this, -1, _("Add Contours"));
 
 	// Put any existing raw polyline layers in the drop-down choice
@@ -2401,7 +2401,6 @@ void MainFrame::OnElevContours(wxCommandEvent& event)
 	VTLOG(" Removed %d points, done\n", removed);
 
 	m_pView->Refresh();
-#endif // SUPPORT_QUIKGRID
 }
 
 void MainFrame::OnElevCarve(wxCommandEvent &event)
@@ -11,6 +11,7 @@
 #include "wx/wx.h"
 #endif
 
+#include "vtdata/FileFilters.h"
 #include "vtdata/vtLog.h"
 #include "vtui/Helper.h"	// For ProgressDialog
 #include "ImageLayer.h"
@@ -72,14 +73,33 @@ bool vtImageLayer::TransformCoords(vtProjection &proj_new)
 
 		int iSampleN = g_Options.GetValueInt(TAG_SAMPLING_N);
 
-		OpenProgressDialog(_("Converting Image CRS"), _T(""));
-		success = img_new->ConvertProjection(m_pImage, proj_new, iSampleN,
-			progress_callback);
+		// An image which is too large to be in memory is reprojected
+		//  straight to a new file, which then replaces the layer's file.
+		vtString fname_new;
+		if (m_pImage->GetBitmap() == NULL)
+		{
+			fname_new = GetExportFilename(FSTRING_TIF);
+			if (fname_new == "")
+			{
+				delete img_new;
+				return false;
+			}
+		}
+
+		OpenProgressDialog(_("Converting Image CRS"), _T(""), true);
+		if (fname_new != "")
+			success = img_new->ConvertProjectionToFile(m_pImage, proj_new,
+				iSampleN, fname_new, progress_callback);
+		else
+			success = img_new->ConvertProjection(m_pImage, proj_new, iSampleN,
+				progress_callback);
 
 		if (success)
 		{
 			delete m_pImage;
 			m_pImage = img_new;
+			if (fname_new != "")
+				SetLayerFilename(wxString::FromUTF8((const char *) fname_new));
 		}
 		else
 		{
@@ -1,7 +1,7 @@
 //
 // ImportOSM.cpp: The main Builder class of the VTBuilder
 //
-// Copyright (c) 2006-2012 Virtual Terrain Project
+// Copyright (c) 2006-2013 Virtual Terrain Project
 // Free for all uses, see license.txt for details.
 //
 
@@ -13,6 +13,7 @@
 #endif
 
 #include <map>
+#include <algorithm>	// for sort, lower_bound
 
 #include "vtdata/PolyChecker.h"
 #include "vtui/Helper.h"
@@ -29,10 +30,45 @@
 // Visitor class, for XML parsing of an OpenStreetMap file.
 //
 
+// OSM IDs no longer fit in 32 bits.
+typedef long long OSMID;
+
+// Parse an ID, which may be too large for atoi.
+static OSMID ParseOSMID(const char *str)
+{
+	OSMID id = 0;
+	bool negative = (*str == '-');
+	if (negative)
+		str++;
+	for (; *str >= '0' && *str <= '9'; str++)
+		id = id * 10 + (*str - '0');
+	return negative ? -id : id;
+}
+
+static vtString FormatOSMID(OSMID id)
+{
+	char buf[40];
+	sprintf(buf, "%lld", id);
+	return vtString(buf);
+}
+
+// A node is kept in a flat array, sorted by ID.
 struct OSMNode {
+	OSMID id;
 	DPoint2 p;
 	bool signal_lights;
-	vtPole *pole;
+	bool operator<(const OSMNode &other) const { return id < other.id; }
+};
+
+// A way which is a road.  Roads are only made once all the ways have been
+// read, because until then we don't know which of their points are shared
+// with other roads.  The refs of all the roads are in one array.
+struct OSMRoadWay {
+	uint first_ref;
+	uint num_refs;
+	int lanes;
+	int flags;
+	SurfaceType surface;
 };
 
 class VisitorOSM : public XMLVisitor
@@ -42,7 +78,7 @@ public:
 	void startElement(const char *name, const XMLAttributes &atts);
 	void endElement(const char *name);
 	void data(const char *s, int length) {}	// OSM doesn't use actual XML data
-	void SetSignalLights();
+	void MakeRoads();
 
 	vtRoadLayer *m_road_layer;
 	vtStructureLayer *m_struct_layer;
@@ -52,7 +88,11 @@ public:
 	vtLine *m_line;
 
 private:
-	void MakeRoad();
+	const OSMNode *FindNode(OSMID id) const;
+	void SortNodes();
+	bool ResolveRefs(DLine2 &points);
+
+	void AddRoadWay();
 	void MakeStructure();
 	void MakeBuilding();
 	void MakeLinear();
@@ -60,6 +100,7 @@ private:
 	void StartPowerPole();
 	void MakePowerLine();
 	void ParseOSMTag(const vtString &key, const vtString &value);
+	vtUtilityLayer *GetUtilityLayer();
 
 	enum ParseState {
 		PS_NONE,
@@ -67,16 +108,22 @@ private:
 		PS_WAY
 	} m_state;
 
-	typedef std::map<int, OSMNode> NodeMap;
-	NodeMap m_nodes;
-	std::vector<int> m_refs;
+	std::vector<OSMNode> m_nodes;
+	bool m_bNodesSorted;
+	std::vector<OSMID> m_refs;
+
+	std::vector<OSMRoadWay> m_RoadWays;
+	std::vector<OSMID> m_RoadRefs;
+
+	typedef std::map<OSMID, vtPole*> PoleMap;
+	PoleMap m_poles;
 
 	vtProjection m_proj;
 
 	vtString	m_Name, m_URL;
 	LayerType	m_WayType;
 	bool		m_bIsArea;
-	int			m_id;
+	OSMID		m_id;
 
 	int			m_iRoadLanes;
 	int			m_iRoadFlags;
@@ -94,28 +141,60 @@ VisitorOSM::VisitorOSM() : m_state(PS_NONE)
 	m_road_layer = NULL;
 	m_struct_layer = NULL;
 	m_util_layer = NULL;
+	m_bNodesSorted = true;
 
 	// OSM is always in Geo WGS84
 	m_proj.SetWellKnownGeogCS("WGS84");
 }
 
-void VisitorOSM::SetSignalLights()
+const OSMNode *VisitorOSM::FindNode(OSMID id) const
 {
-	// For all the nodes which have signal lights, set the state
-	for (NodeMap::iterator it = m_nodes.begin(); it != m_nodes.end(); it++)
+	OSMNode key;
+	key.id = id;
+	std::vector<OSMNode>::const_iterator it =
+		std::lower_bound(m_nodes.begin(), m_nodes.end(), key);
+	if (it == m_nodes.end() || it->id != id)
+		return NULL;
+	return &(*it);
+}
+
+// OSM files normally list the nodes in order of ID, but don't have to.
+void VisitorOSM::SortNodes()
+{
+	if (!m_bNodesSorted)
 	{
-		OSMNode &node = it->second;
-		if (node.signal_lights)
+		std::sort(m_nodes.begin(), m_nodes.end());
+		m_bNodesSorted = true;
+	}
+}
+
+//
+// Find the positions of the nodes of the current way.  Nodes which aren't in
+// the file (such as those outside an extract) are left out.
+// Returns false if any were missing.
+//
+bool VisitorOSM::ResolveRefs(DLine2 &points)
+{
+	// Nodes may have come after an earlier way, as in osmChange files.
+	SortNodes();
+
+	bool bAll = true;
+	std::vector<OSMID> found;
+	found.reserve(m_refs.size());
+	points.Clear();
+	for (uint r = 0; r < m_refs.size(); r++)
+	{
+		const OSMNode *node = FindNode(m_refs[r]);
+		if (node)
 		{
-			TNode *tnode = m_road_layer->FindNodeByID(it->first);
-			if (tnode)
-			{
-				for (int j = 0; j < tnode->NumLinks(); j++)
-					tnode->SetIntersectType(j, IT_LIGHT);
-			}
+			points.Append(node->p);
+			found.push_back(m_refs[r]);
 		}
+		else
+			bAll = false;
 	}
-	m_road_layer->GuessIntersectionTypes();
+	m_refs.swap(found);
+	return bAll;
 }
 
 void VisitorOSM::startElement(const char *name, const XMLAttributes &atts)
@@ -130,7 +209,7 @@ void VisitorOSM::startElement(const char *name, const XMLAttributes &atts)
 
 			val = atts.getValue("id");
 			if (val)
-				m_id = atoi(val);
+				m_id = ParseOSMID(val);
 			else
 				m_id = -1;	// Shouldn't happen.
 
@@ -143,9 +222,12 @@ void VisitorOSM::startElement(const char *name, const XMLAttributes &atts)
 				p.y = atof(val);
 
 			OSMNode node;
+			node.id = m_id;
 			node.p = p;
 			node.signal_lights = false;
-			m_nodes[m_id] = node;
+			if (!m_nodes.empty() && m_id < m_nodes.back().id)
+				m_bNodesSorted = false;
+			m_nodes.push_back(node);
 
 			m_state = PS_NODE;
 
@@ -153,11 +235,14 @@ void VisitorOSM::startElement(const char *name, const XMLAttributes &atts)
 		}
 		else if (!strcmp(name, "way"))
 		{
+			// The nodes usually come before the ways.
+			SortNodes();
+
 			m_refs.clear();
 			m_state = PS_WAY;
 			val = atts.getValue("id");
 			if (val)
-				m_id = atoi(val);
+				m_id = ParseOSMID(val);
 			else
 				m_id = -1;	// Shouldn't happen.
 
@@ -196,7 +281,7 @@ void VisitorOSM::startElement(const char *name, const XMLAttributes &atts)
 		{
 			if (value == "traffic_signals")
 			{
-				m_nodes[m_nodes.size()-1].signal_lights = true;
+				m_nodes.back().signal_lights = true;
 			}
 		}
 		else if (m_pole)
@@ -212,8 +297,7 @@ void VisitorOSM::startElement(const char *name, const XMLAttributes &atts)
 			val = atts.getValue("ref");
 			if (val)
 			{
-				int ref = atoi(val);
-				m_refs.push_back(ref);
+				m_refs.push_back(ParseOSMID(val));
 			}
 		}
 		else if (!strcmp(name, "tag"))
@@ -245,13 +329,11 @@ void VisitorOSM::endElement(const char *name)
 	else if (m_state == PS_WAY && !strcmp(name, "way"))
 	{
 		// Look at the referenced nodes, turn them into a vt link
-		uint refs = m_refs.size();
-
 		// must have at least 2 refs
 		if (m_refs.size() >= 2)
 		{
 			if (m_WayType == LT_ROAD && !m_bIsArea)	// Areas aren't roads
-				MakeRoad();
+				AddRoadWay();
 			if (m_WayType == LT_STRUCTURE)
 				MakeStructure();
 		}
@@ -525,119 +607,124 @@ void VisitorOSM::ParseOSMTag(const vtString &key, const vtString &value)
 		m_URL = value;
 }
 
-void VisitorOSM::MakeRoad()
+void VisitorOSM::AddRoadWay()
 {
-	if (!m_road_layer)
-	{
-		m_road_layer = new vtRoadLayer;
-		m_road_layer->SetProjection(m_proj);
-	}
+	// Only keep the nodes which are in the file.  Every ref which is kept
+	//  can be found again by MakeRoads, since nodes are never removed.
+	DLine2 points;
+	ResolveRefs(points);
+	if (m_refs.size() < 2)
+		return;
 
-	LinkEdit *link = m_road_layer->AddNewLink();
+	OSMRoadWay way;
+	way.first_ref = (uint) m_RoadRefs.size();
+	way.num_refs = (uint) m_refs.size();
+	way.lanes = m_iRoadLanes;
+	way.flags = m_iRoadFlags;
+	way.surface = m_eSurfaceType;
+	m_RoadWays.push_back(way);
+	m_RoadRefs.insert(m_RoadRefs.end(), m_refs.begin(), m_refs.end());
+}
 
-	link->m_iLanes = m_iRoadLanes;
-	link->m_iFlags = m_iRoadFlags;
-	link->m_Surface = m_eSurfaceType;
+/**
+ * Make the road network from all the road ways.  A node is needed at the ends
+ * of each way, and wherever a way shares a point with another way (or with
+ * itself).  Each way becomes one link between each pair of nodes along it.
+ * Points are matched by their OSM ID.
+ */
+void VisitorOSM::MakeRoads()
+{
+	if (m_RoadWays.empty())
+		return;
 
-	int ref_first = m_refs[0];
-	int ref_last = m_refs[m_refs.size() - 1];
+	// Nodes may have come after the last way.
+	SortNodes();
 
-	// Make nodes at the first and last points.
-	NodeEdit *node0 = (NodeEdit *) m_road_layer->FindNodeByID(ref_first);
-	NodeEdit *node1 = (NodeEdit *) m_road_layer->FindNodeByID(ref_last);
-	if (!node0)
-	{
-		// No node there yet, create it
-		node0 = m_road_layer->AddNewNode();
-		node0->SetPos(m_nodes[ref_first].p);
-		node0->m_id = ref_first;
-	}
-	if (!node1)
+	m_road_layer = new vtRoadLayer;
+	m_road_layer->SetProjection(m_proj);
+
+	// Count how many times each point is used; the ends count twice.
+	std::vector<OSMID> uses;
+	uses.reserve(m_RoadRefs.size() + m_RoadWays.size() * 2);
+	uint w, r;
+	for (w = 0; w < m_RoadWays.size(); w++)
 	{
-		// No node there yet, create it
-		node1 = m_road_layer->AddNewNode();
-		node1->SetPos(m_nodes[ref_last].p);
-		node1->m_id = ref_last;
+		const OSMRoadWay &way = m_RoadWays[w];
+		uses.insert(uses.end(), m_RoadRefs.begin() + way.first_ref,
+			m_RoadRefs.begin() + way.first_ref + way.num_refs);
+		uses.push_back(m_RoadRefs[way.first_ref]);
+		uses.push_back(m_RoadRefs[way.first_ref + way.num_refs - 1]);
 	}
-	link->ConnectNodes(node0, node1);
+	std::sort(uses.begin(), uses.end());
 
-	// Copy all the points
-	for (uint r = 0; r < m_refs.size(); r++)
+	// Points used more than once are nodes
+	std::vector<OSMID> node_ids;
+	for (r = 1; r < uses.size(); r++)
 	{
-		int idx = m_refs[r];
-		link->Append(m_nodes[idx].p);
+		if (uses[r] == uses[r-1] && (node_ids.empty() || node_ids.back() != uses[r]))
+			node_ids.push_back(uses[r]);
 	}
-	link->Dirtied();
+	std::vector<OSMID>().swap(uses);
+	std::vector<NodeEdit*> nodes(node_ids.size(), (NodeEdit*) NULL);
 
-	// If either end of this link shares a node in the middle of another link,
-	// we need to split that link to maintain topology.
-	LinkEdit *next = NULL;
-	for (LinkEdit *it = m_road_layer->GetFirstLink(); it; it = next)
+	for (w = 0; w < m_RoadWays.size(); w++)
 	{
-		next = it->GetNext();
-		if (it == link)
-			continue;	// Don't compare to itself
+		const OSMRoadWay &way = m_RoadWays[w];
+		const OSMID *refs = &m_RoadRefs[way.first_ref];
 
-		// Look in the middle section [1 .. size-1]
-		for (int i = 1; i < (int) it->GetSize() - 1; i++)
+		LinkEdit *link = NULL;
+		NodeEdit *start = NULL;
+		for (r = 0; r < way.num_refs; r++)
 		{
-			// We use matching by exact position, not by id
-			if (it->GetAt(i) == node0->Pos())
+			const OSMNode *pNode = FindNode(refs[r]);
+			if (!pNode)
+				continue;	// Shouldn't happen; AddRoadWay kept only known nodes.
+			const DPoint2 &p = pNode->p;
+			if (link)
+				link->Append(p);
+
+			std::vector<OSMID>::const_iterator it =
+				std::lower_bound(node_ids.begin(), node_ids.end(), refs[r]);
+			if (it == node_ids.end() || *it != refs[r])
+				continue;	// not a node, just a point along the link
+
+			const size_t idx = it - node_ids.begin();
+			if (!nodes[idx])
+			{
+				// No node there yet, create it
+				nodes[idx] = m_road_layer->AddNewNode();
+				nodes[idx]->SetPos(p);
+			}
+			if (link)
 			{
-				// Found one. Split by making two new links.
-				m_road_layer->SplitLinkAtIndex(it, i, node0);
-				break;
+				// Finish the link here
+				link->ConnectNodes(start, nodes[idx]);
+				link->Dirtied();
 			}
-			if (it->GetAt(i) == node1->Pos())
+			if (r < way.num_refs - 1)
 			{
-				// Found one. Split by making two new links.
-				m_road_layer->SplitLinkAtIndex(it, i, node1);
-				break;
+				// Start the next link of this way
+				link = m_road_layer->AddNewLink();
+				link->m_iLanes = way.lanes;
+				link->m_iFlags = way.flags;
+				link->m_Surface = way.surface;
+				link->Append(p);
+				start = nodes[idx];
 			}
 		}
 	}
 
-	bool bMayNeedSplit = true;
-	while (bMayNeedSplit)
+	// For all the nodes which have signal lights, set the state
+	for (uint i = 0; i < node_ids.size(); i++)
 	{
-		bMayNeedSplit = false;
-
-		// Also look for places where a mid-point of this the new link shares a
-		// node with the mid-point of an existing link.
-		for (LinkEdit *it = m_road_layer->GetFirstLink(); it && !bMayNeedSplit; it = next)
+		const OSMNode *node = FindNode(node_ids[i]);
+		if (node && node->signal_lights && nodes[i])
 		{
-			next = it->GetNext();
-			if (it == link)
-				continue;	// Don't compare to itself
-
-			// Look in the middle section [1 .. size-1]
-			for (int i = 1; i < (int) it->GetSize() - 1 && !bMayNeedSplit; i++)
-			{
-				for (int j = 1; j < (int) link->GetSize() - 1 && !bMayNeedSplit; j++)
-				{
-					// We use matching by exact position, not by id
-					if (it->GetAt(i) == link->GetAt(j))
-					{
-						// Found one. Split both links.
-						NodeEdit *node = m_road_layer->AddNewNode();
-						node->SetPos(it->GetAt(i));
-
-						m_road_layer->SplitLinkAtIndex(it, i, node);
-
-						LinkEdit *link1, *link2;
-						m_road_layer->SplitLinkAtIndex(link, j, node, &link1, &link2);
-
-						// We need to continue checking the second part of our
-						// split link for further intersections.
-						link = link2;
-
-						// This will drop us out of all three for loops
-						bMayNeedSplit = true;
-					}
-				}
-			}
+			for (int j = 0; j < nodes[i]->NumLinks(); j++)
+				nodes[i]->SetIntersectType(j, IT_LIGHT);
 		}
 	}
+	m_road_layer->GuessIntersectionTypes();
 }
 
 void VisitorOSM::MakeStructure()
@@ -660,12 +747,12 @@ void VisitorOSM::MakeBuilding()
 	// be the same as the first.  If not, something is wrong.
 	if (m_refs.size() < 4)
 	{
-		VTLOG("Bad building, id %d, only %d nodes\n", m_id, m_refs.size());
+		VTLOG("Bad building, id %lld, only %d nodes\n", m_id, m_refs.size());
 		return;
 	}
 	if (m_refs[0] != m_refs[m_refs.size()-1])
 	{
-		VTLOG("Bad building, id %d, not closed\n", m_id);
+		VTLOG("Bad building, id %lld, not closed\n", m_id);
 		return;
 	}
 
@@ -673,11 +760,11 @@ void VisitorOSM::MakeBuilding()
 	m_refs.erase(m_refs.end() - 1);
 
 	// Apply footprint
-	DLine2 foot(m_refs.size());
-	for (uint r = 0; r < m_refs.size(); r++)
+	DLine2 foot;
+	if (!ResolveRefs(foot))
 	{
-		int idx = m_refs[r];
-		foot[r] = m_nodes[idx].p;
+		VTLOG("Bad building, id %lld, missing nodes\n", m_id);
+		return;
 	}
 	// The order of vertices in OSM does not seem to have a consistent
 	// direction. We use a counter-clockwise convention.
@@ -725,11 +812,7 @@ void VisitorOSM::MakeBuilding()
 	if (m_URL != "")
 		bld->AddTag("url", m_URL);
 	if (m_id != -1)
-	{
-		char id_string[40];
-		sprintf(id_string, "%d", m_id);
-		bld->AddTag("id", id_string);
-	}
+		bld->AddTag("id", FormatOSMID(m_id));
 }
 
 void VisitorOSM::MakeLinear()
@@ -738,29 +821,23 @@ void VisitorOSM::MakeLinear()
 	if (m_refs.size() < 2)
 		return;
 
-	vtFence *ls = m_struct_layer->AddNewFence();
-
 	// Apply footprint
-	DLine2 foot(m_refs.size());
-	for (uint r = 0; r < m_refs.size(); r++)
-	{
-		int idx = m_refs[r];
-		foot[r] = m_nodes[idx].p;
-	}
+	DLine2 foot;
+	ResolveRefs(foot);
+	if (foot.GetSize() < 2)
+		return;
+
+	vtFence *ls = m_struct_layer->AddNewFence();
 	ls->SetFencePoints(foot);
 
 	// Apply style;
 	ls->ApplyStyle(m_eLinearStyle);
 
 	if (m_id != -1)
-	{
-		char id_string[40];
-		sprintf(id_string, "%d", m_id);
-		ls->AddTag("id", id_string);
-	}
+		ls->AddTag("id", FormatOSMID(m_id));
 }
 
-void VisitorOSM::StartPowerPole()
+vtUtilityLayer *VisitorOSM::GetUtilityLayer()
 {
 	if (!m_util_layer)
 	{
@@ -768,43 +845,48 @@ void VisitorOSM::StartPowerPole()
 		m_util_layer->SetProjection(m_proj);
 		m_util_layer->SetModified(true);
 	}
+	return m_util_layer;
+}
 
-	OSMNode &node = m_nodes[m_id];
+void VisitorOSM::StartPowerPole()
+{
+	// The node being read is the last one
+	const OSMNode &node = m_nodes.back();
 
-	m_pole = m_util_layer->AddNewPole();
-	m_pole->m_id = m_id;
+	m_pole = GetUtilityLayer()->AddNewPole();
+	m_pole->m_id = (int) m_id;	// only the low bits fit
 	m_pole->m_p = node.p;
 
-	node.pole = m_pole;
+	m_poles[m_id] = m_pole;
 }
 
 void VisitorOSM::MakePowerLine()
 {
-	m_line = m_util_layer->AddNewLine();
+	DLine2 points;
+	ResolveRefs(points);
 
+	m_line = GetUtilityLayer()->AddNewLine();
 	m_line->m_poles.resize(m_refs.size());
 	for (uint r = 0; r < m_refs.size(); r++)
 	{
-		int idx = m_refs[r];
+		OSMID idx = m_refs[r];
 
 		// Look for that node by id; if we don't find it, then it wasn't a tower;
 		// it was probably a start or end point at a non-tower feature.
-		NodeMap::iterator it = m_nodes.find(m_id);
-		if (it != m_nodes.end())
+		PoleMap::iterator it = m_poles.find(idx);
+		if (it != m_poles.end())
 		{
 			// Connect to a known pole.
-			m_line->m_poles[r] = m_nodes[idx].pole;
+			m_line->m_poles[r] = it->second;
 		}
 		else
 		{
 			// We need to make a new pole node.
-			OSMNode &node = m_nodes[idx];
-
 			m_pole = m_util_layer->AddNewPole();
-			m_pole->m_id = idx;
-			m_pole->m_p = node.p;
+			m_pole->m_id = (int) idx;
+			m_pole->m_p = points[r];
 
-			node.pole = m_pole;
+			m_poles[idx] = m_pole;
 
 			// Then we can connect it
 			m_line->m_poles[r] = m_pole;
@@ -835,11 +917,10 @@ void Builder::ImportDataFromOSM(const wxString &strFileName, LayerArray &layers,
 		return;
 	}
 
+	// Roads are made once all the ways are known
+	visitor.MakeRoads();
 	if (visitor.m_road_layer)
-	{
-		visitor.SetSignalLights();
 		layers.push_back(visitor.m_road_layer);
-	}
 
 	if (visitor.m_struct_layer)
 		layers.push_back(visitor.m_struct_layer);
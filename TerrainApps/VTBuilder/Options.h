@@ -26,6 +26,7 @@
 #define TAG_MAX_MEM_GRID "ElevMaxMemGrid"
 #define TAG_DRAW_RAW_SIMPLE "DrawSimpleRawLayers"
 #define TAG_DRAW_TIN_SIMPLE "DrawSimpleTinLayers"
+#define TAG_LAZY_MIPMAPS "LazyMipMaps"	// build image mipmaps on first use
 
 #define TAG_SLOW_FILL_GAPS "SlowFillGaps"	// deprecated
 #define TAG_GAP_FILL_METHOD "GapFillMethod"		// 1 fast, 2 slow, 3 region-growing
@@ -18,6 +18,8 @@
 
 #include "RoadMapEdit.h"
 #include "assert.h"
+#include <map>
+#include <set>
 
 
 //helper
@@ -55,13 +57,42 @@ void NodeEdit::EnforceLinkEndpoints()
 #define TOLERANCE_METERS (8.0f)
 #define TOLERANCE_DEGREES (TOLERANCE_METERS/110000)
 
+// A node in the grid used by MergeRedundantNodes, with its place in the list
+struct GridNode
+{
+	NodeEdit *m_pNode;
+	int m_iOrder;
+};
+typedef std::pair<int,int> GridCell;
+typedef std::map<GridCell, std::vector<GridNode> > NodeGrid;
+
+static GridCell CellOf(const DPoint2 &p, double cellsize)
+{
+	return GridCell((int) floor(p.x / cellsize), (int) floor(p.y / cellsize));
+}
+
+static void RemoveFromGrid(NodeGrid &grid, const GridCell &cell, NodeEdit *pN)
+{
+	std::vector<GridNode> &nodes = grid[cell];
+	for (uint i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].m_pNode == pN)
+		{
+			nodes.erase(nodes.begin() + i);
+			break;
+		}
+	}
+}
+
 //
 // Since the original data is scattered over many source files,
 // any road which crosses a DLG file boundary will be split
 // by two nodes, one on each edge of the two files.
 //
 // This routine will merge any two nodes which are sufficiently
-// close together.
+// close together.  The nodes are put in a grid with cells the size
+// of the tolerance, so each node only needs to be compared with the
+// nodes in the 3x3 cells around it.
 //
 // Warning: some degerate roads may result.
 //
@@ -74,9 +105,7 @@ int RoadMapEdit::MergeRedundantNodes(bool bDegrees, bool progress_callback(int))
 	int removed = 0;
 
 	int nodes = NumNodes();
-	float total = (float)nodes * nodes / 2;
-	int count1 = 0, count = 0, count_tick, count_last_tick = 0;
-	float tick_size = (float)total / 100;
+	int count = 0, count_tick, count_last_tick = 0;
 	double tolerance, tolerance_squared;
 
 	if (bDegrees)
@@ -85,35 +114,61 @@ int RoadMapEdit::MergeRedundantNodes(bool bDegrees, bool progress_callback(int))
 		tolerance = TOLERANCE_METERS;
 	tolerance_squared = tolerance * tolerance;
 
+	// Put every node in the grid, remembering the order of the list
+	NodeGrid grid;
 	NodeEdit *pN, *pN2;
+	for (pN = GetFirstNode(); pN; pN = pN->GetNext())
+	{
+		GridNode gn = { pN, count++ };
+		grid[CellOf(pN->Pos(), tolerance)].push_back(gn);
+	}
 
+	count = 0;
 	for (pN = GetFirstNode(); pN && pN->GetNext(); pN = next)
 	{
-		count1++;
 		next = pN->GetNext();
-		bool remove = false;
-		for (pN2 = next; pN2; pN2 = pN2->GetNext())
-		{
-			diff = pN2->Pos() - pN->Pos();
-			if (diff.LengthSquared() < tolerance_squared)
+		const GridCell cell = CellOf(pN->Pos(), tolerance);
+
+		// As before, merge with the first later node in the list which is
+		//  close enough.
+		GridNode found = { NULL, nodes };
+		for (int x = cell.first - 1; x <= cell.first + 1; x++)
+			for (int y = cell.second - 1; y <= cell.second + 1; y++)
 			{
-				remove = true;
-				break;
+				NodeGrid::const_iterator it = grid.find(GridCell(x, y));
+				if (it == grid.end())
+					continue;
+				const std::vector<GridNode> &nearby = it->second;
+				for (uint i = 0; i < nearby.size(); i++)
+				{
+					if (nearby[i].m_iOrder <= count || nearby[i].m_iOrder >= found.m_iOrder)
+						continue;
+					diff = nearby[i].m_pNode->Pos() - pN->Pos();
+					if (diff.LengthSquared() < tolerance_squared)
+						found = nearby[i];
+				}
 			}
-		}
-		count += (nodes - count1);
-		count_tick = (int) (count / tick_size);
-		if (count_tick > count_last_tick)
+		count++;
+		count_tick = count * 100 / nodes;
+		if (progress_callback && count_tick > count_last_tick)
 		{
 			count_last_tick = count_tick;
 			progress_callback(count_tick);
 		}
-		if (remove)
+
+		pN2 = found.m_pNode;
+		if (pN2)
 		{
 			// we've got a pair that need to be merged
 			//new point is placed between the 2 original points
+			const GridCell cell2 = CellOf(pN2->Pos(), tolerance);
 			pN2->SetPos((pN2->Pos() + pN->Pos()) / 2.0f);
 
+			// keep the grid up to date
+			RemoveFromGrid(grid, cell, pN);
+			RemoveFromGrid(grid, cell2, pN2);
+			grid[CellOf(pN2->Pos(), tolerance)].push_back(found);
+
 			// we're going to remove the "pN" node
 			// inform any roads which may have referenced it
 			ReplaceNode(pN, pN2);
@@ -132,6 +187,8 @@ int RoadMapEdit::MergeRedundantNodes(bool bDegrees, bool progress_callback(int))
 		else
 			prev = pN;
 	}
+	if (removed)
+		InvalidateIndex();
 	VTLOG(" Removed %i nodes\n", removed);
 	return removed;
 }
@@ -186,6 +243,8 @@ int RoadMapEdit::RemoveDegenerateLinks()
 		else
 			prevL = pL;
 	}
+	if (count)
+		InvalidateIndex();
 	VTLOG(" Removed %i degenerate links.\n", count);
 	return count;
 }
@@ -239,6 +298,7 @@ int RoadMapEdit::CleanLinkPoints(double epsilon)
 			}
 		}
 	}
+	InvalidateIndex();
 	return count;
 }
 
@@ -278,6 +338,8 @@ int RoadMapEdit::DeleteDanglingLinks()
 
 		pR = next;
 	}
+	if (count)
+		InvalidateIndex();
 	return count;
 }
 
@@ -337,8 +399,11 @@ int RoadMapEdit::FixOverlappedLinks(bool bDegrees)
 		fixed++;
 		((LinkEdit*)pR1)->m_fLength = pR1->Length();
 		((LinkEdit*)pR2)->m_fLength = pR2->Length();
-
+		pR1->Dirtied();
+		pR2->Dirtied();
 	}
+	if (fixed)
+		InvalidateIndex();
 	return fixed;
 }
 
@@ -367,6 +432,10 @@ int RoadMapEdit::FixExtraneousParallels()
 	int removed = 0, i, j, roads;
 	LinkEdit *pR1=NULL, *pR2=NULL;
 
+	// Links are detached from their nodes as soon as they are found, but
+	//  taken out of the list of links all at once, at the end.
+	std::set<LinkEdit*> doomed;
+
 	for (NodeEdit *pN = GetFirstNode(); pN && pN->GetNext(); pN = pN->GetNext())
 	{
 		roads = pN->NumLinks();
@@ -405,13 +474,17 @@ int RoadMapEdit::FixExtraneousParallels()
 			if (leads_to[0] == 1 && leads_to[1] > 1)
 			{
 				// delete R1
-				DeleteSingleLink(pR1);
+				pR1->GetNode(0)->DetachLink(pR1);
+				pR1->GetNode(1)->DetachLink(pR1);
+				doomed.insert(pR1);
 				removed++;
 			}
 			else if (leads_to[0] > 1 && leads_to[1] == 1)
 			{
 				// delete R2;
-				DeleteSingleLink(pR2);
+				pR2->GetNode(0)->DetachLink(pR2);
+				pR2->GetNode(1)->DetachLink(pR2);
+				doomed.insert(pR2);
 				removed++;
 			}
 			else
@@ -422,6 +495,8 @@ int RoadMapEdit::FixExtraneousParallels()
 			}
 		}
 	}
+	if (removed)
+		DeleteLinks(doomed);
 	return removed;
 }
 
@@ -118,8 +118,10 @@ bool vtRoadLayer::AppendDataFrom(vtLayer *pL)
 	}
 	pFrom->m_pFirstLink = NULL;
 	pFrom->m_pFirstNode = NULL;
+	pFrom->InvalidateIndex();
 
 	ComputeExtents();
+	InvalidateIndex();
 
 	return true;
 }
@@ -167,6 +169,7 @@ void vtRoadLayer::MoveSelectedNodes(const DPoint2 &offset)
 		if (n->IsSelected())
 			n->Translate(offset);
 	}
+	InvalidateIndex();
 }
 
 bool vtRoadLayer::TransformCoords(vtProjection &proj_new)
@@ -195,6 +198,7 @@ bool vtRoadLayer::TransformCoords(vtProjection &proj_new)
 	SetModified(true);
 
 	m_bValidExtents = false;
+	InvalidateIndex();
 	return true;
 }
 
@@ -256,6 +260,7 @@ void vtRoadLayer::Offset(const DPoint2 &p)
 		r2->Dirtied();
 
 	m_bValidExtents = false;
+	InvalidateIndex();
 }
 
 void vtRoadLayer::GetPropertyText(wxString &strIn)
@@ -360,6 +365,7 @@ void vtRoadLayer::OnLeftUp(BuilderView *pView, UIContext &ui)
 		}
 		// We have changed the layer
 		SetModified(true);
+		InvalidateIndex();
 	}
 	ui.m_iEditingPoint = -1;
 }
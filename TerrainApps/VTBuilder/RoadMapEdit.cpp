@@ -577,6 +577,7 @@ DRECT *RoadMapEdit::DeleteSelected(int &nDeleted)
 			prevLink = tmpLink;
 	}
 	m_bValidExtents = false;
+	InvalidateIndex();
 
 	return array;
 }
@@ -596,8 +597,11 @@ bool RoadMapEdit::SelectLink(const DPoint2 &point, float error, DRECT &bound)
 int RoadMapEdit::SelectLinks(const DRECT &bound, bool bval)
 {
 	int found = 0;
-	for (LinkEdit* curLink = GetFirstLink(); curLink; curLink = curLink->GetNext())
+	std::vector<TLink*> links;
+	GetIndex().FindLinks(bound, links);
+	for (uint i = 0; i < links.size(); i++)
 	{
+		LinkEdit *curLink = (LinkEdit *) links[i];
 		if (curLink->InBounds(bound)) {
 			curLink->Select(bval);
 			found++;
@@ -719,8 +723,11 @@ bool RoadMapEdit::SelectHwyNum(int num)
 bool RoadMapEdit::CrossSelectLinks(DRECT bound, bool bval)
 {
 	bool found = false;
-	for (LinkEdit* curLink = GetFirstLink(); curLink; curLink = curLink->GetNext())
+	std::vector<TLink*> links;
+	GetIndex().FindLinks(bound, links);
+	for (uint i = 0; i < links.size(); i++)
 	{
+		LinkEdit *curLink = (LinkEdit *) links[i];
 		if (curLink->PartiallyInBounds(bound)) {
 			curLink->Select(bval);
 			found = true;
@@ -759,8 +766,11 @@ bool RoadMapEdit::SelectNode(const DPoint2 &point, float epsilon, DRECT &bound)
 int RoadMapEdit::SelectNodes(DRECT bound, bool bval)
 {
 	int found = 0;
-	for (NodeEdit* curNode = GetFirstNode(); curNode; curNode = curNode->GetNext())
+	std::vector<TNode*> nodes;
+	GetIndex().FindNodes(bound, nodes);
+	for (uint i = 0; i < nodes.size(); i++)
 	{
+		NodeEdit *curNode = (NodeEdit *) nodes[i];
 		if (bound.ContainsPoint(curNode->Pos()))
 		{
 			curNode->Select(bval);
@@ -832,8 +842,12 @@ LinkEdit *RoadMapEdit::FindLink(const DPoint2 &point, float error)
 	// A buffer rectangle, to make it easier to click a link.
 	DRECT target(point.x-error, point.y+error, point.x+error, point.y-error);
 
-	for (LinkEdit *curLink = GetFirstLink(); curLink; curLink = curLink->GetNext())
+	// Only look at the links which pass near the target
+	std::vector<TLink*> links;
+	GetIndex().FindLinks(target, links);
+	for (uint i = 0; i < links.size(); i++)
 	{
+		LinkEdit *curLink = (LinkEdit *) links[i];
 		if (curLink->OverlapsExtent(target))
 		{
 			b = curLink->DistanceToPoint(point);
@@ -847,24 +861,27 @@ LinkEdit *RoadMapEdit::FindLink(const DPoint2 &point, float error)
 	return bestSoFar;
 }
 
-void RoadMapEdit::DeleteSingleLink(LinkEdit *pDeleteLink)
+void RoadMapEdit::DeleteLinks(const std::set<LinkEdit*> &links)
 {
-	LinkEdit *prev = NULL;
-	for (LinkEdit *curLink = GetFirstLink(); curLink; curLink = curLink->GetNext())
+	LinkEdit *prev = NULL, *next;
+	for (LinkEdit *curLink = GetFirstLink(); curLink; curLink = next)
 	{
-		if (curLink == pDeleteLink)
+		next = curLink->GetNext();
+		if (links.find(curLink) != links.end())
 		{
 			if (prev)
-				prev->SetNext(curLink->GetNext());
+				prev->SetNext(next);
 			else
-				m_pFirstLink = curLink->GetNext();
+				m_pFirstLink = next;
 			curLink->GetNode(0)->DetachLink(curLink);
 			curLink->GetNode(1)->DetachLink(curLink);
 			delete curLink;
-			return;
 		}
-		prev = curLink;
+		else
+			prev = curLink;
 	}
+	m_bValidExtents = false;
+	InvalidateIndex();
 }
 
 void RoadMapEdit::ReplaceNode(NodeEdit *pN, NodeEdit *pN2)
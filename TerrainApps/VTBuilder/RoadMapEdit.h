@@ -10,6 +10,7 @@
 
 #include "vtdata/RoadMap.h"
 #include "vtdata/Selectable.h"
+#include <set>
 
 class vtScaledView;
 class vtRoadLayer;
@@ -225,8 +226,8 @@ protected:
 	bool AppendFromOGRLayer(OGRLayer *pLayer);
 	void AddLinkFromLineString(OGRLineString *pLineString);
 
-	//delete one road.
-	void DeleteSingleLink(LinkEdit *pLink);
+	//delete a set of roads, in one pass over the list.
+	void DeleteLinks(const std::set<LinkEdit*> &links);
 	//replace a node
 	void ReplaceNode(NodeEdit *pN, NodeEdit *pN2);
 };
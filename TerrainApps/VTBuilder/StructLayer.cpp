@@ -212,6 +212,8 @@ void vtStructureLayer::DrawLinear(wxDC *pDC, vtScaledView *pView, vtFence *fen)
 
 bool vtStructureLayer::OnSave(bool progress_callback(int))
 {
+	if (GetExtension(GetFilename()).CompareNoCase(".vtsb") == 0)
+		return WriteBinary(GetFilename());
 	return WriteXML(GetFilename(), m_bPreferGZip);
 }
 
@@ -232,7 +234,11 @@ bool vtStructureLayer::OnLoad()
 	if (bShowProgress)
 		OpenProgressDialog(_("Loading Structures"), wxString::FromUTF8((const char *) fname), false);
 
-	bool success = ReadXML(fname, progress_callback);
+	bool success;
+	if (GetExtension(fname).CompareNoCase(".vtsb") == 0)
+		success = ReadBinary(fname);
+	else
+		success = ReadXML(fname, progress_callback);
 
 	if (bShowProgress)
 		CloseProgressDialog();
@@ -1106,6 +1112,7 @@ bool vtStructureLayer::AskForSaveFilename()
 {
 	wxString filter = FSTRING_VTST;
 	AddType(filter, FSTRING_VTSTGZ);
+	AddType(filter, FSTRING_VTSB);
 
 	wxFileDialog saveFile(NULL, _("Save Layer"), _T(""), GetLayerFilename(),
 		filter, wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
@@ -1117,10 +1124,13 @@ bool vtStructureLayer::AskForSaveFilename()
 
 	wxString fname = saveFile.GetPath();
 	m_bPreferGZip = (saveFile.GetFilterIndex() == 1);
+	const bool bBinary = (saveFile.GetFilterIndex() == 2);
 
 	// work around incorrect extension(s) that wxFileDialog added
 	RemoveFileExtensions(fname);
-	if (m_bPreferGZip)
+	if (bBinary)
+		fname += _T(".vtsb");
+	else if (m_bPreferGZip)
 		fname += _T(".vtst.gz");
 	else
 		fname += _T(".vtst");
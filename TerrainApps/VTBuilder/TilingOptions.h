@@ -9,6 +9,7 @@
 #define TilingOptions_H
 
 #include "ElevDrawOptions.h"
+#include "minidata/TilesetManifest.h"
 
 enum TextureCompressionType { TC_OPENGL, TC_SQUISH_FAST, TC_SQUISH_SLOW, TC_JPEG };
 
@@ -27,6 +28,8 @@ public:
 		bUseTextureCompression = false;
 		eCompressionType = TC_OPENGL;
 		iNoDataFilled = 0;
+		bIncremental = false;
+		iTilesSkipped = 0;
 		iMinCol = -1;
 		iMaxCol = -1;
 		iMinRow = -1;
@@ -65,6 +68,38 @@ public:
 
 	// after the sampling, will contain the number of NODATA heixels filled in
 	int iNoDataFilled;
+
+	// If true, use the manifest from a previous run to only rebuild the
+	//  tiles whose inputs have changed.
+	bool bIncremental;
+
+	// after writing, will contain the number of tiles which were unchanged
+	int iTilesSkipped;
+
+	// Fingerprint of all the options which affect the content of the tiles
+	void AddToHash(TileHash &hash) const
+	{
+		hash.Add(cols);
+		hash.Add(rows);
+		hash.Add(lod0size);
+		hash.Add(numlods);
+		hash.Add(bCreateDerivedImages ? 1 : 0);
+		hash.Add(bMaskUnknownAreas ? 1 : 0);
+		hash.Add(bImageAlpha ? 1 : 0);
+		hash.Add(bOmitFlatTiles ? 1 : 0);
+		hash.Add(bUseTextureCompression ? 1 : 0);
+		hash.Add((int) eCompressionType);
+		if (bCreateDerivedImages)
+		{
+			hash.Add(draw.m_bShadingQuick ? 1 : 0);
+			hash.Add(draw.m_bShadingDot ? 1 : 0);
+			hash.Add(draw.m_iCastAngle);
+			hash.Add(draw.m_iCastDirection);
+			hash.Add(draw.m_fAmbient);
+			hash.Add(draw.m_fGamma);
+			hash.Add((const char *) draw.m_strColorMapFile);
+		}
+	}
 };
 
 #endif // TilingOptions_H
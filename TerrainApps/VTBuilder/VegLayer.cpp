@@ -582,6 +582,48 @@ int vtVegLayer::FindBiotype(const DPoint2 &p)
 		return -1;
 }
 
+/**
+ * Find the density at a batch of points, which should be close together.
+ * A density of -1 is given for points outside all the polygons.  This does
+ * not change the layer, so it can be called from several threads at once.
+ */
+void vtVegLayer::FindDensities(const DPoint2 *points, uint num, float *result) const
+{
+	const vtFeatureSetPolygon *pset = (const vtFeatureSetPolygon *) m_pSet;
+	int hint = -1;
+	for (uint i = 0; i < num; i++)
+	{
+		int poly = -1;
+		if (m_VLType == VLT_Density)
+			poly = pset->FindPolygon(points[i], hint);
+		if (poly != -1)
+			result[i] = m_pSet->GetFloatValue(poly, m_field_density);
+		else
+			result[i] = -1;
+	}
+}
+
+/**
+ * Find the biotype at a batch of points, which should be close together.
+ * A biotype of -1 is given for points outside all the polygons.  This does
+ * not change the layer, so it can be called from several threads at once.
+ */
+void vtVegLayer::FindBiotypes(const DPoint2 *points, uint num, int *result) const
+{
+	const vtFeatureSetPolygon *pset = (const vtFeatureSetPolygon *) m_pSet;
+	int hint = -1;
+	for (uint i = 0; i < num; i++)
+	{
+		int poly = -1;
+		if (m_VLType == VLT_BioMap)
+			poly = pset->FindPolygon(points[i], hint);
+		if (poly != -1)
+			result[i] = m_pSet->GetIntegerValue(poly, m_field_biotype);
+		else
+			result[i] = -1;
+	}
+}
+
 bool vtVegLayer::ExportToSHP(const char *fname)
 {
 	if (m_VLType != VLT_Instances)
@@ -59,6 +59,8 @@ public:
 	// Search functionality
 	float FindDensity(const DPoint2 &p);
 	int   FindBiotype(const DPoint2 &p);
+	void FindDensities(const DPoint2 *points, uint num, float *result) const;
+	void FindBiotypes(const DPoint2 *points, uint num, int *result) const;
 
 	// Exporting data
 	bool ExportToSHP(const char *fname);
@@ -188,6 +188,24 @@ uint vtBitmap::GetDepth() const
 	return 24;
 }
 
+uchar *vtBitmap::GetRowData(int y)
+{
+#if USE_DIBSECTIONS
+	return m_pScanline + (y * m_iScanlineWidth);
+#else
+	return m_pImage->GetData() + (y * m_pImage->GetWidth() * 3);
+#endif
+}
+
+const uchar *vtBitmap::GetRowData(int y) const
+{
+#if USE_DIBSECTIONS
+	return m_pScanline + (y * m_iScanlineWidth);
+#else
+	return m_pImage->GetData() + (y * m_pImage->GetWidth() * 3);
+#endif
+}
+
 //
 // If we aren't using DIBSections, then we don't have direct access to the
 // image data, so we must copy from the image to the bitmap when we want
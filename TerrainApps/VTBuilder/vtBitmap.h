@@ -46,6 +46,11 @@ public:
 
 	void ContentsChanged();
 
+	// Direct access to the rows of 24-bit pixel data.  The order of the
+	//  bytes in each pixel is platform-dependent (BGR for DIBSections).
+	uchar *GetRowData(int y);
+	const uchar *GetRowData(int y) const;
+
 	bool ReadPNGFromMemory(uchar *buf, int len);
 	bool WriteJPEG(const char *fname, int quality);
 
@@ -432,15 +432,18 @@ void vtImage::DrawToView(wxDC *pDC, vtScaledView *pView)
 	double dRes = 1.0 / pView->GetScale();
 	const DPoint2 spacing = GetSpacing();
 	double spacing_diff = 1E9;
+	int closest = -1;
 	for (uint i = 0; i < m_Bitmaps.size(); i++)
 	{
 		const double d2 = fabs(dRes - m_Bitmaps[i].m_Spacing.x);
-		if (d2 < spacing_diff && m_Bitmaps[i].m_pBitmap)
+		if (d2 < spacing_diff && (m_Bitmaps[i].m_pBitmap || m_Bitmaps[i].m_bPending))
 		{
 			spacing_diff = d2;
-			pBitmap = m_Bitmaps[i].m_pBitmap;
+			closest = i;
 		}
 	}
+	if (closest != -1)
+		pBitmap = GetMipMap(closest);
 
 	if (pBitmap == NULL)
 		bDrawImage = false;
@@ -547,8 +550,13 @@ void vtImage::DrawToView(wxDC *pDC, vtScaledView *pView)
 #endif
 }
 
-bool vtImage::ConvertProjection(vtImage *pOld, vtProjection &NewProj,
-								int iSampleN, bool progress_callback(int))
+/**
+ * Work out the extents and size (preserving approximately the same sampling
+ * rate) of an image which is the result of reprojecting the given image.
+ * The extents are set on this image, and the size is returned.
+ */
+bool vtImage::SetupConvertedExtents(vtImage *pOld, const vtProjection &NewProj,
+									IPoint2 &size)
 {
 	// Create conversion object
 	const vtProjection *pSource, *pDest;
@@ -621,11 +629,26 @@ bool vtImage::ConvertProjection(vtImage *pOld, vtProjection &NewProj,
 	const double fRows = m_Extents.Height() / new_step.y;
 
 	// round up to the nearest integer
-	const IPoint2 size(fColumns + 0.999, fRows + 0.999);
+	size.Set((int) (fColumns + 0.999), (int) (fRows + 0.999));
 
 	// do safety checks
 	if (size.x < 1 || size.y < 1)
 		return false;
+	return true;
+}
+
+bool vtImage::ConvertProjection(vtImage *pOld, vtProjection &NewProj,
+								int iSampleN, bool progress_callback(int))
+{
+	const vtProjection *pSource = &pOld->GetAtProjection();
+	const vtProjection *pDest = &NewProj;
+
+	IPoint2 size;
+	if (!SetupConvertedExtents(pOld, NewProj, size))
+		return false;
+
+	// The whole image is built in memory, so don't let it get too large.
+	//  For larger images, use ConvertProjectionToFile.
 	if (size.x > 40000 || size.y > 40000)
 		return false;
 
@@ -690,6 +713,284 @@ bool vtImage::ConvertProjection(vtImage *pOld, vtProjection &NewProj,
 	return true;
 }
 
+// Helper for ConvertProjectionToFile: a sparse grid of points, in the
+//  source CRS, for a band of output rows.  Values in between the grid nodes
+//  are bilinearly interpolated.
+struct WarpControlGrid
+{
+	int m_step;				// spacing of the grid nodes, in output pixels
+	int m_cols, m_rows;		// number of nodes
+	std::vector<double> m_x, m_y;
+
+	// Interpolate the source location of output pixel coordinate (u, v),
+	//  which are relative to the first row of the band.
+	void Interpolate(double u, double v, DPoint2 &result) const
+	{
+		int ci = (int) (u / m_step);
+		int cj = (int) (v / m_step);
+		if (ci < 0) ci = 0;
+		if (cj < 0) cj = 0;
+		if (ci > m_cols-2) ci = m_cols-2;
+		if (cj > m_rows-2) cj = m_rows-2;
+		const double fu = u / m_step - ci;
+		const double fv = v / m_step - cj;
+		const int n = cj * m_cols + ci;
+		result.x = (1-fv) * ((1-fu) * m_x[n] + fu * m_x[n+1]) +
+			fv * ((1-fu) * m_x[n+m_cols] + fu * m_x[n+m_cols+1]);
+		result.y = (1-fv) * ((1-fu) * m_y[n] + fu * m_y[n+1]) +
+			fv * ((1-fu) * m_y[n+m_cols] + fu * m_y[n+m_cols+1]);
+	}
+};
+
+/**
+ * Reproject a (possibly very large) image straight to a GeoTIFF file,
+ * without ever holding the whole input or output image in memory.
+ *
+ * The output is produced in bands of rows.  For each band, the inverse
+ * transformation is only computed exactly on a sparse grid of control
+ * points, which is refined until bilinear interpolation between the points
+ * is within 1/8 of a source pixel.  The source rows which the band touches
+ * are read through the image's LineBufferGDAL (or directly from memory),
+ * then the rows of the band are sampled in parallel and written to disk.
+ *
+ * On success, this image is loaded (out-of-core) from the new file.
+ */
+bool vtImage::ConvertProjectionToFile(vtImage *pOld, vtProjection &NewProj,
+	int iSampleN, const char *fname, bool progress_callback(int))
+{
+	const vtProjection *pSource = &pOld->GetAtProjection();
+	const vtProjection *pDest = &NewProj;
+
+	IPoint2 size;
+	if (!SetupConvertedExtents(pOld, NewProj, size))
+		return false;
+
+	// Transformation points backwards, from the target to the source
+	ScopedOCTransform trans_back(CreateCoordTransform(pDest, pSource));
+	if (!trans_back)
+		return false;
+
+	// The source is sampled from its base level, either in memory or on disk
+	const BitmapInfo &src = pOld->m_Bitmaps[0];
+	if (!src.m_pBitmap && !src.m_bOnDisk)
+		return false;
+	const IPoint2 &src_size = src.m_Size;
+	const DPoint2 &src_spacing = src.m_Spacing;
+	const DRECT &src_ext = pOld->m_Extents;
+
+	GDALDriverManager *pManager = GetGDALDriverManager();
+	GDALDriver *pDriver = pManager ? pManager->GetDriverByName("GTiff") : NULL;
+	if (!pDriver)
+		return false;
+
+	char **papszOptions = NULL;
+	papszOptions = CSLSetNameValue(papszOptions, "TILED", "YES");
+	papszOptions = CSLSetNameValue(papszOptions, "BIGTIFF", "IF_SAFER");
+	papszOptions = CSLSetNameValue(papszOptions, "ALPHA", "YES");
+	if (g_Options.GetValueBool(TAG_TIFF_COMPRESS))
+		papszOptions = CSLSetNameValue(papszOptions, "COMPRESS", "DEFLATE");
+
+	vtString fname_local = UTF8ToLocal(fname);
+	GDALDataset *pDataset = pDriver->Create(fname_local, size.x, size.y, 4,
+		GDT_Byte, papszOptions);
+	CSLDestroy(papszOptions);
+	if (!pDataset)
+		return false;
+
+	const DPoint2 step(m_Extents.Width() / size.x, m_Extents.Height() / size.y);
+	double adfGeoTransform[6] = { m_Extents.left, step.x, 0, m_Extents.top, 0, -step.y };
+	pDataset->SetGeoTransform(adfGeoTransform);
+
+	char *pszSRS_WKT = NULL;
+	NewProj.exportToWkt(&pszSRS_WKT);
+	pDataset->SetProjection(pszSRS_WKT);
+	CPLFree(pszSRS_WKT);
+
+	// Multisample offsets, in output pixels
+	DLine2 offsets;
+	MakeSampleOffsets(DPoint2(1, 1), iSampleN, offsets);
+	const int num_offsets = offsets.GetSize();
+
+	const int band_rows = 64;
+	const double tolerance = 0.125;	// in source pixels
+	uchar *band = new uchar[size.x * band_rows * 4];
+
+	// Rows of the source needed by the current band, if out of core
+	RGBAi *window = NULL;
+	int window_y0 = 0, window_rows = 0, window_alloc = 0;
+
+	WarpControlGrid grid;
+	std::vector<double> cx, cy;
+	clock_t tm1 = clock();
+	bool bOK = true;
+
+	for (int y0 = 0; y0 < size.y && bOK; y0 += band_rows)
+	{
+		const int rows = (y0 + band_rows > size.y) ? size.y - y0 : band_rows;
+
+		if (progress_callback != NULL && progress_callback(y0 * 99 / size.y))
+		{
+			bOK = false;	// user cancelled
+			break;
+		}
+
+		// Build the control grid for this band, refining until it is
+		//  accurate enough.
+		for (grid.m_step = 32; ; grid.m_step /= 2)
+		{
+			grid.m_cols = (size.x + grid.m_step - 1) / grid.m_step + 1;
+			grid.m_rows = (rows + grid.m_step - 1) / grid.m_step + 1;
+			const int nodes = grid.m_cols * grid.m_rows;
+			grid.m_x.resize(nodes);
+			grid.m_y.resize(nodes);
+			for (int j = 0; j < grid.m_rows; j++)
+				for (int i = 0; i < grid.m_cols; i++)
+				{
+					grid.m_x[j*grid.m_cols+i] = m_Extents.left + (i * grid.m_step) * step.x;
+					grid.m_y[j*grid.m_cols+i] = m_Extents.top - (y0 + j * grid.m_step) * step.y;
+				}
+			trans_back->Transform(nodes, &grid.m_x[0], &grid.m_y[0]);
+
+			if (grid.m_step == 1)
+				break;
+
+			// Check the error at the center of each grid cell
+			const int cells = (grid.m_cols-1) * (grid.m_rows-1);
+			cx.resize(cells);
+			cy.resize(cells);
+			for (int j = 0; j < grid.m_rows-1; j++)
+				for (int i = 0; i < grid.m_cols-1; i++)
+				{
+					cx[j*(grid.m_cols-1)+i] = m_Extents.left + ((i + 0.5) * grid.m_step) * step.x;
+					cy[j*(grid.m_cols-1)+i] = m_Extents.top - (y0 + (j + 0.5) * grid.m_step) * step.y;
+				}
+			trans_back->Transform(cells, &cx[0], &cy[0]);
+
+			double max_error = 0;
+			DPoint2 interp;
+			for (int j = 0; j < grid.m_rows-1; j++)
+				for (int i = 0; i < grid.m_cols-1; i++)
+				{
+					grid.Interpolate((i + 0.5) * grid.m_step, (j + 0.5) * grid.m_step, interp);
+					const int n = j*(grid.m_cols-1)+i;
+					double err = fabs(interp.x - cx[n]) / src_spacing.x;
+					if (err > max_error) max_error = err;
+					err = fabs(interp.y - cy[n]) / src_spacing.y;
+					if (err > max_error) max_error = err;
+				}
+			if (max_error <= tolerance)
+				break;
+		}
+
+		// If the source is on disk, read the range of source rows which
+		//  this band touches, one scanline at a time.
+		if (!src.m_pBitmap)
+		{
+			double vmin = 1E9, vmax = -1E9;
+			for (uint n = 0; n < grid.m_y.size(); n++)
+			{
+				const double v = (src_ext.top - grid.m_y[n]) / src_spacing.y;
+				if (v < vmin) vmin = v;
+				if (v > vmax) vmax = v;
+			}
+			// allow for multisampling and interpolation
+			const double margin = 2 + (step.y / src_spacing.y);
+			int ya = (int) (vmin - margin), yb = (int) (vmax + margin);
+			if (ya < 0) ya = 0;
+			if (yb > src_size.y-1) yb = src_size.y-1;
+
+			window_y0 = ya;
+			window_rows = (yb >= ya) ? yb - ya + 1 : 0;
+			if (window_rows * src_size.x > window_alloc)
+			{
+				delete [] window;
+				window_alloc = window_rows * src_size.x;
+				window = new RGBAi[window_alloc];
+			}
+			for (int r = 0; r < window_rows; r++)
+			{
+				RGBAi *data = pOld->m_linebuf.GetScanlineFromBuffer(window_y0 + r, 0);
+				memcpy(window + r * src_size.x, data, src_size.x * sizeof(RGBAi));
+			}
+		}
+
+		// Now warp each row of the band.  Rows are independent, and the
+		//  source is only read, so they can be done in parallel.
+		int r;
+#pragma omp parallel for schedule(dynamic, 4)
+		for (r = 0; r < rows; r++)
+		{
+			DPoint2 mp;
+			RGBAi value, sum;
+			RGBi rgb;
+			uchar *dst = band + r * size.x * 4;
+			for (int i = 0; i < size.x; i++)
+			{
+				int count = 0;
+				sum.Set(0,0,0,0);
+				for (int k = 0; k < num_offsets; k++)
+				{
+					// Sample at pixel centers
+					grid.Interpolate(i + 0.5 + offsets[k].x, r + 0.5 + offsets[k].y, mp);
+
+					double u = (mp.x - src_ext.left) / src_spacing.x;
+					double v = (src_ext.top - mp.y) / src_spacing.y;
+					if (u < 0 || u >= src_size.x || v < 0 || v >= src_size.y)
+						continue;
+					const int ix = (int) u, iy = (int) v;
+					if (src.m_pBitmap)
+					{
+						src.m_pBitmap->GetPixel24(ix, iy, rgb);
+						value = rgb;
+					}
+					else if (iy >= window_y0 && iy < window_y0 + window_rows)
+						value = window[(iy - window_y0) * src_size.x + ix];
+					else
+						continue;
+
+					if (bTreatBlackAsTransparent && value == RGBAi(0,0,0,255))
+						continue;
+					sum += value;
+					count++;
+				}
+				if (count > 0)
+				{
+					sum /= count;
+					*dst++ = sum.r;
+					*dst++ = sum.g;
+					*dst++ = sum.b;
+					*dst++ = 255;
+				}
+				else
+				{
+					// nodata
+					*dst++ = 0; *dst++ = 0; *dst++ = 0; *dst++ = 0;
+				}
+			}
+		}
+
+		// Write the band, pixel-interleaved
+		if (pDataset->RasterIO(GF_Write, 0, y0, size.x, rows, band, size.x,
+			rows, GDT_Byte, 4, NULL, 4, size.x * 4, 1) != CE_None)
+			bOK = false;
+	}
+	delete [] band;
+	delete [] window;
+	GDALClose(pDataset);
+
+	VTLOG("ConvertProjectionToFile: %d x %d pixels in %.2f seconds.\n",
+		size.x, size.y, (float) (clock() - tm1) / CLOCKS_PER_SEC);
+
+	if (!bOK)
+	{
+		vtDeleteFile(fname);
+		return false;
+	}
+
+	// Now open the result, out of core
+	return LoadFromGDAL(fname);
+}
+
 void vtImage::GetProjection(vtProjection &proj) const
 {
 	proj = m_proj;
@@ -858,7 +1159,8 @@ void vtImage::GetRGBA(int x, int y, RGBAi &rgba, double dRes)
 		for (int i = 0; i < (int)m_Bitmaps.size(); i++)
 		{
 			// if it is available
-			if (m_Bitmaps[i].m_pBitmap || m_Bitmaps[i].m_bOnDisk)
+			if (m_Bitmaps[i].m_pBitmap || m_Bitmaps[i].m_bOnDisk ||
+				m_Bitmaps[i].m_bPending)
 			{
 				double spc = (m_Bitmaps[i].m_Spacing.x + m_Bitmaps[i].m_Spacing.y)/2.0;
 				double rel_spc = fabs(dRes - spc);
@@ -887,6 +1189,8 @@ void vtImage::GetRGBA(int x, int y, RGBAi &rgba, double dRes)
 	}
 
 	const BitmapInfo &bm = m_Bitmaps[closest_bitmap];
+	if (bm.m_bPending)
+		GetMipMap(closest_bitmap);
 	if (bm.m_pBitmap)
 	{
 		// get pixel from bitmap in memory
@@ -984,8 +1288,11 @@ void vtImage::DrawMipMaps()
 	vtBitmap *big = m_Bitmaps[0].m_pBitmap;
 	for (size_t m = 1; m < m_Bitmaps.size(); m++)
 	{
+		progress_callback((int) ((m-1) * 99 / (m_Bitmaps.size()-1)));
+
 		vtBitmap *smaller = m_Bitmaps[m].m_pBitmap;
 		SampleMipLevel(big, smaller);
+		m_Bitmaps[m].m_bPending = false;
 		big = smaller;
 	}
 }
@@ -996,7 +1303,54 @@ void vtImage::FreeMipMaps()
 	{
 		delete m_Bitmaps[m].m_pBitmap;
 		m_Bitmaps[m].m_pBitmap = NULL;
+		m_Bitmaps[m].m_bPending = false;
+	}
+}
+
+/**
+ * Rather than building all the mipmaps up front, mark them as pending so
+ * that each level is only built (by GetMipMap) when it is first needed, for
+ * example when zooming out.
+ */
+void vtImage::DeferMipMaps()
+{
+	if (m_Bitmaps.size() == 0 || m_Bitmaps[0].m_pBitmap == NULL)
+		return;
+	for (size_t m = 1; m < m_Bitmaps.size(); m++)
+	{
+		if (!m_Bitmaps[m].m_pBitmap)
+			m_Bitmaps[m].m_bPending = true;
+	}
+}
+
+/**
+ * Get the in-memory bitmap for a mipmap level, building it (and any
+ * pending levels above it) if it was deferred.  Not thread-safe.
+ *
+ * \return The bitmap, or NULL if the level isn't in memory.
+ */
+vtBitmap *vtImage::GetMipMap(int level)
+{
+	BitmapInfo &bmi = m_Bitmaps[level];
+	if (bmi.m_pBitmap || !bmi.m_bPending || level == 0)
+		return bmi.m_pBitmap;
+
+	vtBitmap *bigger = GetMipMap(level - 1);
+	if (!bigger)
+		return NULL;
+
+	VTLOG("Building mipmap level %d (%d x %d)\n", level, bmi.m_Size.x, bmi.m_Size.y);
+	vtBitmap *bm = new vtBitmap;
+	if (!bm->Allocate(bmi.m_Size, bigger->GetDepth()))
+	{
+		delete bm;
+		bmi.m_bPending = false;
+		return NULL;
 	}
+	SampleMipLevel(bigger, bm);
+	bmi.m_pBitmap = bm;
+	bmi.m_bPending = false;
+	return bm;
 }
 
 bool vtImage::ReadPPM(const char *fname, bool progress_callback(int))
@@ -1329,6 +1683,7 @@ bool vtImage::LoadFromGDAL(const char *fname)
 
 	// GDAL doesn't yet support utf-8 or wide filenames, so convert
 	vtString fname_local = UTF8ToLocal(fname);
+	m_strFilename = fname;
 
 	try
 	{
@@ -1479,6 +1834,9 @@ bool vtImage::LoadFromGDAL(const char *fname)
 				}
 				pBitmap->ContentsChanged();
 				m_Bitmaps[0].m_pBitmap = pBitmap;
+
+				if (g_Options.GetValueBool(TAG_LAZY_MIPMAPS))
+					DeferMipMaps();
 			}
 		}
 	}
@@ -1862,6 +2220,28 @@ bool vtImage::WriteTileset(TilingOptions &opts, BuilderView *pView)
 			GDALSetCacheMax(need_cache_bytes);
 	}
 
+	// Keep a manifest of what each tile was built from, so that a later run
+	//  (or a resumed one) only needs to rebuild the tiles which changed.
+	//  Sampling the image is the expensive part, so rather than hashing the
+	//  texels, we fingerprint the source file.
+	TileHash options_hash;
+	opts.AddToHash(options_hash);
+	options_hash.Add(area);
+	options_hash.Add(g_Options.GetValueInt(TAG_SAMPLING_N));
+
+	TileHash source_hash;
+	source_hash.Add((const char *) m_strFilename);
+	source_hash.Add(GetFileSize(m_strFilename));
+	source_hash.Add((double) GetFileModTime(m_strFilename));
+	source_hash.Add(m_Extents);
+
+	const vtString manifest_fname = TilesetManifest::FilenameFor(opts.fname);
+	TilesetManifest manifest(opts.cols, opts.rows);
+	if (opts.bIncremental && m_strFilename != "")
+		manifest.Read(manifest_fname, options_hash.m_value);
+	manifest.Begin(manifest_fname, options_hash.m_value);
+	opts.iTilesSkipped = 0;
+
 	int i, j, lod;
 	m_iTotal = opts.rows * opts.cols * opts.numlods;
 	m_iCompleted = 0;
@@ -1891,14 +2271,36 @@ bool vtImage::WriteTileset(TilingOptions &opts, BuilderView *pView)
 			int base_tile_exponent = vt_log2(base_tilesize);
 			lod_existence_map.set(i, j, base_tile_exponent, base_tile_exponent-(opts.numlods-1));
 
+			TilesetManifest::Entry entry;
+			TileHash tile_hash = source_hash;
+			tile_hash.Add(tile_area);
+			entry.m_hash = tile_hash.m_value;
+			entry.m_area = tile_area;
+			entry.m_sources = m_strFilename;
+
+			// Skip tiles which were already written from the same source
+			if (manifest.IsCurrent(col, row, entry.m_hash) &&
+				vtFileExists(MakeFilenameDB(dirname, col, row, 0)))
+			{
+				opts.iTilesSkipped++;
+				m_iCompleted += opts.numlods;
+				continue;
+			}
+
 			for (lod = 0; lod < opts.numlods && !bCancelled; lod++)
 			{
 				if (!WriteTile(opts, pView, dirname, tile_area, tile_dim,
 					col, row, lod))
 					bCancelled = true;
 			}
+			// Only a tile with all its LODs is considered finished
+			if (!bCancelled)
+				manifest.Record(col, row, entry);
 		}
 	}
+	manifest.End();
+	if (opts.iTilesSkipped > 0)
+		VTLOG("Kept %d unchanged tiles from the previous tileset.\n", opts.iTilesSkipped);
 	if (bCancelled)
 		wxMessageBox(_("Cancelled."));
 	else
@@ -2019,34 +2421,31 @@ bool vtImage::WriteTile(const TilingOptions &opts, BuilderView *pView, vtString
 	return true;
 }
 
-void SampleMipLevel(vtBitmap *bigger, vtBitmap *smaller)
+/**
+ * Make a mipmap level by averaging each 2x2 block of pixels of the level
+ * above.  This works directly on the rows of pixel data, rather than pixel
+ * by pixel, and the rows are split between threads.
+ */
+void SampleMipLevel(const vtBitmap *bigger, vtBitmap *smaller)
 {
-	const IPoint2 size = bigger->GetSize();
-
-	const int xsmall = size.x / 2;
-	const int ysmall = size.y / 2;
+	const IPoint2 size = smaller->GetSize();
 
-	RGBi rgb, sum;
-
-	for (int y = 0; y < ysmall; y++)
+	int y;
+#pragma omp parallel for schedule(static)
+	for (y = 0; y < size.y; y++)
 	{
-		if ((y%32)==0)
-			progress_callback(y * 99 / ysmall);
+		const uchar *src0 = bigger->GetRowData(y*2);
+		const uchar *src1 = bigger->GetRowData(y*2+1);
+		uchar *dst = smaller->GetRowData(y);
 
-		for (int x = 0; x < xsmall; x++)
+		// Each output byte is the rounded average of the matching bytes of
+		//  the four pixels in the block.
+		for (int x = 0; x < size.x; x++, src0 += 6, src1 += 6, dst += 3)
 		{
-			sum.Set(0,0,0);
-
-			bigger->GetPixel24(x*2, y*2, rgb);
-			sum += rgb;
-			bigger->GetPixel24(x*2+1, y*2, rgb);
-			sum += rgb;
-			bigger->GetPixel24(x*2, y*2+1, rgb);
-			sum += rgb;
-			bigger->GetPixel24(x*2, y*2, rgb);
-			sum += rgb;
-
-			smaller->SetPixel24(x, y, sum/4);
+			dst[0] = (uchar) ((src0[0] + src0[3] + src1[0] + src1[3] + 2) >> 2);
+			dst[1] = (uchar) ((src0[1] + src0[4] + src1[1] + src1[4] + 2) >> 2);
+			dst[2] = (uchar) ((src0[2] + src0[5] + src1[2] + src1[5] + 2) >> 2);
 		}
 	}
+	smaller->ContentsChanged();
 }
@@ -73,11 +73,12 @@ public:
 class BitmapInfo
 {
 public:
-	BitmapInfo() { m_pBitmap = NULL; m_bOnDisk = false; }
+	BitmapInfo() { m_pBitmap = NULL; m_bOnDisk = false; m_bPending = false; }
 
 	int number;				// 0, 1, 2..
 	vtBitmap *m_pBitmap;	// non-NULL if in memory
 	bool m_bOnDisk;		// true if GDAL overview exists on disk
+	bool m_bPending;	// true if mipmap will be built in memory on first use
 	IPoint2 m_Size;			// size in pixels
 	DPoint2 m_Spacing;		// spatial resolution in earth units/pixel
 };
@@ -97,6 +98,9 @@ public:
 	void DrawToView(wxDC *pDC, vtScaledView *pView);
 	bool ConvertProjection(vtImage *input, vtProjection &proj_new,
 						   int iSampleN, bool progress_callback(int) = NULL);
+	bool ConvertProjectionToFile(vtImage *input, vtProjection &proj_new,
+						   int iSampleN, const char *fname,
+						   bool progress_callback(int) = NULL);
 
 	DPoint2 GetSpacing(int bitmap = 0) const;
 	vtBitmap *GetBitmap() {
@@ -156,9 +160,13 @@ public:
 	void AllocMipMaps();
 	void DrawMipMaps();
 	void FreeMipMaps();
+	void DeferMipMaps();
+	vtBitmap *GetMipMap(int level);
 
 protected:
 	void SetDefaults();
+	bool SetupConvertedExtents(vtImage *pOld, const vtProjection &NewProj,
+		IPoint2 &size);
 	void CleanupGDALUsage();
 
 	vtProjection	m_proj;
@@ -167,6 +175,9 @@ protected:
 
 	std::vector<BitmapInfo> m_Bitmaps;
 
+	// The file this image was loaded from, if any
+	vtString m_strFilename;
+
 	// Used during writing of tilesets
 	int m_iTotal, m_iCompleted;
 	ImageGLCanvas *m_pCanvas;
@@ -175,6 +186,6 @@ protected:
 // Helpers
 bool GetBitDepthUsingGDAL(const char *fname, int &depth_in_bits, GDALDataType &eType);
 void MakeSampleOffsets(const DPoint2 cellsize, uint N, DLine2 &offsets);
-void SampleMipLevel(vtBitmap *bigger, vtBitmap *smaller);
+void SampleMipLevel(const vtBitmap *bigger, vtBitmap *smaller);
 
 #endif	// VTIMAGE_H
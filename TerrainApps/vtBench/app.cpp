@@ -0,0 +1,478 @@
+//
+// Name:     app.cpp
+// Purpose:  Headless benchmark for terrain creation and rendering.
+//
+// Builds a terrain from its .xml parameters, then renders a fixed number of
+// frames along a camera path, into an offscreen pbuffer.  The time of each
+// terrain creation step and the statistics of each frame are written to a
+// JSON file, so that results can be compared between builds.
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "vtlib/vtlib.h"
+
+#include <osgViewer/Viewer>
+#include <algorithm>
+
+#include "vtlib/core/AnimPath.h"
+#include "vtlib/core/Profiler.h"
+#include "vtlib/core/Terrain.h"
+#include "vtlib/core/TerrainScene.h"
+#include "vtdata/DataPath.h"
+#include "vtdata/FilePath.h"
+#include "vtdata/vtLog.h"
+
+#if WIN32
+#include <windows.h>
+#include <psapi.h>
+#elif __linux__
+#include <unistd.h>
+#endif
+
+struct BenchOptions
+{
+	BenchOptions()
+	{
+		iWidth = 1280;
+		iHeight = 720;
+		iFrames = 600;
+		iWarmup = 30;
+		bWindow = false;
+		strOutput = "vtbench.json";
+	}
+	vtString strTerrain;
+	vtString strPath;
+	vtString strOutput;
+	vtString strTrace;
+	int iWidth, iHeight;
+	int iFrames;
+	int iWarmup;
+	bool bWindow;
+};
+
+struct FrameResult
+{
+	double fTime;		// position along the camera path
+	double fFrame;		// all in milliseconds
+	double fUpdate;
+	double fCull;
+	double fDraw;
+	double fTriangles;
+	double fVertices;
+	double fMemory;		// megabytes
+};
+
+static void Usage()
+{
+	printf("Usage: vtBench [options] terrain.xml\n");
+	printf("  -frames N       Number of frames to measure (default 600)\n");
+	printf("  -warmup N       Frames to render before measuring (default 30)\n");
+	printf("  -size W H       Size of the rendering (default 1280 720)\n");
+	printf("  -path file      Camera path (.vtap) to fly, instead of an orbit\n");
+	printf("  -out file       Results file (default vtbench.json)\n");
+	printf("  -trace file     Also write a profiler trace, in Chrome format\n");
+	printf("  -window         Render to a window instead of a pbuffer\n");
+}
+
+static bool ParseArgs(int argc, char **argv, BenchOptions &opt)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		vtString arg = argv[i];
+		bool bMore = (i + 1 < argc);
+		if (arg == "-frames" && bMore)
+			opt.iFrames = atoi(argv[++i]);
+		else if (arg == "-warmup" && bMore)
+			opt.iWarmup = atoi(argv[++i]);
+		else if (arg == "-size" && i + 2 < argc)
+		{
+			opt.iWidth = atoi(argv[++i]);
+			opt.iHeight = atoi(argv[++i]);
+		}
+		else if (arg == "-path" && bMore)
+			opt.strPath = argv[++i];
+		else if (arg == "-out" && bMore)
+			opt.strOutput = argv[++i];
+		else if (arg == "-trace" && bMore)
+			opt.strTrace = argv[++i];
+		else if (arg == "-window")
+			opt.bWindow = true;
+		else if (arg[0] == '-')
+			return false;
+		else
+			opt.strTerrain = arg;
+	}
+	return (opt.strTerrain != "" && opt.iFrames > 0 && opt.iWarmup >= 0 &&
+		opt.iWidth > 0 && opt.iHeight > 0);
+}
+
+/**
+ * Resident memory of this process, in megabytes, or 0 if it is not known
+ * on this platform.
+ */
+static double GetMemoryUsage()
+{
+#if WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return pmc.WorkingSetSize / (1024.0 * 1024.0);
+#elif __linux__
+	FILE *fp = fopen("/proc/self/statm", "r");
+	if (fp)
+	{
+		long size, resident;
+		int count = fscanf(fp, "%ld %ld", &size, &resident);
+		fclose(fp);
+		if (count == 2)
+			return (double) resident * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+	}
+#endif
+	return 0;
+}
+
+/**
+ * Make the graphics context to render into.  Unless asked for a window, we
+ * try for an offscreen pbuffer so that the benchmark can run without a
+ * desktop, and so that window placement and vsync don't affect it.
+ */
+static bool SetupContext(osgViewer::Viewer *viewer, const BenchOptions &opt)
+{
+	osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits;
+	traits->x = 0;
+	traits->y = 0;
+	traits->width = opt.iWidth;
+	traits->height = opt.iHeight;
+	traits->red = 8;
+	traits->green = 8;
+	traits->blue = 8;
+	traits->alpha = 8;
+	traits->depth = 24;
+	traits->windowDecoration = opt.bWindow;
+	traits->doubleBuffer = opt.bWindow;
+	traits->vsync = false;
+	traits->pbuffer = !opt.bWindow;
+
+	osg::ref_ptr<osg::GraphicsContext> gc = osg::GraphicsContext::createGraphicsContext(traits.get());
+	if (!gc.valid())
+	{
+		printf("Couldn't create a %s graphics context.\n", opt.bWindow ? "window" : "pbuffer");
+		return false;
+	}
+	osg::Camera *camera = viewer->getCamera();
+	camera->setGraphicsContext(gc.get());
+	camera->setViewport(new osg::Viewport(0, 0, opt.iWidth, opt.iHeight));
+	GLenum buffer = traits->doubleBuffer ? GL_BACK : GL_FRONT;
+	camera->setDrawBuffer(buffer);
+	camera->setReadBuffer(buffer);
+
+	// Measure the cost of each frame on its own
+	viewer->setThreadingModel(osgViewer::Viewer::SingleThreaded);
+	viewer->realize();
+
+	vtGetScene()->SetGraphicsContext(gc.get());
+	vtGetScene()->SetWindowSize(opt.iWidth, opt.iHeight);
+	return true;
+}
+
+/**
+ * If no camera path is given, orbit the center of the terrain at a height
+ * above its highest point, looking at the center.
+ */
+static vtAnimPath *MakeOrbitPath(vtTerrain *pTerr)
+{
+	vtHeightField3d *hf = pTerr->GetHeightField();
+	FPoint3 center;
+	hf->GetCenter(center);
+	float fMin, fMax;
+	hf->GetHeightExtents(fMin, fMax);
+	hf->FindAltitudeAtPoint(center, center.y);
+
+	const FRECT &ext = hf->m_WorldExtents;
+	const float fRadius = std::min(fabs(ext.Width()), fabs(ext.Height())) * 0.35f;
+	const float fHeight = fMax + fRadius * 0.15f;
+
+	vtAnimPath *path = new vtAnimPath;
+	const int iPoints = 16;
+	for (int i = 0; i <= iPoints; i++)
+	{
+		const float a = PI2f * i / iPoints;
+		FPoint3 pos(center.x + cosf(a) * fRadius, fHeight, center.z + sinf(a) * fRadius);
+		path->Insert(i, ControlPoint(pos));
+	}
+	path->SetInterpMode(vtAnimPath::CUBIC_SPLINE);
+	path->ProcessPoints();
+	return path;
+}
+
+static void PlaceCamera(vtCamera *pCamera, vtAnimPath *path, bool bOrbit,
+						double fTime, const FPoint3 &center)
+{
+	FMatrix4 mat;
+	if (!path->GetMatrix(fTime, mat, bOrbit))
+		return;
+	if (bOrbit)
+	{
+		pCamera->SetTrans(mat.GetTrans());
+		pCamera->PointTowards(center);
+	}
+	else
+		pCamera->SetTransform(mat);
+}
+
+static double GetStat(osg::Stats *stats, uint frame, const char *name)
+{
+	double value = 0;
+	if (stats)
+		stats->getAttribute(frame, name, value);
+	return value;
+}
+
+static double Average(const std::vector<FrameResult> &frames, double FrameResult::*member)
+{
+	if (frames.empty())
+		return 0;
+	double sum = 0;
+	for (size_t i = 0; i < frames.size(); i++)
+		sum += frames[i].*member;
+	return sum / frames.size();
+}
+
+static double Percentile(std::vector<double> values, double fraction)
+{
+	if (values.empty())
+		return 0;
+	std::sort(values.begin(), values.end());
+	size_t i = (size_t) (fraction * (values.size() - 1) + 0.5);
+	return values[i];
+}
+
+static vtString JsonString(const char *str)
+{
+	vtString result = "\"";
+	for (const char *c = str; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			result += '\\';
+		result += *c;
+	}
+	result += "\"";
+	return result;
+}
+
+static bool WriteResults(const BenchOptions &opt, vtTerrainScene *ts,
+						 float fBuildTime, double fBuildMemory,
+						 const std::vector<FrameResult> &frames)
+{
+	FILE *fp = vtFileOpen(opt.strOutput, "wb");
+	if (!fp)
+		return false;
+
+	std::vector<double> times(frames.size());
+	double fPeakMemory = fBuildMemory;
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		times[i] = frames[i].fFrame;
+		if (frames[i].fMemory > fPeakMemory)
+			fPeakMemory = frames[i].fMemory;
+	}
+	const double fAvgFrame = Average(frames, &FrameResult::fFrame);
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "\t\"terrain\": %s,\n", (const char *) JsonString(opt.strTerrain));
+	fprintf(fp, "\t\"camera_path\": %s,\n", (const char *)
+		JsonString(opt.strPath == "" ? "orbit" : (const char *) opt.strPath));
+	fprintf(fp, "\t\"width\": %d,\n\t\"height\": %d,\n", opt.iWidth, opt.iHeight);
+	fprintf(fp, "\t\"offscreen\": %s,\n", opt.bWindow ? "false" : "true");
+	fprintf(fp, "\t\"warmup_frames\": %d,\n", opt.iWarmup);
+
+	fprintf(fp, "\t\"build\": {\n");
+	fprintf(fp, "\t\t\"total_s\": %.4f,\n", fBuildTime);
+	fprintf(fp, "\t\t\"steps_s\": [");
+	for (int i = 1; i <= NUM_CREATE_STEPS; i++)
+		fprintf(fp, "%s%.4f", i == 1 ? "" : ", ", ts->GetCreateStepTime(i));
+	fprintf(fp, "],\n");
+	fprintf(fp, "\t\t\"memory_mb\": %.1f\n", fBuildMemory);
+	fprintf(fp, "\t},\n");
+
+	fprintf(fp, "\t\"summary\": {\n");
+	fprintf(fp, "\t\t\"frames\": %d,\n", (int) frames.size());
+	fprintf(fp, "\t\t\"frame_avg_ms\": %.3f,\n", fAvgFrame);
+	fprintf(fp, "\t\t\"frame_p50_ms\": %.3f,\n", Percentile(times, 0.5));
+	fprintf(fp, "\t\t\"frame_p95_ms\": %.3f,\n", Percentile(times, 0.95));
+	fprintf(fp, "\t\t\"frame_max_ms\": %.3f,\n", Percentile(times, 1.0));
+	fprintf(fp, "\t\t\"fps\": %.2f,\n", fAvgFrame > 0 ? 1000.0 / fAvgFrame : 0.0);
+	fprintf(fp, "\t\t\"update_avg_ms\": %.3f,\n", Average(frames, &FrameResult::fUpdate));
+	fprintf(fp, "\t\t\"cull_avg_ms\": %.3f,\n", Average(frames, &FrameResult::fCull));
+	fprintf(fp, "\t\t\"draw_avg_ms\": %.3f,\n", Average(frames, &FrameResult::fDraw));
+	fprintf(fp, "\t\t\"triangles_avg\": %.0f,\n", Average(frames, &FrameResult::fTriangles));
+	fprintf(fp, "\t\t\"memory_peak_mb\": %.1f\n", fPeakMemory);
+	fprintf(fp, "\t},\n");
+
+	fprintf(fp, "\t\"frames\": [\n");
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		const FrameResult &f = frames[i];
+		fprintf(fp, "\t\t{\"t\": %.3f, \"frame_ms\": %.3f, \"update_ms\": %.3f, "
+			"\"cull_ms\": %.3f, \"draw_ms\": %.3f, \"triangles\": %.0f, "
+			"\"vertices\": %.0f, \"memory_mb\": %.1f}%s\n",
+			f.fTime, f.fFrame, f.fUpdate, f.fCull, f.fDraw, f.fTriangles,
+			f.fVertices, f.fMemory, i + 1 < frames.size() ? "," : "");
+	}
+	fprintf(fp, "\t]\n");
+	fprintf(fp, "}\n");
+	fclose(fp);
+	return true;
+}
+
+int main(int argc, char ** argv)
+{
+	BenchOptions opt;
+	if (!ParseArgs(argc, argv, opt))
+	{
+		Usage();
+		return 1;
+	}
+
+	VTSTARTLOG("debug.txt");
+	VTLOG1("vtBench\n");
+
+	vtScene *pScene = vtGetScene();
+	pScene->Init(argc, argv);
+	osgViewer::Viewer *viewer = pScene->getViewer();
+	if (!SetupContext(viewer, opt))
+		return 1;
+
+	vtCamera *pCamera = pScene->GetCamera();
+	pCamera->SetHither(10);
+	pCamera->SetYon(100000);
+
+	vtStringArray paths;
+	paths.push_back(vtString("../../../Data/"));
+	paths.push_back(vtString("../../Data/"));
+	paths.push_back(vtString("../Data/"));
+	paths.push_back(vtString("Data/"));
+	vtSetDataPath(paths);
+
+	vtString pfile = opt.strTerrain;
+	if (!vtFileExists(pfile))
+		pfile = FindFileOnPaths(vtGetDataPath(), "Terrains/" + opt.strTerrain);
+	if (pfile == "")
+	{
+		printf("Couldn't find terrain parameters %s\n", (const char *) opt.strTerrain);
+		return 1;
+	}
+
+	vtTerrainScene *ts = new vtTerrainScene;
+	pScene->SetRoot(ts->BeginTerrainScene());
+
+	vtTerrain *pTerr = new vtTerrain;
+	pTerr->SetParamFile(pfile);
+	if (!pTerr->LoadParams())
+	{
+		printf("Couldn't read terrain parameters %s\n", (const char *) pfile);
+		return 1;
+	}
+
+	printf("Building terrain %s\n", (const char *) pfile);
+	ts->AppendTerrain(pTerr);
+	osg::Timer_t start = osg::Timer::instance()->tick();
+	if (!ts->BuildTerrain(pTerr))
+	{
+		printf("Terrain creation failed: %s\n", (const char *) pTerr->GetLastError());
+		return 1;
+	}
+	ts->SetCurrentTerrain(pTerr);
+	const float fBuildTime = (float) osg::Timer::instance()->delta_s(start,
+		osg::Timer::instance()->tick());
+	const double fBuildMemory = GetMemoryUsage();
+	printf("Built in %.3f seconds, %.1f MB\n", fBuildTime, fBuildMemory);
+
+	// The camera path
+	vtAnimPathPtr path;
+	const bool bOrbit = (opt.strPath == "");
+	if (bOrbit)
+		path = MakeOrbitPath(pTerr);
+	else
+	{
+		path = new vtAnimPath;
+		if (!path->SetProjection(pTerr->GetProjection(), pTerr->GetLocalCS()) ||
+			!path->Read(opt.strPath) || path->IsEmpty())
+		{
+			printf("Couldn't read camera path %s\n", (const char *) opt.strPath);
+			return 1;
+		}
+	}
+	FPoint3 center;
+	pTerr->GetHeightField()->GetCenter(center);
+	pTerr->GetHeightField()->FindAltitudeAtPoint(center, center.y);
+
+	// Ask OSG to collect the statistics we want
+	osg::Stats *viewerStats = viewer->getViewerStats();
+	osg::Stats *cameraStats = viewer->getCamera()->getStats();
+	if (viewerStats)
+		viewerStats->collectStats("update", true);
+	if (cameraStats)
+	{
+		cameraStats->collectStats("rendering", true);
+		cameraStats->collectStats("scene", true);
+	}
+	if (opt.strTrace != "")
+		vtProfiler::SetEnabled(true);
+
+	// The path is sampled at even steps, rather than in real time, so that
+	//  each run draws exactly the same frames.
+	const double fFirst = path->GetFirstTime();
+	const double fPeriod = path->GetPeriod();
+	const int iTotal = opt.iWarmup + opt.iFrames;
+	std::vector<FrameResult> frames;
+	frames.reserve(opt.iFrames);
+
+	printf("Rendering %d frames..\n", opt.iFrames);
+	for (int i = 0; i < iTotal && !viewer->done(); i++)
+	{
+		const int iMeasured = i - opt.iWarmup;
+		const double fTime = fFirst + (iMeasured < 0 ? 0 :
+			fPeriod * iMeasured / std::max(opt.iFrames - 1, 1));
+		PlaceCamera(pCamera, path, bOrbit, fTime, center);
+
+		osg::Timer_t t0 = osg::Timer::instance()->tick();
+		pScene->DoUpdate();
+		osg::Timer_t t1 = osg::Timer::instance()->tick();
+		if (iMeasured < 0)
+			continue;
+
+		const uint fn = viewer->getFrameStamp()->getFrameNumber();
+		FrameResult f;
+		f.fTime = fTime;
+		f.fFrame = osg::Timer::instance()->delta_m(t0, t1);
+		f.fUpdate = GetStat(viewerStats, fn, "Update traversal time taken") * 1000;
+		f.fCull = GetStat(cameraStats, fn, "Cull traversal time taken") * 1000;
+		f.fDraw = GetStat(cameraStats, fn, "Draw traversal time taken") * 1000;
+		f.fTriangles = GetStat(cameraStats, fn, "Visible number of GL_TRIANGLES") +
+			GetStat(cameraStats, fn, "Visible number of GL_TRIANGLE_STRIP") +
+			GetStat(cameraStats, fn, "Visible number of GL_TRIANGLE_FAN") +
+			GetStat(cameraStats, fn, "Visible number of GL_QUADS") * 2;
+		f.fVertices = GetStat(cameraStats, fn, "Visible vertex count");
+		f.fMemory = GetMemoryUsage();
+		frames.push_back(f);
+	}
+
+	if (!WriteResults(opt, ts, fBuildTime, fBuildMemory, frames))
+		printf("Couldn't write results to %s\n", (const char *) opt.strOutput);
+	else
+		printf("Average frame %.3f ms over %d frames, results in %s\n",
+			Average(frames, &FrameResult::fFrame), (int) frames.size(),
+			(const char *) opt.strOutput);
+
+	if (opt.strTrace != "" && !vtProfiler::WriteChromeTrace(opt.strTrace))
+		printf("Couldn't write trace to %s\n", (const char *) opt.strTrace);
+
+	path = NULL;
+	ts->CleanupScene();
+	delete ts;
+	pScene->Shutdown();
+
+	return 0;
+}
@@ -11,6 +11,9 @@
 #include "vtlib/core/GeomUtil.h"
 #include "vtlib/vtosg/OSGEventHandler.h"
 #include "vtlib/vtosg/MultiTexture.h"
+#include "vtlib/core/Terrain.h"
+#include "vtlib/core/Structure3d.h"
+#include "vtdata/ElevationGrid.h"
 #include "vtdata/vtLog.h"
 
 class Orbit : public vtEngine
@@ -41,12 +44,28 @@ protected:
 	~Orbit() {}
 };
 
+// A terrain which is only a heightfield, for the buildings of the benchmark
+//  to stand on.
+class BenchTerrain : public vtTerrain
+{
+public:
+	void SetHeightField(vtHeightField3d *pHF) { m_pHeightField = pHF; }
+};
+
 class App : public vtEngine
 {
 public:
-	App() { m_pCamera = NULL; }
+	App()
+	{
+		m_pCamera = NULL;
+		m_pBenchTerrain = NULL;
+		m_pBenchStructures = NULL;
+		m_iBenchFrames = 0;
+		m_fBenchTime = 0.0f;
+	}
 
 	int main(int argc, char **argv);
+	void Eval();
 
 	bool CreateScene();
 	void OnKey(int key, int flags);
@@ -78,6 +97,7 @@ public:
 	void MakeTest8();
 	void MakeTest9();
 	void MakeTest10();
+	void MakeTest11();
 
 public:
 	vtScene *m_pScene;
@@ -102,6 +122,12 @@ public:
 	// Collections of nodes into individual tests
 	std::vector<vtGroup*> m_Test;
 
+	// The buildings of the geometry benchmark, and its frame timing
+	BenchTerrain *m_pBenchTerrain;
+	vtStructureArray3d *m_pBenchStructures;
+	int m_iBenchFrames;
+	float m_fBenchTime;
+
 	// Engines
 	vtTrackball *m_tball;
 	Orbit *orbit;
@@ -119,6 +145,10 @@ public:
 // 5. a LOD object
 // 6. many LOD objects
 // 7. Shader
+// 8. Single texture
+// 9. Single texture, using TexGen
+// 10. Two textures
+// 11. Geometry benchmark: a large set of buildings
 
 //
 // Create the 3d scene: prepare for user interaction.
@@ -199,6 +229,7 @@ bool App::CreateScene()
 	MakeTest8();
 	MakeTest9();
 	MakeTest10();
+	MakeTest11();
 
 	SetTest(0);
 
@@ -451,11 +482,89 @@ void App::MakeTest10()
 	grp->addChild(ball5);
 }
 
+void App::MakeTest11()
+{
+	// Test 11: Geometry benchmark, a grid of buildings, constructed by
+	//  vtBuilding3d on a flat heightfield, as they would be on a terrain.
+	vtGroup *grp = MakeTestGroup(11);
+
+	const int grid = 80;
+	const double spacing = 12.0;	// meters
+	const double size = grid * spacing;
+
+	vtProjection proj;
+	proj.SetProjectionSimple(true, 1, EPSG_DATUM_WGS84);
+	vtElevationGrid *pFlat = new vtElevationGrid(DRECT(0, size, size, 0),
+		IPoint2(2, 2), true, proj);
+	pFlat->FillWithSingleValue(0.0f);
+	pFlat->SetupLocalCS();
+	m_pBenchTerrain = new BenchTerrain;
+	m_pBenchTerrain->SetHeightField(pFlat);
+
+	vtStructure3d::InitializeMaterialArrays();
+	m_pBenchStructures = new vtStructureArray3d;
+	m_pBenchStructures->m_proj = proj;
+	m_pBenchStructures->SetTerrain(m_pBenchTerrain);
+	for (int i = 0; i < grid; i++)
+	for (int j = 0; j < grid; j++)
+	{
+		vtBuilding *bld = m_pBenchStructures->AddNewBuilding();
+		bld->SetRectangle(DPoint2((i + 0.5) * spacing, (j + 0.5) * spacing),
+			8.0f, 6.0f + (i + j) % 3);
+		bld->SetNumStories(1 + (i*7 + j*13) % 8);
+		for (uint k = 0; k < bld->NumLevels(); k++)
+			bld->GetLevel(k)->SetEdgeMaterial(BMAT_NAME_PLAIN);
+		bld->SetColor(BLD_BASIC, RGBi(200, 190 - 10 * (i % 4), 170));
+		bld->SetRoofType((i + j) % 2 ? ROOF_HIP : ROOF_FLAT);
+		bld->SetColor(BLD_ROOF, RGBi(120, 60, 50));
+	}
+
+	// Scale the buildings down to the size of the reference grid
+	const float scale = 20.0f / (float) size;
+	vtTransform *pScale = new vtTransform;
+	pScale->Scale(scale);
+	pScale->SetTrans(FPoint3(-0.5f * size * scale, -1.0f, 0.5f * size * scale));
+	grp->addChild(pScale);
+
+	const int num = (int) m_pBenchStructures->size();
+	int built = 0, verts = 0, prims = 0;
+	osg::Timer_t start = osg::Timer::instance()->tick();
+	for (int i = 0; i < num; i++)
+	{
+		if (m_pBenchStructures->ConstructStructure(i))
+			built++;
+	}
+	double ms = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+
+	for (int i = 0; i < num; i++)
+	{
+		vtStructure3d *str3d = m_pBenchStructures->GetStructure3d(i);
+		if (!str3d->GetContainer())
+			continue;
+		pScale->addChild(str3d->GetContainer());
+
+		vtGeode *geode = str3d->GetGeom();
+		for (uint k = 0; geode && k < geode->NumMeshes(); k++)
+		{
+			vtMesh *mesh = geode->GetMesh(k);
+			if (!mesh)
+				continue;
+			verts += mesh->NumVertices();
+			prims += mesh->NumPrims();
+		}
+	}
+	VTLOG("Test 11: built %d of %d buildings (%d vertices, %d primitives) in %.1f ms\n",
+		built, num, verts, prims, ms);
+}
+
 void App::SetTest(int test)
 {
 	m_iTest = test;
 	VTLOG("Test %d\n", test);
 
+	m_iBenchFrames = 0;
+	m_fBenchTime = 0.0f;
+
 	for (size_t i = 0; i < m_Test.size(); i++)
 		m_Test[i]->SetEnabled(i == test);
 
@@ -487,6 +596,25 @@ void App::SetTest(int test)
 	}
 }
 
+void App::Eval()
+{
+	if (m_iTest != 11)
+		return;
+
+	// Report the average time to draw a frame of the geometry benchmark,
+	//  skipping the first frames, during which the buffers are compiled.
+	m_iBenchFrames++;
+	if (m_iBenchFrames <= 10)
+		return;
+	m_fBenchTime += vtGetFrameTime();
+	if (m_iBenchFrames == 210)
+	{
+		VTLOG("Test 11: average frame time %.2f ms\n", m_fBenchTime / 200 * 1000);
+		m_iBenchFrames = 10;
+		m_fBenchTime = 0.0f;
+	}
+}
+
 void App::OnKey(int key, int flags)
 {
 	m_iTest++;
@@ -0,0 +1,205 @@
+//
+// TilesetManifest.cpp
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "TilesetManifest.h"
+#include "vtdata/FilePath.h"
+#include "vtdata/vtLog.h"
+
+#define MANIFEST_VERSION	1
+
+// Hashes are written as two 32-bit halves, to avoid depending on printf
+//  support for 64-bit integers.
+static void SplitHash(unsigned long long hash, uint &hi, uint &lo)
+{
+	hi = (uint) (hash >> 32);
+	lo = (uint) (hash & 0xffffffff);
+}
+
+static unsigned long long JoinHash(uint hi, uint lo)
+{
+	return (((unsigned long long) hi) << 32) | lo;
+}
+
+TilesetManifest::TilesetManifest(int cols, int rows)
+{
+	m_cols = cols;
+	m_rows = rows;
+	m_options_hash = 0;
+	m_entries.resize(cols * rows);
+	m_fp = NULL;
+}
+
+TilesetManifest::~TilesetManifest()
+{
+	End();
+}
+
+/**
+ * The manifest is stored inside the tileset's directory, e.g. for the
+ * tileset "c:/data/foo.ini" it is "c:/data/foo/tileset.manifest".
+ */
+vtString TilesetManifest::FilenameFor(const char *tileset_fname)
+{
+	vtString dirname = tileset_fname;
+	RemoveFileExtensions(dirname);
+	return dirname + "/tileset.manifest";
+}
+
+/**
+ * Read an existing manifest.  If it was written with different options (as
+ * given by the options hash) then none of its tiles are considered current.
+ *
+ * \returns true if a usable manifest was read.
+ */
+bool TilesetManifest::Read(const char *fname, unsigned long long options_hash)
+{
+	FILE *fp = vtFileOpen(fname, "rb");
+	if (!fp)
+		return false;
+
+	char buf[4096];
+	int version = 0;
+	uint hi, lo;
+	bool bOptionsMatch = false;
+	int count = 0;
+	while (fgets(buf, 4096, fp))
+	{
+		if (sscanf(buf, "Version=%d", &version) == 1)
+			continue;
+		if (sscanf(buf, "Options=%8x%8x", &hi, &lo) == 2)
+		{
+			bOptionsMatch = (JoinHash(hi, lo) == options_hash);
+			continue;
+		}
+		if (strncmp(buf, "Tile ", 5) != 0)
+			continue;
+		if (version != MANIFEST_VERSION || !bOptionsMatch)
+			break;
+
+		int col, row, omitted, len = 0;
+		Entry e;
+		if (sscanf(buf, "Tile %d %d %8x%8x %d %lf %lf %lf %lf%n",
+			&col, &row, &hi, &lo, &omitted, &e.m_area.left, &e.m_area.right,
+			&e.m_area.bottom, &e.m_area.top, &len) < 9)
+			continue;
+		if (col < 0 || col >= m_cols || row < 0 || row >= m_rows)
+			continue;
+
+		// The rest of the line is the list of sources
+		vtString sources = buf + len;
+		sources.TrimLeft();
+		sources.TrimRight();
+
+		e.m_hash = JoinHash(hi, lo);
+		e.m_bOmitted = (omitted != 0);
+		e.m_sources = sources;
+		e.m_bValid = true;
+
+		// Later lines override earlier ones, since tiles are appended as
+		//  they are written.
+		m_entries[col * m_rows + row] = e;
+		count++;
+	}
+	fclose(fp);
+
+	VTLOG("TilesetManifest: read %d tile records, options %s\n", count,
+		bOptionsMatch ? "match" : "differ");
+	if (!bOptionsMatch)
+	{
+		for (size_t i = 0; i < m_entries.size(); i++)
+			m_entries[i].m_bValid = false;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Start writing the manifest.  Any tiles which are already known (from a
+ * previous call to Read) are written out immediately, and the file is kept
+ * open so that each new tile can be appended as soon as it is finished.
+ */
+bool TilesetManifest::Begin(const char *fname, unsigned long long options_hash)
+{
+	End();
+	m_options_hash = options_hash;
+	m_fp = vtFileOpen(fname, "wb");
+	if (!m_fp)
+		return false;
+
+	uint hi, lo;
+	SplitHash(m_options_hash, hi, lo);
+	fprintf(m_fp, "[TilesetManifest]\n");
+	fprintf(m_fp, "Version=%d\n", MANIFEST_VERSION);
+	fprintf(m_fp, "Options=%08x%08x\n", hi, lo);
+	for (int col = 0; col < m_cols; col++)
+		for (int row = 0; row < m_rows; row++)
+		{
+			const Entry &e = m_entries[col * m_rows + row];
+			if (e.m_bValid)
+				WriteEntry(col, row, e);
+		}
+	fflush(m_fp);
+	return true;
+}
+
+/**
+ * Note that a tile has been completely written (or deliberately omitted).
+ */
+void TilesetManifest::Record(int col, int row, const Entry &entry)
+{
+	Entry &e = m_entries[col * m_rows + row];
+	e = entry;
+	e.m_bValid = true;
+	if (m_fp)
+	{
+		WriteEntry(col, row, e);
+		fflush(m_fp);
+	}
+}
+
+void TilesetManifest::End()
+{
+	if (m_fp)
+	{
+		fclose(m_fp);
+		m_fp = NULL;
+	}
+}
+
+const TilesetManifest::Entry *TilesetManifest::Find(int col, int row) const
+{
+	const Entry &e = m_entries[col * m_rows + row];
+	return e.m_bValid ? &e : NULL;
+}
+
+/**
+ * \returns true if the tile was previously written from inputs with the
+ *	same hash, and so does not need to be written again.
+ */
+bool TilesetManifest::IsCurrent(int col, int row, unsigned long long hash) const
+{
+	const Entry *e = Find(col, row);
+	return (e != NULL && e->m_hash == hash);
+}
+
+int TilesetManifest::NumRecorded() const
+{
+	int count = 0;
+	for (size_t i = 0; i < m_entries.size(); i++)
+		if (m_entries[i].m_bValid)
+			count++;
+	return count;
+}
+
+void TilesetManifest::WriteEntry(int col, int row, const Entry &e)
+{
+	uint hi, lo;
+	SplitHash(e.m_hash, hi, lo);
+	fprintf(m_fp, "Tile %d %d %08x%08x %d %.16lg %.16lg %.16lg %.16lg %s\n",
+		col, row, hi, lo, e.m_bOmitted ? 1 : 0, e.m_area.left, e.m_area.right,
+		e.m_area.bottom, e.m_area.top, (const char *) e.m_sources);
+}
@@ -0,0 +1,93 @@
+//
+// TilesetManifest.h
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef TILESETMANIFEST_H
+#define TILESETMANIFEST_H
+
+#include "vtdata/MathTypes.h"
+#include "vtdata/vtString.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+/**
+ * A simple 64-bit hash (FNV-1a) used to fingerprint the inputs of a tile.
+ */
+class TileHash
+{
+public:
+	TileHash() { m_value = 14695981039346656037ULL; }
+
+	void Add(const void *data, size_t bytes)
+	{
+		const uchar *p = (const uchar *) data;
+		for (size_t i = 0; i < bytes; i++)
+		{
+			m_value ^= p[i];
+			m_value *= 1099511628211ULL;
+		}
+	}
+	void Add(int value) { Add(&value, sizeof(value)); }
+	void Add(float value) { Add(&value, sizeof(value)); }
+	void Add(double value) { Add(&value, sizeof(value)); }
+	void Add(const char *str) { if (str) Add(str, strlen(str)+1); }
+	void Add(const DRECT &rect)
+	{
+		Add(rect.left); Add(rect.top); Add(rect.right); Add(rect.bottom);
+	}
+
+	unsigned long long m_value;
+};
+
+/**
+ * A manifest which sits alongside a libMini tileset and remembers, for each
+ * tile (cell), which sources and extents it was built from, and a hash of
+ * its content.  When a tileset is re-written, tiles whose hash has not
+ * changed can be skipped.
+ *
+ * Each finished tile is appended to the manifest file immediately, so that
+ * an interrupted (cancelled or crashed) export can be resumed.
+ */
+class TilesetManifest
+{
+public:
+	struct Entry
+	{
+		Entry() { m_bValid = false; m_bOmitted = false; m_hash = 0; }
+
+		bool m_bValid;			// true if this tile was recorded
+		bool m_bOmitted;		// true if the tile had no data and wasn't written
+		unsigned long long m_hash;
+		DRECT m_area;
+		vtString m_sources;		// names of source layers, separated by '|'
+	};
+
+	TilesetManifest(int cols, int rows);
+	~TilesetManifest();
+
+	static vtString FilenameFor(const char *tileset_fname);
+
+	bool Read(const char *fname, unsigned long long options_hash);
+	bool Begin(const char *fname, unsigned long long options_hash);
+	void Record(int col, int row, const Entry &entry);
+	void End();
+
+	const Entry *Find(int col, int row) const;
+	bool IsCurrent(int col, int row, unsigned long long hash) const;
+	int NumRecorded() const;
+
+protected:
+	void WriteEntry(int col, int row, const Entry &entry);
+
+	int m_cols, m_rows;
+	unsigned long long m_options_hash;
+	std::vector<Entry> m_entries;
+	FILE *m_fp;
+};
+
+#endif // TILESETMANIFEST_H
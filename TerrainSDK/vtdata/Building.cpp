@@ -313,12 +313,14 @@ float vtLevel::GetLocalEdgeLength(uint iIndex) const
 void vtLevel::RebuildEdges(uint n)
 {
 	DeleteEdges();
+	m_Edges.SetMaxSize(n);
+
+	// Set up one edge and copy it, rather than looking up the materials
+	//  again for every edge; large files have millions of them.
+	vtEdge proto;
+	proto.Set(0, 0, BMAT_NAME_SIDING);
 	for (uint i = 0; i < n; i++)
-	{
-		vtEdge *pnew = new vtEdge;
-		pnew->Set(0, 0, BMAT_NAME_SIDING);
-		m_Edges.Append(pnew);
-	}
+		m_Edges.Append(new vtEdge(proto));
 }
 
 void vtLevel::ResizeEdgesToMatchFootprint()
@@ -742,15 +744,20 @@ void vtBuilding::FlipFootprintDirection()
 float vtBuilding::CalculateBaseElevation(vtHeightField *pHeightField)
 {
 	const DLine2 &Footprint = m_Levels[0]->GetOuterFootprint();
-	int iSize = Footprint.GetSize();
-	float fLowest = 1E9f;
+	const uint iSize = Footprint.GetSize();
+	if (iSize == 0)
+		return m_fElevationOffset;
+
+	std::vector<float> fAltitudes(iSize);
+	if (pHeightField->FindAltitudesOnEarth(Footprint.GetData(), &fAltitudes[0], iSize) == 0)
+		return m_fElevationOffset;
 
-	float fAltitude;
-	for (int i = 0; i < iSize; i++)
+	// Corners off the heightfield don't count
+	float fLowest = 1E9f;
+	for (uint i = 0; i < iSize; i++)
 	{
-		pHeightField->FindAltitudeOnEarth(Footprint[i], fAltitude);
-		if (fAltitude < fLowest)
-			fLowest = fAltitude;
+		if (fAltitudes[i] != INVALID_ELEVATION && fAltitudes[i] < fLowest)
+			fLowest = fAltitudes[i];
 	}
 	return fLowest + m_fElevationOffset;
 }
@@ -0,0 +1,430 @@
+//
+// ContourGenerator.cpp
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "ContourGenerator.h"
+#include "vtLog.h"
+
+#include <algorithm>	// for sort, unique, upper_bound
+
+// The grid is divided into bands of this many rows, to work on in parallel.
+#define BAND_ROWS	32
+
+vtContourGenerator::vtContourGenerator()
+{
+	m_pGrid = NULL;
+	m_pValues = NULL;
+	m_Size.Set(0, 0);
+}
+
+/**
+ * Set up to generate contours from the true elevation of a heightfield grid.
+ * The grid is used directly, not copied, so it must stay valid (and
+ * unchanged) until Generate has finished.
+ */
+bool vtContourGenerator::Setup(const vtHeightFieldGrid3d *pGrid)
+{
+	if (!pGrid)
+		return false;
+	m_pGrid = pGrid;
+	m_pValues = NULL;
+	m_Size = pGrid->GetDimensions();
+	m_Extents = pGrid->GetEarthExtents();
+	m_Spacing = pGrid->GetSpacing();
+	return (m_Size.x > 1 && m_Size.y > 1);
+}
+
+/**
+ * Set up to generate contours from a buffer of values, such as samples of a
+ * heightfield which is not a grid.  The values are in rows from south to
+ * north, each row from west to east; INVALID_ELEVATION marks unknown values.
+ * The buffer is not copied, so it must stay valid until Generate has
+ * finished.
+ */
+void vtContourGenerator::Setup(const IPoint2 &size, const DRECT &extents,
+							   const float *pValues)
+{
+	m_pGrid = NULL;
+	m_pValues = pValues;
+	m_Size = size;
+	m_Extents = extents;
+	m_Spacing.x = extents.Width() / (size.x - 1);
+	m_Spacing.y = extents.Height() / (size.y - 1);
+}
+
+/// Add a single contour level (elevation).
+void vtContourGenerator::AddLevel(float fLevel)
+{
+	m_Levels.push_back(fLevel);
+}
+
+/**
+ * Add contour levels at a regular interval, over the range of elevation of
+ * the grid.  For example, if the elevation ranges from 50 to 350 meters, an
+ * interval of 100 adds levels at 100, 200 and 300 meters.
+ */
+void vtContourGenerator::AddLevels(float fInterval)
+{
+	if (fInterval <= 0)
+		return;
+
+	float fMin = 1E9, fMax = -1E9;
+	if (m_pGrid)
+		m_pGrid->GetHeightExtents(fMin, fMax);
+	else if (m_pValues)
+	{
+		const int num = m_Size.x * m_Size.y;
+		for (int i = 0; i < num; i++)
+		{
+			const float value = m_pValues[i];
+			if (value == INVALID_ELEVATION)
+				continue;
+			if (value < fMin) fMin = value;
+			if (value > fMax) fMax = value;
+		}
+	}
+	int start = (int) (fMin / fInterval) + 1;
+	int stop = (int) (fMax / fInterval);
+	for (int i = start; i <= stop; i++)
+		m_Levels.push_back(i * fInterval);
+}
+
+/**
+ * Generate the contour lines at all the levels which have been added.  The
+ * resulting polylines are sorted by level.
+ */
+void vtContourGenerator::Generate()
+{
+	m_Lines.clear();
+	m_LineLevels.clear();
+
+	std::sort(m_Levels.begin(), m_Levels.end());
+	m_Levels.erase(std::unique(m_Levels.begin(), m_Levels.end()), m_Levels.end());
+	if (m_Levels.empty() || m_Size.x < 2 || m_Size.y < 2)
+		return;
+
+	// March through the cells of each band of rows
+	const int cell_rows = m_Size.y - 1;
+	const int bands = (cell_rows + BAND_ROWS - 1) / BAND_ROWS;
+	std::vector< std::vector<Segment> > band_segs(bands);
+	int b;
+#pragma omp parallel for schedule(dynamic)
+	for (b = 0; b < bands; b++)
+	{
+		const int end = std::min((b + 1) * BAND_ROWS, cell_rows);
+		MarchBand(b * BAND_ROWS, end, band_segs[b]);
+	}
+
+	// Sort the segments by level, keeping the order of the bands
+	const int levels = (int) m_Levels.size();
+	std::vector< std::vector<Segment> > level_segs(levels);
+	for (b = 0; b < bands; b++)
+	{
+		const std::vector<Segment> &segs = band_segs[b];
+		for (uint k = 0; k < segs.size(); k++)
+			level_segs[segs[k].m_level].push_back(segs[k]);
+		std::vector<Segment>().swap(band_segs[b]);
+	}
+
+	// Join the segments of each level into polylines
+	std::vector< std::vector<DLine2> > level_lines(levels);
+	int l;
+#pragma omp parallel for schedule(dynamic)
+	for (l = 0; l < levels; l++)
+		ChainLevel(level_segs[l], m_Levels[l], level_lines[l]);
+
+	for (l = 0; l < levels; l++)
+	{
+		for (uint k = 0; k < level_lines[l].size(); k++)
+		{
+			m_Lines.push_back(level_lines[l][k]);
+			m_LineLevels.push_back(m_Levels[l]);
+		}
+	}
+	VTLOG("vtContourGenerator: %d levels, %d lines\n", levels, (int) m_Lines.size());
+}
+
+/**
+ * Add the polylines to a featureset, with the level of each in the first
+ * field.
+ *
+ * \return The number of polylines added.
+ */
+int vtContourGenerator::AddToFeatureSet(vtFeatureSetLineString *pLS) const
+{
+	const uint num = NumLines();
+	for (uint i = 0; i < num; i++)
+	{
+		int record = pLS->AddPolyLine(m_Lines[i]);
+		if (pLS->NumFields() > 0)
+			pLS->SetValue(record, 0, m_LineLevels[i]);
+	}
+	return (int) num;
+}
+
+// Where a contour level crosses a grid edge.  The edge is from post (i,j)
+//  to its neighbor to the east, or to the north if it is vertical.
+DPoint2 vtContourGenerator::EdgeCrossing(uint edge, float fLevel) const
+{
+	const bool bVertical = (edge & 1) != 0;
+	const int i = (edge >> 1) % m_Size.x;
+	const int j = (edge >> 1) / m_Size.x;
+
+	const float v0 = Value(i, j);
+	const float v1 = bVertical ? Value(i, j + 1) : Value(i + 1, j);
+	const double t = (fLevel - v0) / (double) (v1 - v0);
+
+	DPoint2 p(m_Extents.left + i * m_Spacing.x, m_Extents.bottom + j * m_Spacing.y);
+	if (bVertical)
+		p.y += t * m_Spacing.y;
+	else
+		p.x += t * m_Spacing.x;
+	return p;
+}
+
+// The four edges of a cell, by the post they start at, and direction.
+static const int s_EdgeOffset[4][3] =
+{
+	{ 0, 0, 0 },	// bottom
+	{ 1, 0, 1 },	// right
+	{ 0, 1, 0 },	// top
+	{ 0, 0, 1 }		// left
+};
+
+// For each case of which corners are above the level (bit 0 = SW, bit 1 =
+//  SE, bit 2 = NE, bit 3 = NW), the pairs of edges which the contour
+//  connects.  The saddles (5 and 10) are resolved separately.
+static const int s_CaseEdges[16][2] =
+{
+	{ -1, -1 }, { 0, 3 }, { 0, 1 }, { 1, 3 },
+	{ 1, 2 }, { -1, -1 }, { 0, 2 }, { 2, 3 },
+	{ 2, 3 }, { 0, 2 }, { -1, -1 }, { 1, 2 },
+	{ 1, 3 }, { 0, 1 }, { 0, 3 }, { -1, -1 }
+};
+
+void vtContourGenerator::MarchBand(int iRowStart, int iRowEnd,
+								   std::vector<Segment> &result) const
+{
+	float v[4];
+	int pairs[2][2];
+	const std::vector<float>::const_iterator first_level = m_Levels.begin();
+
+	for (int j = iRowStart; j < iRowEnd; j++)
+	{
+		for (int i = 0; i < m_Size.x - 1; i++)
+		{
+			v[0] = Value(i, j);
+			v[1] = Value(i + 1, j);
+			v[2] = Value(i + 1, j + 1);
+			v[3] = Value(i, j + 1);
+			if (v[0] == INVALID_ELEVATION || v[1] == INVALID_ELEVATION ||
+				v[2] == INVALID_ELEVATION || v[3] == INVALID_ELEVATION)
+				continue;
+
+			const float fMin = std::min(std::min(v[0], v[1]), std::min(v[2], v[3]));
+			const float fMax = std::max(std::max(v[0], v[1]), std::max(v[2], v[3]));
+
+			// The levels which cross this cell: fMin < level <= fMax
+			std::vector<float>::const_iterator it =
+				std::upper_bound(first_level, m_Levels.end(), fMin);
+			for (; it != m_Levels.end() && *it <= fMax; ++it)
+			{
+				const float fLevel = *it;
+				int index = 0;
+				for (int c = 0; c < 4; c++)
+					if (v[c] >= fLevel)
+						index |= (1 << c);
+
+				int npairs = 1;
+				if (index == 5 || index == 10)
+				{
+					// A saddle; use the center to decide which corners connect
+					const bool bCenterHigh = (v[0] + v[1] + v[2] + v[3]) / 4 >= fLevel;
+					npairs = 2;
+					if ((index == 5) == bCenterHigh)
+					{
+						pairs[0][0] = 0; pairs[0][1] = 1;
+						pairs[1][0] = 2; pairs[1][1] = 3;
+					}
+					else
+					{
+						pairs[0][0] = 0; pairs[0][1] = 3;
+						pairs[1][0] = 1; pairs[1][1] = 2;
+					}
+				}
+				else
+				{
+					pairs[0][0] = s_CaseEdges[index][0];
+					pairs[0][1] = s_CaseEdges[index][1];
+				}
+
+				for (int p = 0; p < npairs; p++)
+				{
+					Segment seg;
+					seg.m_level = (uint) (it - first_level);
+					for (int e = 0; e < 2; e++)
+					{
+						const int *off = s_EdgeOffset[pairs[p][e]];
+						seg.m_edge[e] = EdgeId(i + off[0], j + off[1], off[2] != 0);
+					}
+					result.push_back(seg);
+				}
+			}
+		}
+	}
+}
+
+void vtContourGenerator::ChainLevel(const std::vector<Segment> &segs,
+									float fLevel, std::vector<DLine2> &lines) const
+{
+	const uint num = (uint) segs.size();
+	if (num == 0)
+		return;
+
+	// Index the ends of the segments by edge.  Each edge is shared by at
+	//  most two segments, one from each of the cells beside it.
+	std::vector<SegmentEnd> ends(num * 2);
+	for (uint s = 0; s < num; s++)
+	{
+		for (int e = 0; e < 2; e++)
+		{
+			ends[s * 2 + e].m_edge = segs[s].m_edge[e];
+			ends[s * 2 + e].m_segment = s;
+		}
+	}
+	std::sort(ends.begin(), ends.end());
+
+	std::vector<bool> used(num, false);
+	std::vector<uint> forward, backward, edges;
+	for (uint s = 0; s < num; s++)
+	{
+		if (used[s])
+			continue;
+		used[s] = true;
+
+		// Follow the contour, edge to edge, from each end of this segment
+		bool bClosed = false;
+		for (int dir = 1; dir >= 0 && !bClosed; dir--)
+		{
+			std::vector<uint> &chain = dir ? forward : backward;
+			chain.clear();
+
+			uint cur = s;
+			uint edge = segs[s].m_edge[dir];
+			for (;;)
+			{
+				SegmentEnd key;
+				key.m_edge = edge;
+				std::vector<SegmentEnd>::const_iterator it =
+					std::lower_bound(ends.begin(), ends.end(), key);
+				uint next = num;
+				for (; it != ends.end() && it->m_edge == edge; ++it)
+				{
+					if (it->m_segment != cur)
+						next = it->m_segment;
+				}
+				if (next == num)
+					break;		// the contour ends here, at the edge of the data
+				if (next == s)
+				{
+					bClosed = true;
+					break;
+				}
+				if (used[next])
+					break;
+				used[next] = true;
+
+				// Continue out through the other end of the next segment
+				const Segment &nseg = segs[next];
+				edge = (nseg.m_edge[0] == edge) ? nseg.m_edge[1] : nseg.m_edge[0];
+				chain.push_back(edge);
+				cur = next;
+			}
+		}
+
+		edges.clear();
+		if (!bClosed)
+			edges.insert(edges.end(), backward.rbegin(), backward.rend());
+		edges.push_back(segs[s].m_edge[0]);
+		edges.push_back(segs[s].m_edge[1]);
+		edges.insert(edges.end(), forward.begin(), forward.end());
+		if (bClosed)
+			edges.push_back(segs[s].m_edge[0]);
+
+		// we may have some degenerate geometry; we need at least three points
+		if (edges.size() < 3)
+			continue;
+
+		DLine2 line;
+		line.SetMaxSize((uint) edges.size());
+		for (uint k = 0; k < edges.size(); k++)
+			line.Append(EdgeCrossing(edges[k], fLevel));
+
+		// confirm they are not all the same
+		bool same = true;
+		for (uint k = 1; k < line.GetSize() && same; k++)
+			same = (line[k] == line[0]);
+		if (!same)
+			lines.push_back(line);
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// class ContourConverter
+
+ContourConverter::ContourConverter()
+{
+	m_pLS = NULL;
+}
+
+/**
+ * Set up the class to create line features on a terrain.
+ *
+ * \param pHFGrid The heightfield you will generate the contour lines on.
+ * \param fset The featureset to receive the polylines.
+ * \return True if successful.
+ */
+bool ContourConverter::Setup(vtHeightFieldGrid3d *pHFGrid, vtFeatureSetLineString *fset)
+{
+	if (!m_Generator.Setup(pHFGrid))
+		return false;
+
+	m_pLS = fset;
+	return true;
+}
+
+/**
+ * Generate a contour line to be draped on the terrain.
+ *
+ * \param fAlt The altitude (elevation) of the line to be generated.
+ */
+void ContourConverter::GenerateContour(float fAlt)
+{
+	m_Generator.AddLevel(fAlt);
+}
+
+/**
+ * Generate a set of contour lines to be draped on the terrain.
+ *
+ * \param fInterval  The vertical spacing between the contours.  For example,
+ *		if the elevation range of your data is from 50 to 350 meters, then
+ *		an fIterval of 100 will place contour bands at 100,200,300 meters.
+ */
+void ContourConverter::GenerateContours(float fInterval)
+{
+	m_Generator.AddLevels(fInterval);
+}
+
+/**
+ * Finishes the contour generation process.  Call once when you are done
+ * using the class to generate contours.
+ */
+void ContourConverter::Finish()
+{
+	m_Generator.Generate();
+	m_Generator.AddToFeatureSet(m_pLS);
+}
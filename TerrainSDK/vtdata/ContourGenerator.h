@@ -0,0 +1,124 @@
+//
+// ContourGenerator.h
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef CONTOURGENERATORH
+#define CONTOURGENERATORH
+
+#include "HeightField.h"
+#include "Features.h"
+
+/**
+ * Generates contour lines from a grid of elevation, by marching squares.
+ *
+ * The elevation is read directly from a vtHeightFieldGrid3d (such as a
+ * vtElevationGrid), or from a buffer of values supplied by the caller.  All
+ * the contour levels are found in a single pass over the grid, which is
+ * divided into bands of rows that are processed in parallel (if
+ * VTP_USE_OPENMP).  Each crossing of a grid edge is computed only from the
+ * two ends of that edge, so the pieces of a contour from neighboring bands
+ * meet exactly and are joined into continuous polylines.
+ *
+ * Example:
+ \code
+	vtContourGenerator gen;
+	gen.Setup(pGrid);
+	gen.AddLevels(10.0f);
+	gen.Generate();
+	gen.AddToFeatureSet(pLineSet);
+ \endcode
+ */
+class vtContourGenerator
+{
+public:
+	vtContourGenerator();
+
+	bool Setup(const vtHeightFieldGrid3d *pGrid);
+	void Setup(const IPoint2 &size, const DRECT &extents, const float *pValues);
+
+	void AddLevel(float fLevel);
+	void AddLevels(float fInterval);
+	void ClearLevels() { m_Levels.clear(); }
+
+	void Generate();
+
+	/// The number of polylines produced by Generate.
+	uint NumLines() const { return (uint) m_Lines.size(); }
+	/// A polyline produced by Generate, in earth coordinates.
+	const DLine2 &GetLine(uint i) const { return m_Lines[i]; }
+	/// The level (elevation) of a polyline produced by Generate.
+	float GetLineLevel(uint i) const { return m_LineLevels[i]; }
+
+	int AddToFeatureSet(vtFeatureSetLineString *pLS) const;
+
+protected:
+	// A piece of a contour line within one grid cell, between two edges
+	struct Segment
+	{
+		uint m_edge[2];
+		uint m_level;
+	};
+	// An end of a segment, keyed by the edge it is on
+	struct SegmentEnd
+	{
+		uint m_edge;
+		uint m_segment;
+		bool operator<(const SegmentEnd &other) const { return m_edge < other.m_edge; }
+	};
+
+	float Value(int i, int j) const
+	{
+		if (m_pGrid)
+			return m_pGrid->GetElevation(i, j, true);
+		return m_pValues[j * m_Size.x + i];
+	}
+	uint EdgeId(int i, int j, bool bVertical) const
+	{
+		return (uint) (j * m_Size.x + i) * 2 + (bVertical ? 1 : 0);
+	}
+	DPoint2 EdgeCrossing(uint edge, float fLevel) const;
+
+	void MarchBand(int iRowStart, int iRowEnd, std::vector<Segment> &result) const;
+	void ChainLevel(const std::vector<Segment> &segs, float fLevel,
+		std::vector<DLine2> &lines) const;
+
+	const vtHeightFieldGrid3d *m_pGrid;
+	const float *m_pValues;
+	IPoint2 m_Size;
+	DRECT m_Extents;
+	DPoint2 m_Spacing;
+
+	std::vector<float> m_Levels;
+
+	std::vector<DLine2> m_Lines;
+	std::vector<float> m_LineLevels;
+};
+
+/**
+ * Makes contour line features from a heightfield grid.  The first field of
+ * the featureset receives the elevation of each line.
+ *
+ * This is a convenience wrapper around vtContourGenerator; the contours
+ * requested with GenerateContour(s) are all produced at once, by Finish.
+ */
+class ContourConverter
+{
+public:
+	ContourConverter();
+
+	/// Setup to generate line features
+	bool Setup(vtHeightFieldGrid3d *pHFGrid, vtFeatureSetLineString *fset);
+
+	void GenerateContour(float fAlt);
+	void GenerateContours(float fAInterval);
+	void Finish();
+
+protected:
+	vtContourGenerator m_Generator;
+	vtFeatureSetLineString *m_pLS;
+};
+
+#endif // CONTOURGENERATORH
@@ -1669,6 +1669,54 @@ bool vtElevationGrid::FindAltitudeOnEarth(const DPoint2 &p, float &fAltitude,
 	return true;
 }
 
+/**
+ * Return the elevation values at many points in earth coordinates.  The
+ * grid is only read, so the points are divided among threads (if
+ * VTP_USE_OPENMP).
+ *
+ * \return The number of points which were inside the elevation grid.
+ */
+int vtElevationGrid::FindAltitudesOnEarth(const DPoint2 *points,
+	float *fAltitudes, uint count, bool bTrue) const
+{
+	const int num = (int) count;
+	int i, found = 0;
+#pragma omp parallel for reduction(+:found) if(num >= MIN_PARALLEL_QUERY)
+	for (i = 0; i < num; i++)
+	{
+		if (vtElevationGrid::FindAltitudeOnEarth(points[i], fAltitudes[i], bTrue))
+			found++;
+		else
+			fAltitudes[i] = INVALID_ELEVATION;
+	}
+	return found;
+}
+
+/**
+ * Return the elevation values at many points in world coordinates.  The
+ * grid is only read, so the points are divided among threads (if
+ * VTP_USE_OPENMP).  Culture is not considered.
+ *
+ * \return The number of points which were inside the elevation grid.
+ */
+int vtElevationGrid::FindAltitudesAtPoints(FPoint3 *points, uint count,
+	bool bTrue, int iCultureFlags) const
+{
+	const int num = (int) count;
+	int i, found = 0;
+#pragma omp parallel for reduction(+:found) if(num >= MIN_PARALLEL_QUERY)
+	for (i = 0; i < num; i++)
+	{
+		float fAltitude;
+		if (vtElevationGrid::FindAltitudeAtPoint(points[i], fAltitude, bTrue))
+		{
+			points[i].y = fAltitude;
+			found++;
+		}
+	}
+	return found;
+}
+
 void vtElevationGrid::SetError(vtElevError *err, vtElevError::ErrorType type,
 	const char *szFormat, ...)
 {
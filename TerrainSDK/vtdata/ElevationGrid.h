@@ -166,6 +166,8 @@ public:
 
 	// Implement vtHeightField methods
 	bool FindAltitudeOnEarth(const DPoint2 &p, float &fAltitude, bool bTrue = false) const;
+	int FindAltitudesOnEarth(const DPoint2 *points, float *fAltitudes,
+		uint count, bool bTrue = false) const;
 
 	// Implement vtHeightField3d methods
 	virtual float GetElevation(int iX, int iZ, bool bTrue = false) const;
@@ -177,6 +179,8 @@ public:
 	bool FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude,
 		bool bTrue = false, int iCultureFlags = 0,
 		FPoint3 *vNormal = NULL) const;
+	int FindAltitudesAtPoints(FPoint3 *points, uint count,
+		bool bTrue = false, int iCultureFlags = 0) const;
 
 protected:
 	bool	m_bFloatMode;
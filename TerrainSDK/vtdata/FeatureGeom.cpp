@@ -34,6 +34,7 @@ void vtFeatureSetPoint2D::SetNumGeometries(int iNum)
 void vtFeatureSetPoint2D::Reserve(int iNum)
 {
 	m_Point2.SetMaxSize(iNum);
+	ReserveRecords(iNum);
 }
 
 bool vtFeatureSetPoint2D::ComputeExtent(DRECT &rect) const
@@ -235,6 +236,7 @@ void vtFeatureSetPoint3D::SetNumGeometries(int iNum)
 void vtFeatureSetPoint3D::Reserve(int iNum)
 {
 	m_Point3.SetMaxSize(iNum);
+	ReserveRecords(iNum);
 }
 
 bool vtFeatureSetPoint3D::ComputeExtent(DRECT &rect) const
@@ -415,6 +417,7 @@ void vtFeatureSetLineString::SetNumGeometries(int iNum)
 void vtFeatureSetLineString::Reserve(int iNum)
 {
 	m_Line.reserve(iNum);
+	ReserveRecords(iNum);
 }
 
 bool vtFeatureSetLineString::ComputeExtent(DRECT &rect) const
@@ -669,6 +672,7 @@ void vtFeatureSetLineString3D::SetNumGeometries(int iNum)
 void vtFeatureSetLineString3D::Reserve(int iNum)
 {
 	m_Line.reserve(iNum);
+	ReserveRecords(iNum);
 }
 
 bool vtFeatureSetLineString3D::ComputeExtent(DRECT &rect) const
@@ -913,6 +917,7 @@ void vtFeatureSetPolygon::SetNumGeometries(int iNum)
 void vtFeatureSetPolygon::Reserve(int iNum)
 {
 	m_Poly.reserve(iNum);
+	ReserveRecords(iNum);
 }
 
 bool vtFeatureSetPolygon::ComputeExtent(DRECT &rect) const
@@ -1078,16 +1083,39 @@ const IntVector *SpatialIndex::GetIndexForPoint(const DPoint2 &p) const
  * The index of the polygon is return, or -1 if no polygon was found.
  */
 int vtFeatureSetPolygon::FindPolygon(const DPoint2 &p) const
+{
+	if (m_pIndex != NULL)
+		return FindPolygon(p, m_pIndex->m_iLastFound);
+
+	int hint = -1;
+	return FindPolygon(p, hint);
+}
+
+/**
+ * Find the first polygon in this feature set which contains the given
+ * point, starting with a hint.
+ *
+ * Points which are close together are usually in the same polygon, so the
+ * polygon found last time is tried first.  Unlike the other form of
+ * FindPolygon, this does not change the feature set, so several threads can
+ * search at once, each with their own hint.
+ *
+ * \param p The point.
+ * \param iHint The index of a polygon to try first, or -1.  It is set to the
+ *		polygon found.
+ * \return The index of the polygon, or -1 if no polygon was found.
+ */
+int vtFeatureSetPolygon::FindPolygon(const DPoint2 &p, int &iHint) const
 {
 	uint num, i;
 
 	if (m_pIndex != NULL)
 	{
 		// use Index
-		if (m_pIndex->m_iLastFound != -1)	// try last successful result
+		if (iHint != -1)	// try last successful result
 		{
-			if (m_Poly[m_pIndex->m_iLastFound].ContainsPoint(p))
-				return m_pIndex->m_iLastFound;		// found
+			if (m_Poly[iHint].ContainsPoint(p))
+				return iHint;		// found
 		}
 		const IntVector *index = m_pIndex->GetIndexForPoint(p);
 		if (index)
@@ -1098,11 +1126,11 @@ int vtFeatureSetPolygon::FindPolygon(const DPoint2 &p) const
 				int e = index->at(i);
 				if (m_Poly[e].ContainsPoint(p))
 				{
-					m_pIndex->m_iLastFound = e;
+					iHint = e;
 					return e;		// found
 				}
 			}
-			m_pIndex->m_iLastFound = -1;
+			iHint = -1;
 		}
 	}
 	else
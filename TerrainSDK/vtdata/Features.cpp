@@ -9,6 +9,88 @@
 #include "vtLog.h"
 #include "DxfParser.h"
 #include "FilePath.h"
+#include <string.h>	// for memcpy
+#include <algorithm>
+
+// The flags of four features, with the same bits set in each
+#define FLAGS4(f)	((uint) (f) * 0x01010101u)
+
+// DBF records are decoded in blocks of this many, one field at a time
+#define DBF_BLOCK_RECORDS	1024
+
+/**
+ * Set every feature's flags to (flags & keep) ^ toggle.  The flags are
+ * done four at a time, as words.
+ */
+static void CombineFlags(std::vector<uchar> &flags, uchar keep, uchar toggle)
+{
+	const size_t num = flags.size();
+	if (num == 0)
+		return;
+	uchar *data = &flags[0];
+	const uint keep4 = FLAGS4(keep), toggle4 = FLAGS4(toggle);
+	size_t i = 0;
+	for (; i + 4 <= num; i += 4)
+	{
+		uint word;
+		memcpy(&word, data + i, 4);
+		word = (word & keep4) ^ toggle4;
+		memcpy(data + i, &word, 4);
+	}
+	for (; i < num; i++)
+		data[i] = (data[i] & keep) ^ toggle;
+}
+
+/**
+ * Count the features which have a flag bit set, four at a time.
+ */
+static uint CountFlags(const std::vector<uchar> &flags, uchar bit)
+{
+	const size_t num = flags.size();
+	if (num == 0)
+		return 0;
+	const uchar *data = &flags[0];
+	const uint bit4 = FLAGS4(bit);
+	uint count = 0;
+	size_t i = 0;
+	for (; i + 4 <= num; i += 4)
+	{
+		uint word;
+		memcpy(&word, data + i, 4);
+		// make each byte 0 or 1, then add up the bytes
+		word = (word & bit4) / bit;
+		count += (word * 0x01010101u) >> 24;
+	}
+	for (; i < num; i++)
+		if (data[i] & bit)
+			count++;
+	return count;
+}
+
+/**
+ * Find the first feature which has a flag bit set, skipping four at a time.
+ * Returns the number of features if there is none.
+ */
+static size_t FirstFlag(const std::vector<uchar> &flags, uchar bit)
+{
+	const size_t num = flags.size();
+	if (num == 0)
+		return 0;
+	const uchar *data = &flags[0];
+	const uint bit4 = FLAGS4(bit);
+	size_t i = 0;
+	for (; i + 4 <= num; i += 4)
+	{
+		uint word;
+		memcpy(&word, data + i, 4);
+		if (word & bit4)
+			break;
+	}
+	for (; i < num; i++)
+		if (data[i] & bit)
+			break;
+	return i;
+}
 
 //
 // Construct / Destruct
@@ -16,14 +98,12 @@
 vtFeatureSet::vtFeatureSet()
 {
 	m_eGeomType = wkbNone;
+	m_iNextFeatureId = 0;
 }
 
 vtFeatureSet::~vtFeatureSet()
 {
 	DeleteFields();
-
-	for (uint i = 0; i < m_Features.size(); i++)
-		delete m_Features[i];
 }
 
 /**
@@ -600,6 +680,10 @@ bool vtFeatureSet::LoadFromOGR(OGRLayer *pLayer,
 
 	int i, j, count;
 
+	// Remember which OGR field each of our new fields comes from
+	const uint first_field = NumFields();
+	std::vector<int> ogr_field;
+
 	for (j = 0; j < num_fields; j++)
 	{
 		OGRFieldDefn *field_def = defn->GetFieldDefn(j);
@@ -623,6 +707,7 @@ bool vtFeatureSet::LoadFromOGR(OGRLayer *pLayer,
 			continue;
 		}
 		AddField(field_name, ftype, width);
+		ogr_field.push_back(j);
 	}
 
 	// For efficiency, pre-allocate room for the number of features
@@ -646,6 +731,9 @@ bool vtFeatureSet::LoadFromOGR(OGRLayer *pLayer,
 	vtFeatureSetLineString3D *pSetLine3 = dynamic_cast<vtFeatureSetLineString3D *>(this);
 	vtFeatureSetPolygon *pSetPoly = dynamic_cast<vtFeatureSetPolygon *>(this);
 
+	// Repeated string values share their memory
+	vtStringPool pool;
+
 	pLayer->ResetReading();
 	count = 0;
 	OGRFeature *pFeature;
@@ -867,23 +955,23 @@ bool vtFeatureSet::LoadFromOGR(OGRLayer *pLayer,
 		{
 			AddRecord();
 
-			for (j = 0; j < num_fields; j++)
+			// Set the values directly, since we know the types
+			for (j = 0; j < (int) ogr_field.size(); j++)
 			{
-				Field *pField = GetField(j);
+				Field *pField = m_fields[first_field + j];
+				const int k = ogr_field[j];
 				switch (pField->m_type)
 				{
-				case FT_Boolean:
-					SetValue(count, j, pFeature->GetFieldAsInteger(j) != 0);
-					break;
 				case FT_Integer:
-					SetValue(count, j, pFeature->GetFieldAsInteger(j));
+					pField->m_int[count] = pFeature->GetFieldAsInteger(k);
 					break;
 				case FT_Double:
-					SetValue(count, j, pFeature->GetFieldAsDouble(j));
+					pField->m_double[count] = pFeature->GetFieldAsDouble(k);
 					break;
 				case FT_String:
-					SetValue(count, j, pFeature->GetFieldAsString(j));
+					pField->m_string[count] = pool.Intern(pFeature->GetFieldAsString(k));
 					break;
+				case FT_Boolean:
 				case FT_Short:
 				case FT_Float:
 				case FT_Unknown:
@@ -977,6 +1065,26 @@ void vtFeatureSet::ParseDBFFields(DBFHandle db)
 	}
 }
 
+// Copy the characters of a DBF value, without the spaces around it, as a
+//  0-terminated string.  Returns the length.
+static int TrimDBFValue(const char *src, int width, char *dest)
+{
+	int start = 0, end = width;
+	while (start < end && src[start] == ' ')
+		start++;
+	while (end > start && (src[end-1] == ' ' || src[end-1] == 0))
+		end--;
+	memcpy(dest, src + start, end - start);
+	dest[end - start] = 0;
+	return end - start;
+}
+
+/**
+ * Read the records of a DBF into the fields, which must already be there
+ * (see ParseDBFFields).  The raw records are read a block at a time, and
+ * each field's column of the block is decoded straight into the field's
+ * array.  Strings which repeat share their memory.
+ */
 void vtFeatureSet::ParseDBFRecords(DBFHandle db, bool progress_callback(int))
 {
 	int iRecords = DBFGetRecordCount(db);
@@ -986,27 +1094,78 @@ void vtFeatureSet::ParseDBFRecords(DBFHandle db, bool progress_callback(int))
 	if ((uint) iRecords > NumEntities())
 		iRecords = NumEntities();
 
-	for (int i = 0; i < iRecords; i++)
+	// Each record starts with a deletion flag, then the fields in order
+	const int iDBFFields = DBFGetFieldCount(db);
+	const uint iFields = std::min(NumFields(), (uint) iDBFFields);
+	std::vector<int> offset(iDBFFields), width(iDBFFields);
+	int record_length = 1, max_width = 0, decimals;
+	for (int f = 0; f < iDBFFields; f++)
+	{
+		DBFGetFieldInfo(db, f, NULL, &width[f], &decimals);
+		offset[f] = record_length;
+		record_length += width[f];
+		max_width = std::max(max_width, width[f]);
+	}
+
+	// Make sure every field has a record for every entity
+	for (uint iField = 0; iField < NumFields(); iField++)
+		m_fields[iField]->SetNumRecords(NumEntities());
+
+	std::vector<char> block(DBF_BLOCK_RECORDS * record_length);
+	std::vector<char> buf(max_width + 1);
+	char *value = &buf[0];
+	vtStringPool pool;
+
+	for (int first = 0; first < iRecords; first += DBF_BLOCK_RECORDS)
 	{
-		if (progress_callback && ((i%16)==0))
-			progress_callback(i*100/iRecords);
-		uint iField;
-		for (iField = 0; iField < NumFields(); iField++)
+		if (progress_callback)
+			progress_callback(first*100/iRecords);
+
+		const int count = std::min(DBF_BLOCK_RECORDS, iRecords - first);
+		int i;
+		for (i = 0; i < count; i++)
+		{
+			const char *tuple = DBFReadTuple(db, first + i);
+			if (tuple)
+				memcpy(&block[i * record_length], tuple, record_length);
+			else
+				memset(&block[i * record_length], ' ', record_length);
+		}
+		for (uint iField = 0; iField < iFields; iField++)
 		{
 			Field *field = m_fields[iField];
+			const char *src = &block[offset[iField]];
+			const int w = width[iField];
 			switch (field->m_type)
 			{
 			case FT_String:
-				SetValue(i, iField, DBFReadStringAttribute(db, i, iField));
+				for (i = 0; i < count; i++, src += record_length)
+				{
+					int len = TrimDBFValue(src, w, value);
+					field->m_string[first + i] = pool.Intern(value, len);
+				}
 				break;
 			case FT_Integer:
-				SetValue(i, iField, DBFReadIntegerAttribute(db, i, iField));
+				for (i = 0; i < count; i++, src += record_length)
+				{
+					TrimDBFValue(src, w, value);
+					field->m_int[first + i] = (int) atof(value);
+				}
 				break;
 			case FT_Double:
-				SetValue(i, iField, DBFReadDoubleAttribute(db, i, iField));
+				for (i = 0; i < count; i++, src += record_length)
+				{
+					TrimDBFValue(src, w, value);
+					field->m_double[first + i] = atof(value);
+				}
 				break;
 			case FT_Boolean:
-				SetValue(i, iField, DBFReadLogicalAttribute(db, i, iField));
+				for (i = 0; i < count; i++, src += record_length)
+				{
+					TrimDBFValue(src, w, value);
+					field->m_bool[first + i] = (value[0] == 'T' || value[0] == 't' ||
+						value[0] == 'Y' || value[0] == 'y');
+				}
 				break;
 			case FT_Short:
 			case FT_Float:
@@ -1016,6 +1175,7 @@ void vtFeatureSet::ParseDBFRecords(DBFHandle db, bool progress_callback(int))
 			}
 		}
 	}
+	VTLOG("  %d records, %d distinct strings\n", iRecords, pool.NumStrings());
 }
 
 void ParseQuotedCSV(const char *buf, vtStringArray &strings)
@@ -1238,8 +1398,6 @@ bool vtFeatureSet::SaveToKML(const char *filename, bool progress_callback(int))
  */
 void vtFeatureSet::SetNumEntities(int iNum)
 {
-	int previous = NumEntities();
-
 	// First set the number of geometries
 	SetNumGeometries(iNum);
 
@@ -1247,25 +1405,44 @@ void vtFeatureSet::SetNumEntities(int iNum)
 	for (uint iField = 0; iField < NumFields(); iField++)
 		m_fields[iField]->SetNumRecords(iNum);
 
-	// Also keep size of flag array in synch
-	m_Features.resize(iNum);
-	for (int i = 0; i < (iNum - previous); i++)
+	// Also keep size of flag and ID arrays in synch
+	const int previous = (int) m_Flags.size();
+	if (iNum < previous)
 	{
-		vtFeature *f = new vtFeature;
-		f->flags = 0;
-		m_Features[i] = f;
+		m_Flags.resize(iNum);
+		m_FeatureIds.resize(iNum);
 	}
+	else
+		AppendFeatures(iNum - previous);
+}
+
+/**
+ * Make room in the fields for this many records, so that adding them one
+ * at a time does not grow the arrays over and over.
+ */
+void vtFeatureSet::ReserveRecords(int iNum)
+{
+	for (uint iField = 0; iField < NumFields(); iField++)
+		m_fields[iField]->Reserve(iNum);
+	m_Flags.reserve(iNum);
+	m_FeatureIds.reserve(iNum);
+}
+
+/**
+ * Add flags and IDs for this many features, at the end.
+ */
+void vtFeatureSet::AppendFeatures(int iNum, uchar flags)
+{
+	m_Flags.insert(m_Flags.end(), iNum, flags);
+	for (int i = 0; i < iNum; i++)
+		m_FeatureIds.push_back(m_iNextFeatureId++);
 }
 
 void vtFeatureSet::AllocateFeatures()
 {
-	// Set up Features array
-	for (uint i = 0; i < NumEntities(); i++)
-	{
-		vtFeature *f = new vtFeature;
-		f->flags = 0;
-		m_Features.push_back(f);
-	}
+	// Set up flags for the features which don't have them yet
+	if (NumEntities() > m_Flags.size())
+		AppendFeatures(NumEntities() - m_Flags.size());
 }
 
 /**
@@ -1331,11 +1508,11 @@ bool vtFeatureSet::AppendDataFrom(vtFeatureSet *pFromSet)
 			field1->GetValueAsString(i, str);
 			field2->SetValueFromString(first_appended_ent+i, str);
 		}
-		// copy flags
-		vtFeature *feat = new vtFeature;
-		feat->flags = pFromSet->m_Features[i]->flags;
-		m_Features.push_back(feat);
 	}
+	// copy flags
+	AppendFeatures(num);
+	std::copy(pFromSet->m_Flags.begin(), pFromSet->m_Flags.begin() + num,
+		m_Flags.end() - num);
 
 	// empty the source layer
 	pFromSet->SetNumEntities(0);
@@ -1349,24 +1526,17 @@ bool vtFeatureSet::AppendDataFrom(vtFeatureSet *pFromSet)
 
 uint vtFeatureSet::NumSelected() const
 {
-	uint count = 0;
-	uint size = m_Features.size();
-	for (uint i = 0; i < size; i++)
-		if (m_Features[i]->flags & FF_SELECTED)
-			count++;
-	return count;
+	return CountFlags(m_Flags, FF_SELECTED);
 }
 
 void vtFeatureSet::DeselectAll()
 {
-	for (uint i = 0; i < m_Features.size(); i++)
-		m_Features[i]->flags &= ~FF_SELECTED;
+	CombineFlags(m_Flags, (uchar) ~FF_SELECTED, 0);
 }
 
 void vtFeatureSet::InvertSelection()
 {
-	for (uint i = 0; i < m_Features.size(); i++)
-		m_Features[i]->flags ^= FF_SELECTED;
+	CombineFlags(m_Flags, 0xff, FF_SELECTED);
 }
 
 int vtFeatureSet::DoBoxSelect(const DRECT &rect, SelectionType st)
@@ -1378,7 +1548,7 @@ int vtFeatureSet::DoBoxSelect(const DRECT &rect, SelectionType st)
 	bool bWas;
 	for (int i = 0; i < entities; i++)
 	{
-		bWas = (m_Features[i]->flags & FF_SELECTED);
+		bWas = (m_Flags[i] & FF_SELECTED) != 0;
 		if (st == ST_NORMAL)
 			Select(i, false);
 
@@ -1574,36 +1744,35 @@ void vtFeatureSet::DeleteSelected()
 
 void vtFeatureSet::SetToDelete(int iFeature)
 {
-	m_Features[iFeature]->flags |= FF_DELETE;
+	m_Flags[iFeature] |= FF_DELETE;
 }
 
+/**
+ * Remove all the features which have been marked with SetToDelete.  The
+ * remaining features are moved down, in one pass, to fill the gaps.
+ *
+ * \return The number of features removed.
+ */
 int vtFeatureSet::ApplyDeletion()
 {
-	int entities = NumEntities();
+	const uint entities = NumEntities();
 
-	int target = 0;
-	int deleted = 0;
-	int newtotal = entities;
-	for (int i = 0; i < entities; i++)
+	// The features before the first deleted one don't move
+	uint target = (uint) FirstFlag(m_Flags, FF_DELETE);
+	if (target >= entities)
+		return 0;
+
+	for (uint i = target + 1; i < entities; i++)
 	{
-		if ((m_Features[i]->flags & FF_DELETE))
-		{
-			delete m_Features[i];
-			newtotal--;
-			deleted++;
-		}
-		else
-		{
-			if (target != i)
-			{
-				CopyEntity(i, target);
-				m_Features[target] = m_Features[i];
-			}
-			target++;
-		}
+		if (m_Flags[i] & FF_DELETE)
+			continue;
+		CopyEntity(i, target);
+		m_Flags[target] = m_Flags[i];
+		m_FeatureIds[target] = m_FeatureIds[i];
+		target++;
 	}
-	SetNumEntities(newtotal);
-	return deleted;
+	SetNumEntities(target);
+	return entities - target;
 }
 
 void vtFeatureSet::CopyEntity(uint from, uint to)
@@ -1618,9 +1787,7 @@ void vtFeatureSet::CopyEntity(uint from, uint to)
 
 void vtFeatureSet::DePickAll()
 {
-	int i, entities = NumEntities();
-	for (i = 0; i < entities; i++)
-		m_Features[i]->flags &= ~FF_PICKED;
+	CombineFlags(m_Flags, (uchar) ~FF_PICKED, 0);
 }
 
 
@@ -1721,9 +1888,7 @@ int vtFeatureSet::AddRecord()
 		recs = m_fields[i]->AddRecord();
 	}
 
-	vtFeature *f = new vtFeature;
-	f->flags = 0;
-	m_Features.push_back(f);
+	AppendFeatures(1);
 
 	return recs;
 }
@@ -1847,6 +2012,20 @@ void Field::SetNumRecords(int iNum)
 	}
 }
 
+void Field::Reserve(int iNum)
+{
+	switch (m_type)
+	{
+	case FT_Boolean: m_bool.SetMaxSize(iNum);	break;
+	case FT_Short: m_short.SetMaxSize(iNum);	break;
+	case FT_Integer: m_int.SetMaxSize(iNum);	break;
+	case FT_Float:	m_float.SetMaxSize(iNum);	break;
+	case FT_Double:	m_double.SetMaxSize(iNum);	break;
+	case FT_String: m_string.reserve(iNum);	break;
+	case FT_Unknown: break;
+	}
+}
+
 int Field::AddRecord()
 {
 	int index = 0;
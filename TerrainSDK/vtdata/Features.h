@@ -49,6 +49,7 @@ public:
 
 	int AddRecord();
 	void SetNumRecords(int iNum);
+	void Reserve(int iNum);
 
 	void SetValue(uint iRecord, const char *string);
 	void SetValue(uint iRecord, int value);
@@ -90,10 +91,6 @@ FieldType ConvertFieldType(DBFFieldType type);
 #define FF_PICKED		2
 #define FF_DELETE		4
 
-struct vtFeature {
-	uchar flags;
-};
-
 /**
  * vtFeatureSet contains a collection of features which are just abstract data,
  * without any specific correspondence to any aspect of the physical world.
@@ -148,13 +145,13 @@ public:
 	void Select(uint iEnt, bool set = true)
 	{
 		if (set)
-			m_Features[iEnt]->flags |= FF_SELECTED;
+			m_Flags[iEnt] |= FF_SELECTED;
 		else
-			m_Features[iEnt]->flags &= ~FF_SELECTED;
+			m_Flags[iEnt] &= ~FF_SELECTED;
 	}
 	bool IsSelected(uint iEnt)
 	{
-		return ((m_Features[iEnt]->flags & FF_SELECTED) != 0);
+		return ((m_Flags[iEnt] & FF_SELECTED) != 0);
 	}
 	uint NumSelected() const;
 	void DeselectAll();
@@ -163,7 +160,7 @@ public:
 	void DeleteSelected();
 	bool IsDeleted(uint iEnt)
 	{
-		return ((m_Features[iEnt]->flags & FF_DELETE) != 0);
+		return ((m_Flags[iEnt] & FF_DELETE) != 0);
 	}
 	int DoBoxSelect(const DRECT &rect, SelectionType st);
 
@@ -171,13 +168,13 @@ public:
 	void Pick(uint iEnt, bool set = true)
 	{
 		if (set)
-			m_Features[iEnt]->flags |= FF_PICKED;
+			m_Flags[iEnt] |= FF_PICKED;
 		else
-			m_Features[iEnt]->flags &= ~FF_PICKED;
+			m_Flags[iEnt] &= ~FF_PICKED;
 	}
 	bool IsPicked(uint iEnt)
 	{
-		return ((m_Features[iEnt]->flags & FF_PICKED) != 0);
+		return ((m_Flags[iEnt] & FF_PICKED) != 0);
 	}
 	void DePickAll();
 
@@ -209,7 +206,11 @@ public:
 	void SetProjection(const vtProjection &proj) { m_proj = proj; }
 	vtProjection &GetAtProjection() { return m_proj; }
 
-	vtFeature *GetFeature(uint iIndex) const { return m_Features[iIndex]; }
+	/**
+	 * A number which identifies a feature.  Unlike the feature's index, it
+	 * does not change when other features are deleted.
+	 */
+	uint GetFeatureId(uint iIndex) const { return m_FeatureIds[iIndex]; }
 
 protected:
 	// these must be implemented for each type of geometry
@@ -219,13 +220,17 @@ protected:
 	virtual void SetNumGeometries(int iNum) = 0;
 
 	void CopyEntity(uint from, uint to);
+	void ReserveRecords(int iNum);
+	void AppendFeatures(int iNum, uchar flags = 0);
 	void ParseDBFFields(DBFHandle db);
 	void ParseDBFRecords(DBFHandle db, bool progress_callback(int)=0);
 
 	OGRwkbGeometryType		m_eGeomType;
 
-	// The size of the features array will match the number of elements
-	std::vector<vtFeature*> m_Features;
+	// The size of the flag and ID arrays will match the number of elements
+	std::vector<uchar> m_Flags;
+	std::vector<uint> m_FeatureIds;
+	uint m_iNextFeatureId;
 
 	vtArray<Field*> m_fields;
 	vtProjection	m_proj;
@@ -254,6 +259,7 @@ public:
 	void SetPoint(uint num, const DPoint2 &p);
 	DPoint2 &GetPoint(uint num) { return m_Point2[num]; }
 	const DPoint2 &GetPoint(uint num) const { return m_Point2[num]; }
+	const DLine2 &GetAllPoints() const { return m_Point2; }
 
 	int FindClosestPoint(const DPoint2 &p, double epsilon, double *distance = NULL);
 	void FindAllPointsAtLocation(const DPoint2 &p, std::vector<int> &found);
@@ -424,6 +430,7 @@ public:
 	DPolygon2 &GetPolygon(uint num) { return m_Poly[num]; }
 	int FindSimplePolygon(const DPoint2 &p) const;
 	int FindPolygon(const DPoint2 &p) const;
+	int FindPolygon(const DPoint2 &p, int &iHint) const;
 
 	// Try to address some kinds of degenerate geometry that can occur in polygons
 	int FixGeometry(double dEpsilon);
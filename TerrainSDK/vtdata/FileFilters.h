@@ -70,6 +70,7 @@
 #define FSTRING_VTAP	_T("AnimPath Files (*.vtap)|*.vtap")
 #define FSTRING_VTB		_T("VTBuilder Project Files (*.vtb)|*.vtb")
 #define FSTRING_VTCO	_T("Content XML Files (*.vtco)|*.vtco")
+#define FSTRING_VTSB	_T("Binary Structure Files (*.vtsb)|*.vtsb")
 #define FSTRING_VTST	_T("Structure Files (*.vtst)|*.vtst")
 #define FSTRING_VTSTGZ	_T("Structure Files (*.vtst.gz)|*.vtst.gz")
 #define FSTRING_WRL		_T("WRL Files (*.wrl)|*.wrl")
@@ -550,6 +550,17 @@ int GetFileSize(const char *fname)
 	return buf.st_size;
 }
 
+/**
+ * Return the last modification time of a file, or 0 if it can't be found.
+ */
+time_t GetFileModTime(const char *fname)
+{
+	struct stat buf;
+	if (stat(fname, &buf) != 0)
+		return 0;
+	return buf.st_mtime;
+}
+
 void SetEnvironmentVar(const vtString &var, const vtString &value)
 {
 #if VTUNIX
@@ -20,6 +20,7 @@
 #endif
 
 #include <fstream>
+#include <time.h>
 
 #ifdef WIN32
   #include <io.h>
@@ -101,6 +102,7 @@ vtString GetExtension(const vtString &fname, bool bFull = true);
 vtString ChangeFileExtension(const char *input, const char *extension);
 bool vtFileExists(const char *fname);
 int GetFileSize(const char *fname);
+time_t GetFileModTime(const char *fname);
 
 void SetEnvironmentVar(const vtString &var, const vtString &value);
 
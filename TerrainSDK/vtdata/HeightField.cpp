@@ -32,6 +32,33 @@ void vtHeightField::SetEarthExtents(const DRECT &ext)
 	m_EarthExtents = ext;
 }
 
+/**
+ * Find the elevation at many points in earth coordinates at once.  This
+ * gives the same results as calling FindAltitudeOnEarth for each point,
+ * but subclasses implement it more efficiently.
+ *
+ * \param points The points to test.
+ * \param fAltitudes Receives the elevation at each point, or
+ *		INVALID_ELEVATION where there is none.
+ * \param count The number of points.
+ * \param bTrue True to get the true elevation, false to get the displayed
+ *		(possibly exaggerated) elevation.
+ * \return The number of points at which there was an elevation.
+ */
+int vtHeightField::FindAltitudesOnEarth(const DPoint2 *points,
+	float *fAltitudes, uint count, bool bTrue) const
+{
+	int found = 0;
+	for (uint i = 0; i < count; i++)
+	{
+		if (FindAltitudeOnEarth(points[i], fAltitudes[i], bTrue))
+			found++;
+		else
+			fAltitudes[i] = INVALID_ELEVATION;
+	}
+	return found;
+}
+
 /**
  * Gets the minimum and maximum height values.  The values are placed in the
  * arguments by reference.  You must have first called ComputeHeightExtents.
@@ -58,6 +85,36 @@ int vtHeightField3d::PointIsAboveTerrain(const FPoint3 &p) const
 }
 
 
+/**
+ * Find the elevation at many points in world coordinates at once.  This
+ * gives the same results as calling FindAltitudeAtPoint for each point,
+ * but subclasses implement it more efficiently.
+ *
+ * \param points The points to test.  The X and Z values are used, and the
+ *		Y value receives the elevation.  Where there is no elevation, Y is
+ *		left unchanged.
+ * \param count The number of points.
+ * \param bTrue True to get the true elevation, false to get the displayed
+ *		(possibly exaggerated) elevation.
+ * \param iCultureFlags Which culture to test, as for FindAltitudeAtPoint.
+ * \return The number of points at which there was an elevation.
+ */
+int vtHeightField3d::FindAltitudesAtPoints(FPoint3 *points, uint count,
+	bool bTrue, int iCultureFlags) const
+{
+	int found = 0;
+	float fAltitude;
+	for (uint i = 0; i < count; i++)
+	{
+		if (FindAltitudeAtPoint(points[i], fAltitude, bTrue, iCultureFlags))
+		{
+			points[i].y = fAltitude;
+			found++;
+		}
+	}
+	return found;
+}
+
 /**
  * Converts a earth coordinate (project or geographic) to a world coordinate
  * on the surface of the heightfield.
@@ -74,6 +131,24 @@ bool vtHeightField3d::ConvertEarthToSurfacePoint(const DPoint2 &epos,
 	return FindAltitudeAtPoint(p3, p3.y, bTrue, iCultureFlags);
 }
 
+/**
+ * Converts many earth coordinates to world coordinates on the surface of
+ * the heightfield, with a single query of the heightfield.  Points with no
+ * elevation get a Y value of 0.
+ *
+ * \return The number of points at which there was an elevation.
+ */
+int vtHeightField3d::ConvertEarthToSurfacePoints(const DPoint2 *epos,
+	FPoint3 *p3, uint count, int iCultureFlags, bool bTrue) const
+{
+	for (uint i = 0; i < count; i++)
+	{
+		m_LocalCS.EarthToLocal(epos[i], p3[i].x, p3[i].z);
+		p3[i].y = 0.0f;
+	}
+	return FindAltitudesAtPoints(p3, count, bTrue, iCultureFlags);
+}
+
 /**
  * Tests whether a given point is within the current terrain
  */
@@ -120,8 +195,8 @@ float vtHeightField3d::LineOnSurface(const DLine2 &line, float fSpacing, float f
 	uint i, j;
 	FPoint3 v1, v2, v;
 
-	float fTotalLength = 0.0f;
-	int iVerts = 0;
+	// First make the points in the XZ plane, then drape them all at once
+	const uint start = output.GetSize();
 	uint points = line.GetSize();
 	if (bCurve)
 	{
@@ -152,27 +227,18 @@ float vtHeightField3d::LineOnSurface(const DLine2 &line, float fSpacing, float f
 			iSteps = 3;
 		double dStep = full / iSteps;
 
-		FPoint3 last_v;
 		for (double f = 0; f <= full; f += dStep)
 		{
 			spline.Interpolate(f, &p3);
 
 			m_LocalCS.EarthToLocal(p3.x, p3.y, v.x, v.z);
-			FindAltitudeAtPoint(v, v.y, bTrue);
-			v.y += fOffset;
+			v.y = 0.0f;
 			output.Append(v);
-			iVerts++;
-
-			// keep a running total of approximate ground length
-			if (f > 0)
-				fTotalLength += (v - last_v).Length();
-			last_v = v;
 		}
 	}
 	else
 	{
 		// not curved: straight line in earth coordinates
-		FPoint3 last_v;
 		for (i = 0; i < points; i++)
 		{
 			if (bInterp)
@@ -192,26 +258,29 @@ float vtHeightField3d::LineOnSurface(const DLine2 &line, float fSpacing, float f
 				{
 					// simple linear interpolation of the ground coordinate
 					v.Set(v1.x + diff.x / iSteps * j, 0.0f, v1.z + diff.z / iSteps * j);
-					FindAltitudeAtPoint(v, v.y, bTrue);
-					v.y += fOffset;
 					output.Append(v);
-					iVerts++;
-
-					// keep a running total of approximate ground length
-					if (j > 0)
-						fTotalLength += (v - last_v).Length();
-					last_v = v;
 				}
 			}
 			else
 			{
 				m_LocalCS.EarthToLocal(line[i], v.x, v.z);
-				FindAltitudeAtPoint(v, v.y, bTrue);
-				v.y += fOffset;
+				v.y = 0.0f;
 				output.Append(v);
 			}
 		}
 	}
+	const uint end = output.GetSize();
+	if (end > start)
+		FindAltitudesAtPoints(output.GetData() + start, end - start, bTrue);
+
+	// Apply the offset, and keep a running total of approximate ground length
+	float fTotalLength = 0.0f;
+	for (i = start; i < end; i++)
+	{
+		output[i].y += fOffset;
+		if ((bCurve || bInterp) && i > start)
+			fTotalLength += (output[i] - output[i-1]).Length();
+	}
 	return fTotalLength;
 }
 
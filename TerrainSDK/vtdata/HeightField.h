@@ -16,6 +16,10 @@
 class vtBitmapBase;
 #define INVALID_ELEVATION	SHRT_MIN
 
+// Batches of point queries smaller than this are not worth spreading
+//  across threads.
+#define MIN_PARALLEL_QUERY	256
+
 /**
  * A heightfield is any collection of surfaces such that, given a horizontal
  * X,Y position, there exists only a single elevation value.
@@ -30,6 +34,8 @@ public:
 	void Initialize(const DRECT &extents, float fMinHeight, float fMaxHeight);
 
 	virtual bool FindAltitudeOnEarth(const DPoint2 &p, float &fAltitude, bool bTrue = false) const = 0;
+	virtual int FindAltitudesOnEarth(const DPoint2 *points, float *fAltitudes,
+		uint count, bool bTrue = false) const;
 
 	/** Test if a point is within the extents of the grid. */
 	bool ContainsEarthPoint(const DPoint2 &p, bool bInclusive = false) const
@@ -64,6 +70,12 @@ class CultureExtension
 public:
 	virtual bool FindAltitudeOnCulture(const FPoint3 &p3, float &fAltitude,
 		bool bTrue, int iCultureFlags) const = 0;
+
+	/** A number which changes whenever the culture is edited, or the
+		height of the culture changes.  This lets callers which cache the
+		height of culture know when to discard it.  Culture which is only
+		paged in or out doesn't change it. */
+	virtual uint GetCultureRevision() const { return 0; }
 };
 
 /**
@@ -107,6 +119,8 @@ public:
 	virtual bool FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude,
 		bool bTrue = false, int iCultureFlags = 0,
 		FPoint3 *vNormal = NULL) const = 0;
+	virtual int FindAltitudesAtPoints(FPoint3 *points, uint count,
+		bool bTrue = false, int iCultureFlags = 0) const;
 
 	/// Find the intersection point of a ray with the heightfield
 	virtual bool CastRayToSurface(const FPoint3 &point, const FPoint3 &dir,
@@ -116,11 +130,14 @@ public:
 
 	bool ConvertEarthToSurfacePoint(const DPoint2 &epos, FPoint3 &p3,
 		int iCultureFlags = 0, bool bTrue = false) const;
+	int ConvertEarthToSurfacePoints(const DPoint2 *epos, FPoint3 *p3,
+		uint count, int iCultureFlags = 0, bool bTrue = false) const;
 
 	bool ContainsWorldPoint(float x, float z) const;
 	void GetCenter(FPoint3 &center) const;
 
 	void SetCulture(CultureExtension *ext) { m_pCulture = ext; }
+	CultureExtension *GetCulture() const { return m_pCulture; }
 
 	float LineOnSurface(const DLine2 &line, float fSpacing, float fOffset,
 		bool bInterp, bool bCurve, bool bTrue, FLine3 &output);
@@ -1417,6 +1417,47 @@ protected:
 	std::string m_old_locale;
 };
 
+/**
+ * A small, fast pseudo-random number generator (xorshift).  Unlike rand(),
+ * each instance has its own state, so a sequence depends only on the seed.
+ * This makes it useful for generating the same result again, and for work
+ * which is split across threads.
+ */
+class vtRandom
+{
+public:
+	vtRandom(uint seed = 0) { Seed(seed); }
+
+	/// Start a new sequence.  Seeds which are close give unrelated sequences.
+	void Seed(uint seed)
+	{
+		// Mix the bits of the seed, and avoid the state of zero
+		seed = (seed ^ 61) ^ (seed >> 16);
+		seed *= 9;
+		seed ^= seed >> 4;
+		seed *= 0x27d4eb2d;
+		seed ^= seed >> 15;
+		m_state = seed ? seed : 0x9e3779b9;
+	}
+	/// The next value, from 1 to 2^32-1.
+	uint Next()
+	{
+		m_state ^= m_state << 13;
+		m_state ^= m_state >> 17;
+		m_state ^= m_state << 5;
+		return m_state;
+	}
+	/// A value in the range [0, 1).
+	float Unit() { return (Next() >> 8) * (1.0f / 16777216.0f); }
+	/// A value in the range [0, x), like random().
+	float Random(float x) { return Unit() * x; }
+	/// A value in the range [-x/2, x/2), like random_offset().
+	float Offset(float x) { return (Unit() - 0.5f) * x; }
+
+protected:
+	uint m_state;
+};
+
 
 ///////////////////////////////////////////////////////////////////////
 // handy helper functions
@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #include "vtLog.h"
 #include "Plants.h"
@@ -22,6 +23,10 @@
 
 extern int FindDBField(DBFHandle db, const char *field_name);
 
+// When writing a VF file, plants are grouped into square blocks of about
+//  this many plants.
+#define VF_PLANTS_PER_BLOCK	4096
+
 /////////////////////////
 
 vtPlantAppearance::vtPlantAppearance(AppearType type, const char *filename,
@@ -786,8 +791,43 @@ struct vtPlantInstance20 {
 	float size;
 	short species_id;
 };
+
+// The fixed header at the start of a VF 3.0 file.  It is followed by:
+//  - the SRS as WKT, 0-terminated (wkt_length bytes)
+//  - the species names, each 0-terminated (names_length bytes)
+//  - padding to a multiple of 8 bytes
+//  - the block table (numblocks * vtVF3Block)
+//  - the positions of the plants, as offsets from the origin of their
+//	block (numinstances * FPoint2)
+//  - the heights of the plants, in centimeters (numinstances * short)
+//  - the species of the plants, as indices into the names (numinstances * short)
+struct vtVF3Header {
+	char magic[8];		// "vf3.0"
+	int numinstances;
+	int numspecies;
+	int numblocks;
+	int wkt_length;
+	int names_length;
+	int reserved;
+};
+
+// A set of plants which are near each other.  They are contiguous in each
+//  of the arrays, and the blocks are in the same order as the plants.
+struct vtVF3Block {
+	DRECT extent;
+	DPoint2 origin;
+	int first;
+	int count;
+};
 #endif
 
+// The offset in a VF 3.0 file of the block table
+static long VF3BlockStart(const vtVF3Header &header)
+{
+	long start = sizeof(vtVF3Header) + header.wkt_length + header.names_length;
+	return (start + 7) & ~7L;
+}
+
 bool vtPlantInstanceArray::ReadVF_version11(const char *fname)
 {
 	FILE *fp = vtFileOpen(fname, "rb");
@@ -844,7 +884,15 @@ bool vtPlantInstanceArray::ReadVF_version11(const char *fname)
 	return true;
 }
 
-bool vtPlantInstanceArray::ReadVF(const char *fname)
+/**
+ * Read plants from a VF file, adding them to this array.
+ *
+ * \param fname The filename, in UTF-8.
+ * \param pArea If not NULL, only the plants inside this area are read.  For
+ *		VF 3.0 files, only the parts of the file which are near the area
+ *		are read.
+ */
+bool vtPlantInstanceArray::ReadVF(const char *fname, const DRECT *pArea)
 {
 	VTLOG("Reading VF file '%s'\n", fname);
 
@@ -873,7 +921,33 @@ bool vtPlantInstanceArray::ReadVF(const char *fname)
 	if (version < 2.0f)
 	{
 		fclose(fp);
-		return ReadVF_version11(fname);
+		const int previous = NumEntities();
+		if (!ReadVF_version11(fname))
+			return false;
+
+		// Old files are read whole, then the plants outside the area dropped
+		if (pArea)
+		{
+			int kept = previous;
+			for (int i = previous; i < (int) NumEntities(); i++)
+			{
+				if (!pArea->ContainsPoint(GetPoint(i), true))
+					continue;
+				float size;
+				short species_id;
+				GetPlant(i, size, species_id);
+				SetPoint(kept, GetPoint(i));
+				SetPlant(kept, size, species_id);
+				kept++;
+			}
+			SetNumEntities(kept);
+		}
+		return true;
+	}
+	if (version >= 3.0f)
+	{
+		fclose(fp);
+		return ReadVF_version3(fname, pArea);
 	}
 
 	int i, numinstances, numspecies, quiet;
@@ -941,6 +1015,9 @@ bool vtPlantInstanceArray::ReadVF(const char *fname)
 		// species id
 		quiet = fread(&local_species_id, sizeof(short), 1, fp);
 
+		if (pArea && !pArea->ContainsPoint(pos, true))
+			continue;
+
 		// convert from file-local id to new id
 		if (local_species_id < 0 || local_species_id > numspecies-1)
 		{
@@ -962,7 +1039,197 @@ bool vtPlantInstanceArray::ReadVF(const char *fname)
 	return true;
 }
 
-bool vtPlantInstanceArray::WriteVF(const char *fname) const
+bool vtPlantInstanceArray::ReadVF_version3(const char *fname, const DRECT *pArea)
+{
+	FILE *fp = vtFileOpen(fname, "rb");
+	if (!fp)
+		return false;
+
+	vtVF3Header header;
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+		strncmp(header.magic, "vf3", 3) != 0 ||
+		header.numinstances < 0 || header.numblocks < 0 ||
+		header.wkt_length < 1 || header.names_length < 0)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	// read the SRS and the species names
+	vector<char> text(header.wkt_length + header.names_length + 1);
+	if (fread(&text[0], 1, text.size() - 1, fp) != text.size() - 1)
+	{
+		fclose(fp);
+		return false;
+	}
+	text[text.size() - 1] = 0;
+
+	char *wkt = &text[0];
+	OGRErr err = m_proj.importFromWkt(&wkt);
+	if (err != OGRERR_NONE)
+	{
+		// It shouldn't be fatal to encounter a missing or unparsable projection
+	}
+
+	// create lookup table of new IDs
+	int i, unknown = 0;
+	vector<short> local_ids;
+	const char *name = &text[header.wkt_length];
+	const char *names_end = name + header.names_length;
+	for (i = 0; i < header.numspecies && name < names_end; i++)
+	{
+		short species_id = m_pSpeciesList->GetSpeciesIdByName(name);
+		if (species_id == -1)
+		{
+			VTLOG("  Unknown species: %s\n", name);
+			unknown++;
+		}
+		local_ids.push_back(species_id);
+		name += strlen(name) + 1;
+	}
+	if (unknown > 0)
+		VTLOG("Warning: %d unknown species encountered in VF table\n", unknown);
+	const int numspecies = (int) local_ids.size();
+
+	// read the block table, and decide which blocks to read
+	vector<vtVF3Block> blocks(header.numblocks);
+	const long block_start = VF3BlockStart(header);
+	fseek(fp, block_start, SEEK_SET);
+	if (header.numblocks > 0 &&
+		fread(&blocks[0], sizeof(vtVF3Block), header.numblocks, fp) != (size_t) header.numblocks)
+	{
+		fclose(fp);
+		return false;
+	}
+	int total = 0, next = 0;
+	vector<int> wanted;
+	for (i = 0; i < header.numblocks; i++)
+	{
+		if (blocks[i].first != next || blocks[i].count < 0 ||
+			blocks[i].first + blocks[i].count > header.numinstances)
+		{
+			fclose(fp);
+			return false;
+		}
+		next += blocks[i].count;
+		if (pArea && !pArea->OverlapsRect(blocks[i].extent))
+			continue;
+		wanted.push_back(i);
+		total += blocks[i].count;
+	}
+
+	if (next != header.numinstances)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	// make room for all of them at once.  The species are read straight into
+	//  place, the offsets and heights into arrays of their own.
+	const long pos_start = block_start + header.numblocks * sizeof(vtVF3Block);
+	const long height_start = pos_start + header.numinstances * sizeof(FPoint2);
+	const long species_start = height_start + header.numinstances * sizeof(short);
+
+	const int previous = NumEntities();
+	SetNumEntities(previous + total);
+	DPoint2 *pos = m_Point2.GetData();
+	float *sizes = m_fields[m_SizeField]->m_float.GetData();
+	short *species = m_fields[m_SpeciesField]->m_short.GetData();
+
+	vector<FPoint2> offsets(total);
+	vector<short> heights(total);
+	bool success = true;
+	if (total == header.numinstances)
+	{
+		// whole file: one read for each array
+		if (total > 0)
+		{
+			fseek(fp, pos_start, SEEK_SET);
+			success &= (fread(&offsets[0], sizeof(FPoint2), total, fp) == (size_t) total);
+			success &= (fread(&heights[0], sizeof(short), total, fp) == (size_t) total);
+			success &= (fread(species + previous, sizeof(short), total, fp) == (size_t) total);
+		}
+	}
+	else
+	{
+		int to = 0;
+		for (i = 0; i < (int) wanted.size(); i++)
+		{
+			const vtVF3Block &block = blocks[wanted[i]];
+			if (block.count == 0)
+				continue;
+			fseek(fp, pos_start + block.first * sizeof(FPoint2), SEEK_SET);
+			success &= (fread(&offsets[to], sizeof(FPoint2), block.count, fp) == (size_t) block.count);
+			fseek(fp, height_start + block.first * sizeof(short), SEEK_SET);
+			success &= (fread(&heights[to], sizeof(short), block.count, fp) == (size_t) block.count);
+			fseek(fp, species_start + block.first * sizeof(short), SEEK_SET);
+			success &= (fread(species + previous + to, sizeof(short), block.count, fp) == (size_t) block.count);
+			to += block.count;
+		}
+	}
+	fclose(fp);
+	if (!success)
+	{
+		SetNumEntities(previous);
+		return false;
+	}
+
+	// positions are relative to their block, heights are in centimeters
+	int n = 0;
+	for (i = 0; i < (int) wanted.size(); i++)
+	{
+		const vtVF3Block &block = blocks[wanted[i]];
+		for (int j = 0; j < block.count; j++, n++)
+		{
+			pos[previous + n] = block.origin + DPoint2(offsets[n]);
+			sizes[previous + n] = (float) heights[n] / 100.0f;
+		}
+	}
+
+	// convert from file-local ids to new ids, dropping the plants which are
+	//  of unknown species or outside the area
+	int kept = previous;
+	unknown = 0;
+	for (i = previous; i < previous + total; i++)
+	{
+		const short local_species_id = species[i];
+		if (local_species_id < 0 || local_species_id > numspecies-1)
+		{
+			VTLOG(" Warning: species index %d out of range [0..%d]\n", local_species_id, numspecies-1);
+			continue;
+		}
+		const short species_id = local_ids[local_species_id];
+		if (species_id == -1)
+		{
+			unknown++;
+			continue;
+		}
+		if (pArea && !pArea->ContainsPoint(pos[i], true))
+			continue;
+		pos[kept] = pos[i];
+		sizes[kept] = sizes[i];
+		species[kept] = species_id;
+		kept++;
+	}
+	if (kept != previous + total)
+		SetNumEntities(kept);
+	if (unknown > 0)
+		VTLOG("Warning: %d/%d instances were ignored because of unknown species.\n", unknown, total);
+
+	VTLOG(" Read %d of %d plants, from %d of %d blocks.\n", kept - previous,
+		header.numinstances, (int) wanted.size(), header.numblocks);
+	return true;
+}
+
+/**
+ * Write the plants to a VF file.
+ *
+ * \param fname The filename, in UTF-8.
+ * \param bBlocks If true, the plants are sorted into square blocks, so that
+ *		those in an area can be read without reading the whole file (see
+ *		ReadVF).  Otherwise, they are written in their current order.
+ */
+bool vtPlantInstanceArray::WriteVF(const char *fname, bool bBlocks) const
 {
 	int i, numinstances = NumEntities();
 	if (numinstances == 0)
@@ -970,92 +1237,128 @@ bool vtPlantInstanceArray::WriteVF(const char *fname) const
 	if (!m_pSpeciesList)
 		return false;
 	int numspecies = m_pSpeciesList->NumSpecies();
-	short len;	// for string lengths
 	short species_id;
 	float size;
 
-	FILE *fp = vtFileOpen(fname, "wb");
-	if (!fp)
-		return false;
-
-	fwrite("vf2.0", 6, 1, fp);
-
-	// write SRS as WKT
+	// SRS as WKT
 	char *wkt;
 	OGRErr err = m_proj.exportToWkt(&wkt);
 	if (err != OGRERR_NONE)
 		return false;
-	len = (short) strlen(wkt);
-	fwrite(&len, sizeof(short), 1, fp);
-	fwrite(wkt, len, 1, fp);
+	vtString strWkt = wkt;
 	OGRFree(wkt);
 
 	// filter out ununsed species, create table of used species
-	vector<int> index_count;
-	for (i = 0; i < numspecies; i++)
-		index_count.push_back(0);
+	vector<int> index_count(numspecies, 0);
 	for (i = 0; i < numinstances; i++)
 	{
 		GetPlant(i, size, species_id);
 		index_count[species_id]++;
 	}
 	vector<int> index_table;
+	std::string names;
 	for (i = 0; i < numspecies; i++)
 	{
 		if (index_count[i] > 0)
+		{
 			index_table.push_back(i);
+			names += m_pSpeciesList->GetSpecies(i)->GetSciName();
+			names += (char) 0;
+		}
 	}
 	int used = index_table.size();
 
-	// write number of species
-	fwrite(&used, sizeof(int), 1, fp);
-
-	// write species binomial strings
-	for (i = 0; i < used; i++)
-	{
-		species_id = index_table[i];
-		const char *name = m_pSpeciesList->GetSpecies(species_id)->GetSciName();
-		len = (short) strlen(name);
-		fwrite(&len, sizeof(short), 1, fp);
-		fwrite(name, len, 1, fp);
-	}
-
 	// reverse table for lookup
-	vector<short> reverse_table;
-	reverse_table.resize(numspecies);
+	vector<short> reverse_table(numspecies);
 	for (i = 0; i < used; i++)
 		reverse_table[index_table[i]] = i;
 
-	// write number of instances
-	fwrite(&numinstances, sizeof(int), 1, fp);
-
-	// write local origin (center of exents) as double-precision coordinates
+	// Sort the plants into a grid of blocks, with a counting sort
 	DRECT rect;
 	ComputeExtent(rect);
-	DPoint2 origin, diff;
-	rect.GetCenter(origin);
-	fwrite(&origin, sizeof(double), 2, fp);
+	int side = 1;
+	if (bBlocks)
+		side = std::max(1, (int) ceil(sqrt((double) numinstances / VF_PLANTS_PER_BLOCK)));
+	const double cell_x = rect.Width() / side, cell_y = rect.Height() / side;
 
-	// write instances
-	FPoint2 offset;
+	vector<int> cell_of(numinstances), cell_start(side * side + 1, 0);
 	for (i = 0; i < numinstances; i++)
 	{
-		// location
-		diff = GetPoint(i) - origin;
-		offset = diff;	// acceptable to use single precision for local offset
-		fwrite(&offset, sizeof(float), 2, fp);
+		const DPoint2 &p = GetPoint(i);
+		int cx = (cell_x > 0) ? (int) ((p.x - rect.left) / cell_x) : 0;
+		int cy = (cell_y > 0) ? (int) ((p.y - rect.bottom) / cell_y) : 0;
+		if (cx > side - 1) cx = side - 1;
+		if (cy > side - 1) cy = side - 1;
+		cell_of[i] = cy * side + cx;
+		cell_start[cell_of[i] + 1]++;
+	}
+	for (i = 0; i < side * side; i++)
+		cell_start[i + 1] += cell_start[i];
 
-		GetPlant(i, size, species_id);
+	vector<int> order(numinstances);
+	vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+	for (i = 0; i < numinstances; i++)
+		order[fill[cell_of[i]]++] = i;
 
-		// height in centimeters
-		short height = (short) (size * 100.0f);
-		fwrite(&height, sizeof(short), 1, fp);
+	vector<vtVF3Block> blocks;
+	for (i = 0; i < side * side; i++)
+	{
+		if (cell_start[i] == cell_start[i + 1])
+			continue;
+		vtVF3Block block;
+		block.first = cell_start[i];
+		block.count = cell_start[i + 1] - cell_start[i];
+		block.extent.SetInsideOut();
+		for (int j = block.first; j < block.first + block.count; j++)
+			block.extent.GrowToContainPoint(GetPoint(order[j]));
+		block.origin = block.extent.GetCenter();
+		blocks.push_back(block);
+	}
 
-		// species id
-		short local_id = reverse_table[species_id];
-		fwrite(&local_id, sizeof(short), 1, fp);
+	// Gather the arrays in block order: location as an offset from the
+	//  block's origin, and height in centimeters
+	vector<FPoint2> offsets(numinstances);
+	vector<short> heights(numinstances);
+	vector<short> local_ids(numinstances);
+	for (uint b = 0; b < blocks.size(); b++)
+	{
+		const vtVF3Block &block = blocks[b];
+		for (i = block.first; i < block.first + block.count; i++)
+		{
+			offsets[i] = FPoint2(GetPoint(order[i]) - block.origin);
+			GetPlant(order[i], size, species_id);
+			heights[i] = (short) (size * 100.0f);
+			local_ids[i] = reverse_table[species_id];
+		}
 	}
 
+	vtVF3Header header;
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, "vf3.0");
+	header.numinstances = numinstances;
+	header.numspecies = used;
+	header.numblocks = (int) blocks.size();
+	header.wkt_length = strWkt.GetLength() + 1;
+	header.names_length = (int) names.size();
+
+	FILE *fp = vtFileOpen(fname, "wb");
+	if (!fp)
+		return false;
+
+	fwrite(&header, sizeof(header), 1, fp);
+	fwrite((const char *) strWkt, header.wkt_length, 1, fp);
+	if (header.names_length > 0)
+		fwrite(names.c_str(), header.names_length, 1, fp);
+
+	const char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	const long written = sizeof(header) + header.wkt_length + header.names_length;
+	fwrite(padding, VF3BlockStart(header) - written, 1, fp);
+
+	fwrite(&blocks[0], sizeof(vtVF3Block), blocks.size(), fp);
+	fwrite(&offsets[0], sizeof(FPoint2), numinstances, fp);
+	fwrite(&heights[0], sizeof(short), numinstances, fp);
+	fwrite(&local_ids[0], sizeof(short), numinstances, fp);
+
 	fclose(fp);
 	return true;
 }
@@ -193,6 +193,14 @@ public:
  * It can be read from/written to the VF format ("vegetation file")
  * designed specifically for the purpose of storing plants, which makes
  * it very compact and much more efficient than, e.g. SHP format.
+ *
+ * Since version 3.0, a VF file has a fixed header followed by contiguous
+ * arrays of the positions, sizes and species of the plants, so it can be
+ * read with a few large reads.  As in earlier versions, each plant takes
+ * 12 bytes: a float offset from the origin of its block, and its height
+ * (in centimeters) and species as shorts.  The plants are grouped
+ * into spatial blocks, so the plants in one area of a large forest can be
+ * read without reading the whole file.
  */
 class vtPlantInstanceArray : public vtFeatureSetPoint2D
 {
@@ -207,9 +215,12 @@ public:
 	uint InstancesOfSpecies(short species_id);
 
 	bool ReadVF_version11(const char *fname);
-	bool ReadVF(const char *fname);
+	bool ReadVF(const char *fname, const DRECT *pArea = NULL);
 	bool ReadSHP(const char *fname);
-	bool WriteVF(const char *fname) const;
+	bool WriteVF(const char *fname, bool bBlocks = true) const;
+
+protected:
+	bool ReadVF_version3(const char *fname, const DRECT *pArea);
 
 protected:
 	vtSpeciesList *m_pSpeciesList;
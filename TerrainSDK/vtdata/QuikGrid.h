@@ -21,41 +21,8 @@
 #include "surfgrid.h"
 #include "contour.h"
 
-#include "HeightField.h"
-#include "Features.h"
-
 typedef void (*ContourCallback)(void *context, float x, float y, bool bStart);
 
 void SetQuikGridCallbackFunction(ContourCallback fn, void *context);
 
-class ContourConverter
-{
-public:
-	ContourConverter();
-	~ContourConverter();
-
-	/// Setup to generate line features
-	bool Setup(vtHeightFieldGrid3d *pHFGrid, vtFeatureSetLineString *fset);
-
-	void GenerateContour(float fAlt);
-	void GenerateContours(float fAInterval);
-	void Finish();
-	void Coord(float x, float y, bool bStart);
-
-protected:
-	bool SetupGrid(vtHeightFieldGrid3d *pHGGrid);
-	void Flush();
-
-	class SurfaceGrid *m_pGrid;
-
-	vtHeightFieldGrid3d *m_pHF;
-	DRECT m_ext;
-	DPoint2 m_spacing;
-	float m_fAltitude;
-	float m_fHeight;
-	DLine2	m_line;
-
-	vtFeatureSetLineString *m_pLS;
-};
-
 #endif // SUPPORT_QUIKGRID
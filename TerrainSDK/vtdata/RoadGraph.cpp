@@ -0,0 +1,159 @@
+//
+// RoadGraph.cpp
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "RoadGraph.h"
+
+#include <algorithm>	// for sort, lower_bound
+#include <limits.h>		// for INT_MIN
+
+vtRoadGraph::vtRoadGraph()
+{
+}
+
+void vtRoadGraph::Clear()
+{
+	m_NodePos.clear();
+	m_NodeID.clear();
+	m_Links.clear();
+	m_Points.clear();
+	m_AdjStart.clear();
+	m_AdjLinks.clear();
+	m_IdOrder.clear();
+}
+
+/**
+ * Allocate space ahead of time, when you know how much the graph will hold.
+ */
+void vtRoadGraph::Reserve(uint iNodes, uint iLinks, uint iPoints)
+{
+	m_NodePos.reserve(iNodes);
+	m_NodeID.reserve(iNodes);
+	m_Links.reserve(iLinks);
+	m_Points.reserve(iPoints);
+}
+
+/**
+ * Add a node.
+ * \return The index of the new node.
+ */
+int vtRoadGraph::AddNode(const DPoint2 &p, int id)
+{
+	m_NodePos.push_back(p);
+	m_NodeID.push_back(id);
+	return (int) m_NodePos.size() - 1;
+}
+
+/**
+ * Add a link between two nodes, with default attributes.  The points of the
+ * link are then added with AddPoint, before adding another link.
+ * \return The index of the new link.
+ */
+int vtRoadGraph::AddLink(int iNode0, int iNode1)
+{
+	vtRoadGraphLink link;
+	link.m_node[0] = iNode0;
+	link.m_node[1] = iNode1;
+	link.m_iFirstPoint = (uint) m_Points.size();
+	link.m_iNumPoints = 0;
+	link.m_eIntersection[0] = IT_NONE;
+	link.m_eIntersection[1] = IT_NONE;
+
+	// Same defaults as TLink
+	link.m_id = 0;
+	link.m_iHwy = -1;
+	link.m_iFlags = (RF_FORWARD|RF_REVERSE);
+	link.m_iLanes = 0;
+	link.m_Surface = SURFT_PAVED;
+	link.m_fLeftWidth = 1.0f;
+	link.m_fRightWidth = 1.0f;
+	link.m_fSidewalkWidth = SIDEWALK_WIDTH;
+	link.m_fCurbHeight = CURB_HEIGHT;
+	link.m_fMarginWidth = MARGIN_WIDTH;
+	link.m_fLaneWidth = LANE_WIDTH;
+	link.m_fParkingWidth = PARKING_WIDTH;
+
+	m_Links.push_back(link);
+	return (int) m_Links.size() - 1;
+}
+
+/**
+ * Add a point to the last link added.
+ */
+void vtRoadGraph::AddPoint(const DPoint2 &p)
+{
+	m_Points.push_back(p);
+	m_Links.back().m_iNumPoints++;
+}
+
+/**
+ * Build the adjacency (the links at each node), and the lookup of nodes by
+ * ID.  Call this once all the nodes and links have been added.  At each
+ * node, the links are in the order they were added.
+ */
+void vtRoadGraph::BuildAdjacency()
+{
+	const uint nodes = NumNodes();
+	const uint links = NumLinks();
+
+	// Count the links at each node, then turn the counts into offsets
+	m_AdjStart.assign(nodes + 1, 0);
+	uint i;
+	for (i = 0; i < links; i++)
+	{
+		m_AdjStart[m_Links[i].m_node[0] + 1]++;
+		if (m_Links[i].m_node[1] != m_Links[i].m_node[0])
+			m_AdjStart[m_Links[i].m_node[1] + 1]++;
+	}
+	for (i = 0; i < nodes; i++)
+		m_AdjStart[i + 1] += m_AdjStart[i];
+
+	std::vector<uint> fill(m_AdjStart.begin(), m_AdjStart.end() - 1);
+	m_AdjLinks.resize(m_AdjStart[nodes]);
+	for (i = 0; i < links; i++)
+	{
+		m_AdjLinks[fill[m_Links[i].m_node[0]]++] = i;
+		if (m_Links[i].m_node[1] != m_Links[i].m_node[0])
+			m_AdjLinks[fill[m_Links[i].m_node[1]]++] = i;
+	}
+
+	m_IdOrder.resize(nodes);
+	for (i = 0; i < nodes; i++)
+		m_IdOrder[i] = std::pair<int,int>(m_NodeID[i], i);
+	std::sort(m_IdOrder.begin(), m_IdOrder.end());
+}
+
+/**
+ * The number of links at a node.  Valid after BuildAdjacency.
+ */
+uint vtRoadGraph::NumNodeLinks(int iNode) const
+{
+	return m_AdjStart[iNode + 1] - m_AdjStart[iNode];
+}
+
+/**
+ * The indices of the links at a node.  Valid after BuildAdjacency.
+ */
+const int *vtRoadGraph::NodeLinks(int iNode) const
+{
+	if (NumNodeLinks(iNode) == 0)
+		return NULL;
+	return &m_AdjLinks[m_AdjStart[iNode]];
+}
+
+/**
+ * Find a node by its ID.  Valid after BuildAdjacency.
+ * \return The index of the node, or -1 if there is no node with that ID.
+ */
+int vtRoadGraph::FindNodeByID(int id) const
+{
+	std::vector< std::pair<int,int> >::const_iterator it =
+		std::lower_bound(m_IdOrder.begin(), m_IdOrder.end(),
+			std::pair<int,int>(id, INT_MIN));
+	if (it == m_IdOrder.end() || it->first != id)
+		return -1;
+	return it->second;
+}
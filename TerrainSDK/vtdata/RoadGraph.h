@@ -0,0 +1,116 @@
+//
+// RoadGraph.h
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef ROADGRAPHH
+#define ROADGRAPHH
+
+#include "RoadMap.h"
+
+/**
+ * The attributes of a link in a vtRoadGraph.  These are the same as those of
+ * a TLink, without its points or its connections.
+ */
+struct vtRoadGraphLink
+{
+	int		m_node[2];		// index of the "from" and "to" nodes
+	uint	m_iFirstPoint;	// index of the first point in the point buffer
+	uint	m_iNumPoints;	// number of points
+	IntersectionType m_eIntersection[2];	// how the link meets each node
+
+	int		m_id;
+	short	m_iHwy;
+	short	m_iFlags;
+	unsigned short m_iLanes;
+	SurfaceType m_Surface;
+	float	m_fLeftWidth;
+	float	m_fRightWidth;
+	float	m_fSidewalkWidth;
+	float	m_fCurbHeight;
+	float	m_fMarginWidth;
+	float	m_fLaneWidth;
+	float	m_fParkingWidth;
+};
+
+/**
+ * A compact representation of a road network: the nodes and links are kept
+ * in contiguous arrays, the points of all the links are in one shared
+ * buffer, and the links at each node are in a single adjacency array
+ * (compressed sparse rows).  Nodes and links are referred to by their index
+ * in the arrays, which does not change once they are added.
+ *
+ * This is meant for bulk work on large networks, which would otherwise
+ * spend much of its time following the pointers of vtRoadMap's linked
+ * lists.  For now it is only used to read and write RMF files, as a
+ * temporary copy of the network, so those briefly hold the network twice;
+ * the 3D road map and the editor still work on vtRoadMap.
+ * vtRoadMap::ToGraph and vtRoadMap::AddFromGraph convert between the two.
+ *
+ * Example:
+ \code
+	vtRoadGraph graph;
+	int n0 = graph.AddNode(DPoint2(0,0));
+	int n1 = graph.AddNode(DPoint2(100,0));
+	int link = graph.AddLink(n0, n1);
+	graph.AddPoint(DPoint2(0,0));
+	graph.AddPoint(DPoint2(100,0));
+	graph.BuildAdjacency();
+ \endcode
+ */
+class vtRoadGraph
+{
+public:
+	vtRoadGraph();
+
+	void Clear();
+	void Reserve(uint iNodes, uint iLinks, uint iPoints);
+
+	int AddNode(const DPoint2 &p, int id = 0);
+	int AddLink(int iNode0, int iNode1);
+	void AddPoint(const DPoint2 &p);
+	void BuildAdjacency();
+
+	uint NumNodes() const { return (uint) m_NodePos.size(); }
+	uint NumLinks() const { return (uint) m_Links.size(); }
+	uint NumPoints() const { return (uint) m_Points.size(); }
+
+	/// The position of a node.
+	DPoint2 &NodePos(int iNode) { return m_NodePos[iNode]; }
+	const DPoint2 &NodePos(int iNode) const { return m_NodePos[iNode]; }
+	/// The ID of a node, as read from a file.
+	int NodeID(int iNode) const { return m_NodeID[iNode]; }
+
+	/// A link's attributes.
+	vtRoadGraphLink &Link(int iLink) { return m_Links[iLink]; }
+	const vtRoadGraphLink &Link(int iLink) const { return m_Links[iLink]; }
+	/// The points of a link, which are contiguous in the point buffer.
+	DPoint2 *LinkPoints(int iLink) { return &m_Points[m_Links[iLink].m_iFirstPoint]; }
+	const DPoint2 *LinkPoints(int iLink) const { return &m_Points[m_Links[iLink].m_iFirstPoint]; }
+
+	/// All the points of all the links, in order of the links.
+	std::vector<DPoint2> &GetPoints() { return m_Points; }
+
+	// Adjacency, valid after BuildAdjacency
+	uint NumNodeLinks(int iNode) const;
+	const int *NodeLinks(int iNode) const;
+
+	int FindNodeByID(int id) const;
+
+protected:
+	std::vector<DPoint2> m_NodePos;
+	std::vector<int> m_NodeID;
+	std::vector<vtRoadGraphLink> m_Links;
+	std::vector<DPoint2> m_Points;
+
+	// The links at node i are m_AdjLinks[m_AdjStart[i] .. m_AdjStart[i+1]-1]
+	std::vector<uint> m_AdjStart;
+	std::vector<int> m_AdjLinks;
+
+	// Pairs of (ID, node index) sorted by ID, for FindNodeByID
+	std::vector< std::pair<int,int> > m_IdOrder;
+};
+
+#endif	// ROADGRAPHH
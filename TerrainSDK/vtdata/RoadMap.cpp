@@ -8,7 +8,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <algorithm>	// for sort, unique
 #include "RoadMap.h"
+#include "RoadGraph.h"
 #include "vtLog.h"
 #include "FilePath.h"
 
@@ -19,6 +21,11 @@
 // Convenience for writing one thing to file.
 #define FWrite(data,size) fwrite(data,size,1,fp)
 
+// The road index aims for about this many nodes in each cell.
+#define NODES_PER_CELL	2
+// It has no more than this many cells on a side.
+#define MAX_INDEX_SIDE	1024
+
 
 //diff a - b.  result between PI and -PI.
 float diffAngle(float a, float b)
@@ -496,6 +503,152 @@ void TLink::EstimateWidth(bool bIncludeSidewalk)
 }
 
 
+//
+// vtRoadIndex class
+//
+
+vtRoadIndex::vtRoadIndex()
+{
+	m_iCols = m_iRows = 0;
+}
+
+void vtRoadIndex::Clear()
+{
+	m_Nodes.clear();
+	m_Links.clear();
+	m_iCols = m_iRows = 0;
+}
+
+/**
+ * Build the index from the linked lists of nodes and links of a road map.
+ */
+void vtRoadIndex::Build(TNode *pFirstNode, TLink *pFirstLink)
+{
+	Clear();
+
+	// The index covers everything in the map
+	int iNodes = 0;
+	m_extent.SetInsideOut();
+	for (TNode *pN = pFirstNode; pN; pN = pN->GetNext())
+	{
+		m_extent.GrowToContainPoint(pN->Pos());
+		iNodes++;
+	}
+	for (TLink *pL = pFirstLink; pL; pL = pL->GetNext())
+		m_extent.GrowToContainLine(*pL);
+	if (m_extent.left > m_extent.right)
+		return;		// nothing to index
+
+	// Choose square cells, which hold a few nodes each on average
+	const double fWidth = std::max(m_extent.Width(), 1E-9);
+	const double fHeight = std::max(m_extent.Height(), 1E-9);
+	const double fCells = std::max(iNodes / NODES_PER_CELL, 1);
+	const double fSide = sqrt(fWidth * fHeight / fCells);
+	m_iCols = std::min(std::max((int) (fWidth / fSide), 1), MAX_INDEX_SIDE);
+	m_iRows = std::min(std::max((int) (fHeight / fSide), 1), MAX_INDEX_SIDE);
+	m_CellSize.Set(fWidth / m_iCols, fHeight / m_iRows);
+
+	m_Nodes.resize(m_iCols * m_iRows);
+	m_Links.resize(m_iCols * m_iRows);
+
+	int x0, y0, x1, y1;
+	for (TNode *pN = pFirstNode; pN; pN = pN->GetNext())
+	{
+		const DPoint2 &p = pN->Pos();
+		CellRange(DRECT(p.x, p.y, p.x, p.y), x0, y0, x1, y1);
+		m_Nodes[y0 * m_iCols + x0].push_back(pN);
+	}
+	for (TLink *pL = pFirstLink; pL; pL = pL->GetNext())
+	{
+		for (uint i = 1; i < pL->GetSize(); i++)
+		{
+			// Walk along long segments in steps of about one cell, so that
+			//  the link is only put in cells near the segment itself.
+			const DPoint2 &p0 = pL->GetAt(i-1);
+			const DPoint2 &p1 = pL->GetAt(i);
+			const DPoint2 diff = p1 - p0;
+			const int steps = 1 + (int) std::max(fabs(diff.x) / m_CellSize.x,
+				fabs(diff.y) / m_CellSize.y);
+			for (int s = 0; s < steps; s++)
+			{
+				DPoint2 a = p0 + diff * ((double) s / steps);
+				DPoint2 b = p0 + diff * ((double) (s+1) / steps);
+				DRECT rect(a.x, a.y, b.x, b.y);
+				rect.Sort();
+				CellRange(rect, x0, y0, x1, y1);
+				for (int y = y0; y <= y1; y++)
+					for (int x = x0; x <= x1; x++)
+					{
+						std::vector<TLink*> &cell = m_Links[y * m_iCols + x];
+						if (cell.empty() || cell.back() != pL)
+							cell.push_back(pL);
+					}
+			}
+		}
+	}
+}
+
+/**
+ * Find the nodes which are within a rectangle.
+ */
+void vtRoadIndex::FindNodes(const DRECT &rect, std::vector<TNode*> &result) const
+{
+	int x0, y0, x1, y1;
+	if (!CellRange(rect, x0, y0, x1, y1))
+		return;
+	for (int y = y0; y <= y1; y++)
+		for (int x = x0; x <= x1; x++)
+		{
+			const std::vector<TNode*> &cell = m_Nodes[y * m_iCols + x];
+			for (uint i = 0; i < cell.size(); i++)
+				if (rect.ContainsPoint(cell[i]->Pos(), true))
+					result.push_back(cell[i]);
+		}
+}
+
+/**
+ * Find the links which may be within a rectangle.  This is conservative: it
+ * returns every link which has a segment near the rectangle, each once, so
+ * the caller should still test the links it gets back.
+ */
+void vtRoadIndex::FindLinks(const DRECT &rect, std::vector<TLink*> &result) const
+{
+	int x0, y0, x1, y1;
+	if (!CellRange(rect, x0, y0, x1, y1))
+		return;
+	const size_t first = result.size();
+	for (int y = y0; y <= y1; y++)
+		for (int x = x0; x <= x1; x++)
+		{
+			const std::vector<TLink*> &cell = m_Links[y * m_iCols + x];
+			result.insert(result.end(), cell.begin(), cell.end());
+		}
+	// A link may be in several of the cells
+	std::sort(result.begin() + first, result.end());
+	result.erase(std::unique(result.begin() + first, result.end()), result.end());
+}
+
+// Find the range of cells which overlap a rectangle.  Returns false if the
+//  rectangle is outside the index.
+bool vtRoadIndex::CellRange(const DRECT &rect, int &x0, int &y0, int &x1, int &y1) const
+{
+	if (m_iCols == 0 ||
+		rect.right < m_extent.left || rect.left > m_extent.right ||
+		rect.top < m_extent.bottom || rect.bottom > m_extent.top)
+		return false;
+
+	x0 = (int) ((rect.left - m_extent.left) / m_CellSize.x);
+	x1 = (int) ((rect.right - m_extent.left) / m_CellSize.x);
+	y0 = (int) ((rect.bottom - m_extent.bottom) / m_CellSize.y);
+	y1 = (int) ((rect.top - m_extent.bottom) / m_CellSize.y);
+	x0 = std::max(x0, 0);
+	y0 = std::max(y0, 0);
+	x1 = std::min(x1, m_iCols-1);
+	y1 = std::min(y1, m_iRows-1);
+	return true;
+}
+
+
 //
 // RoadMap class
 //
@@ -504,6 +657,7 @@ vtRoadMap::vtRoadMap()
 {
 	// provide inital values for extent
 	m_bValidExtents = false;
+	m_bValidIndex = false;
 
 	m_pFirstLink = NULL;
 	m_pFirstNode = NULL;
@@ -532,6 +686,7 @@ void vtRoadMap::DeleteElements()
 		delete m_pFirstNode;
 		m_pFirstNode = nextN;
 	}
+	m_bValidIndex = false;
 }
 
 TNode *vtRoadMap::FindNodeByID(int id)
@@ -555,20 +710,146 @@ TNode *vtRoadMap::FindNodeAtPoint(const DPoint2 &point, double epsilon)
 
 	// a target rectangle, to quickly cull points too far away
 	DRECT target(point.x-epsilon, point.y+epsilon, point.x+epsilon, point.y-epsilon);
-	for (TNode *curNode = GetFirstNode(); curNode; curNode = curNode->GetNext())
+	std::vector<TNode*> nodes;
+	GetIndex().FindNodes(target, nodes);
+	for (uint i = 0; i < nodes.size(); i++)
 	{
-		if (!target.ContainsPoint(curNode->Pos()))
-			continue;
-		result = (curNode->Pos() - point).Length();
+		result = (nodes[i]->Pos() - point).Length();
 		if (result < dist)
 		{
-			closest = curNode;
+			closest = nodes[i];
 			dist = result;
 		}
 	}
 	return closest;
 }
 
+/**
+ * Get the spatial index of the nodes and links.  It is rebuilt if anything
+ * has changed since it was last built.
+ */
+const vtRoadIndex &vtRoadMap::GetIndex()
+{
+	if (!m_bValidIndex)
+	{
+		m_Index.Build(m_pFirstNode, m_pFirstLink);
+		m_bValidIndex = true;
+	}
+	return m_Index;
+}
+
+/**
+ * Copy the road map into a compact vtRoadGraph.  The nodes and links of the
+ * graph are in the same order as in the road map's lists.
+ *
+ * The nodes and links are first numbered (m_id) from 1, in order, as they
+ * are in an RMF file, so the graph index of a node is its ID - 1.
+ *
+ * eturn false if a link refers to a node which is not in the road map.
+ */
+bool vtRoadMap::ToGraph(vtRoadGraph &graph)
+{
+	int id = 1;
+	std::vector<const TNode*> nodes;
+	for (TNode *pN = m_pFirstNode; pN; pN = pN->GetNext())
+	{
+		pN->m_id = id++;
+		nodes.push_back(pN);
+	}
+	id = 1;
+	uint iPoints = 0;
+	for (TLink *pL = m_pFirstLink; pL; pL = pL->GetNext())
+	{
+		pL->m_id = id++;
+		iPoints += pL->GetSize();
+	}
+	graph.Clear();
+	graph.Reserve(nodes.size(), id - 1, iPoints);
+
+	for (uint i = 0; i < nodes.size(); i++)
+		graph.AddNode(nodes[i]->Pos(), nodes[i]->m_id);
+
+	int end[2];
+	for (TLink *pL = m_pFirstLink; pL; pL = pL->GetNext())
+	{
+		for (int e = 0; e < 2; e++)
+		{
+			const TNode *pN = pL->GetNode(e);
+			end[e] = pN ? pN->m_id - 1 : -1;
+			if (end[e] < 0 || end[e] >= (int) nodes.size() || nodes[end[e]] != pN)
+			{
+				VTLOG("ToGraph: link %d has a node which is not in the road map.\n", pL->m_id);
+				graph.Clear();
+				return false;
+			}
+		}
+		const int iLink = graph.AddLink(end[0], end[1]);
+		vtRoadGraphLink &link = graph.Link(iLink);
+		link.m_eIntersection[0] = pL->GetIntersectionType(0);
+		link.m_eIntersection[1] = pL->GetIntersectionType(1);
+		link.m_id = pL->m_id;
+		link.m_iHwy = pL->m_iHwy;
+		link.m_iFlags = pL->m_iFlags;
+		link.m_iLanes = pL->m_iLanes;
+		link.m_Surface = pL->m_Surface;
+		link.m_fLeftWidth = pL->m_fLeftWidth;
+		link.m_fRightWidth = pL->m_fRightWidth;
+		link.m_fSidewalkWidth = pL->m_fSidewalkWidth;
+		link.m_fCurbHeight = pL->m_fCurbHeight;
+		link.m_fMarginWidth = pL->m_fMarginWidth;
+		link.m_fLaneWidth = pL->m_fLaneWidth;
+		link.m_fParkingWidth = pL->m_fParkingWidth;
+		for (uint i = 0; i < pL->GetSize(); i++)
+			graph.AddPoint(pL->GetAt(i));
+	}
+	graph.BuildAdjacency();
+	return true;
+}
+
+/**
+ * Add the nodes and links of a vtRoadGraph to the road map.  They are made
+ * with AddNewNode and AddNewLink, so a subclass gets its own kind of node
+ * and link.
+ */
+void vtRoadMap::AddFromGraph(const vtRoadGraph &graph)
+{
+	std::vector<TNode*> nodes(graph.NumNodes());
+	for (uint i = 0; i < graph.NumNodes(); i++)
+	{
+		TNode *pN = AddNewNode();
+		pN->SetPos(graph.NodePos(i));
+		pN->m_id = graph.NodeID(i);
+		nodes[i] = pN;
+	}
+	for (uint i = 0; i < graph.NumLinks(); i++)
+	{
+		const vtRoadGraphLink &link = graph.Link(i);
+		TLink *pL = AddNewLink();
+		pL->m_id = link.m_id;
+		pL->m_iHwy = link.m_iHwy;
+		pL->m_iFlags = link.m_iFlags;
+		pL->m_iLanes = link.m_iLanes;
+		pL->m_Surface = link.m_Surface;
+		pL->m_fLeftWidth = link.m_fLeftWidth;
+		pL->m_fRightWidth = link.m_fRightWidth;
+		pL->m_fSidewalkWidth = link.m_fSidewalkWidth;
+		pL->m_fCurbHeight = link.m_fCurbHeight;
+		pL->m_fMarginWidth = link.m_fMarginWidth;
+		pL->m_fLaneWidth = link.m_fLaneWidth;
+		pL->m_fParkingWidth = link.m_fParkingWidth;
+
+		pL->SetSize(link.m_iNumPoints);
+		const DPoint2 *points = graph.LinkPoints(i);
+		for (uint j = 0; j < link.m_iNumPoints; j++)
+			pL->SetAt(j, points[j]);
+
+		pL->ConnectNodes(nodes[link.m_node[0]], nodes[link.m_node[1]]);
+		pL->SetIntersectionType(0, link.m_eIntersection[0]);
+		pL->SetIntersectionType(1, link.m_eIntersection[1]);
+	}
+	m_bValidIndex = false;
+}
+
 int	vtRoadMap::NumLinks() const
 {
 	int count = 0;
@@ -645,6 +926,8 @@ int vtRoadMap::RemoveUnusedNodes()
 		pN = next;
 	}
 	VTLOG("   %d of %d removed\n", unused, total);
+	if (unused)
+		m_bValidIndex = false;
 	return unused;
 }
 
@@ -667,6 +950,7 @@ void vtRoadMap::RemoveNode(TNode *pNode)
 			else
 				m_pFirstNode = next;
 			delete pN;
+			m_bValidIndex = false;
 			break;
 		}
 		else
@@ -694,6 +978,7 @@ void vtRoadMap::RemoveLink(TLink *pLink)
 			else
 				m_pFirstLink = next;
 			delete pL;
+			m_bValidIndex = false;
 			break;
 		}
 		else
@@ -812,29 +1097,30 @@ bool vtRoadMap::ReadRMF(const char *filename)
 		return false;
 	}
 
-	// Use a temporary array for fast lookup
-	TNodePtr *pNodeLookup = new TNodePtr[numNodes+1];
+	// Read everything into a compact graph, then make the nodes and links
+	//  from it all at once.
+	vtRoadGraph graph;
+	graph.Reserve(numNodes, numLinks, numLinks * 4);
 
-	// Read the nodes
+	// Read the nodes.  Their IDs are their place in the file, from 1.
 	int ivalue;
+	DPoint2 p;
 	for (i = 1; i <= numNodes; i++)
 	{
-		tmpNode = AddNewNode();
-		quiet = fread(&(tmpNode->m_id), intSize, 1, fp);
+		quiet = fread(&dummy, intSize, 1, fp);
 		if (version < 1.8f)
 		{
 			int x, y;
 			quiet = fread(&x, intSize, 1, fp);
 			quiet = fread(&y, intSize, 1, fp);
-			tmpNode->SetPos(DPoint2(x, y));
+			p.Set(x, y);
 		}
 		else
 		{
-			quiet = fread(&tmpNode->Pos().x, doubleSize, 1, fp);
-			quiet = fread(&tmpNode->Pos().y, doubleSize, 1, fp);
+			quiet = fread(&p.x, doubleSize, 1, fp);
+			quiet = fread(&p.y, doubleSize, 1, fp);
 		}
-		// add to quick lookup table
-		pNodeLookup[i] = tmpNode;
+		graph.AddNode(p, dummy);
 	}
 
 	quiet = fread(buffer,7,1,fp);
@@ -844,37 +1130,39 @@ bool vtRoadMap::ReadRMF(const char *filename)
 		return false;
 	}
 
-	// Read the links
+	// Read the links.  The nodes they connect aren't known until after their
+	//  points, so fill them in afterwards.
 	float ftmp;
 	int itmp;
 	int node_numbers[2];
 	for (i = 1; i <= numLinks; i++)
 	{
-		tmpLink = AddNewLink();
-		quiet = fread(&(tmpLink->m_id), intSize, 1, fp);	//id
+		const int iLink = graph.AddLink(-1, -1);
+		vtRoadGraphLink &link = graph.Link(iLink);
+		quiet = fread(&(link.m_id), intSize, 1, fp);	//id
 		if (version < 1.89)
 		{
 			quiet = fread(&itmp, intSize, 1, fp);			//highway number
-			tmpLink->m_iHwy = (short) itmp;
+			link.m_iHwy = (short) itmp;
 			quiet = fread(&ftmp, floatSize, 1, fp);	//width
 			quiet = fread(&itmp, intSize, 1, fp);			//number of lanes
-			tmpLink->m_iLanes = (unsigned short) itmp;
+			link.m_iLanes = (unsigned short) itmp;
 			quiet = fread(&itmp, intSize, 1, fp);			//surface type
-			tmpLink->m_Surface =  (SurfaceType) itmp;
+			link.m_Surface =  (SurfaceType) itmp;
 			quiet = fread(&itmp, intSize, 1, fp);			//FLAG
-			tmpLink->m_iFlags = (short) (itmp >> 16);
+			link.m_iFlags = (short) (itmp >> 16);
 		}
 		else
 		{
 			quiet = fread(&(dummy), 4, 1, fp);			//highway number
-			tmpLink->m_iHwy = (short) dummy;
+			link.m_iHwy = (short) dummy;
 			quiet = fread(&ftmp, floatSize, 1, fp);	//width
 			quiet = fread(&(dummy), 4, 1, fp);			//number of lanes
-			tmpLink->m_iLanes = (short) dummy;
+			link.m_iLanes = (short) dummy;
 			quiet = fread(&dummy, 4, 1, fp);			//surface type
-			tmpLink->m_Surface =  (SurfaceType) dummy;
+			link.m_Surface =  (SurfaceType) dummy;
 			quiet = fread(&(dummy), 4, 1, fp);			//FLAG
-			tmpLink->m_iFlags = dummy;
+			link.m_iFlags = dummy;
 		}
 
 		if (version < 1.89)
@@ -885,39 +1173,42 @@ bool vtRoadMap::ReadRMF(const char *filename)
 
 		if (version >= 2.0)
 		{
-			quiet = fread(&(tmpLink->m_fSidewalkWidth), floatSize, 1, fp);	// sidewalk width
-			quiet = fread(&(tmpLink->m_fCurbHeight), floatSize, 1, fp);		// curb height
-			quiet = fread(&(tmpLink->m_fMarginWidth), floatSize, 1, fp);	// margin width
-			quiet = fread(&(tmpLink->m_fLaneWidth), floatSize, 1, fp);		// lane width
-			quiet = fread(&(tmpLink->m_fParkingWidth), floatSize, 1, fp);	// parking width
+			quiet = fread(&(link.m_fSidewalkWidth), floatSize, 1, fp);	// sidewalk width
+			quiet = fread(&(link.m_fCurbHeight), floatSize, 1, fp);		// curb height
+			quiet = fread(&(link.m_fMarginWidth), floatSize, 1, fp);	// margin width
+			quiet = fread(&(link.m_fLaneWidth), floatSize, 1, fp);		// lane width
+			quiet = fread(&(link.m_fParkingWidth), floatSize, 1, fp);	// parking width
 		}
 		int size;
 		quiet = fread(&size, intSize, 1, fp);	// number of coordinates making the link
-		tmpLink->SetSize(size);
 
 		for (j = 0; j < size; j++)
 		{
 			if (version < 1.8f)
 			{
 				quiet = fread(&ivalue, intSize, 1, fp);
-				(*tmpLink)[j].x = ivalue;
+				p.x = ivalue;
 				quiet = fread(&ivalue, intSize, 1, fp);
-				(*tmpLink)[j].y = ivalue;
+				p.y = ivalue;
 			}
 			else
 			{
-				quiet = fread(&((*tmpLink)[j].x), doubleSize, 1, fp);
-				quiet = fread(&((*tmpLink)[j].y), doubleSize, 1, fp);
+				quiet = fread(&p.x, doubleSize, 1, fp);
+				quiet = fread(&p.y, doubleSize, 1, fp);
 			}
+			graph.AddPoint(p);
 		}
 
 		// The start/end nodes
 		quiet = fread(node_numbers, intSize, 2, fp);
 		if (node_numbers[0] < 1 || node_numbers[0] > numNodes ||
 			node_numbers[1] < 1 || node_numbers[1] > numNodes)
+		{
+			fclose(fp);
 			return false;
-		tmpLink->ConnectNodes(pNodeLookup[node_numbers[0]],
-							  pNodeLookup[node_numbers[1]]);
+		}
+		graph.Link(iLink).m_node[0] = node_numbers[0] - 1;
+		graph.Link(iLink).m_node[1] = node_numbers[1] - 1;
 	}
 
 	// Read traffic control information
@@ -928,6 +1219,7 @@ bool vtRoadMap::ReadRMF(const char *filename)
 		return false;
 	}
 
+	graph.BuildAdjacency();
 	for (i = 0; i < numNodes; i++)
 	{
 		int id, numLinks;
@@ -940,7 +1232,7 @@ bool vtRoadMap::ReadRMF(const char *filename)
 			return false;
 		}
 
-		tmpNode = pNodeLookup[id];
+		const int iNode = id - 1;
 		quiet = fread(&dummy, intSize, 1, fp);
 		quiet = fread(&numLinks, intSize, 1, fp);
 
@@ -955,16 +1247,21 @@ bool vtRoadMap::ReadRMF(const char *filename)
 			quiet = fread(&type, intSize, 1, fp);
 			quiet = fread(&lStatus, intSize, 1, fp);
 			//now figure out which links at the node get what behavior
-			id = tmpNode->FindLink(id);
-			if (id >= 0)
+			const int *links = graph.NodeLinks(iNode);
+			for (uint k = 0; k < graph.NumNodeLinks(iNode); k++)
 			{
-				tmpNode->SetIntersectType(id, type);
+				vtRoadGraphLink &link = graph.Link(links[k]);
+				if (link.m_id != id)
+					continue;
+				if (link.m_node[0] == iNode)
+					link.m_eIntersection[0] = type;
+				if (link.m_node[1] == iNode)
+					link.m_eIntersection[1] = type;
+				break;
 			}
 		}
 	}
-
-	// We don't need the lookup table any more
-	delete [] pNodeLookup;
+	AddFromGraph(graph);
 
 	//are we at end of file?
 	quiet = fread(buffer,8, 1, fp);
@@ -982,10 +1279,14 @@ bool vtRoadMap::WriteRMF(const char *filename)
 {
 	int i;
 
-	TNode *curNode = GetFirstNode();
-	TLink *curLink = GetFirstLink();
-	int numNodes = NumNodes();
-	int numLinks = NumLinks();
+	// Write from a compact copy of the network, in the same order.  This
+	//  sets the id numbers (1-based) of the nodes and links, so they are
+	//  their index + 1.
+	vtRoadGraph graph;
+	if (!ToGraph(graph))
+		return false;
+	int numNodes = graph.NumNodes();
+	int numLinks = graph.NumLinks();
 
 	// must have nodes, or saving will fail
 	if (numNodes == 0)
@@ -998,21 +1299,6 @@ bool vtRoadMap::WriteRMF(const char *filename)
 		return false;
 	}
 
-	// go through and set id numbers (1-based) for the nodes and links
-	i= 1;
-	while (curNode) {
-		curNode->m_id = i++;
-		curNode = curNode->GetNext();
-	}
-	i=1;
-	while (curLink) {
-		curLink->m_id = i++;
-		curLink = curLink->GetNext();
-	}
-
-	curNode = GetFirstNode();
-	curLink = GetFirstLink();
-
 	FWrite(RMFVERSION_STRING, 11);
 
 	// Projection
@@ -1034,68 +1320,73 @@ bool vtRoadMap::WriteRMF(const char *filename)
 	FWrite(&numLinks, intSize);  // number of links
 	FWrite("Nodes:",7);
 	//write nodes
-	while (curNode)
+	int id;
+	for (i = 0; i < numNodes; i++)
 	{
-		FWrite(&(curNode->m_id), intSize);		// id
-		FWrite(&curNode->Pos().x, doubleSize);	// coordinate
-		FWrite(&curNode->Pos().y, doubleSize);
-		curNode = curNode->GetNext();
+		id = i + 1;
+		FWrite(&id, intSize);						// id
+		FWrite(&graph.NodePos(i).x, doubleSize);	// coordinate
+		FWrite(&graph.NodePos(i).y, doubleSize);
 	}
 	FWrite("Roads:",7);
 	//write links
-	while (curLink)
+	int value;
+	for (i = 0; i < numLinks; i++)
 	{
-		float fWidth = curLink->GetTotalWidth();
-		FWrite(&(curLink->m_id), intSize);			//id
-		FWrite(&(curLink->m_iHwy), 4);				//highway number
+		const vtRoadGraphLink &link = graph.Link(i);
+		float fWidth = link.m_fLeftWidth + link.m_fRightWidth;
+		id = i + 1;
+		FWrite(&id, intSize);						//id
+		value = link.m_iHwy;
+		FWrite(&value, 4);							//highway number
 		FWrite(&(fWidth), floatSize);				//width
-		FWrite(&(curLink->m_iLanes), 4);			//number of lanes
-		FWrite(&(curLink->m_Surface), 4);			//surface type
-		FWrite(&(curLink->m_iFlags), 4);			//FLAG
-		FWrite(&(curLink->m_fSidewalkWidth), floatSize);	// sidewalk width
-		FWrite(&(curLink->m_fCurbHeight), floatSize);	// curb height
-		FWrite(&(curLink->m_fMarginWidth), floatSize);	// margin width
-		FWrite(&(curLink->m_fLaneWidth), floatSize);	// lane width width
-		FWrite(&(curLink->m_fParkingWidth), floatSize);	// parking width
-
-		int size = curLink->GetSize();
+		value = link.m_iLanes;
+		FWrite(&value, 4);							//number of lanes
+		value = link.m_Surface;
+		FWrite(&value, 4);							//surface type
+		value = link.m_iFlags;
+		FWrite(&value, 4);							//FLAG
+		FWrite(&(link.m_fSidewalkWidth), floatSize);	// sidewalk width
+		FWrite(&(link.m_fCurbHeight), floatSize);	// curb height
+		FWrite(&(link.m_fMarginWidth), floatSize);	// margin width
+		FWrite(&(link.m_fLaneWidth), floatSize);	// lane width width
+		FWrite(&(link.m_fParkingWidth), floatSize);	// parking width
+
+		int size = link.m_iNumPoints;
 		FWrite(&size, intSize);//number of coordinates making the link
-		for (i = 0; i < size; i++)
-		{
-			//coordinates that make the link
-			FWrite(&curLink->GetAt(i).x, doubleSize);
-			FWrite(&curLink->GetAt(i).y, doubleSize);
-		}
-		//nodes (endpoints)
-		FWrite(&(curLink->GetNode(0)->m_id), intSize);	//what link is at the end point?
-		FWrite(&(curLink->GetNode(1)->m_id), intSize);
+		//coordinates that make the link, which are contiguous
+		if (size > 0)
+			fwrite(graph.LinkPoints(i), sizeof(DPoint2), size, fp);
 
-		curLink = curLink->GetNext();
+		//nodes (endpoints)
+		id = link.m_node[0] + 1;
+		FWrite(&id, intSize);	//what link is at the end point?
+		id = link.m_node[1] + 1;
+		FWrite(&id, intSize);
 	}
 
 	int dummy = 0;
 
 	//write traffic control information
 	FWrite("Traffic:",9);
-	curNode = GetFirstNode();
-	while (curNode)
+	for (i = 0; i < numNodes; i++)
 	{
-		// safety check
-		if (curNode->m_id < 1 || curNode->m_id > numNodes)
-			return false;
-
-		int num_links = curNode->NumLinks();
-		FWrite(&(curNode->m_id), intSize);	//node ID
+		int num_links = graph.NumNodeLinks(i);
+		const int *links = graph.NodeLinks(i);
+		id = i + 1;
+		FWrite(&id, intSize);	//node ID
 		FWrite(&(dummy), intSize); //node traffic behavior
 		FWrite(&(num_links), intSize); //node traffic behavior
-		for (i = 0; i < num_links; i++) {
-			IntersectionType type = curNode->GetIntersectType(i);
+		for (int j = 0; j < num_links; j++) {
+			const vtRoadGraphLink &link = graph.Link(links[j]);
+			IntersectionType type = (link.m_node[0] == i) ?
+				link.m_eIntersection[0] : link.m_eIntersection[1];
 			int lStatus = 0;
-			FWrite(&(curNode->GetLink(i)->m_id), intSize);  //link ID
+			id = links[j] + 1;
+			FWrite(&id, intSize);  //link ID
 			FWrite(&type, intSize);  //get the intersection type associated with that link
 			FWrite(&lStatus,intSize);
 		}
-		curNode = curNode->GetNext();
 	}
 
 	//EOF
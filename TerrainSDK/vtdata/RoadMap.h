@@ -55,6 +55,7 @@ enum IntersectionType {
 // Nodes and Links refer to each other, so use forward declarations
 class TNode;
 class TLink;
+class vtRoadGraph;
 
 /**
  * A Transporation Node is a place where 2 or more links meet.
@@ -219,6 +220,38 @@ protected:
 typedef TLink *LinkPtr;
 typedef TNode *TNodePtr;
 
+/**
+ * A uniform grid over the nodes and link segments of a road map, so that
+ * the nodes and links near a point can be found without visiting every one.
+ * Each node is in the cell which contains it; each link is in every cell
+ * touched by the bounding box of one of its segments.
+ *
+ * The index is a snapshot: it must be rebuilt whenever nodes or links are
+ * added, removed or moved.  vtRoadMap does this for you, see
+ * vtRoadMap::GetIndex.
+ */
+class vtRoadIndex
+{
+public:
+	vtRoadIndex();
+
+	void Build(TNode *pFirstNode, TLink *pFirstLink);
+	void Clear();
+
+	void FindNodes(const DRECT &rect, std::vector<TNode*> &result) const;
+	void FindLinks(const DRECT &rect, std::vector<TLink*> &result) const;
+
+protected:
+	bool CellRange(const DRECT &rect, int &x0, int &y0, int &x1, int &y1) const;
+
+	DRECT	m_extent;
+	DPoint2	m_CellSize;
+	int		m_iCols, m_iRows;
+
+	std::vector< std::vector<TNode*> > m_Nodes;
+	std::vector< std::vector<TLink*> > m_Links;
+};
+
 /**
  * vtRoadMap contains a sets of nodes (TNode) and links (TLink) which define
  * a transportation network.
@@ -251,11 +284,13 @@ public:
 	{
 		pNode->SetNext(m_pFirstNode);
 		m_pFirstNode = pNode;
+		m_bValidIndex = false;
 	}
 	void AddLink(TLink *pLink)
 	{
 		pLink->SetNext(m_pFirstLink);
 		m_pFirstLink = pLink;
+		m_bValidIndex = false;
 	}
 
 	virtual TNode *AddNewNode()
@@ -282,6 +317,15 @@ public:
 	TNode *FindNodeByID(int id);
 	TNode *FindNodeAtPoint(const DPoint2 &point, double epsilon);
 
+	// spatial index of the nodes and links, rebuilt when needed
+	const vtRoadIndex &GetIndex();
+	/// Call when nodes or links have been moved, added or removed directly.
+	void InvalidateIndex() { m_bValidIndex = false; }
+
+	// conversion to and from the compact, array-based representation
+	bool ToGraph(vtRoadGraph &graph);
+	void AddFromGraph(const vtRoadGraph &graph);
+
 	// cleaning function: remove unused nodes, return the number removed
 	int RemoveUnusedNodes();
 
@@ -294,6 +338,9 @@ protected:
 	DRECT	m_extents;			// the extent of the roads in the RoadMap
 	bool	m_bValidExtents;	// true when extents are computed
 
+	vtRoadIndex	m_Index;
+	bool	m_bValidIndex;		// true when m_Index is up to date
+
 	TLink	*m_pFirstLink;
 	TNode	*m_pFirstNode;
 
@@ -12,8 +12,10 @@
 #pragma warning( disable : 4786 )
 #endif
 
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #include "shapelib/shapefil.h"
 #include "xmlhelper/easyxml.hpp"
@@ -27,6 +29,12 @@
 #include "StructArray.h"
 #include "vtLog.h"
 
+// When reading a VTST file, this many structures are parsed together as
+//  one block, and the blocks are parsed in parallel.
+#define XML_BLOCK_STRUCTURES	512
+// The progress callback is called after each batch of this many blocks.
+#define XML_BATCH_BLOCKS		64
+
 vtStructureArray g_DefaultStructures;
 
 
@@ -923,11 +931,55 @@ RGBi ParseHexColor(const char *str)
 	return color;
 }
 
+/**
+ * Look up a material by name.  If we don't have it, add a dummy material
+ * with that name.
+ */
+const vtString *FindOrAddMaterial(const char *name)
+{
+	vtMaterialDescriptorArray *mats = GetGlobalMaterials();
+	const vtString *found = mats->FindName(name);
+	if (found == NULL)
+	{
+		// What to do when a VTST references a material that
+		// we don't have?  We don't want to lose the material
+		// name information, and we also don't want to crash
+		// later with a NULL material.  So, make a dummy.
+		vtMaterialDescriptor *mat;
+		mat = new vtMaterialDescriptor(name, "", VT_MATERIAL_COLOURABLE);
+		mat->SetRGB(RGBi(255,255,255));	// white means: missing
+		mats->push_back(mat);
+		found = &mat->GetName();
+	}
+	return found;
+}
+
+/**
+ * The structures parsed from one block of a VTST file.  Blocks are parsed
+ * in parallel, so they don't add to the array or the global materials
+ * directly; the structures are added, and any missing materials are made,
+ * when the blocks are merged in order.
+ *
+ * Buildings ask their CRS for its units, and an OGRSpatialReference can't
+ * be used from several threads, so each block has its own copy of the CRS
+ * until the merge.
+ */
+struct StructBlock
+{
+	StructBlock() : m_bFailed(false) {}
+
+	vtProjection m_proj;
+	std::vector<vtStructure*> m_Structures;
+	std::vector<vtEdge*> m_MissingEdges;	// edges whose material we lack
+	std::vector<string> m_MissingNames;		// and the names of those materials
+	bool m_bFailed;
+};
+
 class StructVisitorGML : public XMLVisitor
 {
 public:
-	StructVisitorGML(vtStructureArray *sa) :
-	  m_state(0), m_pSA(sa) {}
+	StructVisitorGML(vtStructureArray *sa, StructBlock *block = NULL) :
+	  m_state(0), m_pSA(sa), m_pBlock(block) {}
 	void startXML() { m_state = 0; }
 	void endXML() { m_state = 0; }
 	void startElement(const char *name, const XMLAttributes &atts);
@@ -935,10 +987,16 @@ public:
 	void data(const char *s, int length);
 
 private:
+	vtBuilding *AddBuilding();
+	vtFence *AddFence();
+	vtStructInstance *AddInstance();
+	void SetEdgeMaterial(const char *name);
+
 	string m_data;
 	int m_state;
 
 	vtStructureArray *m_pSA;
+	StructBlock *m_pBlock;
 	vtStructure *m_pStructure;
 	vtBuilding *m_pBuilding;
 	vtStructInstance *m_pInstance;
@@ -951,6 +1009,54 @@ private:
 	int m_iEdge;
 };
 
+vtBuilding *StructVisitorGML::AddBuilding()
+{
+	if (!m_pBlock)
+		return m_pSA->AddNewBuilding();
+
+	vtBuilding *nb = m_pSA->NewBuilding();
+	nb->SetCRS(&m_pBlock->m_proj);
+	m_pBlock->m_Structures.push_back(nb);
+	return nb;
+}
+
+vtFence *StructVisitorGML::AddFence()
+{
+	if (!m_pBlock)
+		return m_pSA->AddNewFence();
+
+	vtFence *nf = m_pSA->NewFence();
+	m_pBlock->m_Structures.push_back(nf);
+	return nf;
+}
+
+vtStructInstance *StructVisitorGML::AddInstance()
+{
+	if (!m_pBlock)
+		return m_pSA->AddNewInstance();
+
+	vtStructInstance *ni = m_pSA->NewInstance();
+	m_pBlock->m_Structures.push_back(ni);
+	return ni;
+}
+
+void StructVisitorGML::SetEdgeMaterial(const char *name)
+{
+	if (!m_pBlock)
+	{
+		m_pEdge->m_pMaterial = FindOrAddMaterial(name);
+		return;
+	}
+	// Other blocks may be reading the materials, so only look; any missing
+	//  material is made when this block is merged.
+	m_pEdge->m_pMaterial = GetGlobalMaterials()->FindName(name);
+	if (m_pEdge->m_pMaterial == NULL)
+	{
+		m_pBlock->m_MissingEdges.push_back(m_pEdge);
+		m_pBlock->m_MissingNames.push_back(name);
+	}
+}
+
 void StructVisitorGML::startElement(const char *name, const XMLAttributes &atts)
 {
 	const char *attval;
@@ -969,14 +1075,14 @@ void StructVisitorGML::startElement(const char *name, const XMLAttributes &atts)
 	{
 		if (!strcmp(name, "Building"))
 		{
-			m_pBuilding = m_pSA->AddNewBuilding();
+			m_pBuilding = AddBuilding();
 			m_pStructure = m_pBuilding;
 			m_state = 2;
 			m_iLevel = 0;
 		}
 		else if (!strcmp(name, "Linear"))
 		{
-			m_pFence = m_pSA->AddNewFence();
+			m_pFence = AddFence();
 			m_pFence->GetParams().Blank();
 			m_pStructure = m_pFence;
 
@@ -992,7 +1098,7 @@ void StructVisitorGML::startElement(const char *name, const XMLAttributes &atts)
 		}
 		else if (!strcmp(name, "Imported"))
 		{
-			m_pInstance = m_pSA->AddNewInstance();
+			m_pInstance = AddInstance();
 			m_pStructure = m_pInstance;
 
 			m_state = 20;
@@ -1040,22 +1146,7 @@ void StructVisitorGML::startElement(const char *name, const XMLAttributes &atts)
 
 				attval = atts.getValue("Material");
 				if (attval)
-				{
-					vtMaterialDescriptorArray *mats = GetGlobalMaterials();
-					m_pEdge->m_pMaterial = mats->FindName(attval);
-					if (m_pEdge->m_pMaterial == NULL)
-					{
-						// What to do when a VTST references a material that
-						// we don't have?  We don't want to lose the material
-						// name information, and we also don't want to crash
-						// later with a NULL material.  So, make a dummy.
-						vtMaterialDescriptor *mat;
-						mat = new vtMaterialDescriptor(attval, "", VT_MATERIAL_COLOURABLE);
-						mat->SetRGB(RGBi(255,255,255));	// white means: missing
-						mats->push_back(mat);
-						m_pEdge->m_pMaterial = &mat->GetName();
-					}
-				}
+					SetEdgeMaterial(attval);
 				attval = atts.getValue("Color");
 				if (attval)
 					m_pEdge->m_Color = ParseHexColor(attval);
@@ -1212,8 +1303,8 @@ void DLine2FromString(const char *data, DLine2 &line)
 	// Speed/memory optimization: quick check of how many vertices
 	//  there are, then preallocate that many
 	uint verts = 0;
-	for (size_t i = 0; i < strlen(data); i++)
-		if (data[i] == ',')
+	for (const char *c = data; *c; c++)
+		if (*c == ',')
 			verts++;
 	line.Clear();
 	line.SetMaxSize(verts);
@@ -1367,7 +1458,7 @@ void StructVisitorGML::endElement(const char *name)
 
 void StructVisitorGML::data(const char *s, int length)
 {
-	m_data.append(string(s, length));
+	m_data.append(s, length);
 }
 
 /////////////////////////////////////////////////////////////////////////
@@ -1433,6 +1524,186 @@ bool vtStructureArray::WriteXML(const char* filename, bool bGZip) const
 	return true;
 }
 
+/**
+ * Read a whole file into memory, uncompressing it if it is gzipped.
+ * The XML parser takes an int length, so (uncompressed) files of INT_MAX
+ * bytes or more are refused.
+ */
+static bool ReadWholeFile(const char *pathname, std::vector<char> &buf)
+{
+	gzFile fp = vtGZOpen(pathname, "rb");
+	if (!fp)
+		return false;
+
+	const unsigned chunk = 1 << 20;
+	int count;
+	do
+	{
+		const size_t used = buf.size();
+		if (used > (size_t) INT_MAX - chunk)
+		{
+			VTLOG(" File is too large to parse (2 GB or more).\n");
+			gzclose(fp);
+			buf.clear();
+			return false;
+		}
+		buf.resize(used + chunk);
+		count = gzread(fp, &buf[used], chunk);
+		buf.resize(used + (count > 0 ? count : 0));
+	}
+	while (count == (int) chunk);
+	gzclose(fp);
+	return (count >= 0);
+}
+
+/**
+ * Find the next start tag of a structure (Building, Linear or Imported)
+ * in a null-terminated buffer.
+ */
+static const char *FindStructureStart(const char *p)
+{
+	while ((p = strchr(p, '<')) != NULL)
+	{
+		p++;
+		int len = 0;
+		if (!strncmp(p, "Building", 8))
+			len = 8;
+		else if (!strncmp(p, "Linear", 6))
+			len = 6;
+		else if (!strncmp(p, "Imported", 8))
+			len = 8;
+		if (len && p[len] != 0 && strchr(" \t\r\n/>", p[len]))
+			return p - 1;
+	}
+	return NULL;
+}
+
+/**
+ * Parse the structures of a GML-style VTST in blocks, in parallel.  Each
+ * block is a run of whole structures, wrapped in its own collection
+ * element, so it can be parsed by itself.  The results are the same as
+ * parsing the whole file, in the same order.
+ *
+ * \return false if the file could not be parsed this way, in which case
+ *		nothing has been added to the array.
+ */
+static bool ReadGMLBlocks(vtStructureArray *sa, const std::vector<char> &buf,
+						  const char *pathname, bool progress_callback(int))
+{
+	const char *text = &buf[0];
+
+	// Anything that might make a block mean something different by itself
+	//  (a DTD, or the CRS after the structures) rules out this approach.
+	const char *first = FindStructureStart(text);
+	if (!first || strstr(text, "<!DOCTYPE") || strstr(first, "<SRS"))
+		return false;
+	const char *last = strstr(first, "</StructureCollection");
+	if (!last)
+		return false;
+
+	// The start of every block
+	std::vector<const char *> starts;
+	int num = 0;
+	for (const char *p = first; p && p < last; p = FindStructureStart(p + 1))
+	{
+		if (num % XML_BLOCK_STRUCTURES == 0)
+			starts.push_back(p);
+		num++;
+	}
+	starts.push_back(last);
+	const int blocks = (int) starts.size() - 1;
+
+	// Each block gets the XML declaration, if any, so that it has the same
+	//  encoding as the file.
+	string decl;
+	if (!strncmp(text, "<?xml", 5))
+	{
+		const char *close = strstr(text, "?>");
+		if (close)
+			decl.assign(text, close + 2 - text);
+	}
+
+	// The part before the first structure has the CRS.
+	try
+	{
+		StructVisitorGML visitor(sa);
+		string head(text, first - text);
+		head += "</StructureCollection>";
+		readXMLBuffer(head.c_str(), (int) head.length(), visitor, pathname);
+	}
+	catch (xh_exception &)
+	{
+		return false;
+	}
+
+	VTLOG(" %d structures in %d blocks\n", num, blocks);
+	std::vector<StructBlock> results(blocks);
+	bool bFailed = false;
+	for (int b0 = 0; b0 < blocks && !bFailed; b0 += XML_BATCH_BLOCKS)
+	{
+		if (progress_callback != NULL)
+			progress_callback(b0 * 99 / blocks);
+
+		const int b1 = std::min(b0 + XML_BATCH_BLOCKS, blocks);
+		int b;
+		for (b = b0; b < b1; b++)
+			results[b].m_proj = sa->m_proj;
+#pragma omp parallel for schedule(dynamic, 1)
+		for (b = b0; b < b1; b++)
+		{
+			StructBlock &block = results[b];
+			try
+			{
+				StructVisitorGML visitor(sa, &block);
+				string str = decl;
+				str += "<StructureCollection>";
+				str.append(starts[b], starts[b+1] - starts[b]);
+				str += "</StructureCollection>";
+				readXMLBuffer(str.c_str(), (int) str.length(), visitor, pathname);
+			}
+			catch (...)
+			{
+				block.m_bFailed = true;
+			}
+		}
+		for (b = b0; b < b1; b++)
+			if (results[b].m_bFailed)
+				bFailed = true;
+	}
+
+	if (bFailed)
+	{
+		for (int b = 0; b < blocks; b++)
+			for (uint i = 0; i < results[b].m_Structures.size(); i++)
+				delete results[b].m_Structures[i];
+		return false;
+	}
+
+	// Merge the blocks in order
+	sa->reserve(sa->size() + num);
+	for (int b = 0; b < blocks; b++)
+	{
+		StructBlock &block = results[b];
+		for (uint i = 0; i < block.m_MissingEdges.size(); i++)
+		{
+			block.m_MissingEdges[i]->m_pMaterial =
+				FindOrAddMaterial(block.m_MissingNames[i].c_str());
+		}
+		for (uint i = 0; i < block.m_Structures.size(); i++)
+		{
+			vtBuilding *bld = block.m_Structures[i]->GetBuilding();
+			if (bld)
+				bld->SetCRS(&sa->m_proj);
+		}
+		sa->insert(sa->end(), block.m_Structures.begin(), block.m_Structures.end());
+	}
+	return true;
+}
+
+/**
+ * Read a VTST file.  The whole file is read into memory first, and the
+ * structures of current (GML-style) files are parsed in parallel blocks.
+ */
 bool vtStructureArray::ReadXML(const char *pathname, bool progress_callback(int))
 {
 	VTLOG("vtStructureArray::ReadXML: ");
@@ -1442,65 +1713,52 @@ bool vtStructureArray::ReadXML(const char *pathname, bool progress_callback(int)
 	//  So, push the 'standard' locale, it is restored when it goes out of scope.
 	ScopedLocale normal_numbers(LC_NUMERIC, "C");
 
-	// check to see if it's old or new format
-	bool bOldFormat = false;
-	gzFile fp = vtGZOpen(pathname, "r");
-	if (!fp)
+	std::vector<char> buf;
+	if (!ReadWholeFile(pathname, buf))
 		return false;
 
 	m_strFilename = pathname;
 
-	gzseek(fp, 24, SEEK_SET);
-	char buf[10];
-	gzread(fp, buf, 10);
-	if (!strncmp(buf, "structures", 10))
+	// check to see if it's old or new format
+	bool bOldFormat = false;
+	if (buf.size() >= 34 && !strncmp(&buf[24], "structures", 10))
 		bOldFormat = true;
-	else
+	else if (buf.size() >= 36 && !strncmp(&buf[26], "structures", 10))
 	{
 		// RFJ quick hack for extra carriage returns
-		gzseek(fp, 26, SEEK_SET);
-		gzread(fp, buf, 10);
-		if (!strncmp(buf, "structures", 10))
-			bOldFormat = true;
+		bOldFormat = true;
 	}
 
-	gzclose(fp);
+	// Terminate the text, so that we can search it.  ReadWholeFile has
+	//  already refused anything too long for an int.
+	const int iLength = (int) buf.size();
+	buf.push_back(0);
+
+	if (!bOldFormat && ReadGMLBlocks(this, buf, pathname, progress_callback))
+		return true;
 
-	bool success = false;
-	if (bOldFormat)
+	// Otherwise, parse it as a whole
+	try
 	{
-		StructureVisitor visitor(this);
-		try
+		if (bOldFormat)
 		{
-			readXML(pathname, visitor, progress_callback);
-			success = true;
+			StructureVisitor visitor(this);
+			readXMLBuffer(&buf[0], iLength, visitor, pathname);
 		}
-		catch (xh_exception &ex)
+		else
 		{
-			// TODO: would be good to pass back the error message.
-			VTLOG1("XML Error: ");
-			VTLOG1(ex.getFormattedMessage().c_str());
-			return false;
+			StructVisitorGML visitor(this);
+			readXMLBuffer(&buf[0], iLength, visitor, pathname);
 		}
 	}
-	else
+	catch (xh_exception &ex)
 	{
-		StructVisitorGML visitor(this);
-		try
-		{
-			readXML(pathname, visitor, progress_callback);
-			success = true;
-		}
-		catch (xh_exception &ex)
-		{
-			// TODO: would be good to pass back the error message.
-			VTLOG1("XML Error: ");
-			VTLOG1(ex.getFormattedMessage().c_str());
-			return false;
-		}
+		// TODO: would be good to pass back the error message.
+		VTLOG1("XML Error: ");
+		VTLOG1(ex.getFormattedMessage().c_str());
+		return false;
 	}
-
-	return success;
+	return true;
 }
 
 bool vtStructureArray::WriteFootprintsToSHP(const char* filename)
@@ -61,10 +61,24 @@ typedef enum
 	SCHEMA_UI
 } SchemaType;
 
+/**
+ * An entry in the block index of a binary structure file (.vtsb).  Each
+ * block holds the structures in one part of the file's extent.
+ */
+struct vtStructureBlock
+{
+	DRECT	m_extent;	// extent of the block's structures
+	long	m_offset;	// where the block starts in the file
+	int		m_size;		// size of the block in bytes
+	int		m_count;	// number of structures in the block
+	bool	m_bRead;	// true once the block has been read
+};
+
 /**
  * The vtStructureArray class contains a list of Built Structures
  * (vtStructure objects).  It can be loaded and saved to VTST files
- * with the ReadXML and WriteXML methods.
+ * with the ReadXML and WriteXML methods, and to binary VTSB files with
+ * the ReadBinary and WriteBinary methods.
  *
  */
 class vtStructureArray : public std::vector<vtStructure*>
@@ -105,6 +119,13 @@ public:
 	bool ReadXML(const char *pathname, bool progress_callback(int) = NULL);
 
 	bool WriteXML(const char *pathname, bool bGZip = false) const;
+
+	// binary format, which can be read an area at a time
+	bool ReadBinary(const char *pathname, const DRECT *pArea = NULL);
+	bool ReadBinaryIndex(const char *pathname);
+	int ReadBinaryBlocks(const DRECT *pArea);
+	bool HasUnreadBlocks() const;
+	bool WriteBinary(const char *pathname) const;
 	bool WriteFootprintsToSHP(const char *pathname);
 	bool WriteFootprintsToCanoma3DV(const char *pathname, const DRECT *area,
 		const vtHeightField *pHF);	
@@ -160,12 +181,16 @@ protected:
 	int m_iEditLevel;
 	int m_iEditEdge;
 	int m_iLastSelected;
+
+	// The block index of the binary file we are reading, if any
+	std::vector<vtStructureBlock> m_Blocks;
 };
 
 extern vtStructureArray g_DefaultStructures;
 
 // Helpers
 int GetSHPType(const char *filename);
+const vtString *FindOrAddMaterial(const char *name);
 
 bool SetupDefaultStructures(const vtString &fname);
 vtBuilding *GetClosestDefault(vtBuilding *pBld);
@@ -0,0 +1,852 @@
+//
+// Binary (.vtsb) file methods for the vtStructureArray class.
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+
+#include "Building.h"
+#include "Fence.h"
+#include "FilePath.h"
+#include "StructArray.h"
+#include "vtLog.h"
+
+// When writing, the structures are sorted into square blocks of about this
+//  many structures each.
+#define VTSB_STRUCTURES_PER_BLOCK	256
+
+// A VTSB file consists of:
+//  - the header (vtSBHeader)
+//  - the CRS as WKT, 0-terminated (wkt_length bytes)
+//  - padding to a multiple of 8 bytes
+//  - the block index (numblocks * vtSBBlockEntry)
+//  - the blocks, one after another
+//
+// Each block stands alone, so it can be read with a single seek.  It is a
+//  vtSBBlockHeader, followed by flat tables of the records below, in the
+//  order of the header's counts, then the block's strings.  Each table is
+//  padded to a multiple of 8 bytes.  Records refer to each other by their
+//  index in the block, and to strings by their offset in the block's
+//  strings; -1 means none.
+struct vtSBHeader {
+	char magic[8];		// "vtsb1.0"
+	int numstructures;
+	int numblocks;
+	int wkt_length;
+	int reserved;
+};
+
+struct vtSBBlockEntry {
+	DRECT extent;
+	int count;			// number of structures
+	int size;			// size of the block, in bytes
+};
+
+struct vtSBBlockHeader {
+	int structures;
+	int tags;
+	int levels;
+	int rings;
+	int edges;
+	int features;
+	int points;			// DPoint2 for footprints and fence paths
+	int fences;
+	int instances;
+	int strings_length;
+};
+
+struct vtSBStructure {
+	int type;			// vtStructureType
+	int absolute;
+	float elevation_offset;
+	int first_tag;
+	int num_tags;
+	int first;			// first level (building), or the fence or instance
+	int count;			// number of levels (building)
+	int reserved;
+};
+
+struct vtSBTag {
+	int name;
+	int value;
+};
+
+struct vtSBLevel {
+	float story_height;
+	int stories;
+	int first_ring;		// the footprint: outer ring, then any inner rings
+	int num_rings;
+	int first_edge;
+	int num_edges;
+};
+
+struct vtSBRing {
+	int first_point;
+	int num_points;
+};
+
+struct vtSBEdge {
+	int material;
+	int facade;
+	int slope;
+	short color[3];
+	short reserved;
+	int first_feature;
+	int num_features;
+};
+
+struct vtSBFeature {
+	int code;
+	short color[3];
+	short reserved;
+	float width;
+	float vf1;
+	float vf2;
+};
+
+struct vtSBFence {
+	int first_point;
+	int num_points;
+	int post_type;
+	int post_extension;
+	int connect_type;
+	int connect_material;
+	int connect_profile;
+	short connect_slope;
+	short constant_top;
+	float post_height;
+	float post_spacing;
+	float post_width;
+	float post_depth;
+	float connect_top;
+	float connect_bottom;
+	float connect_width;
+};
+
+struct vtSBInstance {
+	DPoint2 p;
+	float rotation;
+	float scale;
+};
+
+static size_t SBAlign(size_t n)
+{
+	return (n + 7) & ~(size_t)7;
+}
+
+// The offset in a VTSB file of the block index
+static long SBIndexStart(const vtSBHeader &header)
+{
+	return (long) SBAlign(sizeof(vtSBHeader) + header.wkt_length);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Writing
+
+/**
+ * Builds the tables of one block.
+ */
+class vtSBBlockWriter
+{
+public:
+	void AddStructure(const vtStructure *str);
+	void Write(std::vector<char> &out) const;
+
+protected:
+	int AddString(const vtString &str);
+	int AddPoints(const DLine2 &line);
+
+	std::vector<vtSBStructure> m_Structures;
+	std::vector<vtSBTag> m_Tags;
+	std::vector<vtSBLevel> m_Levels;
+	std::vector<vtSBRing> m_Rings;
+	std::vector<vtSBEdge> m_Edges;
+	std::vector<vtSBFeature> m_Features;
+	std::vector<DPoint2> m_Points;
+	std::vector<vtSBFence> m_Fences;
+	std::vector<vtSBInstance> m_Instances;
+
+	std::string m_Strings;
+	std::map<std::string, int> m_StringOffsets;
+};
+
+int vtSBBlockWriter::AddString(const vtString &str)
+{
+	if (str.IsEmpty())
+		return -1;
+	const std::string key((const char *) str);
+	std::map<std::string, int>::const_iterator it = m_StringOffsets.find(key);
+	if (it != m_StringOffsets.end())
+		return it->second;
+	const int offset = (int) m_Strings.size();
+	m_Strings.append(key.c_str(), key.length() + 1);
+	m_StringOffsets[key] = offset;
+	return offset;
+}
+
+int vtSBBlockWriter::AddPoints(const DLine2 &line)
+{
+	const int first = (int) m_Points.size();
+	for (uint i = 0; i < line.GetSize(); i++)
+		m_Points.push_back(line[i]);
+	return first;
+}
+
+void vtSBBlockWriter::AddStructure(const vtStructure *str)
+{
+	vtSBStructure rec;
+	memset(&rec, 0, sizeof(rec));
+	rec.type = str->GetType();
+	rec.absolute = str->GetAbsolute();
+	rec.elevation_offset = str->GetElevationOffset();
+	rec.first_tag = (int) m_Tags.size();
+	rec.num_tags = str->NumTags();
+	for (int i = 0; i < rec.num_tags; i++)
+	{
+		const vtTag *tag = str->GetTag(i);
+		vtSBTag t;
+		t.name = AddString(tag->name);
+		t.value = AddString(tag->value);
+		m_Tags.push_back(t);
+	}
+
+	// The type accessors aren't const, but we only read through them.
+	vtStructure *s = const_cast<vtStructure *>(str);
+	if (vtBuilding *bld = s->GetBuilding())
+	{
+		rec.first = (int) m_Levels.size();
+		rec.count = bld->NumLevels();
+		for (int i = 0; i < rec.count; i++)
+		{
+			const vtLevel *lev = bld->GetLevel(i);
+			const DPolygon2 &foot = lev->GetFootprint();
+
+			vtSBLevel l;
+			l.story_height = lev->m_fStoryHeight;
+			l.stories = lev->m_iStories;
+			l.first_ring = (int) m_Rings.size();
+			l.num_rings = (int) foot.size();
+			for (uint j = 0; j < foot.size(); j++)
+			{
+				vtSBRing r;
+				r.first_point = AddPoints(foot[j]);
+				r.num_points = foot[j].GetSize();
+				m_Rings.push_back(r);
+			}
+			l.first_edge = (int) m_Edges.size();
+			l.num_edges = lev->NumEdges();
+			for (int j = 0; j < l.num_edges; j++)
+			{
+				const vtEdge *edge = lev->GetEdge(j);
+				vtSBEdge e;
+				e.material = edge->m_pMaterial ? AddString(*edge->m_pMaterial) : -1;
+				e.facade = AddString(edge->m_Facade);
+				e.slope = edge->m_iSlope;
+				e.color[0] = edge->m_Color.r;
+				e.color[1] = edge->m_Color.g;
+				e.color[2] = edge->m_Color.b;
+				e.reserved = 0;
+				e.first_feature = (int) m_Features.size();
+				e.num_features = (int) edge->m_Features.size();
+				for (int k = 0; k < e.num_features; k++)
+				{
+					const vtEdgeFeature &feat = edge->m_Features[k];
+					vtSBFeature f;
+					f.code = feat.m_code;
+					f.color[0] = feat.m_color.r;
+					f.color[1] = feat.m_color.g;
+					f.color[2] = feat.m_color.b;
+					f.reserved = 0;
+					f.width = feat.m_width;
+					f.vf1 = feat.m_vf1;
+					f.vf2 = feat.m_vf2;
+					m_Features.push_back(f);
+				}
+				m_Edges.push_back(e);
+			}
+			m_Levels.push_back(l);
+		}
+	}
+	else if (vtFence *fen = s->GetFence())
+	{
+		const vtLinearParams &param = fen->GetParams();
+		vtSBFence f;
+		f.first_point = AddPoints(fen->GetFencePoints());
+		f.num_points = fen->GetFencePoints().GetSize();
+		f.post_type = AddString(param.m_PostType);
+		f.post_extension = AddString(param.m_PostExtension);
+		f.connect_type = param.m_iConnectType;
+		f.connect_material = AddString(param.m_ConnectMaterial);
+		f.connect_profile = AddString(param.m_ConnectProfile);
+		f.connect_slope = param.m_iConnectSlope;
+		f.constant_top = param.m_bConstantTop;
+		f.post_height = param.m_fPostHeight;
+		f.post_spacing = param.m_fPostSpacing;
+		f.post_width = param.m_fPostWidth;
+		f.post_depth = param.m_fPostDepth;
+		f.connect_top = param.m_fConnectTop;
+		f.connect_bottom = param.m_fConnectBottom;
+		f.connect_width = param.m_fConnectWidth;
+		rec.first = (int) m_Fences.size();
+		m_Fences.push_back(f);
+	}
+	else if (vtStructInstance *inst = s->GetInstance())
+	{
+		vtSBInstance i;
+		i.p = inst->GetPoint();
+		i.rotation = inst->GetRotation();
+		i.scale = inst->GetScale();
+		rec.first = (int) m_Instances.size();
+		m_Instances.push_back(i);
+	}
+	m_Structures.push_back(rec);
+}
+
+template <class T>
+static void AppendTable(std::vector<char> &out, const std::vector<T> &table)
+{
+	const size_t at = out.size();
+	const size_t bytes = table.size() * sizeof(T);
+	out.resize(SBAlign(at + bytes), 0);
+	if (bytes)
+		memcpy(&out[at], &table[0], bytes);
+}
+
+void vtSBBlockWriter::Write(std::vector<char> &out) const
+{
+	vtSBBlockHeader header;
+	header.structures = (int) m_Structures.size();
+	header.tags = (int) m_Tags.size();
+	header.levels = (int) m_Levels.size();
+	header.rings = (int) m_Rings.size();
+	header.edges = (int) m_Edges.size();
+	header.features = (int) m_Features.size();
+	header.points = (int) m_Points.size();
+	header.fences = (int) m_Fences.size();
+	header.instances = (int) m_Instances.size();
+	header.strings_length = (int) m_Strings.size();
+
+	out.resize(SBAlign(sizeof(header)), 0);
+	memcpy(&out[0], &header, sizeof(header));
+	AppendTable(out, m_Structures);
+	AppendTable(out, m_Tags);
+	AppendTable(out, m_Levels);
+	AppendTable(out, m_Rings);
+	AppendTable(out, m_Edges);
+	AppendTable(out, m_Features);
+	AppendTable(out, m_Points);
+	AppendTable(out, m_Fences);
+	AppendTable(out, m_Instances);
+
+	const size_t at = out.size();
+	out.resize(SBAlign(at + m_Strings.size()), 0);
+	if (!m_Strings.empty())
+		memcpy(&out[at], m_Strings.c_str(), m_Strings.size());
+}
+
+/**
+ * Write the structures to a binary structure file (.vtsb).  The structures
+ * are sorted into square blocks, so that those in an area can be read
+ * without reading the whole file (see ReadBinary).  Everything that
+ * WriteXML writes is kept, so the two formats can be converted freely,
+ * although the order of the structures is not kept.
+ *
+ * \param pathname The filename, in UTF-8.
+ */
+bool vtStructureArray::WriteBinary(const char *pathname) const
+{
+	VTLOG("WriteBinary(%s)\n", pathname);
+
+	char *wkt;
+	OGRErr err = m_proj.exportToWkt(&wkt);
+	if (err != OGRERR_NONE)
+		return false;
+	vtString strWkt = wkt;
+	OGRFree(wkt);
+
+	// Sort the structures into a grid of blocks, by the center of their
+	//  extents, with a counting sort
+	const int num = (int) size();
+	DRECT rect;
+	if (num)
+		GetExtents(rect);
+	const int side = std::max(1, (int) ceil(sqrt((double) num / VTSB_STRUCTURES_PER_BLOCK)));
+	const double cell_x = rect.Width() / side, cell_y = rect.Height() / side;
+
+	int i;
+	std::vector<int> cell_of(num), cell_start(side * side + 1, 0);
+	std::vector<DRECT> extents(num);
+	std::vector<bool> has_extents(num);
+	for (i = 0; i < num; i++)
+	{
+		has_extents[i] = at(i)->GetExtents(extents[i]);
+		int cx = 0, cy = 0;
+		if (has_extents[i])
+		{
+			DPoint2 center;
+			extents[i].GetCenter(center);
+			if (cell_x > 0)
+				cx = (int) ((center.x - rect.left) / cell_x);
+			if (cell_y > 0)
+				cy = (int) ((center.y - rect.bottom) / cell_y);
+			cx = std::max(0, std::min(cx, side - 1));
+			cy = std::max(0, std::min(cy, side - 1));
+		}
+		cell_of[i] = cy * side + cx;
+		cell_start[cell_of[i] + 1]++;
+	}
+	for (i = 0; i < side * side; i++)
+		cell_start[i + 1] += cell_start[i];
+
+	std::vector<int> order(num);
+	std::vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+	for (i = 0; i < num; i++)
+		order[fill[cell_of[i]]++] = i;
+
+	// Build each block, and its entry in the index
+	std::vector<vtSBBlockEntry> entries;
+	std::vector< std::vector<char> > blocks;
+	for (i = 0; i < side * side; i++)
+	{
+		if (cell_start[i] == cell_start[i + 1])
+			continue;
+		vtSBBlockEntry entry;
+		entry.count = cell_start[i + 1] - cell_start[i];
+		entry.extent.SetInsideOut();
+
+		vtSBBlockWriter writer;
+		for (int j = cell_start[i]; j < cell_start[i + 1]; j++)
+		{
+			writer.AddStructure(at(order[j]));
+			if (has_extents[order[j]])
+				entry.extent.GrowToContainRect(extents[order[j]]);
+		}
+		// A block with nothing to place it by is read with any area
+		if (entry.extent.left > entry.extent.right)
+			entry.extent = rect;
+
+		blocks.push_back(std::vector<char>());
+		writer.Write(blocks.back());
+		entry.size = (int) blocks.back().size();
+		entries.push_back(entry);
+	}
+
+	vtSBHeader header;
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, "vtsb1.0");
+	header.numstructures = num;
+	header.numblocks = (int) entries.size();
+	header.wkt_length = strWkt.GetLength() + 1;
+
+	FILE *fp = vtFileOpen(pathname, "wb");
+	if (!fp)
+		return false;
+
+	fwrite(&header, sizeof(header), 1, fp);
+	fwrite((const char *) strWkt, header.wkt_length, 1, fp);
+
+	const char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	const long written = sizeof(header) + header.wkt_length;
+	fwrite(padding, SBIndexStart(header) - written, 1, fp);
+
+	if (header.numblocks > 0)
+		fwrite(&entries[0], sizeof(vtSBBlockEntry), entries.size(), fp);
+	bool success = true;
+	for (i = 0; i < (int) blocks.size(); i++)
+		success &= (fwrite(&blocks[i][0], blocks[i].size(), 1, fp) == 1);
+
+	fclose(fp);
+	VTLOG(" Wrote %d structures in %d blocks.\n", num, header.numblocks);
+	return success;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Reading
+
+/**
+ * Gives access to the tables of one block, which has been read into memory.
+ */
+class vtSBBlockReader
+{
+public:
+	bool Setup(const char *data, int size);
+	bool Decode(vtStructureArray *sa) const;
+
+protected:
+	template <class T>
+	bool Table(const char *&p, const char *end, int count, const T *&table);
+	const char *String(int offset) const;
+	bool ReadBuilding(vtBuilding *bld, const vtSBStructure &rec) const;
+
+	vtSBBlockHeader m_header;
+	const vtSBStructure *m_Structures;
+	const vtSBTag *m_Tags;
+	const vtSBLevel *m_Levels;
+	const vtSBRing *m_Rings;
+	const vtSBEdge *m_Edges;
+	const vtSBFeature *m_Features;
+	const DPoint2 *m_Points;
+	const vtSBFence *m_Fences;
+	const vtSBInstance *m_Instances;
+	const char *m_Strings;
+};
+
+template <class T>
+bool vtSBBlockReader::Table(const char *&p, const char *end, int count, const T *&table)
+{
+	if (count < 0)
+		return false;
+	const size_t bytes = SBAlign(count * sizeof(T));
+	if ((size_t) (end - p) < bytes)
+		return false;
+	table = (const T *) p;
+	p += bytes;
+	return true;
+}
+
+bool vtSBBlockReader::Setup(const char *data, int size)
+{
+	if (size < (int) sizeof(m_header))
+		return false;
+	memcpy(&m_header, data, sizeof(m_header));
+
+	const char *p = data + SBAlign(sizeof(m_header));
+	const char *end = data + size;
+	if (!Table(p, end, m_header.structures, m_Structures) ||
+		!Table(p, end, m_header.tags, m_Tags) ||
+		!Table(p, end, m_header.levels, m_Levels) ||
+		!Table(p, end, m_header.rings, m_Rings) ||
+		!Table(p, end, m_header.edges, m_Edges) ||
+		!Table(p, end, m_header.features, m_Features) ||
+		!Table(p, end, m_header.points, m_Points) ||
+		!Table(p, end, m_header.fences, m_Fences) ||
+		!Table(p, end, m_header.instances, m_Instances) ||
+		!Table(p, end, m_header.strings_length, m_Strings))
+		return false;
+
+	// The strings must end with a terminator, so none can run off the end
+	if (m_header.strings_length > 0 && m_Strings[m_header.strings_length - 1] != 0)
+		return false;
+	return true;
+}
+
+const char *vtSBBlockReader::String(int offset) const
+{
+	if (offset < 0 || offset >= m_header.strings_length)
+		return "";
+	return m_Strings + offset;
+}
+
+// Check that a range of records is within a table
+#define SB_RANGE(first, count, table_size) \
+	((first) >= 0 && (count) >= 0 && (first) <= (table_size) - (count))
+
+bool vtSBBlockReader::ReadBuilding(vtBuilding *bld, const vtSBStructure &rec) const
+{
+	if (!SB_RANGE(rec.first, rec.count, m_header.levels))
+		return false;
+
+	for (int i = rec.first; i < rec.first + rec.count; i++)
+	{
+		const vtSBLevel &l = m_Levels[i];
+		if (!SB_RANGE(l.first_ring, l.num_rings, m_header.rings) ||
+			!SB_RANGE(l.first_edge, l.num_edges, m_header.edges))
+			return false;
+
+		vtLevel *lev = bld->CreateLevel();
+		lev->m_fStoryHeight = l.story_height;
+		lev->m_iStories = l.stories;
+
+		DPolygon2 foot;
+		for (int j = l.first_ring; j < l.first_ring + l.num_rings; j++)
+		{
+			const vtSBRing &r = m_Rings[j];
+			if (!SB_RANGE(r.first_point, r.num_points, m_header.points))
+				return false;
+			DLine2 line;
+			line.SetSize(r.num_points);
+			if (r.num_points)
+				memcpy(line.GetData(), m_Points + r.first_point, r.num_points * sizeof(DPoint2));
+			foot.push_back(line);
+		}
+		lev->SetFootprint(foot);
+
+		// Setting the footprint made default edges; fill them in.  A level
+		//  whose edge count disagrees with its footprint is corrupt.
+		if (l.num_edges != lev->NumEdges())
+			return false;
+		for (int j = 0; j < l.num_edges; j++)
+		{
+			const vtSBEdge &e = m_Edges[l.first_edge + j];
+			if (!SB_RANGE(e.first_feature, e.num_features, m_header.features))
+				return false;
+
+			vtEdge *edge = lev->GetEdge(j);
+			edge->m_pMaterial = (e.material >= 0) ? FindOrAddMaterial(String(e.material)) : NULL;
+			edge->m_Facade = String(e.facade);
+			edge->m_iSlope = e.slope;
+			edge->m_Color.Set(e.color[0], e.color[1], e.color[2]);
+			edge->m_Features.resize(e.num_features);
+			for (int k = 0; k < e.num_features; k++)
+			{
+				const vtSBFeature &f = m_Features[e.first_feature + k];
+				vtEdgeFeature &feat = edge->m_Features[k];
+				feat.m_code = f.code;
+				feat.m_color.Set(f.color[0], f.color[1], f.color[2]);
+				feat.m_width = f.width;
+				feat.m_vf1 = f.vf1;
+				feat.m_vf2 = f.vf2;
+			}
+		}
+	}
+	bld->DetermineLocalFootprints();
+	return true;
+}
+
+/**
+ * Add the block's structures to the array.  If the block is damaged, the
+ * array is left as it was.
+ */
+bool vtSBBlockReader::Decode(vtStructureArray *sa) const
+{
+	const uint previous = sa->size();
+	bool success = true;
+	for (int i = 0; i < m_header.structures && success; i++)
+	{
+		const vtSBStructure &rec = m_Structures[i];
+		if (!SB_RANGE(rec.first_tag, rec.num_tags, m_header.tags))
+		{
+			success = false;
+			break;
+		}
+
+		vtStructure *str = NULL;
+		if (rec.type == ST_BUILDING)
+		{
+			vtBuilding *bld = sa->AddNewBuilding();
+			success = ReadBuilding(bld, rec);
+			str = bld;
+		}
+		else if (rec.type == ST_LINEAR)
+		{
+			if (!SB_RANGE(rec.first, 1, m_header.fences))
+			{
+				success = false;
+				break;
+			}
+			const vtSBFence &f = m_Fences[rec.first];
+			if (!SB_RANGE(f.first_point, f.num_points, m_header.points))
+			{
+				success = false;
+				break;
+			}
+			vtFence *fen = sa->AddNewFence();
+			vtLinearParams &param = fen->GetParams();
+			param.m_PostType = String(f.post_type);
+			param.m_PostExtension = String(f.post_extension);
+			param.m_iConnectType = f.connect_type;
+			param.m_ConnectMaterial = String(f.connect_material);
+			param.m_ConnectProfile = String(f.connect_profile);
+			param.m_iConnectSlope = f.connect_slope;
+			param.m_bConstantTop = (f.constant_top != 0);
+			param.m_fPostHeight = f.post_height;
+			param.m_fPostSpacing = f.post_spacing;
+			param.m_fPostWidth = f.post_width;
+			param.m_fPostDepth = f.post_depth;
+			param.m_fConnectTop = f.connect_top;
+			param.m_fConnectBottom = f.connect_bottom;
+			param.m_fConnectWidth = f.connect_width;
+
+			DLine2 &pts = fen->GetFencePoints();
+			pts.SetSize(f.num_points);
+			if (f.num_points)
+				memcpy(pts.GetData(), m_Points + f.first_point, f.num_points * sizeof(DPoint2));
+			str = fen;
+		}
+		else if (rec.type == ST_INSTANCE)
+		{
+			if (!SB_RANGE(rec.first, 1, m_header.instances))
+			{
+				success = false;
+				break;
+			}
+			const vtSBInstance &in = m_Instances[rec.first];
+			vtStructInstance *inst = sa->AddNewInstance();
+			inst->SetPoint(in.p);
+			inst->SetRotation(in.rotation);
+			inst->SetScale(in.scale);
+			str = inst;
+		}
+		else
+		{
+			success = false;
+			break;
+		}
+
+		str->SetAbsolute(rec.absolute != 0);
+		str->SetElevationOffset(rec.elevation_offset);
+		for (int j = rec.first_tag; j < rec.first_tag + rec.num_tags; j++)
+			str->AddTag(String(m_Tags[j].name), String(m_Tags[j].value));
+	}
+
+	if (!success)
+	{
+		for (uint i = previous; i < sa->size(); i++)
+			delete sa->at(i);
+		sa->resize(previous);
+	}
+	return success;
+}
+
+/**
+ * Read the header and block index of a binary structure file (.vtsb),
+ * without reading any structures.  Follow this with ReadBinaryBlocks to
+ * read the structures, all at once or an area at a time.
+ *
+ * \param pathname The filename, in UTF-8.
+ */
+bool vtStructureArray::ReadBinaryIndex(const char *pathname)
+{
+	VTLOG("vtStructureArray::ReadBinaryIndex(%s)\n", pathname);
+	m_Blocks.clear();
+
+	FILE *fp = vtFileOpen(pathname, "rb");
+	if (!fp)
+		return false;
+
+	vtSBHeader header;
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+		strncmp(header.magic, "vtsb1", 5) != 0 ||
+		header.numstructures < 0 || header.numblocks < 0 ||
+		header.wkt_length < 1)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	std::vector<char> wkt(header.wkt_length + 1);
+	std::vector<vtSBBlockEntry> entries(header.numblocks);
+	bool success = (fread(&wkt[0], 1, header.wkt_length, fp) == (size_t) header.wkt_length);
+	fseek(fp, SBIndexStart(header), SEEK_SET);
+	if (header.numblocks > 0)
+		success &= (fread(&entries[0], sizeof(vtSBBlockEntry), header.numblocks, fp) == (size_t) header.numblocks);
+	fclose(fp);
+	if (!success)
+		return false;
+
+	char *wkt_ptr = &wkt[0];
+	OGRErr err = m_proj.importFromWkt(&wkt_ptr);
+	if (err != OGRERR_NONE)
+	{
+		// It shouldn't be fatal to encounter a missing or unparsable projection
+	}
+
+	long offset = SBIndexStart(header) + header.numblocks * sizeof(vtSBBlockEntry);
+	m_Blocks.resize(header.numblocks);
+	for (int i = 0; i < header.numblocks; i++)
+	{
+		if (entries[i].size < (int) sizeof(vtSBBlockHeader) || entries[i].count < 0)
+		{
+			m_Blocks.clear();
+			return false;
+		}
+		vtStructureBlock &block = m_Blocks[i];
+		block.m_extent = entries[i].extent;
+		block.m_offset = offset;
+		block.m_size = entries[i].size;
+		block.m_count = entries[i].count;
+		block.m_bRead = false;
+		offset += entries[i].size;
+	}
+	m_strFilename = pathname;
+
+	VTLOG(" %d structures in %d blocks.\n", header.numstructures, header.numblocks);
+	return true;
+}
+
+/**
+ * Read more structures from the binary file whose index was read with
+ * ReadBinaryIndex: those in the blocks which overlap an area, and have not
+ * been read yet.  The structures are added to the end of the array.
+ *
+ * \param pArea The area, in the CRS of the file, or NULL to read all the
+ *		remaining blocks.
+ * \return The number of structures added, or -1 if the file couldn't be read.
+ */
+int vtStructureArray::ReadBinaryBlocks(const DRECT *pArea)
+{
+	std::vector<int> wanted;
+	for (uint i = 0; i < m_Blocks.size(); i++)
+	{
+		if (m_Blocks[i].m_bRead)
+			continue;
+		if (pArea && !pArea->OverlapsRect(m_Blocks[i].m_extent))
+			continue;
+		wanted.push_back(i);
+	}
+	if (wanted.empty())
+		return 0;
+
+	FILE *fp = vtFileOpen(m_strFilename, "rb");
+	if (!fp)
+		return -1;
+
+	const uint previous = size();
+	std::vector<char> data;
+	bool success = true;
+	for (uint i = 0; i < wanted.size() && success; i++)
+	{
+		vtStructureBlock &block = m_Blocks[wanted[i]];
+		data.resize(block.m_size);
+		fseek(fp, block.m_offset, SEEK_SET);
+		vtSBBlockReader reader;
+		success = (fread(&data[0], 1, block.m_size, fp) == (size_t) block.m_size) &&
+			reader.Setup(&data[0], block.m_size) &&
+			reader.Decode(this);
+		block.m_bRead = true;
+	}
+	fclose(fp);
+
+	if (!success)
+	{
+		VTLOG(" Couldn't read structure block from %s\n", (const char *) m_strFilename);
+		return -1;
+	}
+	return size() - previous;
+}
+
+/**
+ * Return true if there are blocks of the binary file, whose index was read
+ * with ReadBinaryIndex, which have not been read yet.
+ */
+bool vtStructureArray::HasUnreadBlocks() const
+{
+	for (uint i = 0; i < m_Blocks.size(); i++)
+	{
+		if (!m_Blocks[i].m_bRead)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Read a binary structure file (.vtsb).
+ *
+ * \param pathname The filename, in UTF-8.
+ * \param pArea If not NULL, only the blocks of structures which overlap this
+ *		area, in the CRS of the file, are read.  The others can be read
+ *		later with ReadBinaryBlocks.
+ */
+bool vtStructureArray::ReadBinary(const char *pathname, const DRECT *pArea)
+{
+	if (!ReadBinaryIndex(pathname))
+		return false;
+	return (ReadBinaryBlocks(pArea) >= 0);
+}
@@ -16,6 +16,15 @@
 #include "shapelib/shapefil.h"
 #include "ogrsf_frmts.h"
 
+#include <algorithm>
+
+// Structures are imported from OGR this many features at a time.  The
+//  features of a batch are read in order, then made into structures in
+//  parallel.
+#define OGR_BATCH_FEATURES	1024
+// Each batch is made in chunks of this many structures.
+#define OGR_CHUNK_FEATURES	64
+
 //
 // Helper: find the index of a field in a DBF file, given the name of the field.
 // Returns -1 if not found.
@@ -634,6 +643,254 @@ void vtStructureArray::AddElementsFromOGR_RAW(OGRDataSource *pDatasource,
 	}
 }
 
+/**
+ * The parts of an OGR feature which are needed to make a building from it,
+ * so that the feature can be freed as soon as it is read.
+ */
+struct OGRBuildingSource
+{
+	DPolygon2 m_footprint;
+	float m_fHeight;	// from the height field, if there is one
+};
+
+/**
+ * Get the footprint and height of a building from an OGR feature.
+ *
+ * \return false if the feature is not a building we can import.
+ */
+static bool ReadOGRBuildingSource(OGRFeature *pFeature, OGRFeatureDefn *pLayerDefn,
+	SchemaType Schema, int iHeightIndex, OGRBuildingSource &source)
+{
+	int iFeatureCode;
+
+	// Preprocess according to schema
+	switch(Schema)
+	{
+		case SCHEMA_OSGB_TOPO_AREA:
+		case SCHEMA_MAPINFO_OSGB_TOPO_AREA:
+			// Get feature code
+			if (Schema == SCHEMA_OSGB_TOPO_AREA)
+				iFeatureCode = pFeature->GetFieldAsInteger(pLayerDefn->GetFieldIndex("featureCode"));
+			else
+				iFeatureCode = pFeature->GetFieldAsInteger(pLayerDefn->GetFieldIndex("FC"));
+
+			// Skip things that are not buildings
+			iFeatureCode = pFeature->GetFieldAsInteger(pLayerDefn->GetFieldIndex("osgb:featureCode"));
+			switch(iFeatureCode)
+			{
+				// Just do polygons for the time being
+				case 10021: // Building defined by area
+				case 10062: // Glasshouse
+				case 10185: // Generic structure
+				case 10190: // Archway
+				// case 10193: // Pylon
+				case 10187: // Upper level of communication
+				case 10025: // Buildings or structure
+					break;
+				default:
+					return false;
+			}
+			break;
+		default:
+			break;
+	}
+
+	OGRGeometry *pGeom = pFeature->GetGeometryRef();
+	if (!pGeom)
+		return false;
+	OGRwkbGeometryType GeometryType = pGeom->getGeometryType();
+
+	// For the moment ignore multi polygons .. although we could treat
+	// them as multiple buildings !!
+	DPolygon2 &footprint = source.m_footprint;
+	OGRPolygon	 *pPolygon;
+	OGRLineString *pLineString;
+	uint line_points = 0;
+
+	switch (wkbFlatten(GeometryType))
+	{
+		case wkbPolygon:
+			pPolygon = (OGRPolygon *) pGeom;
+			OGRToDPolygon2(*pPolygon, footprint);
+			break;
+
+		case wkbLineString:
+			pLineString = (OGRLineString *) pGeom;
+			line_points = pLineString->getNumPoints();
+
+			// Ignore last point if it is the same as the first
+			if (DPoint2(pLineString->getX(0), pLineString->getY(0)) ==
+				DPoint2(pLineString->getX(line_points - 1), pLineString->getY(line_points - 1)))
+				line_points--;
+
+			footprint.resize(1);
+			footprint[0].SetSize(line_points);
+			for (uint j = 0; j < line_points; j++)
+				footprint[0].SetAt(j, DPoint2(pLineString->getX(j), pLineString->getY(j)));
+			break;
+
+		case wkbPoint:
+			{
+			DPoint2 dPoint(((OGRPoint *)pGeom)->getX(), ((OGRPoint *)pGeom)->getY());
+
+			footprint.resize(1);
+			footprint[0].Append(dPoint + DPoint2(- DEFAULT_BUILDING_SIZE / 2, - DEFAULT_BUILDING_SIZE / 2));
+			footprint[0].Append(dPoint + DPoint2(DEFAULT_BUILDING_SIZE / 2, - DEFAULT_BUILDING_SIZE / 2));
+			footprint[0].Append(dPoint + DPoint2(DEFAULT_BUILDING_SIZE / 2, DEFAULT_BUILDING_SIZE / 2));
+			footprint[0].Append(dPoint + DPoint2(- DEFAULT_BUILDING_SIZE / 2, DEFAULT_BUILDING_SIZE / 2));
+			}
+			break;
+
+		default:
+			return false;
+	}
+	if (footprint.empty())
+		return false;
+
+	source.m_fHeight = 0.0f;
+	if (iHeightIndex != -1)
+		source.m_fHeight = (float)pFeature->GetFieldAsDouble(iHeightIndex);
+	return true;
+}
+
+/**
+ * Make a building from a footprint which was read from OGR, in the style of
+ * the default building.  Only the array's factory and the defaults are
+ * used, so buildings can be made on several threads at once, as long as
+ * each thread has its own CRS.
+ *
+ * \return The new building, or NULL if it is excluded by the options.
+ */
+static vtBuilding *MakeBuildingFromOGR(vtStructureArray *sa, vtProjection *proj,
+	const StructImportOptions &opt, bool bHeight, OGRBuildingSource &source)
+{
+	DPolygon2 &footprint = source.m_footprint;
+	const DLine2 &outer_ring = footprint[0];
+	const uint outer_ring_size = outer_ring.GetSize();
+	uint i;
+
+	if (opt.bInsideOnly)
+	{
+		// Exclude footprints outside the indicated extents
+		for (i = 0; i < outer_ring_size; i++)
+			if (!opt.rect.ContainsPoint(outer_ring[i]))
+				return NULL;
+	}
+
+	vtBuilding *pBld = sa->NewBuilding();
+	pBld->SetCRS(proj);
+
+	// Force footprint anticlockwise
+	PolyChecker PolyChecker;
+	if (PolyChecker.IsClockwisePolygon(outer_ring))
+		footprint.ReverseOrder();
+	pBld->SetFootprint(0, footprint);
+
+	vtBuilding *pDefBld = GetClosestDefault(pBld);
+	if (pDefBld)
+		pBld->CopyStyleFrom(pDefBld, true);
+	else
+		pBld->SetNumStories(1);
+
+	// Set the correct height for the roof level if neccessary
+	vtLevel *pLevel = pBld->GetLevel(pBld->NumLevels() - 1);
+	pBld->SetRoofType(pLevel->GuessRoofType(), pLevel->GetEdge(0)->m_iSlope);
+
+	// Modify the height of the building if neccessary
+	if (bHeight)
+	{
+		float fTotalHeight = 0;
+		float fScaleFactor;
+		uint iNumLevels = pBld->NumLevels();
+		RoofType eRoofType = pBld->GetRoofType();
+		float fRoofHeight = pBld->GetLevel(iNumLevels - 1)->m_fStoryHeight;
+
+		// If building has a roof I must exclude this from the calculation
+		if (ROOF_UNKNOWN != eRoofType)
+			iNumLevels--;
+		else
+			fRoofHeight = 0;
+
+		for (i = 0; i < iNumLevels; i++)
+			fTotalHeight += pBld->GetLevel(i)->m_fStoryHeight;
+
+		fScaleFactor = (source.m_fHeight - fRoofHeight)/fTotalHeight;
+		for (i = 0; i < iNumLevels; i++)
+			pBld->GetLevel(i)->m_fStoryHeight *= fScaleFactor;
+	}
+	return pBld;
+}
+
+/**
+ * Add a foundation level to each building made from OGR which stands on
+ * sloping ground.  The elevations of the corners of all the buildings are
+ * found with one call to the heightfield.
+ */
+static void AddFoundationsFromOGR(const std::vector<vtBuilding*> &buildings,
+	const std::vector<OGRBuildingSource> &sources, vtHeightField *pHF)
+{
+	const uint num = buildings.size();
+	uint i, v;
+
+	// Use the outer footprint of the lowest level
+	std::vector<DPoint2> corners;
+	for (i = 0; i < num; i++)
+	{
+		if (!buildings[i])
+			continue;
+		const DLine2 &outer_ring = sources[i].m_footprint[0];
+		for (v = 0; v < outer_ring.GetSize(); v++)
+			corners.push_back(outer_ring[v]);
+	}
+	if (corners.empty())
+		return;
+	std::vector<float> elev(corners.size());
+	pHF->FindAltitudesOnEarth(&corners[0], &elev[0], corners.size());
+
+	uint corner = 0;
+	for (i = 0; i < num; i++)
+	{
+		vtBuilding *pBld = buildings[i];
+		if (!pBld)
+			continue;
+		const DPolygon2 &footprint = sources[i].m_footprint;
+		const uint outer_ring_size = footprint[0].GetSize();
+
+		float fMin = 1E9, fMax = -1E9;
+		for (v = 0; v < outer_ring_size; v++, corner++)
+		{
+			const float fElev = elev[corner];
+			if (fElev == INVALID_ELEVATION)
+				continue;
+			if (fElev < fMin)
+				fMin = fElev;
+			if (fElev > fMax)
+				fMax = fElev;
+		}
+		if (fMin > fMax)
+			continue;	// not on the heightfield
+		const float fDiff = fMax - fMin;
+		if (fDiff > MINIMUM_BASEMENT_SIZE)
+		{
+			// Create and add a foundation level
+			vtLevel *pNewLevel = new vtLevel;
+			pNewLevel->m_iStories = 1;
+			pNewLevel->m_fStoryHeight = fDiff;
+			pBld->InsertLevel(0, pNewLevel);
+			pBld->SetFootprint(0, footprint);
+			pNewLevel->SetEdgeMaterial(BMAT_NAME_PLAIN);
+			pNewLevel->SetEdgeColor(RGBi(128, 128, 128));
+		}
+		else
+			pBld->SetElevationOffset(fDiff);
+	}
+}
+
+/**
+ * Import buildings from an OGR layer.  The features are read in batches,
+ * in order, and the buildings of each batch are made in parallel (if
+ * VTP_USE_OPENMP), then added to the array in the order of the features.
+ */
 void vtStructureArray::AddBuildingsFromOGR(OGRLayer *pLayer,
 		StructImportOptions &opt, bool progress_callback(int))
 {
@@ -662,404 +919,406 @@ void vtStructureArray::AddBuildingsFromOGR(OGRLayer *pLayer,
 	else if (!strcmp(layer_name, "topographicpoint"))
 		Schema = SCHEMA_MAPINFO_OSGB_TOPO_POINT;
 
-	PolyChecker PolyChecker;
-	int count = 0;
+	// The buildings ask their CRS for its units, and an OGRSpatialReference
+	//  can't be used from several threads, so each chunk gets its own copy.
+	//  Once made, the buildings get the array's CRS.
+	const int max_chunks = OGR_BATCH_FEATURES / OGR_CHUNK_FEATURES;
+	std::vector<vtProjection> chunk_proj(max_chunks);
+	int c, k;
+	for (c = 0; c < max_chunks; c++)
+		chunk_proj[c] = m_proj;
+
+	std::vector<OGRBuildingSource> sources;
+	sources.reserve(OGR_BATCH_FEATURES);
+	std::vector<vtBuilding*> buildings;
 	OGRFeature	 *pFeature;
-	int iFeatureCode;
-	float fMinZ, fMaxZ, fTotalZ;
-	float fZ;
-	float fMin, fMax, fDiff, fElev;
-	uint i, j;
-	while( (pFeature = pLayer->GetNextFeature()) != NULL )
+	int count = 0, made = 0;
+	bool bMore = true;
+	while (bMore)
 	{
-		count++;
-		progress_callback(count * 100 / feature_count);
-		// Preprocess according to schema
-		switch(Schema)
+		// Read a batch of features.  OGR is only used from this thread.
+		sources.clear();
+		while (sources.size() < OGR_BATCH_FEATURES)
 		{
-			case SCHEMA_OSGB_TOPO_AREA:
-			case SCHEMA_MAPINFO_OSGB_TOPO_AREA:
-				// Get feature code
-				if (Schema == SCHEMA_OSGB_TOPO_AREA)
-					iFeatureCode = pFeature->GetFieldAsInteger(pLayerDefn->GetFieldIndex("featureCode"));
-				else
-					iFeatureCode = pFeature->GetFieldAsInteger(pLayerDefn->GetFieldIndex("FC"));
-
-				// Skip things that are not buildings
-				iFeatureCode = pFeature->GetFieldAsInteger(pLayerDefn->GetFieldIndex("osgb:featureCode"));
-				switch(iFeatureCode)
-				{
-					// Just do polygons for the time being
-					case 10021: // Building defined by area
-					case 10062: // Glasshouse
-					case 10185: // Generic structure
-					case 10190: // Archway
-					// case 10193: // Pylon
-					case 10187: // Upper level of communication
-					case 10025: // Buildings or structure
-						break;
-					default:
-						continue;
-				}
-				break;
-			default:
+			pFeature = pLayer->GetNextFeature();
+			if (!pFeature)
+			{
+				bMore = false;
 				break;
+			}
+			count++;
+			sources.resize(sources.size() + 1);
+			if (!ReadOGRBuildingSource(pFeature, pLayerDefn, Schema, iHeightIndex,
+				sources.back()))
+				sources.pop_back();
+			OGRFeature::DestroyFeature(pFeature);
 		}
 
-		OGRGeometry *pGeom = pFeature->GetGeometryRef();
-		if (!pGeom)
+		// Make the buildings
+		const int num = (int) sources.size();
+		const int chunks = (num + OGR_CHUNK_FEATURES - 1) / OGR_CHUNK_FEATURES;
+		buildings.resize(num);
+#pragma omp parallel for private(k) schedule(dynamic, 1)
+		for (c = 0; c < chunks; c++)
 		{
-			OGRFeature::DestroyFeature(pFeature);
-			continue;
+			const int last = std::min(num, (c + 1) * OGR_CHUNK_FEATURES);
+			for (k = c * OGR_CHUNK_FEATURES; k < last; k++)
+			{
+				buildings[k] = MakeBuildingFromOGR(this, &chunk_proj[c], opt,
+					iHeightIndex != -1, sources[k]);
+			}
 		}
-		OGRwkbGeometryType GeometryType = pGeom->getGeometryType();
+		for (k = 0; k < num; k++)
+			if (buildings[k])
+				buildings[k]->SetCRS(&m_proj);
 
-		// For the moment ignore multi polygons .. although we could treat
-		// them as multiple buildings !!
-		DPolygon2 footprint;
-		OGRPolygon	 *pPolygon;
-		OGRLineString *pLineString;
-		uint line_points = 0;
+		// Add foundation
+		if ((opt.bBuildFoundations) && (NULL != opt.pHeightField))
+			AddFoundationsFromOGR(buildings, sources, opt.pHeightField);
 
-		switch (wkbFlatten(GeometryType))
+		// Add them to the array in the order of the features
+		for (k = 0; k < num; k++)
 		{
-			case wkbPolygon:
-				pPolygon = (OGRPolygon *) pGeom;
-				OGRToDPolygon2(*pPolygon, footprint);
-				break;
-
-			case wkbLineString:
-				pLineString = (OGRLineString *) pGeom;
-				line_points = pLineString->getNumPoints();
-
-				// Ignore last point if it is the same as the first
-				if (DPoint2(pLineString->getX(0), pLineString->getY(0)) ==
-					DPoint2(pLineString->getX(line_points - 1), pLineString->getY(line_points - 1)))
-					line_points--;
-
-				footprint.resize(1);
-				footprint[0].SetSize(line_points);
-				fMaxZ = -1E9;
-				fMinZ = 1E9;
-				fTotalZ = 0;
-				for (j = 0; j < line_points; j++)
-				{
-					fZ = (float)pLineString->getZ(j);
-					if (fZ > fMaxZ)
-						fMaxZ = fZ;
-					if (fZ < fMinZ)
-						fMinZ = fZ;
-					fTotalZ += fZ;
-					footprint[0].SetAt(j, DPoint2(pLineString->getX(j), pLineString->getY(j)));
-				}
-				break;
-
-			case wkbPoint:
-				{
-				DPoint2 dPoint(((OGRPoint *)pGeom)->getX(), ((OGRPoint *)pGeom)->getY());
-
-				footprint.resize(1);
-				footprint[0].Append(dPoint + DPoint2(- DEFAULT_BUILDING_SIZE / 2, - DEFAULT_BUILDING_SIZE / 2));
-				footprint[0].Append(dPoint + DPoint2(DEFAULT_BUILDING_SIZE / 2, - DEFAULT_BUILDING_SIZE / 2));
-				footprint[0].Append(dPoint + DPoint2(DEFAULT_BUILDING_SIZE / 2, DEFAULT_BUILDING_SIZE / 2));
-				footprint[0].Append(dPoint + DPoint2(- DEFAULT_BUILDING_SIZE / 2, DEFAULT_BUILDING_SIZE / 2));
-				}
-				break;
-
-			default:
-				OGRFeature::DestroyFeature(pFeature);
-				continue;
+			if (buildings[k])
+			{
+				push_back(buildings[k]);
+				made++;
+			}
 		}
+		if (progress_callback != NULL && feature_count > 0)
+			progress_callback(count * 100 / feature_count);
+	}
+	VTLOG("AddBuildingsFromOGR: %d features, %d buildings\n", count, made);
+}
 
-		const DLine2 &outer_ring = footprint[0];
-		uint outer_ring_size = outer_ring.GetSize();
+/**
+ * The parts of an OGR feature which are needed to make a linear structure
+ * from it, so that the feature can be freed as soon as it is read.
+ */
+struct OGRLinearSource
+{
+	DLine2 m_points;
+	float m_fHeight;	// from the height field, if there is one
+};
 
-		if (opt.bInsideOnly)
-		{
-			// Exclude footprints outside the indicated extents
-			for (j = 0; j < outer_ring_size; j++)
-				if (!opt.rect.ContainsPoint(outer_ring[j]))
+/**
+ * Get the points and height of a linear structure from an OGR feature.
+ *
+ * \return false if the feature is not a linear we can import.
+ */
+static bool ReadOGRLinearSource(OGRFeature *pFeature, OGRFeatureDefn *pLayerDefn,
+	SchemaType Schema, int iHeightIndex, OGRLinearSource &source)
+{
+	int iFeatureCode;
+
+	// Preprocess according to schema
+	switch(Schema)
+	{
+		case SCHEMA_OSGB_TOPO_LINE:
+		case SCHEMA_OSGB_TOPO_POINT:
+			// Skip things that are not linears
+			iFeatureCode = pFeature->GetFieldAsInteger(pLayerDefn->GetFieldIndex("osgb:featureCode"));
+			switch(iFeatureCode)
+			{
+				case 10045: // General feature - point
+				case 10046: // General feature - line
 					break;
-			if (j != outer_ring_size)
-				continue;
-		}
+				default:
+					return false;
+			}
+			break;
+		default:
+			break;
+	}
 
-		vtBuilding *pBld = AddNewBuilding();
-		if (!pBld)
-			return;
+	OGRGeometry *pGeom = pFeature->GetGeometryRef();
+	if (!pGeom)
+		return false;
+	if (wkbLineString != wkbFlatten(pGeom->getGeometryType()))
+		return false;
 
-		// Force footprint anticlockwise
-		if (PolyChecker.IsClockwisePolygon(outer_ring))
-			footprint.ReverseOrder();
-		pBld->SetFootprint(0, footprint);
+	OGRLineString *pLineString = (OGRLineString *) pGeom;
+	const int iNumPoints = pLineString->getNumPoints();
+	source.m_points.SetSize(iNumPoints);
+	for (int i = 0; i < iNumPoints; i++)
+		source.m_points.SetAt(i, DPoint2(pLineString->getX(i), pLineString->getY(i)));
 
-		vtBuilding *pDefBld = GetClosestDefault(pBld);
-		if (pDefBld)
-			pBld->CopyStyleFrom(pDefBld, true);
-		else
-			pBld->SetNumStories(1);
+	source.m_fHeight = 0.0f;
+	if (iHeightIndex != -1)
+		source.m_fHeight = (float)pFeature->GetFieldAsDouble(iHeightIndex);
+	return true;
+}
 
-		// Set the correct height for the roof level if neccessary
-		vtLevel *pLevel = pBld->GetLevel(pBld->NumLevels() - 1);
-		pBld->SetRoofType(pLevel->GuessRoofType(), pLevel->GetEdge(0)->m_iSlope);
+/**
+ * Make a fence from a line which was read from OGR, in the style of the
+ * default fence.  Only the array's factory and the defaults are used, so
+ * fences can be made on several threads at once.
+ *
+ * \return The new fence, or NULL if it is excluded by the options.
+ */
+static vtFence *MakeFenceFromOGR(vtStructureArray *sa,
+	const StructImportOptions &opt, bool bHeight, const OGRLinearSource &source)
+{
+	const DLine2 &points = source.m_points;
+	const uint iNumPoints = points.GetSize();
+	uint i;
 
-		// Modify the height of the building if neccessary
-		if (iHeightIndex != -1)
-		{
-			float fTotalHeight = 0;
-			float fScaleFactor;
-			uint iNumLevels = pBld->NumLevels();
-			RoofType eRoofType = pBld->GetRoofType();
-			float fRoofHeight = pBld->GetLevel(iNumLevels - 1)->m_fStoryHeight;
-
-			// If building has a roof I must exclude this from the calculation
-			if (ROOF_UNKNOWN != eRoofType)
-				iNumLevels--;
-			else
-				fRoofHeight = 0;
+	if (opt.bInsideOnly)
+	{
+		// Exclude fences outside the indicated extents
+		for (i = 0; i < iNumPoints; i++)
+			if (!opt.rect.ContainsPoint(points[i]))
+				return NULL;
+	}
 
-			for (i = 0; i < iNumLevels; i++)
-				fTotalHeight += pBld->GetLevel(i)->m_fStoryHeight;
+	vtFence *pFence = sa->NewFence();
 
-			fScaleFactor = ((float)pFeature->GetFieldAsDouble(iHeightIndex) - fRoofHeight)/fTotalHeight;
-			for (i = 0; i < iNumLevels; i++)
-				pBld->GetLevel(i)->m_fStoryHeight *= fScaleFactor;
-		}
+	vtFence *pDefaultFence = GetClosestDefault(pFence);
+	if (NULL != pDefaultFence)
+		*pFence = *pDefaultFence;
 
-		// Add foundation
-		if ((opt.bBuildFoundations) && (NULL != opt.pHeightField))
-		{
-			// Use the outer footprint of the lowest level
-			fMin = 1E9;
-			fMax = -1E9;
-			for (uint v = 0; v < outer_ring_size; v++)
-			{
-				if (opt.pHeightField->FindAltitudeOnEarth(outer_ring[v], fElev))
-				{
-					if (fElev < fMin)
-						fMin = fElev;
-					if (fElev > fMax)
-						fMax = fElev;
-				}
-			}
-			fDiff = fMax - fMin;
-			if (fDiff > MINIMUM_BASEMENT_SIZE)
-			{
-				// Create and add a foundation level
-				vtLevel *pNewLevel = new vtLevel;
-				pNewLevel->m_iStories = 1;
-				pNewLevel->m_fStoryHeight = fDiff;
-				pBld->InsertLevel(0, pNewLevel);
-				pBld->SetFootprint(0, footprint);
-				pNewLevel->SetEdgeMaterial(BMAT_NAME_PLAIN);
-				pNewLevel->SetEdgeColor(RGBi(128, 128, 128));
-			}
-			else
-				pBld->SetElevationOffset(fDiff);
-		}
+	for (i = 0; i < iNumPoints; i++)
+		pFence->AddPoint(points[i]);
+
+	// Modify height of fence
+	if (bHeight)
+	{
+		pFence->GetParams().m_fPostHeight = source.m_fHeight;
+		pFence->GetParams().m_fConnectTop = source.m_fHeight;
 	}
+	return pFence;
 }
 
+/**
+ * Import linear structures (fences) from an OGR layer.  The features are
+ * read in batches, in order, and the fences of each batch are made in
+ * parallel (if VTP_USE_OPENMP), then added to the array in the order of
+ * the features.
+ */
 void vtStructureArray::AddLinearsFromOGR(OGRLayer *pLayer,
 		StructImportOptions &opt, bool progress_callback(int))
 {
-	int iFeatureCount;
-	OGRFeatureDefn *pLayerDefn;
-	const char *pLayerName;
-	SchemaType eSchema = SCHEMA_UI;
-	int iCount;
-	int iFeatureCode;
-	OGRFeature		*pFeature;
-	OGRGeometry		*pGeom;
-	OGRwkbGeometryType GeometryType;
-	OGRLineString *pLineString;
-	DLine2 FencePoints;
-	int iNumPoints;
-	int i;
-	float fMinZ;
-	float fMaxZ;
-	float fTotalZ;
-	float fZ;
-	vtFence *pFence;
-	vtFence *pDefaultFence;
-
-	iFeatureCount = pLayer->GetFeatureCount();
+	int feature_count = pLayer->GetFeatureCount();
 	pLayer->ResetReading();
 
-	pLayerDefn = pLayer->GetLayerDefn();
+	OGRFeatureDefn *pLayerDefn = pLayer->GetLayerDefn();
 	if (!pLayerDefn)
 		return;
 
-	pLayerName = pLayerDefn->GetName();
-
 	int iHeightIndex = pLayerDefn->GetFieldIndex(opt.m_strFieldNameHeight);
 
 	// Check for layers with known schemas
-	if (!strcmp(pLayerName, "osgb:TopographicLine"))
-		eSchema = SCHEMA_OSGB_TOPO_LINE;
-	else if (!strcmp(pLayerName, "osgb:TopographicPoint"))
-		eSchema = SCHEMA_OSGB_TOPO_POINT;
+	const char *layer_name = pLayerDefn->GetName();
+	SchemaType Schema = SCHEMA_UI;
+	if (!strcmp(layer_name, "osgb:TopographicLine"))
+		Schema = SCHEMA_OSGB_TOPO_LINE;
+	else if (!strcmp(layer_name, "osgb:TopographicPoint"))
+		Schema = SCHEMA_OSGB_TOPO_POINT;
 
-	iCount = 0;
-	while((pFeature = pLayer->GetNextFeature()) != NULL )
+	std::vector<OGRLinearSource> sources;
+	sources.reserve(OGR_BATCH_FEATURES);
+	std::vector<vtFence*> fences;
+	OGRFeature	 *pFeature;
+	int count = 0, made = 0, c, k;
+	bool bMore = true;
+	while (bMore)
 	{
-		iCount++;
-		progress_callback(iCount * 100 / iFeatureCount);
-		// Preprocess according to schema
-		switch(eSchema)
+		// Read a batch of features.  OGR is only used from this thread.
+		sources.clear();
+		while (sources.size() < OGR_BATCH_FEATURES)
 		{
-			case SCHEMA_OSGB_TOPO_LINE:
-			case SCHEMA_OSGB_TOPO_POINT:
-				// Skip things that are not linears
-				iFeatureCode = pFeature->GetFieldAsInteger(pLayerDefn->GetFieldIndex("osgb:featureCode"));
-				switch(iFeatureCode)
-				{
-					case 10045: // General feature - point
-					case 10046: // General feature - line
-						break;
-					default:
-						continue;
-				}
-				break;
-			default:
+			pFeature = pLayer->GetNextFeature();
+			if (!pFeature)
+			{
+				bMore = false;
 				break;
+			}
+			count++;
+			sources.resize(sources.size() + 1);
+			if (!ReadOGRLinearSource(pFeature, pLayerDefn, Schema, iHeightIndex,
+				sources.back()))
+				sources.pop_back();
+			OGRFeature::DestroyFeature(pFeature);
 		}
 
-		pGeom = pFeature->GetGeometryRef();
-		if (!pGeom)
-			continue;
-		GeometryType = pGeom->getGeometryType();
-
-		if (wkbLineString != wkbFlatten(GeometryType))
-			continue;
-
-		pLineString = (OGRLineString *) pGeom;
-
-		iNumPoints = pLineString->getNumPoints();
-
-		FencePoints.SetSize(iNumPoints);
-		fMaxZ = -1E9;
-		fMinZ = 1E9;
-		fTotalZ = 0;
-		for (i = 0; i < iNumPoints; i++)
+		// Make the fences
+		const int num = (int) sources.size();
+		const int chunks = (num + OGR_CHUNK_FEATURES - 1) / OGR_CHUNK_FEATURES;
+		fences.resize(num);
+#pragma omp parallel for private(k) schedule(dynamic, 1)
+		for (c = 0; c < chunks; c++)
 		{
-			fZ = (float)pLineString->getZ(i);
-			if (fZ > fMaxZ)
-				fMaxZ = fZ;
-			if (fZ < fMinZ)
-				fMinZ = fZ;
-			fTotalZ += fZ;
-			FencePoints.SetAt(i, DPoint2(pLineString->getX(i), pLineString->getY(i)));
+			const int last = std::min(num, (c + 1) * OGR_CHUNK_FEATURES);
+			for (k = c * OGR_CHUNK_FEATURES; k < last; k++)
+				fences[k] = MakeFenceFromOGR(this, opt, iHeightIndex != -1, sources[k]);
 		}
 
-		if (opt.bInsideOnly)
+		// Add them to the array in the order of the features
+		for (k = 0; k < num; k++)
 		{
-			// Exclude fences outside the indicated extents
-			for (i = 0; i < iNumPoints; i++)
-				if (!opt.rect.ContainsPoint(FencePoints[i]))
-					break;
-			if (i != iNumPoints)
-				continue;
+			if (fences[k])
+			{
+				push_back(fences[k]);
+				made++;
+			}
 		}
+		if (progress_callback != NULL && feature_count > 0)
+			progress_callback(count * 100 / feature_count);
+	}
+	VTLOG("AddLinearsFromOGR: %d features, %d linears\n", count, made);
+}
 
-		pFence = AddNewFence();
-		if (!pFence)
-			return;
+/**
+ * The part of an OGR feature which is needed to make a structure instance
+ * from it, so that the feature can be freed as soon as it is read.
+ */
+struct OGRInstanceSource
+{
+	DPoint2 m_p;
+};
 
-		pDefaultFence = GetClosestDefault(pFence);
-		if (NULL != pDefaultFence)
-			*pFence = *pDefaultFence;
+/**
+ * Get the location of a structure instance from an OGR feature.
+ *
+ * \return false if the feature is not an instance we can import.
+ */
+static bool ReadOGRInstanceSource(OGRFeature *pFeature, OGRFeatureDefn *pLayerDefn,
+	SchemaType Schema, OGRInstanceSource &source)
+{
+	int iFeatureCode;
 
-		for (i = 0; i < iNumPoints; i++)
-			pFence->AddPoint(FencePoints[i]);
+	// Preprocess according to schema
+	switch(Schema)
+	{
+		case SCHEMA_OSGB_TOPO_AREA:
+			// Skip things that are not buildings
+			iFeatureCode = pFeature->GetFieldAsInteger(pLayerDefn->GetFieldIndex("osgb:featureCode"));
+			switch(iFeatureCode)
+			{
+				case 1:
+				default:
+					return false;
+			}
+			break;
+		default:
+			break;
+	}
 
-		// Modify height of fence
-		if (iHeightIndex != -1)
-		{
-			float f = (float)pFeature->GetFieldAsDouble(iHeightIndex);
-			pFence->GetParams().m_fPostHeight = f;
-			pFence->GetParams().m_fConnectTop = f;
-		}
+	OGRGeometry *pGeom = pFeature->GetGeometryRef();
+	if (!pGeom)
+		return false;
+	if (wkbPoint != wkbFlatten(pGeom->getGeometryType()))
+		return false;
+
+	source.m_p.Set(((OGRPoint *)pGeom)->getX(), ((OGRPoint *)pGeom)->getY());
+	return true;
+}
+
+/**
+ * Make a structure instance at a point which was read from OGR, with the
+ * rotation and scale of the default instance.  Only the array's factory and
+ * the defaults are used, so instances can be made on several threads at
+ * once.
+ *
+ * \return The new instance, or NULL if it is excluded by the options.
+ */
+static vtStructInstance *MakeInstanceFromOGR(vtStructureArray *sa,
+	const StructImportOptions &opt, const OGRInstanceSource &source)
+{
+	if (opt.bInsideOnly && !opt.rect.ContainsPoint(source.m_p))
+		// Exclude instances outside the indicated extents
+		return NULL;
+
+	vtStructInstance *pInstance = sa->NewInstance();
+
+	vtStructInstance *pDefaultInstance = GetClosestDefault(pInstance);
+	if (NULL != pDefaultInstance)
+	{
+		pInstance->SetRotation(pDefaultInstance->GetRotation());
+		pInstance->SetScale(pDefaultInstance->GetScale());
 	}
+	pInstance->SetPoint(source.m_p);
+	return pInstance;
 }
 
+/**
+ * Import structure instances from an OGR layer.  The features are read in
+ * batches, in order, and the instances of each batch are made in parallel
+ * (if VTP_USE_OPENMP), then added to the array in the order of the
+ * features.
+ */
 void vtStructureArray::AddInstancesFromOGR(OGRLayer *pLayer,
 		StructImportOptions &opt, bool progress_callback(int))
 {
-	int			iCount, iFeatureCount;
-	SchemaType	eSchema = SCHEMA_UI;
-	OGRFeature	*pFeature;
-	OGRGeometry	*pGeom;
-	int			iFilenameIndex = -1;
-
-	iFeatureCount = pLayer->GetFeatureCount();
+	int feature_count = pLayer->GetFeatureCount();
 	pLayer->ResetReading();
 
 	OGRFeatureDefn *pLayerDefn = pLayer->GetLayerDefn();
 	if (!pLayerDefn)
 		return;
 
-	const char *pLayerName = pLayerDefn->GetName();
-
 	// Check for layers with known schemas
-	if (!strcmp(pLayerName, "osgb:TopographicArea"))
-		eSchema = SCHEMA_OSGB_TOPO_AREA;
-	else if (!strcmp(pLayerName, "osgb:TopographicPoint"))
-		eSchema = SCHEMA_OSGB_TOPO_POINT;
+	const char *layer_name = pLayerDefn->GetName();
+	SchemaType Schema = SCHEMA_UI;
+	int iFilenameIndex = -1;
+	if (!strcmp(layer_name, "osgb:TopographicArea"))
+		Schema = SCHEMA_OSGB_TOPO_AREA;
+	else if (!strcmp(layer_name, "osgb:TopographicPoint"))
+		Schema = SCHEMA_OSGB_TOPO_POINT;
 	else
 		iFilenameIndex = pLayerDefn->GetFieldIndex(opt.m_strFieldNameFile);
 
 	if (-1 == iFilenameIndex)
 		return;
 
-	int iFeatureCode;
-	iCount = 0;
-	while((pFeature = pLayer->GetNextFeature()) != NULL )
+	std::vector<OGRInstanceSource> sources;
+	sources.reserve(OGR_BATCH_FEATURES);
+	std::vector<vtStructInstance*> instances;
+	OGRFeature	 *pFeature;
+	int count = 0, made = 0, c, k;
+	bool bMore = true;
+	while (bMore)
 	{
-		iCount++;
-		progress_callback(iCount * 100 / iFeatureCount);
-		// Preprocess according to schema
-		switch(eSchema)
+		// Read a batch of features.  OGR is only used from this thread.
+		sources.clear();
+		while (sources.size() < OGR_BATCH_FEATURES)
 		{
-			case SCHEMA_OSGB_TOPO_AREA:
-				// Skip things that are not buildings
-				iFeatureCode = pFeature->GetFieldAsInteger(pLayerDefn->GetFieldIndex("osgb:featureCode"));
-				switch(iFeatureCode)
-				{
-					case 1:
-					default:
-						continue;
-				}
-				break;
-			default:
+			pFeature = pLayer->GetNextFeature();
+			if (!pFeature)
+			{
+				bMore = false;
 				break;
+			}
+			count++;
+			sources.resize(sources.size() + 1);
+			if (!ReadOGRInstanceSource(pFeature, pLayerDefn, Schema, sources.back()))
+				sources.pop_back();
+			OGRFeature::DestroyFeature(pFeature);
 		}
 
-		pGeom = pFeature->GetGeometryRef();
-		if (!pGeom)
-			continue;
-		OGRwkbGeometryType GeometryType = pGeom->getGeometryType();
-
-		if (wkbPoint != wkbFlatten(GeometryType))
-			continue;
-
-		DPoint2 p2(((OGRPoint *)pGeom)->getX(), ((OGRPoint *)pGeom)->getY());
-
-		if (opt.bInsideOnly && !opt.rect.ContainsPoint(p2))
-			// Exclude instances outside the indicated extents
-			continue;
-
-		vtStructInstance *pInstance = AddNewInstance();
-		if (!pInstance)
-			return;
+		// Make the instances
+		const int num = (int) sources.size();
+		const int chunks = (num + OGR_CHUNK_FEATURES - 1) / OGR_CHUNK_FEATURES;
+		instances.resize(num);
+#pragma omp parallel for private(k) schedule(dynamic, 1)
+		for (c = 0; c < chunks; c++)
+		{
+			const int last = std::min(num, (c + 1) * OGR_CHUNK_FEATURES);
+			for (k = c * OGR_CHUNK_FEATURES; k < last; k++)
+				instances[k] = MakeInstanceFromOGR(this, opt, sources[k]);
+		}
 
-		vtStructInstance *pDefaultInstance = GetClosestDefault(pInstance);
-		if (NULL != pDefaultInstance)
+		// Add them to the array in the order of the features
+		for (k = 0; k < num; k++)
 		{
-			pInstance->SetRotation(pDefaultInstance->GetRotation());
-			pInstance->SetScale(pDefaultInstance->GetScale());
+			if (instances[k])
+			{
+				push_back(instances[k]);
+				made++;
+			}
 		}
-		pInstance->SetPoint(p2);
+		if (progress_callback != NULL && feature_count > 0)
+			progress_callback(count * 100 / feature_count);
 	}
+	VTLOG("AddInstancesFromOGR: %d features, %d instances\n", count, made);
 }
-
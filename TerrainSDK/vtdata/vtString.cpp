@@ -1509,3 +1509,77 @@ void vtExtractArray(const vtString &input, vtStringArray &arr, const char delim)
 		arr.push_back(vtString((const char *)input+curr, len-curr));
 }
 
+
+
+/////////////////////////////////////////////////////////////////////////////
+// vtStringPool
+
+// FNV-1a hash of a run of characters
+static uint HashChars(pcchar str, int len)
+{
+	uint hash = 2166136261u;
+	for (int i = 0; i < len; i++)
+	{
+		hash ^= (uchar) str[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+vtStringPool::vtStringPool()
+{
+	m_Slots.resize(256);
+	m_iCount = 0;
+}
+
+/**
+ * Return the pool's copy of a string, adding it if it is not already in
+ * the pool.
+ */
+const vtString &vtStringPool::Intern(pcchar str, int len)
+{
+	if (len == 0)
+		return m_Empty;
+
+	// Keep the table at most half full
+	if ((m_iCount + 1) * 2 > m_Slots.size())
+		Grow();
+
+	const uint mask = (uint) m_Slots.size() - 1;
+	uint i = HashChars(str, len) & mask;
+	while (!m_Slots[i].IsEmpty())
+	{
+		const vtString &slot = m_Slots[i];
+		if (slot.GetLength() == len && memcmp((pcchar) slot, str, len) == 0)
+			return slot;
+		i = (i + 1) & mask;
+	}
+	m_Slots[i] = vtString(str, len);
+	m_iCount++;
+	return m_Slots[i];
+}
+
+void vtStringPool::Clear()
+{
+	m_Slots.clear();
+	m_Slots.resize(256);
+	m_iCount = 0;
+}
+
+void vtStringPool::Grow()
+{
+	std::vector<vtString> old;
+	old.swap(m_Slots);
+	m_Slots.resize(old.size() * 2);
+
+	const uint mask = (uint) m_Slots.size() - 1;
+	for (size_t j = 0; j < old.size(); j++)
+	{
+		if (old[j].IsEmpty())
+			continue;
+		uint i = HashChars(old[j], old[j].GetLength()) & mask;
+		while (!m_Slots[i].IsEmpty())
+			i = (i + 1) & mask;
+		m_Slots[i] = old[j];
+	}
+}
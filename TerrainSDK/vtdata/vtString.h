@@ -418,5 +418,33 @@ vtString vtConcatArray(const vtStringArray &arr, const char delim);
 /** Extract a string array from a string by divider (ie. tokenize) */
 void vtExtractArray(const vtString &input, vtStringArray &arr, const char delim);
 
+/**
+ * A set of unique strings, for sharing the memory of strings which occur
+ * many times, such as the values of an attribute field.  Since vtString is
+ * reference-counted, every copy of a string returned by Intern shares the
+ * same characters.
+ *
+ * The reference returned by Intern is only good until the next call, so
+ * copy it right away.
+ */
+class vtStringPool
+{
+public:
+	vtStringPool();
+
+	const vtString &Intern(pcchar str, int len);
+	const vtString &Intern(pcchar str) { return Intern(str, (int) strlen(str)); }
+	void Clear();
+	uint NumStrings() const { return m_iCount; }
+
+protected:
+	void Grow();
+
+	// Open addressing hash table; empty slots hold empty strings
+	std::vector<vtString> m_Slots;
+	uint m_iCount;
+	vtString m_Empty;
+};
+
 #endif	// VTSTRINGH
 
@@ -13,6 +13,8 @@
 #include "FilePath.h"
 #include "ByteOrder.h"
 
+#include <algorithm>	// for sort
+
 
 vtTin::vtTin()
 {
@@ -1415,6 +1417,82 @@ bool vtTin::FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude,
 		return FindAltitudeOnEarth(DPoint2(earth.x, earth.y), fAltitude, bTrue);
 }
 
+/**
+ * Find the elevation at many points in earth coordinates.  If the TIN has
+ * triangle bins (SetupTriangleBins), the points are visited bin by bin, so
+ * that the triangles of each bin are tested together.  The points are
+ * divided among threads (if VTP_USE_OPENMP).
+ *
+ * \return The number of points which were on the TIN.
+ */
+int vtTin::FindAltitudesOnEarth(const DPoint2 *points, float *fAltitudes,
+	uint count, bool bTrue) const
+{
+	const int num = (int) count;
+
+	// Sort the points by the bin they fall in
+	std::vector< std::pair<int, int> > order(num);
+	int i, k;
+	for (i = 0; i < num; i++)
+	{
+		int key = 0;
+		if (m_trianglebins != NULL)
+		{
+			const int col = (int) ((points[i].x - m_EarthExtents.left) / m_BinSize.x);
+			const int row = (int) ((points[i].y - m_EarthExtents.bottom) / m_BinSize.y);
+			if (col < 0 || col >= m_trianglebins->GetCols() ||
+				row < 0 || row >= m_trianglebins->GetRows())
+				key = -1;
+			else
+				key = row * m_trianglebins->GetCols() + col;
+		}
+		order[i] = std::make_pair(key, i);
+	}
+	if (m_trianglebins != NULL)
+		std::sort(order.begin(), order.end());
+
+	int found = 0;
+#pragma omp parallel for reduction(+:found) if(num >= MIN_PARALLEL_QUERY)
+	for (k = 0; k < num; k++)
+	{
+		const int idx = order[k].second;
+		if (order[k].first != -1 &&
+			vtTin::FindAltitudeOnEarth(points[idx], fAltitudes[idx], bTrue))
+			found++;
+		else
+			fAltitudes[idx] = INVALID_ELEVATION;
+	}
+	return found;
+}
+
+/**
+ * Find the elevation at many points in world coordinates.
+ * \sa FindAltitudesOnEarth
+ */
+int vtTin::FindAltitudesAtPoints(FPoint3 *points, uint count, bool bTrue,
+	int iCultureFlags) const
+{
+	if (count == 0)
+		return 0;
+
+	std::vector<DPoint2> epos(count);
+	std::vector<float> alt(count);
+	DPoint3 earth;
+	for (uint i = 0; i < count; i++)
+	{
+		m_LocalCS.LocalToEarth(points[i], earth);
+		epos[i].Set(earth.x, earth.y);
+	}
+
+	const int found = vtTin::FindAltitudesOnEarth(&epos[0], &alt[0], count, bTrue);
+	for (uint i = 0; i < count; i++)
+	{
+		if (alt[i] != INVALID_ELEVATION)
+			points[i].y = alt[i];
+	}
+	return found;
+}
+
 FPoint3 vtTin::GetTriangleNormal(int iTriangle) const
 {
 	FPoint3 wp0, wp1, wp2;
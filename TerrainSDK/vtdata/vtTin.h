@@ -41,6 +41,8 @@ public:
 			bytes += (sizeof(int) * iData[i].size());
 		return bytes;
 	}
+	int GetCols() const { return iCols; }
+	int GetRows() const { return iRows; }
 private:
 	Bin *iData;
 	int	iCols, iRows;
@@ -108,6 +110,10 @@ public:
 		bool bTrue = false) const;
 	virtual bool FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude,
 		bool bTrue = false, int iCultureFlags=0, FPoint3 *vNormal = NULL) const;
+	virtual int FindAltitudesOnEarth(const DPoint2 *points, float *fAltitudes,
+		uint count, bool bTrue = false) const;
+	virtual int FindAltitudesAtPoints(FPoint3 *points, uint count,
+		bool bTrue = false, int iCultureFlags = 0) const;
 
 	// This method tells you the height, and also which triangle intersected.
 	bool FindTriangleOnEarth(const DPoint2 &p, float &fAltitude,
@@ -16,6 +16,15 @@
 #include "vtdata/Features.h"	// for vtFeatureSet
 #include "vtdata/vtLog.h"
 
+// Layers with more features than this are batched, unless the style says
+//  otherwise.
+#define BATCH_THRESHOLD		5000
+
+// When batched, the number of features per cell (if they are evenly spread)
+//  and the largest grid of cells.
+#define FEATURES_PER_CELL	2000
+#define MAX_CELLS_PER_SIDE	64
+
 vtAbstractLayer::vtAbstractLayer() : vtLayer(LT_RAW)
 {
 	m_pSet = NULL;
@@ -24,10 +33,16 @@ vtAbstractLayer::vtAbstractLayer() : vtLayer(LT_RAW)
 	pLabelGroup = NULL;
 	pMultiTexture = NULL;
 	m_pHeightField = NULL;
+	pGeodeObject = NULL;
+	pGeodeLine = NULL;
 
 	m_Props.SetValueString("Type", TERR_LTYPE_ABSTRACT);
 
 	m_bNeedRebuild = false;
+	m_iEditDepth = 0;
+	m_bBatched = false;
+	material_index_batch_object = -1;
+	material_index_batch_line = -1;
 }
 
 vtAbstractLayer::~vtAbstractLayer()
@@ -167,6 +182,52 @@ bool GetColorField(const vtFeatureSet &feat, int iRecord, int iField, RGBAf &rgb
 	return true;
 }
 
+// Helpers for batched geometry, which append to a mesh of triangles.  Unlike
+//  vtMesh::CreateEllipsoid, these work on a mesh which is not empty.
+static void AddSphere(vtMesh *mesh, const FPoint3 &center, float fRadius, int res)
+{
+	const int theta_res = res * 2;
+	const int phi_res = res;
+	const int base = mesh->NumVertices();
+	for (int j = 0; j <= phi_res; j++)
+	{
+		const float phi = j * PIf / phi_res;
+		for (int i = 0; i <= theta_res; i++)
+		{
+			const float theta = i * PI2f / theta_res;
+			FPoint3 v(sinf(theta) * sinf(phi), cosf(phi), cosf(theta) * sinf(phi));
+			mesh->AddVertexN(center + v * fRadius, v);
+		}
+	}
+	const int row = theta_res + 1;
+	for (int j = 0; j < phi_res; j++)
+	{
+		for (int i = 0; i < theta_res; i++)
+		{
+			const int a = base + j * row + i;
+			const int c = a + row;
+			mesh->AddTri(a, c, a + 1);
+			mesh->AddTri(a + 1, c, c + 1);
+		}
+	}
+}
+
+static void AddTetrahedron(vtMesh *mesh, const FPoint3 &center, float fRadius)
+{
+	const uint start = mesh->NumVertices();
+	mesh->CreateTetrahedron(center, fRadius);
+
+	// Each face has its own three vertices; give them the face normal
+	FPoint3 normal;
+	for (uint i = start; i + 2 < mesh->NumVertices(); i += 3)
+	{
+		normal.UnitNormal(mesh->GetVtxPos(i), mesh->GetVtxPos(i+1), mesh->GetVtxPos(i+2));
+		mesh->SetVtxNormal(i, normal);
+		mesh->SetVtxNormal(i+1, normal);
+		mesh->SetVtxNormal(i+2, normal);
+	}
+}
+
 void vtAbstractLayer::CreateContainer(osg::Group *pParent)
 {
 	// first time
@@ -206,6 +267,11 @@ void vtAbstractLayer::RecreateFeatureVisuals(bool progress_callback(int))
 	uint entities = m_pSet->NumEntities();
 	VTLOG("  Creating %d entities.. ", entities);
 
+	if (!m_Props.GetValueBool("Batched", m_bBatched))
+		m_bBatched = (entities > BATCH_THRESHOLD);
+	if (m_bBatched)
+		SetupCells();
+
 	for (uint i = 0; i < entities; i++)
 	{
 		CreateFeatureVisual(i);
@@ -222,6 +288,8 @@ void vtAbstractLayer::RecreateFeatureVisuals(bool progress_callback(int))
 	if (m_Props.GetValueBool("LineGeometry") && m_pSetP3 != NULL)
 		CreateLineGeometryForPoints();
 
+	if (m_bBatched)
+		VTLOG("(batched in %d x %d cells) ", m_CellCount.x, m_CellCount.y);
 	VTLOG1("Done.\n");
 }
 
@@ -259,6 +327,16 @@ void vtAbstractLayer::CreateGeomGroup()
 	// There is always a yellow highlight material
 	material_index_yellow = pGeomMats->AddRGBMaterial(RGBf(1,1,0), false, false);
 
+	// Batched geometry is colored by its vertices
+	if (m_bBatched)
+	{
+		material_index_batch_object = pGeomMats->AddRGBMaterial(RGBf(1,1,1), true, true);
+		vtMaterial *mat = pGeomMats->at(material_index_batch_object).get();
+		mat->m_pMaterial->setColorMode(osg::Material::AMBIENT_AND_DIFFUSE);
+
+		material_index_batch_line = pGeomMats->AddRGBMaterial(RGBf(1,1,1), false, false);
+	}
+
 	pGeodeObject = new vtGeode;
 	pGeodeObject->setName("Objects");
 	pGeodeObject->SetMaterials(pGeomMats);
@@ -323,6 +401,26 @@ int vtAbstractLayer::GetObjectMaterialIndex(vtTagArray &style, uint iIndex)
 	return result;
 }
 
+RGBAf vtAbstractLayer::GetObjectColor(uint iIndex)
+{
+	int color_field_index;
+	RGBAf rgba;
+	if (m_Props.GetValueInt("ObjectColorFieldIndex", color_field_index) &&
+		GetColorField(*m_pSet, iIndex, color_field_index, rgba))
+		return rgba;
+	return RGBf(m_Props.GetValueRGBi("ObjectGeomColor"));
+}
+
+RGBAf vtAbstractLayer::GetLineColor(uint iIndex)
+{
+	int color_field_index;
+	RGBAf rgba;
+	if (m_Props.GetValueInt("LineColorFieldIndex", color_field_index) &&
+		GetColorField(*m_pSet, iIndex, color_field_index, rgba))
+		return rgba;
+	return RGBf(m_Props.GetValueRGBi("LineGeomColor"));
+}
+
 
 /**
 	Given a featureset and style description, create a geometry object (such as
@@ -341,9 +439,6 @@ void vtAbstractLayer::CreateObjectGeometry(uint iIndex)
 	if (!m_pSetP2 && !m_pSetP3 && !m_pSetLS2 && !m_pSetLS3)
 		return;
 
-	// Determine color and material index
-	int material_index = GetObjectMaterialIndex(m_Props, iIndex);
-
 	// Determine geometry size and placement
 	float fHeight = 0.0f;
 	if (m_pSetP2 || m_pSetLS2)
@@ -356,69 +451,30 @@ void vtAbstractLayer::CreateObjectGeometry(uint iIndex)
 	int res = 3;
 	FPoint3 p3;
 
-	// Track what is created
-	vtVisual *viz = GetViz(m_pSet->GetFeature(iIndex));
-
+	// Find the location of each object
+	std::vector<FPoint3> points;
 	if (m_pSetP2)
 	{
 		const DPoint2 &epos = m_pSetP2->GetPoint(iIndex);
 		m_pHeightField->ConvertEarthToSurfacePoint(epos, p3, 0, true);	// use true elev
 		p3.y += fHeight;
-
-		vtMesh *mesh = new vtMesh(osg::PrimitiveSet::TRIANGLE_STRIP, VT_Normals, res*res*2);
-		mesh->CreateEllipsoid(p3, FPoint3(fRadius, fRadius, fRadius), res);
-
-		pGeodeObject->AddMesh(mesh, material_index);
-
-		// Track
-		if (viz) viz->m_meshes.push_back(mesh);
+		points.push_back(p3);
 	}
 	else if (m_pSetP3)
 	{
 		const DPoint3 &epos = m_pSetP3->GetPoint(iIndex);
-		float original_z = (float) epos.z;
 		m_pHeightField->m_LocalCS.EarthToLocal(epos, p3);
-
-		// If a large number of entities, make as simple geometry as possible
-		bool bTetrahedra = (m_pSet->NumEntities() > 10000);
-
-		bool bShaded = true;
-		vtMesh *mesh;
-		if (bTetrahedra)
-		{
-			mesh = new vtMesh(osg::PrimitiveSet::TRIANGLES, bShaded ? VT_Normals : 0, 12);
-			mesh->CreateTetrahedron(p3, fRadius);
-			if (bShaded)
-				mesh->SetNormalsFromPrimitives();
-		}
-		else
-		{
-			mesh = new vtMesh(osg::PrimitiveSet::TRIANGLE_STRIP, bShaded ? VT_Normals : 0, res*res*2);
-			mesh->CreateEllipsoid(p3, FPoint3(fRadius, fRadius, fRadius), res);
-		}
-
-		pGeodeObject->AddMesh(mesh, material_index);
-
-		// Track
-		if (viz) viz->m_meshes.push_back(mesh);
+		points.push_back(p3);
 	}
 	else if (m_pSetLS2)
 	{
 		const DLine2 &dline = m_pSetLS2->GetPolyLine(iIndex);
-		for (uint j = 0; j < dline.GetSize(); j++)
-		{
-			// preserve 3D point's elevation: don't drape
-			m_pHeightField->ConvertEarthToSurfacePoint(dline[j], p3);
-			p3.y += fHeight;
-
-			vtMesh *mesh = new vtMesh(osg::PrimitiveSet::TRIANGLE_STRIP, VT_Normals, res*res*2);
-			mesh->CreateEllipsoid(p3, FPoint3(fRadius, fRadius, fRadius), res);
-
-			pGeodeObject->AddMesh(mesh, material_index);
-
-			// Track
-			if (viz) viz->m_meshes.push_back(mesh);
-		}
+		const uint num = dline.GetSize();
+		points.resize(num);
+		if (num > 0)
+			m_pHeightField->ConvertEarthToSurfacePoints(dline.GetData(), &points[0], num);
+		for (uint j = 0; j < num; j++)
+			points[j].y += fHeight;
 	}
 	else if (m_pSetLS3)
 	{
@@ -427,15 +483,55 @@ void vtAbstractLayer::CreateObjectGeometry(uint iIndex)
 		{
 			// preserve 3D point's elevation: don't drape
 			m_pHeightField->m_LocalCS.EarthToLocal(dline[j], p3);
+			points.push_back(p3);
+		}
+	}
 
-			vtMesh *mesh = new vtMesh(osg::PrimitiveSet::TRIANGLE_STRIP, VT_Normals, res*res*2);
-			mesh->CreateEllipsoid(p3, FPoint3(fRadius, fRadius, fRadius), res);
+	// If a large number of 3D points, make as simple geometry as possible
+	bool bTetrahedra = (m_pSetP3 != NULL && m_pSet->NumEntities() > 10000);
+
+	// Track what is created
+	vtVisual *viz = GetViz(iIndex);
+
+	if (m_bBatched)
+	{
+		// Add to the mesh of the cell, as a range of vertices
+		vtMesh *mesh = GetCellMesh(GetCell(viz, iIndex), true);
+		viz->m_iObjStart = mesh->NumVertices();
+		for (uint i = 0; i < points.size(); i++)
+		{
+			if (bTetrahedra)
+				AddTetrahedron(mesh, points[i], fRadius);
+			else
+				AddSphere(mesh, points[i], fRadius, res);
+		}
+		viz->m_iObjCount = mesh->NumVertices() - viz->m_iObjStart;
+		ColorRange(mesh, viz->m_iObjStart, viz->m_iObjCount,
+			m_pSet->IsSelected(iIndex) ? RGBAf(1,1,0) : GetObjectColor(iIndex));
+		return;
+	}
 
-			pGeodeObject->AddMesh(mesh, material_index);
+	// Determine color and material index
+	int material_index = GetObjectMaterialIndex(m_Props, iIndex);
 
-			// Track
-			if (viz) viz->m_meshes.push_back(mesh);
+	for (uint i = 0; i < points.size(); i++)
+	{
+		vtMesh *mesh;
+		if (bTetrahedra)
+		{
+			mesh = new vtMesh(osg::PrimitiveSet::TRIANGLES, VT_Normals, 12);
+			mesh->CreateTetrahedron(points[i], fRadius);
+			mesh->SetNormalsFromPrimitives();
 		}
+		else
+		{
+			mesh = new vtMesh(osg::PrimitiveSet::TRIANGLE_STRIP, VT_Normals, res*res*2);
+			mesh->CreateEllipsoid(points[i], FPoint3(fRadius, fRadius, fRadius), res);
+		}
+		pGeodeObject->AddMesh(mesh, material_index);
+
+		// Track
+		if (viz) viz->m_meshes.push_back(mesh);
 	}
 }
 
@@ -461,7 +557,9 @@ void vtAbstractLayer::CreateLineGeometry(uint iIndex)
 	// Determine color and material index
 	int color_field_index;
 	int material_index;
-	if (m_Props.GetValueInt("LineColorFieldIndex", color_field_index))
+	if (m_bBatched)
+		material_index = material_index_batch_line;
+	else if (m_Props.GetValueInt("LineColorFieldIndex", color_field_index))
 	{
 		RGBAf rgba;
 		if (GetColorField(*m_pSet, iIndex, color_field_index, rgba))
@@ -502,8 +600,17 @@ void vtAbstractLayer::CreateLineGeometry(uint iIndex)
 		}
 	}
 
-	vtGeomFactory mf(pGeodeLine, osg::PrimitiveSet::LINE_STRIP, 0, 3000, material_index,
-		iEstimatedVerts);
+	// When batched, the lines are added to the mesh of the cell
+	vtVisual *viz = GetViz(iIndex);
+	vtMesh *batch = NULL;
+	if (m_bBatched)
+	{
+		batch = GetCellMesh(GetCell(viz, iIndex), false);
+		viz->m_iLineStart = batch->NumVertices();
+	}
+	vtGeomFactory mf = batch ? vtGeomFactory(batch) :
+		vtGeomFactory(pGeodeLine, osg::PrimitiveSet::LINE_STRIP, 0, 3000,
+			material_index, iEstimatedVerts);
 
 	float fHeight = 0.0f;
 	if (m_pSetLS2 || m_pSetPoly)
@@ -565,6 +672,14 @@ void vtAbstractLayer::CreateLineGeometry(uint iIndex)
 		}
 	}
 
+	if (batch)
+	{
+		viz->m_iLineCount = batch->NumVertices() - viz->m_iLineStart;
+		ColorRange(batch, viz->m_iLineStart, viz->m_iLineCount,
+			m_pSet->IsSelected(iIndex) ? RGBAf(1,1,0) : GetLineColor(iIndex));
+		return;
+	}
+
 	// If the user specified a line width, apply it now
 	bool bWidth = false;
 	float fWidth;
@@ -572,7 +687,6 @@ void vtAbstractLayer::CreateLineGeometry(uint iIndex)
 		bWidth = true;
 
 	// Track what was created
-	vtVisual *viz = GetViz(m_pSet->GetFeature(iIndex));
 	for (uint i = 0; i < mf.Meshes(); i++)
 	{
 		vtMesh *mesh = mf.Mesh(i);
@@ -717,10 +831,6 @@ void vtAbstractLayer::CreateFeatureLabel(uint iIndex)
 	text->SetText(str);
 #endif
 
-	// Create the vtGeode object to contain the vtTextMesh
-	vtGeode *geode = new vtGeode;
-	geode->setName(str);
-
 	// Determine feature color
 	bool bGotColor = false;
 	int color_field_index;
@@ -741,6 +851,28 @@ void vtAbstractLayer::CreateFeatureLabel(uint iIndex)
 
 	bool bOutline = m_Props.GetValueBool("LabelOutline");
 
+	vtVisual *viz = GetViz(iIndex);
+	if (m_bBatched)
+	{
+		// All the labels of the cell share one geode, and are positioned
+		//  directly rather than with a transform each.
+		vtVisualCell &cell = GetCell(viz, iIndex);
+		if (!cell.m_pLabels)
+		{
+			cell.m_pLabels = new vtGeode;
+			cell.m_pLabels->setName("Labels");
+			pLabelGroup->addChild(cell.m_pLabels);
+		}
+		text->SetPosition(fp3);
+		cell.m_pLabels->AddTextMesh(text, -1, bOutline);
+		viz->m_pLabel = text;
+		return;
+	}
+
+	// Create the vtGeode object to contain the vtTextMesh
+	vtGeode *geode = new vtGeode;
+	geode->setName(str);
+
 	// Labels will automatically turn to face the user because that's vtlib's
 	// default behavior now.
 	geode->AddTextMesh(text, -1, bOutline);
@@ -752,7 +884,6 @@ void vtAbstractLayer::CreateFeatureLabel(uint iIndex)
 	pLabelGroup->addChild(bb);
 
 	// Track what was created
-	vtVisual *viz = GetViz(m_pSet->GetFeature(iIndex));
 	if (viz) viz->m_xform = bb;
 }
 
@@ -767,8 +898,7 @@ void vtAbstractLayer::ReleaseGeometry()
 
 	for (int i = m_pSet->NumEntities()-1; i >= 0; i--)
 	{
-		vtFeature *f = m_pSet->GetFeature(i);
-		ReleaseFeatureGeometry(f);
+		ReleaseFeatureGeometry(i);
 	}
 	if (pGeomGroup)
 	{
@@ -780,14 +910,20 @@ void vtAbstractLayer::ReleaseGeometry()
 		pContainer->removeChild(pLabelGroup);
 		pLabelGroup = NULL;
 	}
+	m_Cells.clear();
 }
 
 /**
  * Release all the 3D stuff created for a given feature.
  */
-void vtAbstractLayer::ReleaseFeatureGeometry(vtFeature *f)
+void vtAbstractLayer::ReleaseFeatureGeometry(uint iIndex)
 {
-	vtVisual *v = GetViz(f);
+	vtVisual *v = GetViz(iIndex);
+
+	// When batched, the geometry is shared with the other features of the
+	//  cell, which must be rebuilt without it.
+	if (v->m_iCell >= 0 && v->m_iCell < (int) m_Cells.size())
+		m_Cells[v->m_iCell].m_bDirty = true;
 
 	for (uint m = 0; m < v->m_meshes.size(); m++)
 	{
@@ -799,16 +935,16 @@ void vtAbstractLayer::ReleaseFeatureGeometry(vtFeature *f)
 	if (v->m_xform)
 		pLabelGroup->removeChild(v->m_xform);
 	delete v;
-	m_Map.erase(f);
+	m_Map.erase(m_pSet->GetFeatureId(iIndex));
 }
 
-void vtAbstractLayer::DeleteFeature(vtFeature *f)
+void vtAbstractLayer::DeleteFeature(uint iIndex)
 {
 	// Check if we need to rebuild the whole thing
 	if (CreateAtOnce())
 		m_bNeedRebuild = true;
 	else
-		ReleaseFeatureGeometry(f);
+		ReleaseFeatureGeometry(iIndex);
 }
 
 void vtAbstractLayer::RefreshFeatureVisuals(bool progress_callback(int))
@@ -821,21 +957,83 @@ void vtAbstractLayer::RefreshFeatureVisuals(bool progress_callback(int))
 void vtAbstractLayer::RefreshFeature(uint iIndex)
 {
 	// If we're not doing a full rebuild, we can create individual items
-	if (!m_bNeedRebuild)
+	if (m_bNeedRebuild)
+		return;
+
+	if (m_bBatched)
 	{
-		vtFeature *f = m_pSet->GetFeature(iIndex);
-		ReleaseFeatureGeometry(f);
+		// Rebuild the cell it was in, and the one it is in now.  Rebuilding
+		//  looks at every feature, so inside EditBegin/EditEnd it waits for
+		//  EditEnd, to rebuild the cells of all the edited features at once.
+		vtVisual *viz = GetViz(iIndex);
+		if (viz->m_iCell >= 0)
+			m_Cells[viz->m_iCell].m_bDirty = true;
+		viz->m_iCell = CellOfFeature(iIndex);
+		m_Cells[viz->m_iCell].m_bDirty = true;
+		if (m_iEditDepth == 0)
+			RebuildDirtyCells();
+	}
+	else
+	{
+		ReleaseFeatureGeometry(iIndex);
 		CreateFeatureVisual(iIndex);
 	}
 }
 
+/**
+ * Rebuild the visuals of a set of features, e.g. to re-drape them after the
+ * elevation under them has changed.  In batched mode, each affected cell is
+ * rebuilt only once.
+ */
+void vtAbstractLayer::RefreshFeatures(const std::vector<uint> &indices)
+{
+	if (!pContainer || m_bNeedRebuild)
+		return;
+
+	if (!m_bBatched)
+	{
+		for (uint i = 0; i < indices.size(); i++)
+			RefreshFeature(indices[i]);
+		return;
+	}
+	for (uint i = 0; i < indices.size(); i++)
+	{
+		vtVisual *viz = GetViz(indices[i]);
+		if (viz->m_iCell >= 0)
+			m_Cells[viz->m_iCell].m_bDirty = true;
+		viz->m_iCell = CellOfFeature(indices[i]);
+		m_Cells[viz->m_iCell].m_bDirty = true;
+	}
+	RebuildDirtyCells();
+}
+
 void vtAbstractLayer::UpdateVisualSelection()
 {
+	if (m_bBatched)
+	{
+		// Color the range of vertices of each feature
+		const RGBAf yellow(1,1,0);
+		for (uint j = 0; j < m_pSet->NumEntities(); j++)
+		{
+			vtVisual *viz = GetViz(j);
+			if (viz->m_iCell < 0)
+				continue;
+			vtVisualCell &cell = m_Cells[viz->m_iCell];
+			bool bSelected = m_pSet->IsSelected(j);
+			if (cell.m_pObjects && viz->m_iObjCount)
+				ColorRange(cell.m_pObjects, viz->m_iObjStart, viz->m_iObjCount,
+					bSelected ? yellow : GetObjectColor(j));
+			if (cell.m_pLines && viz->m_iLineCount)
+				ColorRange(cell.m_pLines, viz->m_iLineStart, viz->m_iLineCount,
+					bSelected ? yellow : GetLineColor(j));
+		}
+		return;
+	}
+
 	// use SetMeshMatIndex to make the meshes of selected features yellow
 	for (uint j = 0; j < m_pSet->NumEntities(); j++)
 	{
-		vtFeature *feat = m_pSet->GetFeature(j);
-		vtVisual *viz = GetViz(feat);
+		vtVisual *viz = GetViz(j);
 		if (viz)
 		{
 			int material_index;
@@ -881,27 +1079,38 @@ void vtAbstractLayer::Reload()
 //  methods around any editing of style or geometry.
 void vtAbstractLayer::EditBegin()
 {
+	m_iEditDepth++;
 }
 
 void vtAbstractLayer::EditEnd()
 {
+	if (m_iEditDepth > 0)
+		m_iEditDepth--;
+	if (m_iEditDepth > 0)
+		return;
+
 	if (m_bNeedRebuild)
 	{
 		m_bNeedRebuild = false;
 		RefreshFeatureVisuals();
 	}
+	else if (m_bBatched)
+		RebuildDirtyCells();
 }
 
-vtVisual *vtAbstractLayer::GetViz(vtFeature *feat)
+vtVisual *vtAbstractLayer::GetViz(uint iIndex)
 {
 #if 0
 	return NULL;
 #else
-	vtVisual *v = m_Map[feat];
+	// The visuals are kept by feature ID, which does not change when other
+	//  features are deleted.
+	const uint id = m_pSet->GetFeatureId(iIndex);
+	vtVisual *v = m_Map[id];
 	if (!v)
 	{
 		v = new vtVisual;
-		m_Map[feat] = v;
+		m_Map[id] = v;
 	}
 	return v;
 #endif
@@ -916,3 +1125,230 @@ bool vtAbstractLayer::CreateAtOnce()
 	return false;
 }
 
+
+/**
+ * Get the bounding box of the geometry which shows a feature.
+ *
+ * \returns false if the feature has no geometry.
+ */
+bool vtAbstractLayer::GetFeatureBound(uint iIndex, FBox3 &box)
+{
+	vtVisual *viz = GetViz(iIndex);
+	box.InsideOut();
+	bool bAny = false;
+
+	FBox3 mbox;
+	for (uint k = 0; k < viz->m_meshes.size(); k++)
+	{
+		viz->m_meshes[k]->GetBoundBox(mbox);
+		box.GrowToContainBox(mbox);
+		bAny = true;
+	}
+	if (viz->m_iCell >= 0)
+	{
+		const vtVisualCell &cell = m_Cells[viz->m_iCell];
+		for (uint i = 0; cell.m_pObjects && i < viz->m_iObjCount; i++)
+			box.GrowToContainPoint(cell.m_pObjects->GetVtxPos(viz->m_iObjStart + i));
+		for (uint i = 0; cell.m_pLines && i < viz->m_iLineCount; i++)
+			box.GrowToContainPoint(cell.m_pLines->GetVtxPos(viz->m_iLineStart + i));
+		bAny = bAny || viz->m_iObjCount != 0 || viz->m_iLineCount != 0;
+	}
+	return bAny;
+}
+
+/**
+ * Get the extents of a feature, in the earth CRS of the terrain.
+ *
+ * \returns false if the feature has no points.
+ */
+bool vtAbstractLayer::GetFeatureExtents(uint iIndex, DRECT &ext)
+{
+	ext.SetInsideOut();
+	if (m_pSetP2)
+		ext.GrowToContainPoint(m_pSetP2->GetPoint(iIndex));
+	else if (m_pSetP3)
+	{
+		const DPoint3 &p3 = m_pSetP3->GetPoint(iIndex);
+		ext.GrowToContainPoint(DPoint2(p3.x, p3.y));
+	}
+	else if (m_pSetLS2)
+		ext.GrowToContainLine(m_pSetLS2->GetPolyLine(iIndex));
+	else if (m_pSetLS3)
+		ext.GrowToContainLine(m_pSetLS3->GetPolyLine(iIndex));
+	else if (m_pSetPoly)
+	{
+		const DPolygon2 &dpoly = m_pSetPoly->GetPolygon(iIndex);
+		for (uint k = 0; k < dpoly.size(); k++)
+			ext.GrowToContainLine(dpoly[k]);
+	}
+	if (ext.left > ext.right)
+		return false;
+
+	if (m_pOCTransform.get())
+	{
+		// Transform the corners; close enough for the small extent of a feature
+		DPoint2 corner[4];
+		corner[0].Set(ext.left, ext.bottom);
+		corner[1].Set(ext.right, ext.bottom);
+		corner[2].Set(ext.right, ext.top);
+		corner[3].Set(ext.left, ext.top);
+		ext.SetInsideOut();
+		for (int i = 0; i < 4; i++)
+		{
+			m_pOCTransform->Transform(1, &corner[i].x, &corner[i].y);
+			ext.GrowToContainPoint(corner[i]);
+		}
+	}
+	return true;
+}
+
+/**
+ * In batched mode, the features are divided among the cells of a grid over
+ * their extents, so that each cell has about FEATURES_PER_CELL features if
+ * they are evenly spread.  Each cell has its own meshes, so that it can be
+ * culled, and rebuilt when one of its features changes, on its own.
+ */
+void vtAbstractLayer::SetupCells()
+{
+	if (!m_pSet->EarthExtents(m_CellExtents))
+		m_CellExtents.SetRect(0, 1, 1, 0);
+
+	int side = (int) ceil(sqrt((double) m_pSet->NumEntities() / FEATURES_PER_CELL));
+	if (side < 1)
+		side = 1;
+	if (side > MAX_CELLS_PER_SIDE)
+		side = MAX_CELLS_PER_SIDE;
+	m_CellCount.Set(side, side);
+
+	m_Cells.clear();
+	m_Cells.resize(side * side);
+}
+
+/**
+ * The cell of a feature is the one which contains its first point.
+ */
+int vtAbstractLayer::CellOfFeature(uint iIndex) const
+{
+	DPoint2 p;
+	if (m_pSetP2)
+		p = m_pSetP2->GetPoint(iIndex);
+	else if (m_pSetP3)
+	{
+		const DPoint3 &p3 = m_pSetP3->GetPoint(iIndex);
+		p.Set(p3.x, p3.y);
+	}
+	else if (m_pSetLS2 && m_pSetLS2->GetPolyLine(iIndex).GetSize() > 0)
+		p = m_pSetLS2->GetPolyLine(iIndex)[0];
+	else if (m_pSetLS3 && m_pSetLS3->GetPolyLine(iIndex).GetSize() > 0)
+	{
+		const DPoint3 &p3 = m_pSetLS3->GetPolyLine(iIndex)[0];
+		p.Set(p3.x, p3.y);
+	}
+	else if (m_pSetPoly && m_pSetPoly->GetPolygon(iIndex).size() > 0 &&
+		m_pSetPoly->GetPolygon(iIndex)[0].GetSize() > 0)
+		p = m_pSetPoly->GetPolygon(iIndex)[0][0];
+	else
+		return 0;
+
+	int x = 0, y = 0;
+	const double width = m_CellExtents.Width();
+	const double height = m_CellExtents.Height();
+	if (width > 0)
+		x = (int) ((p.x - m_CellExtents.left) / width * m_CellCount.x);
+	if (height > 0)
+		y = (int) ((p.y - m_CellExtents.bottom) / height * m_CellCount.y);
+
+	// Features added later may lie outside the original extents
+	if (x < 0) x = 0;
+	if (x > m_CellCount.x - 1) x = m_CellCount.x - 1;
+	if (y < 0) y = 0;
+	if (y > m_CellCount.y - 1) y = m_CellCount.y - 1;
+	return y * m_CellCount.x + x;
+}
+
+vtVisualCell &vtAbstractLayer::GetCell(vtVisual *viz, uint iIndex)
+{
+	if (viz->m_iCell < 0)
+		viz->m_iCell = CellOfFeature(iIndex);
+	return m_Cells[viz->m_iCell];
+}
+
+/**
+ * Get the mesh of a cell which holds the object geometry (triangles) or the
+ * line geometry of its features, creating it if needed.
+ */
+vtMesh *vtAbstractLayer::GetCellMesh(vtVisualCell &cell, bool bObjects)
+{
+	if (!pGeomGroup)
+		CreateGeomGroup();
+	if (!cell.m_pGeode)
+	{
+		cell.m_pGeode = new vtGeode;
+		cell.m_pGeode->setName("Cell");
+		cell.m_pGeode->SetMaterials(pGeomMats);
+		pGeomGroup->addChild(cell.m_pGeode);
+	}
+	if (bObjects && !cell.m_pObjects)
+	{
+		cell.m_pObjects = new vtMesh(osg::PrimitiveSet::TRIANGLES, VT_Normals | VT_Colors, 4096);
+		cell.m_pGeode->AddMesh(cell.m_pObjects, material_index_batch_object);
+	}
+	if (!bObjects && !cell.m_pLines)
+	{
+		cell.m_pLines = new vtMesh(osg::PrimitiveSet::LINE_STRIP, VT_Colors, 4096);
+		cell.m_pGeode->AddMesh(cell.m_pLines, material_index_batch_line);
+
+		float fWidth;
+		if (m_Props.GetValueFloat("LineWidth", fWidth) && fWidth != 1.0f)
+			cell.m_pLines->SetLineWidth(fWidth);
+	}
+	return bObjects ? cell.m_pObjects : cell.m_pLines;
+}
+
+void vtAbstractLayer::ClearCell(vtVisualCell &cell)
+{
+	if (cell.m_pGeode)
+		cell.m_pGeode->RemoveAllMeshes();
+	if (cell.m_pLabels)
+		cell.m_pLabels->RemoveAllMeshes();
+	cell.m_pObjects = NULL;
+	cell.m_pLines = NULL;
+}
+
+/**
+ * Rebuild the meshes of any cells whose features have changed.
+ */
+void vtAbstractLayer::RebuildDirtyCells()
+{
+	int iDirty = 0;
+	for (uint c = 0; c < m_Cells.size(); c++)
+	{
+		if (m_Cells[c].m_bDirty)
+		{
+			ClearCell(m_Cells[c]);
+			iDirty++;
+		}
+	}
+	if (iDirty == 0)
+		return;
+	VTLOG("Rebuilding %d cells of abstract layer\n", iDirty);
+
+	for (uint i = 0; i < m_pSet->NumEntities(); i++)
+	{
+		vtVisual *viz = GetViz(i);
+		if (viz->m_iCell < 0 || !m_Cells[viz->m_iCell].m_bDirty)
+			continue;
+		viz->m_iObjCount = viz->m_iLineCount = 0;
+		viz->m_pLabel = NULL;
+		CreateFeatureVisual(i);
+	}
+	for (uint c = 0; c < m_Cells.size(); c++)
+		m_Cells[c].m_bDirty = false;
+}
+
+void vtAbstractLayer::ColorRange(vtMesh *mesh, uint iStart, uint iCount,
+								 const RGBAf &color)
+{
+	for (uint i = iStart; i < iStart + iCount; i++)
+		mesh->SetVtxColor(i, color);
+}
@@ -18,12 +18,35 @@ class vtTerrain;
 class vtVisual
 {
 public:
-	vtVisual() : m_xform(NULL) {}
+	vtVisual() : m_xform(NULL), m_iCell(-1), m_iObjStart(0), m_iObjCount(0),
+		m_iLineStart(0), m_iLineCount(0), m_pLabel(NULL) {}
 	std::vector<vtMesh*> m_meshes;
 	vtTransform *m_xform;
+
+	// When the layer is batched, the geometry of the feature is a range of
+	//  vertices in the meshes of the cell which contains it.
+	int m_iCell;
+	uint m_iObjStart, m_iObjCount;
+	uint m_iLineStart, m_iLineCount;
+	vtTextMesh *m_pLabel;
 };
 
-typedef std::map<vtFeature*,vtVisual*> VizMap;
+typedef std::map<uint,vtVisual*> VizMap;
+
+/**
+ * The merged visuals of all the features in one cell of a batched
+ * vtAbstractLayer.
+ */
+struct vtVisualCell
+{
+	vtVisualCell() : m_pGeode(NULL), m_pObjects(NULL), m_pLines(NULL),
+		m_pLabels(NULL), m_bDirty(false) {}
+	vtGeode *m_pGeode;		// contains the two meshes
+	vtMesh *m_pObjects;
+	vtMesh *m_pLines;
+	vtGeode *m_pLabels;
+	bool m_bDirty;
+};
 
 /**
  * An abstract layer is a traditional GIS-style set of geometry features with
@@ -52,6 +75,12 @@ typedef std::map<vtFeature*,vtVisual*> VizMap;
 	 - "Tessellate": true to tesslate the geometry of each feature before draping
 		it on the ground.  This can produce a smoother result.
 
+	- "Batched": true to merge the geometry and labels of the features into a
+		few large meshes, one set per cell of a grid over the layer.  This is
+		much faster to create and draw for large layers, and is the default
+		for layers of more than 5000 features.  Set it to false to always
+		create a separate visual for each feature.
+
 	- "Labels": true to show floating text labels for the features.
 	 - "LabelColor": The color of each label (R,G,B as float 0..1)
 		Default is white.
@@ -90,7 +119,10 @@ public:
 	vtFeatureSet *GetFeatureSet() const { return m_pSet; }
 	vtGroup *GetLabelGroup() const { return pLabelGroup; }
 	vtGroup *GetContainer() const { return pContainer.get(); }
-	vtVisual *GetViz(vtFeature *feat);
+	vtVisual *GetViz(uint iIndex);
+	bool GetFeatureBound(uint iIndex, FBox3 &box);
+	bool GetFeatureExtents(uint iIndex, DRECT &ext);
+	bool IsBatched() const { return m_bBatched; }
 	vtMultiTexture *GetMultiTexture() const { return pMultiTexture; }
 	void CreateContainer(osg::Group *pParent);
 	bool EarthExtents(DRECT &ext);
@@ -108,24 +140,37 @@ public:
 	void CreateFeatureLabel(uint iIndex);
 
 	void ReleaseGeometry();
-	void ReleaseFeatureGeometry(vtFeature *f);
+	void ReleaseFeatureGeometry(uint iIndex);
 
 	// When the underlying feature changes, we need to rebuild the visual
 	void RefreshFeatureVisuals(bool progress_callback(int) = NULL);
 	void RefreshFeature(uint iIndex);
+	void RefreshFeatures(const std::vector<uint> &indices);
 	void UpdateVisualSelection();
 	void Reload();
 
 	// To make sure all edits are fully reflected in the visual, call these
-	//  methods around any editing of style or geometry.
+	//  methods around any editing of style or geometry.  In batched mode,
+	//  RefreshFeature calls between them are rebuilt together at EditEnd.
 	void EditBegin();
 	void EditEnd();
-	void DeleteFeature(vtFeature *f);
+	void DeleteFeature(uint iIndex);
 
 protected:
 	void CreateGeomGroup();
 	void CreateLabelGroup();
 	int GetObjectMaterialIndex(vtTagArray &style, uint iIndex);
+	RGBAf GetObjectColor(uint iIndex);
+	RGBAf GetLineColor(uint iIndex);
+
+	// Batched visuals
+	void SetupCells();
+	int CellOfFeature(uint iIndex) const;
+	vtVisualCell &GetCell(vtVisual *viz, uint iIndex);
+	vtMesh *GetCellMesh(vtVisualCell &cell, bool bObjects);
+	void ClearCell(vtVisualCell &cell);
+	void RebuildDirtyCells();
+	void ColorRange(vtMesh *mesh, uint iStart, uint iCount, const RGBAf &color);
 
 	/// This is the set of features which the layer contains.
 	vtFeatureSet *m_pSet;
@@ -157,12 +202,21 @@ protected:
 
 	VizMap m_Map;
 
+	// Batched visuals: a grid of cells over the earth extents of the features
+	bool m_bBatched;
+	int material_index_batch_object;
+	int material_index_batch_line;
+	std::vector<vtVisualCell> m_Cells;
+	DRECT m_CellExtents;
+	IPoint2 m_CellCount;
+
 	// A transform from the CRS of the featureset to the CRS of the scene they are shown in.
 	std::auto_ptr<OCTransform> m_pOCTransform;
 
 	// Edit tracking
 	bool CreateAtOnce();
 	bool m_bNeedRebuild;
+	int m_iEditDepth;
 };
 
 #endif // ABSTRACTLAYERH
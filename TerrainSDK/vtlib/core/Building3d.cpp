@@ -85,7 +85,16 @@ void vtBuilding3d::DestroyGeometry()
 void vtBuilding3d::AdjustHeight(vtHeightField3d *pHeightField)
 {
 	UpdateWorldLocation(pHeightField);
-	m_pContainer->SetTrans(m_center);
+	ApplyWorldLocation();
+}
+
+/**
+ * Move the building's geometry to the location found by UpdateWorldLocation.
+ */
+void vtBuilding3d::ApplyWorldLocation()
+{
+	if (m_pContainer.valid())
+		m_pContainer->SetTrans(m_center);
 }
 
 void vtBuilding3d::CreateUpperPolygon(const vtLevel *lev, FPolygon3 &polygon,
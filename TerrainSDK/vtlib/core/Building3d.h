@@ -54,6 +54,9 @@ public:
 	void DestroyGeometry();
 	bool CreateGeometry(vtHeightField3d *pHeightField);
 	void AdjustHeight(vtHeightField3d *pHeightField);
+	// AdjustHeight in two steps, so that the first can be done in parallel
+	void UpdateWorldLocation(vtHeightField3d *pHeightField);
+	void ApplyWorldLocation();
 	vtGeode *CreateHighlight();
 
 	// randomize building properties
@@ -72,7 +75,6 @@ protected:
 	FPoint3 m_center;
 
 	// internal methods
-	void UpdateWorldLocation(vtHeightField3d *pHeightField);
 	float GetHeightOfStories();
 	void CreateUpperPolygon(const vtLevel *lev, FPolygon3 &poly, FPolygon3 &poly2);
 
@@ -21,6 +21,10 @@ public:
 
 	bool Valid();
 	void Eval();
+	// A car moves only its own transform, but it is not independent (see
+	//  vtEngine::IsIndependent): it samples the ground and roads under its
+	//  wheels, and neither culture intersection nor libMini can be asked
+	//  from several threads at once.
 	void IgnoreElapsedTime();
 
 	FPoint3 GetCurPos() { return m_vCurPos; }
@@ -1,27 +1,19 @@
 //
 // Name:	 Contours.cpp
-// Purpose:  Contour-related code, which interfaces vtlib to the
-//	QuikGrid library.
+// Purpose:  Contour-related code, which uses vtContourGenerator to make
+//	contour lines on a terrain.
 //
-// Copyright (c) 2004-2009 Virtual Terrain Project
+// Copyright (c) 2004-2013 Virtual Terrain Project
 // Free for all uses, see license.txt for details.
 //
 
 #include "vtlib/vtlib.h"
-
-#if SUPPORT_QUIKGRID
-#include "vtdata/QuikGrid.h"
+#include "vtdata/vtLog.h"
 #include "Contours.h"
 #include <vtlib/core/TiledGeom.h>
 
-//
-// This callback function will receive points output from QuikGrid.
-//
-void ReceiveContourPoint2(void *context, float x, float y, bool bStart)
-{
-	vtContourConverter *cc = (vtContourConverter *) context;
-	cc->Coord(x, y, bStart);
-}
+// A tiled terrain is sampled at no more than this many points on a side.
+#define MAX_SAMPLES		8192
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -29,16 +21,14 @@ void ReceiveContourPoint2(void *context, float x, float y, bool bStart)
 
 vtContourConverter::vtContourConverter()
 {
-	m_pMF = NULL;
-	m_pGrid = NULL;
+	m_pTerrain = NULL;
+	m_pHF = NULL;
 	m_pGeode = NULL;
 	m_pLS = NULL;
 }
 
 vtContourConverter::~vtContourConverter()
 {
-	delete m_pMF;
-	delete m_pGrid;
 }
 
 bool vtContourConverter::SetupTerrain(vtTerrain *pTerr)
@@ -46,82 +36,49 @@ bool vtContourConverter::SetupTerrain(vtTerrain *pTerr)
 	// Make a note of this terrain and its attributes
 	m_pTerrain = pTerr;
 	m_pHF = pTerr->GetHeightFieldGrid3d();
-	int tileLod0Size = 0;
-	if (!m_pHF)
-	{
-		vtTiledGeom *tiledGeom = pTerr->GetTiledGeom();
-		if (!tiledGeom)
-			return false;
-
-		m_ext = tiledGeom->GetEarthExtents();
-		//get highest LOD
-		int minLod = 0;
-		for(int i = 0; i < tiledGeom->rows * tiledGeom->rows; i++)
-			if (tiledGeom->m_elev_info.lodmap.m_min[i] > minLod)
-				minLod = tiledGeom->m_elev_info.lodmap.m_min[i];
-
-		tileLod0Size = 1 << minLod;
-		m_spacing = DPoint2(m_ext.Width() / (tiledGeom->cols * tileLod0Size), m_ext.Height() / (tiledGeom->rows *tileLod0Size));
-	}
-	else
-	{
-		m_ext = m_pHF->GetEarthExtents();
-		m_spacing = m_pHF->GetSpacing();
-	}
-
-	// copy data from our grid to a QuikGrid object
-	int nx, ny;
 	if (m_pHF)
-		m_pHF->GetDimensions(nx, ny);
-	else
 	{
-		vtTiledGeom *tiledGeom = pTerr->GetTiledGeom();
-		nx = tiledGeom->cols * tileLod0Size + 1;
-		ny = tiledGeom->rows * tileLod0Size + 1;
+		// Contour directly from the grid
+		return m_Generator.Setup(m_pHF);
 	}
-	// we can't allocate too much memory, so reduce the resolution if too large
-	DPoint2 scale(1.0, 1.0);
-	while ((nx/scale.x) > 8192)
-		scale.x *= 2.0;
-	while ((ny/scale.y) > 8192)
-		scale.y *= 2.0;
 
-	m_spacing.x *= scale.x;
-	m_spacing.y *= scale.y;
-	nx /= scale.x;
-	ny /= scale.y;
+	vtTiledGeom *tiledGeom = pTerr->GetTiledGeom();
+	if (!tiledGeom)
+		return false;
 
-	m_pGrid = new SurfaceGrid(nx,ny);
-	int i, j;
-	if (m_pHF)
-	{
-		for (i = 0; i < nx; i++)
-		{
-			for (j = 0; j < ny; j++)
-			{
-				// use the true elevation, for true contours
-				m_pGrid->zset(i, j, m_pHF->GetElevation(i, j, true));
-			}
-		}
-	}
-	else
+	// Sample the tiles at the resolution of their highest LOD
+	DRECT ext = tiledGeom->GetEarthExtents();
+	int minLod = 0;
+	for (int i = 0; i < tiledGeom->rows * tiledGeom->rows; i++)
+		if (tiledGeom->m_elev_info.lodmap.m_min[i] > minLod)
+			minLod = tiledGeom->m_elev_info.lodmap.m_min[i];
+
+	const int tileLod0Size = 1 << minLod;
+	IPoint2 size(tiledGeom->cols * tileLod0Size + 1,
+				 tiledGeom->rows * tileLod0Size + 1);
+
+	// we can't allocate too much memory, so reduce the resolution if too large
+	while (size.x > MAX_SAMPLES)
+		size.x = (size.x + 1) / 2;
+	while (size.y > MAX_SAMPLES)
+		size.y = (size.y + 1) / 2;
+	const DPoint2 spacing(ext.Width() / (size.x - 1), ext.Height() / (size.y - 1));
+
+	m_Samples.resize(size.x * size.y);
+	float altitude;
+	for (int j = 0; j < size.y; j++)
 	{
-		vtTiledGeom *tiledGeom = pTerr->GetTiledGeom();
-		float topBottom = tiledGeom->m_WorldExtents.top - tiledGeom->m_WorldExtents.bottom;
-		float rightLeft = tiledGeom->m_WorldExtents.right - tiledGeom->m_WorldExtents.left;
-		float xwidth = rightLeft / nx;
-		float ywidth = topBottom / ny;
-		float altitude;
-		for (i = 0; i < nx; i++)
+		for (int i = 0; i < size.x; i++)
 		{
-			for (j = 0; j < ny; j++)
-			{
-				// use the true elevation, for true contours
-				tiledGeom->FindAltitudeAtPoint(FPoint3(i*xwidth, 0, j*ywidth),altitude, true);
-				m_pGrid->zset(i, j, altitude);
-			}
+			// use the true elevation, for true contours
+			const DPoint2 p(ext.left + i * spacing.x, ext.bottom + j * spacing.y);
+			if (tiledGeom->FindAltitudeOnEarth(p, altitude, true))
+				m_Samples[j * size.x + i] = altitude;
+			else
+				m_Samples[j * size.x + i] = INVALID_ELEVATION;
 		}
 	}
+	m_Generator.Setup(size, ext, &m_Samples[0]);
 	return true;
 }
 
@@ -153,8 +110,6 @@ vtGeode *vtContourConverter::Setup(vtTerrain *pTerr, const RGBf &color, float fH
 	m_pGeode->setName("Contour Geometry");
 	m_pGeode->SetMaterials(pMats);
 
-	m_pMF = new vtGeomFactory(m_pGeode, osg::PrimitiveSet::LINE_STRIP, 0, 30000, 0);
-
 	return m_pGeode;
 }
 
@@ -186,9 +141,7 @@ bool vtContourConverter::Setup(vtTerrain *pTerr, vtFeatureSetLineString *fset)
  */
 void vtContourConverter::GenerateContour(float fAlt)
 {
-	SetQuikGridCallbackFunction(ReceiveContourPoint2, this);
-	m_fAltitude = fAlt;
-	Contour(*m_pGrid, fAlt);
+	m_Generator.AddLevel(fAlt);
 }
 
 /**
@@ -200,36 +153,7 @@ void vtContourConverter::GenerateContour(float fAlt)
  */
 void vtContourConverter::GenerateContours(float fInterval)
 {
-	float fMin, fMax;
-	vtHeightField *hf;
-	if (m_pHF)
-		hf = m_pHF;
-	else
-		hf = m_pTerrain->GetTiledGeom();
-	if (!hf)
-		return;
-
-	hf->GetHeightExtents(fMin, fMax);
-	int start = (int) (fMin / fInterval) + 1;
-	int stop = (int) (fMax / fInterval);
-
-	SetQuikGridCallbackFunction(ReceiveContourPoint2, this);
-	for (int i = start; i <= stop; i++)
-	{
-		m_fAltitude = i * fInterval;
-		Contour(*m_pGrid, i * fInterval);
-	}
-}
-
-void vtContourConverter::Coord(float x, float y, bool bStart)
-{
-	if (bStart)
-		Flush();
-
-	DPoint2 p2;
-	p2.x = m_ext.left + x * m_spacing.x;
-	p2.y = m_ext.bottom + y * m_spacing.y;
-	m_line.Append(p2);
+	m_Generator.AddLevels(fInterval);
 }
 
 /**
@@ -238,53 +162,52 @@ void vtContourConverter::Coord(float x, float y, bool bStart)
  */
 void vtContourConverter::Finish()
 {
-	Flush();
+	m_Generator.Generate();
 
-	if (m_pMF)
+	if (m_pGeode)
 	{
+		CreateMesh();
+
 		// Add the geometry to the terrain's scaled features, so that it will scale
 		//  up/down with the terrain's vertical exaggeration.
 		m_pTerrain->GetScaledFeatures()->addChild(m_pGeode);
 	}
+	else if (m_pLS)
+		m_Generator.AddToFeatureSet(m_pLS);
 }
 
-void vtContourConverter::Flush()
+/**
+ * Put all the contour lines into a single line mesh.  Every point of a
+ * contour is at the contour's elevation, so there is no need to sample the
+ * terrain under it.
+ */
+void vtContourConverter::CreateMesh()
 {
-	// we may have some degenerate geometry; we need at least three points
-	if (m_line.GetSize() > 2)
+	const uint num = m_Generator.NumLines();
+	uint vertices = 0;
+	for (uint i = 0; i < num; i++)
+		vertices += m_Generator.GetLine(i).GetSize();
+	if (vertices == 0)
+		return;
+
+	const LocalCS &conv = m_pTerrain->GetLocalCS();
+	vtMesh *mesh = new vtMesh(osg::PrimitiveSet::LINES, 0, vertices);
+	FPoint3 p3;
+	for (uint i = 0; i < num; i++)
 	{
-		// confirm they are not all the same
-		DPoint2 p2 = m_line[0];
-		bool same = true;
-		for (uint i = 1; i < m_line.GetSize(); i++)
-		{
-			if (m_line[i] != p2)
-			{
-				same = false;
-				break;
-			}
-		}
-		if (!same)
-		{
-			if (m_pMF)
-			{
-				const bool bInterpolate = false;		// no need; it already hugs the ground
-				const bool bCurve = false;				// no need; it's already quite smooth
-				const bool bUseTrueElevation = true;	// use true elevation, not scaled
-				const float fSpacing = 0.0f;			// Doesn't matter, no interpolation.
+		const DLine2 &line = m_Generator.GetLine(i);
+		const double fElev = m_Generator.GetLineLevel(i) + m_fHeight;
 
-				m_pMF->AddSurfaceLineToMesh(m_pTerrain->GetHeightField(),
-					m_line, fSpacing, m_fHeight, bInterpolate, bCurve, bUseTrueElevation);
-			}
-			else if (m_pLS)
-			{
-				int record = m_pLS->AddPolyLine(m_line);
-				m_pLS->SetValue(record, 0, m_fAltitude);
-			}
+		int prev = -1;
+		for (uint j = 0; j < line.GetSize(); j++)
+		{
+			conv.EarthToLocal(DPoint3(line[j].x, line[j].y, fElev), p3);
+			int idx = mesh->AddVertex(p3);
+			if (prev != -1)
+				mesh->AddLine(prev, idx);
+			prev = idx;
 		}
 	}
-	m_line.Clear();
+	m_pGeode->AddMesh(mesh, 0);
+	VTLOG("Contour mesh: %d lines, %d vertices\n", num, vertices);
 }
-
-#endif // SUPPORT_QUIKGRID
-
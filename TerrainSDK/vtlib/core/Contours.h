@@ -8,10 +8,8 @@
 #ifndef CONTOURSH
 #define CONTOURSH
 
-#if SUPPORT_QUIKGRID
-
+#include "vtdata/ContourGenerator.h"
 #include "Terrain.h"
-class SurfaceGrid;
 
 /** \defgroup utility Utility classes
  */
@@ -19,9 +17,12 @@ class SurfaceGrid;
 
 /**
  * This class provides the ability to easily construct contour lines
- * on a terrain.  It does so by calling the QuikGrid library to generate
+ * on a terrain.  It does so by using vtContourGenerator to generate
  * contour vectors, then converts those vectors into 3D line geometry
- * draped on the terrain.
+ * draped on the terrain, as a single line mesh.
+ *
+ * The contours are requested with GenerateContour(s), and are all
+ * generated at once, in a single pass over the elevation, by Finish.
  *
  * \par Here is an example of how to use it:
 	\code
@@ -67,25 +68,22 @@ public:
 	void GenerateContour(float fAlt);
 	void GenerateContours(float fAInterval);
 	void Finish();
-	void Coord(float x, float y, bool bStart);
 
 protected:
 	bool SetupTerrain(vtTerrain *pTerr);
-	void Flush();
+	void CreateMesh();
 
-	SurfaceGrid *m_pGrid;
+	vtContourGenerator m_Generator;
 
 	vtTerrain *m_pTerrain;
 	vtHeightFieldGrid3d *m_pHF;
-	DRECT m_ext;
-	DPoint2 m_spacing;
-	float m_fAltitude;
 	float m_fHeight;
-	DLine2	m_line;
 
-	// These are used if building geometry directly
+	// If the terrain is not a grid, it is sampled into this buffer
+	std::vector<float> m_Samples;
+
+	// This is used if building geometry directly
 	vtGeode *m_pGeode;
-	vtGeomFactory *m_pMF;
 
 	// This is used if building line features
 	vtFeatureSetLineString *m_pLS;
@@ -93,5 +91,4 @@ protected:
 
 /*@}*/  // utility
 
-#endif // SUPPORT_QUIKGRID
 #endif // CONTOURSH
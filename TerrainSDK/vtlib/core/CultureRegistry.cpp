@@ -0,0 +1,244 @@
+//
+// CultureRegistry.cpp
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "vtlib/vtlib.h"
+#include "vtdata/vtLog.h"
+#include "CultureRegistry.h"
+#include "AbstractLayer.h"
+#include "TerrainLayers.h"
+
+#include <algorithm>	// for sort
+
+// Aim for this many elements per cell, with at most this many cells per side.
+#define ELEMENTS_PER_CELL	8
+#define MAX_CELLS_PER_SIDE	1024
+
+vtCultureRegistry::vtCultureRegistry()
+{
+	m_CellCount.Set(0, 0);
+	m_iQuery = 0;
+}
+
+/**
+ * Empty the registry.  It will be rebuilt the next time it is needed.
+ */
+void vtCultureRegistry::Clear()
+{
+	m_Elements.clear();
+	m_Layers.clear();
+	m_LayerCounts.clear();
+	m_CellCount.Set(0, 0);
+	m_CellFirst.clear();
+	m_CellElements.clear();
+	m_Stamp.clear();
+}
+
+/**
+ * The number of elements in a layer which the registry can contain, or zero
+ * for other kinds of layers.
+ */
+uint vtCultureRegistry::NumLayerElements(vtLayer *lay)
+{
+	vtStructureLayer *slay = dynamic_cast<vtStructureLayer*>(lay);
+	if (slay)
+		return (uint) slay->size();
+	vtVegLayer *vlay = dynamic_cast<vtVegLayer*>(lay);
+	if (vlay)
+		return vlay->NumEntities();
+	vtAbstractLayer *alay = dynamic_cast<vtAbstractLayer*>(lay);
+	if (alay && alay->GetFeatureSet())
+		return alay->GetFeatureSet()->NumEntities();
+	return 0;
+}
+
+/**
+ * Return true if the registry was built from this set of layers, and none of
+ * them have since gained or lost elements.
+ */
+bool vtCultureRegistry::IsCurrent(const LayerSet &layers) const
+{
+	if (m_Layers.size() != layers.size())
+		return false;
+	for (uint i = 0; i < layers.size(); i++)
+	{
+		if (m_Layers[i] != layers[i].get())
+			return false;
+		if (m_LayerCounts[i] != NumLayerElements(layers[i].get()))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Gather all the culture elements of a set of layers, and index them.
+ */
+void vtCultureRegistry::Build(const LayerSet &layers)
+{
+	Clear();
+
+	DRECT ext;
+	for (uint i = 0; i < layers.size(); i++)
+	{
+		vtLayer *lay = layers[i].get();
+		m_Layers.push_back(lay);
+		m_LayerCounts.push_back(NumLayerElements(lay));
+
+		vtStructureLayer *slay = dynamic_cast<vtStructureLayer*>(lay);
+		if (slay)
+		{
+			for (uint j = 0; j < slay->size(); j++)
+			{
+				if (slay->at(j)->GetExtents(ext))
+					AddElement(CR_STRUCTURE, i, j, ext);
+			}
+		}
+		vtVegLayer *vlay = dynamic_cast<vtVegLayer*>(lay);
+		if (vlay)
+		{
+			for (uint j = 0; j < vlay->NumEntities(); j++)
+			{
+				const DPoint2 &p = vlay->GetPoint(j);
+				ext.SetRect(p.x, p.y, p.x, p.y);
+				AddElement(CR_PLANT, i, j, ext);
+			}
+		}
+		vtAbstractLayer *alay = dynamic_cast<vtAbstractLayer*>(lay);
+		if (alay && alay->GetFeatureSet())
+		{
+			for (uint j = 0; j < alay->GetFeatureSet()->NumEntities(); j++)
+			{
+				if (alay->GetFeatureExtents(j, ext))
+					AddElement(CR_FEATURE, i, j, ext);
+			}
+		}
+	}
+	const uint num = (uint) m_Elements.size();
+	if (num == 0)
+		return;
+
+	// Choose a grid which puts a few elements in each cell
+	m_Extents.SetInsideOut();
+	for (uint i = 0; i < num; i++)
+	{
+		const DRECT &r = m_Elements[i].m_extents;
+		m_Extents.GrowToContainPoint(DPoint2(r.left, r.bottom));
+		m_Extents.GrowToContainPoint(DPoint2(r.right, r.top));
+	}
+	int side = (int) sqrt((double) num / ELEMENTS_PER_CELL);
+	if (side < 1) side = 1;
+	if (side > MAX_CELLS_PER_SIDE) side = MAX_CELLS_PER_SIDE;
+	m_CellCount.Set(side, side);
+	m_CellSize.x = m_Extents.Width() / side;
+	m_CellSize.y = m_Extents.Height() / side;
+
+	// Count the elements in each cell, then fill them in
+	const uint cells = side * side;
+	m_CellFirst.resize(cells + 1, 0);
+	IPoint2 lo, hi;
+	for (uint i = 0; i < num; i++)
+	{
+		CellRange(m_Elements[i].m_extents, lo, hi);
+		for (int y = lo.y; y <= hi.y; y++)
+			for (int x = lo.x; x <= hi.x; x++)
+				m_CellFirst[y * side + x + 1]++;
+	}
+	for (uint c = 0; c < cells; c++)
+		m_CellFirst[c + 1] += m_CellFirst[c];
+
+	std::vector<uint> fill(m_CellFirst.begin(), m_CellFirst.end() - 1);
+	m_CellElements.resize(m_CellFirst[cells]);
+	for (uint i = 0; i < num; i++)
+	{
+		CellRange(m_Elements[i].m_extents, lo, hi);
+		for (int y = lo.y; y <= hi.y; y++)
+			for (int x = lo.x; x <= hi.x; x++)
+				m_CellElements[fill[y * side + x]++] = i;
+	}
+	m_Stamp.resize(num, 0);
+	m_iQuery = 0;
+
+	VTLOG("Culture registry: %d elements in %d x %d cells.\n", num, side, side);
+}
+
+/**
+ * Find the elements whose extents overlap an area.  If the area is empty,
+ * all the elements are returned.  The result is the indices of the
+ * elements, in the order they were added: by layer, then by index.
+ */
+void vtCultureRegistry::Query(const DRECT &area, std::vector<uint> &result)
+{
+	result.clear();
+	const uint num = (uint) m_Elements.size();
+	if (area.IsEmpty())
+	{
+		result.resize(num);
+		for (uint i = 0; i < num; i++)
+			result[i] = i;
+		return;
+	}
+	if (num == 0 || !area.OverlapsRect(m_Extents))
+		return;
+
+	// A new stamp for this query; on wraparound, reset them all
+	if (++m_iQuery == 0)
+	{
+		std::fill(m_Stamp.begin(), m_Stamp.end(), 0);
+		m_iQuery = 1;
+	}
+	IPoint2 lo, hi;
+	CellRange(area, lo, hi);
+	for (int y = lo.y; y <= hi.y; y++)
+	{
+		for (int x = lo.x; x <= hi.x; x++)
+		{
+			const uint c = y * m_CellCount.x + x;
+			for (uint k = m_CellFirst[c]; k < m_CellFirst[c + 1]; k++)
+			{
+				const uint i = m_CellElements[k];
+				if (m_Stamp[i] == m_iQuery)
+					continue;
+				m_Stamp[i] = m_iQuery;
+				if (area.OverlapsRect(m_Elements[i].m_extents))
+					result.push_back(i);
+			}
+		}
+	}
+	std::sort(result.begin(), result.end());
+}
+
+void vtCultureRegistry::AddElement(uchar type, uint layer, uint index,
+								   const DRECT &ext)
+{
+	Element e;
+	e.m_type = type;
+	e.m_layer = layer;
+	e.m_index = index;
+	e.m_extents = ext;
+	e.m_extents.Sort();
+	m_Elements.push_back(e);
+}
+
+// The range of cells which an area touches, clamped to the grid.
+void vtCultureRegistry::CellRange(const DRECT &ext, IPoint2 &lo, IPoint2 &hi) const
+{
+	lo.Set(0, 0);
+	hi.Set(0, 0);
+	if (m_CellSize.x > 0)
+	{
+		lo.x = (int) floor((ext.left - m_Extents.left) / m_CellSize.x);
+		hi.x = (int) floor((ext.right - m_Extents.left) / m_CellSize.x);
+	}
+	if (m_CellSize.y > 0)
+	{
+		lo.y = (int) floor((ext.bottom - m_Extents.bottom) / m_CellSize.y);
+		hi.y = (int) floor((ext.top - m_Extents.bottom) / m_CellSize.y);
+	}
+	if (lo.x < 0) lo.x = 0;
+	if (lo.y < 0) lo.y = 0;
+	if (hi.x > m_CellCount.x - 1) hi.x = m_CellCount.x - 1;
+	if (hi.y > m_CellCount.y - 1) hi.y = m_CellCount.y - 1;
+}
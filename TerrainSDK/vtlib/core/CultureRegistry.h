@@ -0,0 +1,80 @@
+//
+// CultureRegistry.h
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef CULTUREREGISTRYH
+#define CULTUREREGISTRYH
+
+#include "vtdata/MathTypes.h"
+
+class vtLayer;
+class LayerSet;
+
+/** \addtogroup terrain */
+/*@{*/
+
+/**
+ * A spatial index of the culture which is draped on a terrain: structures,
+ * plants and abstract features.  Each element is kept with its earth
+ * extents, in a uniform grid of cells, so that the elements in a given area
+ * can be found quickly.  This is used by vtTerrain::RedrapeCulture to
+ * re-drape only the culture where the elevation has changed.
+ *
+ * The registry refers to elements by layer and index.  It notices when
+ * layers are added or removed, or elements are added or deleted, and is
+ * then rebuilt, but it can't notice when an element moves.  After moving
+ * culture, call Clear (or vtTerrain::InvalidateCultureRegistry).
+ */
+class vtCultureRegistry
+{
+public:
+	enum ElementType { CR_STRUCTURE, CR_PLANT, CR_FEATURE };
+	struct Element
+	{
+		uchar m_type;		// ElementType
+		uint m_layer;		// index of the layer in the LayerSet
+		uint m_index;		// index of the element in the layer
+		DRECT m_extents;	// earth extents
+	};
+
+	vtCultureRegistry();
+
+	void Clear();
+	bool IsEmpty() const { return m_Elements.empty(); }
+	bool IsCurrent(const LayerSet &layers) const;
+	void Build(const LayerSet &layers);
+	void Query(const DRECT &area, std::vector<uint> &result);
+
+	uint NumElements() const { return (uint) m_Elements.size(); }
+	const Element &GetElement(uint i) const { return m_Elements[i]; }
+
+	static uint NumLayerElements(vtLayer *lay);
+
+protected:
+	void AddElement(uchar type, uint layer, uint index, const DRECT &ext);
+	void CellRange(const DRECT &ext, IPoint2 &lo, IPoint2 &hi) const;
+
+	std::vector<Element> m_Elements;
+
+	// What the registry was built from, to tell when it is out of date
+	std::vector<vtLayer*> m_Layers;
+	std::vector<uint> m_LayerCounts;
+
+	// The grid of cells, in compressed row form
+	DRECT m_Extents;
+	IPoint2 m_CellCount;
+	DPoint2 m_CellSize;
+	std::vector<uint> m_CellFirst;
+	std::vector<uint> m_CellElements;
+
+	// To visit each element once per query, even if it is in several cells
+	std::vector<uint> m_Stamp;
+	uint m_iQuery;
+};
+
+/*@}*/	// Group terrain
+
+#endif // CULTUREREGISTRYH
@@ -210,6 +210,32 @@ bool vtDynTerrainGeom::FindAltitudeAtPoint(const FPoint3 &p, float &fAltitude,
 	return true;
 }
 
+/**
+ * Find the elevation at many points.  Culture is tested one point at a time,
+ * as it must intersect the scene graph, but the terrain itself is only read,
+ * so the points are divided among threads (if VTP_USE_OPENMP).
+ */
+int vtDynTerrainGeom::FindAltitudesAtPoints(FPoint3 *points, uint count,
+	bool bTrue, int iCultureFlags) const
+{
+	if (iCultureFlags != 0 && m_pCulture != NULL)
+		return vtHeightField3d::FindAltitudesAtPoints(points, count, bTrue, iCultureFlags);
+
+	const int num = (int) count;
+	int i, found = 0;
+#pragma omp parallel for reduction(+:found) if(num >= MIN_PARALLEL_QUERY)
+	for (i = 0; i < num; i++)
+	{
+		float fAltitude;
+		if (vtDynTerrainGeom::FindAltitudeAtPoint(points[i], fAltitude, bTrue))
+		{
+			points[i].y = fAltitude;
+			found++;
+		}
+	}
+	return found;
+}
+
 
 void vtDynTerrainGeom::SetCull(bool bOnOff)
 {
@@ -64,6 +64,8 @@ public:
 	bool FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude,
 		bool bTrue = false, int iCultureFlags = 0,
 		FPoint3 *vNormal = NULL) const;
+	int FindAltitudesAtPoints(FPoint3 *points, uint count,
+		bool bTrue = false, int iCultureFlags = 0) const;
 
 	// overridables
 	virtual void DoCulling(const vtCamera *pCam) = 0;
@@ -8,12 +8,22 @@
 #include "vtlib/vtlib.h"
 #include "Engine.h"
 #include "Event.h"
+#include "Profiler.h"
 
 #include <algorithm>
+#include <osg/Timer>
+
+// Independent engines are only evaluated in parallel when there are at
+//  least this many in a row; fewer aren't worth the overhead.
+#define MIN_PARALLEL_ENGINES	16
+
+uint vtEngine::s_iTreeChanges = 0;
 
 vtEngine::vtEngine() : vtEnabledBase()
 {
 	m_pWindow = NULL;
+	m_iProfileZone = -1;
+	ResetEvalTime();
 }
 
 osg::Referenced *vtEngine::GetTarget(uint which)
@@ -35,6 +45,12 @@ void vtEngine::Eval()
 {
 }
 
+void vtEngine::AddChild(vtEngine *pEngine)
+{
+	m_Children.push_back(pEngine);
+	s_iTreeChanges++;
+}
+
 void vtEngine::RemoveChild(vtEngine *pEngine)
 {
 	for (uint i = 0; i < NumChildren(); i++)
@@ -42,6 +58,40 @@ void vtEngine::RemoveChild(vtEngine *pEngine)
 		if (m_Children[i] == pEngine)
 			m_Children.erase(m_Children.begin()+i);
 	}
+	s_iTreeChanges++;
+}
+
+/**
+ * Call Eval, and if bTiming is true, measure how long it took.
+ */
+void vtEngine::TimedEval(bool bTiming)
+{
+	// Each engine is a zone for the profiler, by name
+	if (m_iProfileZone == -1 && vtProfiler::IsEnabled())
+	{
+		m_iProfileZone = vtProfiler::Register(m_strName.IsEmpty() ?
+			"Engine" : (const char *) m_strName);
+	}
+	vtProfileScope scope(m_iProfileZone);
+
+	if (!bTiming)
+	{
+		Eval();
+		return;
+	}
+	osg::Timer *timer = osg::Timer::instance();
+	osg::Timer_t start = timer->tick();
+	Eval();
+	m_fEvalTime = (float) timer->delta_s(start, timer->tick());
+	m_fTotalEvalTime += m_fEvalTime;
+	m_iEvalCount++;
+}
+
+void vtEngine::ResetEvalTime()
+{
+	m_fEvalTime = 0.0f;
+	m_fTotalEvalTime = 0.0;
+	m_iEvalCount = 0;
 }
 
 void vtEngine::AddChildrenToList(vtEngineArray &list, bool bEnabledOnly)
@@ -65,6 +115,84 @@ void vtEngine::OnWindowSize(int width, int height)
 {
 }
 
+//
+// vtEngineSchedule
+//
+vtEngineSchedule::vtEngineSchedule(vtEngine *pTop)
+{
+	m_pTop = pTop;
+	m_iTreeChanges = vtEngine::GetTreeChanges();
+	if (pTop)
+		Add(pTop);
+}
+
+void vtEngineSchedule::Add(vtEngine *pEngine)
+{
+	const uint index = m_Entries.size();
+	Entry e;
+	e.m_pEngine = pEngine;
+	m_Entries.push_back(e);
+	for (uint i = 0; i < pEngine->NumChildren(); i++)
+		Add(pEngine->GetChild(i));
+	m_Entries[index].m_iEnd = m_Entries.size();
+}
+
+/**
+ * Evaluate all the enabled engines, in order.  If bParallel is true, each
+ * run of consecutive independent engines (see vtEngine::IsIndependent) is
+ * evaluated in parallel.
+ */
+void vtEngineSchedule::Eval(bool bParallel, bool bTiming)
+{
+	const uint size = m_Entries.size();
+	uint i = 0;
+	while (i < size)
+	{
+		vtEngine *pEng = m_Entries[i].m_pEngine;
+		if (!pEng->GetEnabled())
+		{
+			i = m_Entries[i].m_iEnd;
+			continue;
+		}
+		if (bParallel && pEng->IsIndependent())
+		{
+			m_Batch.clear();
+			while (i < size)
+			{
+				pEng = m_Entries[i].m_pEngine;
+				if (!pEng->GetEnabled())
+				{
+					i = m_Entries[i].m_iEnd;
+					continue;
+				}
+				if (!pEng->IsIndependent())
+					break;
+				m_Batch.push_back(pEng);
+				i++;
+			}
+			EvalBatch(bTiming);
+			continue;
+		}
+		pEng->TimedEval(bTiming);
+		i++;
+	}
+}
+
+void vtEngineSchedule::EvalBatch(bool bTiming)
+{
+	const int count = (int) m_Batch.size();
+	if (count < MIN_PARALLEL_ENGINES)
+	{
+		for (int i = 0; i < count; i++)
+			m_Batch[i]->TimedEval(bTiming);
+		return;
+	}
+#pragma omp parallel for schedule(dynamic, 8)
+	for (int i = 0; i < count; i++)
+		m_Batch[i]->TimedEval(bTiming);
+}
+
+
 //
 // vtLastMouse
 //
@@ -88,24 +88,53 @@ public:
 	 */
 	virtual void Eval();
 
+	/**
+	 * Engines which return true here declare that their Eval() touches only
+	 * their own state and targets, so it may be run at the same time as the
+	 * Eval() of other independent engines (see vtScene::SetParallelEngines).
+	 * That rules out querying shared terrain state, such as the heightfield
+	 * or its culture.  The default is false.
+	 */
+	virtual bool IsIndependent() { return false; }
+
 	// an engine may be associate with a window
 	void SetWindow(vtWindow *pWin) { m_pWindow = pWin; }
 	vtWindow *GetWindow() { return m_pWindow; }
 
 	// Engine tree methods
-	void AddChild(vtEngine *pEngine) { m_Children.push_back(pEngine); }
+	void AddChild(vtEngine *pEngine);
 	void RemoveChild(vtEngine *pEngine);
 	vtEngine *GetChild(uint i) { return m_Children[i].get(); }
 	uint NumChildren() { return m_Children.size(); }
 
 	void AddChildrenToList(class vtEngineArray &list, bool bEnabledOnly);
 
+	/// Counts changes to the structure of any engine tree.
+	static uint GetTreeChanges() { return s_iTreeChanges; }
+
+	// Timing, which the scene measures if vtScene::SetEngineTiming is on
+	void TimedEval(bool bTiming);
+	/// Time taken by the most recent Eval, in seconds.
+	float GetEvalTime() { return m_fEvalTime; }
+	/// Total time taken by Eval, in seconds, since ResetEvalTime.
+	double GetTotalEvalTime() { return m_fTotalEvalTime; }
+	/// Number of timed calls to Eval since ResetEvalTime.
+	uint GetEvalCount() { return m_iEvalCount; }
+	void ResetEvalTime();
+
 protected:
 	std::vector<ReferencePtr> m_Targets;
 	std::vector<vtEnginePtr> m_Children;
 	vtString		 m_strName;
 	vtWindow		*m_pWindow;
 
+	float	m_fEvalTime;
+	double	m_fTotalEvalTime;
+	uint	m_iEvalCount;
+	int		m_iProfileZone;
+
+	static uint s_iTreeChanges;
+
 protected:
 	~vtEngine() {}
 };
@@ -121,6 +150,54 @@ public:
 	}
 };
 
+/**
+ * A flattened engine tree, in the same depth-first order as vtEngineArray.
+ * Unlike vtEngineArray, it includes disabled engines, and records for each
+ * engine where its subtree ends, so that a disabled engine and its children
+ * can be skipped as the list is walked:
+ \code
+	for (uint i = 0; i < sched->Size(); i = sched->Next(i))
+		if (sched->Get(i)->GetEnabled())
+			...
+ \endcode
+ * Since enabling and disabling engines doesn't change it, the schedule only
+ * needs to be built again when an engine is added or removed, which
+ * IsCurrent() detects.
+ */
+class vtEngineSchedule : public osg::Referenced
+{
+public:
+	vtEngineSchedule(vtEngine *pTop);
+
+	bool IsCurrent(vtEngine *pTop) const
+	{
+		return pTop == m_pTop && m_iTreeChanges == vtEngine::GetTreeChanges();
+	}
+	uint Size() const { return m_Entries.size(); }
+	vtEngine *Get(uint i) const { return m_Entries[i].m_pEngine; }
+	uint Next(uint i) const
+	{
+		return m_Entries[i].m_pEngine->GetEnabled() ? i + 1 : m_Entries[i].m_iEnd;
+	}
+
+	void Eval(bool bParallel, bool bTiming);
+
+protected:
+	struct Entry
+	{
+		vtEngine *m_pEngine;
+		uint m_iEnd;	// index after the last engine in this one's subtree
+	};
+	void Add(vtEngine *pEngine);
+	void EvalBatch(bool bTiming);
+
+	std::vector<Entry> m_Entries;
+	std::vector<vtEngine*> m_Batch;
+	vtEngine *m_pTop;
+	uint m_iTreeChanges;
+};
+typedef osg::ref_ptr<vtEngineSchedule> vtEngineSchedulePtr;
+
 
 /**
  * This simple engine extends the base class vtEngine with the ability to
@@ -578,8 +578,9 @@ void vtFence3d::AddFenceMeshes(vtHeightField3d *pHeightField)
 
 	// first, project the posts from earth to world
 	m_Posts3d.SetSize(numfencepts);
-	for (i = 0; i < numfencepts; i++)
-		pHeightField->ConvertEarthToSurfacePoint(m_pFencePts[i], m_Posts3d[i], iIncludeCulture);
+	if (numfencepts > 0)
+		pHeightField->ConvertEarthToSurfacePoints(m_pFencePts.GetData(),
+			m_Posts3d.GetData(), numfencepts, iIncludeCulture);
 
 	// Find highest point
 	m_fMaxGroundY = -1E8;
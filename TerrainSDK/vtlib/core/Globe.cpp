@@ -16,6 +16,15 @@
 #include "vtdata/vtLog.h"	// for logging debug message
 #include "vtdata/DataPath.h"
 
+#include <osg/ClusterCullingCallback>
+
+// Lines on the globe are raised this much above the unit sphere.
+#define LINE_LIFT			1.0002
+
+// Default for SetLineError: a quarter of the lift, so that the straight
+//  segments stay above the surface.
+#define DEFAULT_LINE_ERROR	0.00005
+
 // Helper
 vtTransform *WireAxis(RGBf color, float len);
 
@@ -32,6 +41,7 @@ vtIcoGlobe::vtIcoGlobe()
 	m_bUnfolded = false;
 	m_bTilt = false;
 	m_cylinder = NULL;
+	m_fLineError = DEFAULT_LINE_ERROR;
 }
 
 vtIcoGlobe::~vtIcoGlobe()
@@ -595,21 +605,12 @@ void vtIcoGlobe::BuildSphericalLines(GlobeLayer *glay, float fSize)
 	if (!pSetLS)
 		return;
 
-	int i, size;
-	size = feat->NumEntities();
-
-	vtGeode *geode = new vtGeode;
-	geode->setName("spherical lines");
-	geode->SetMaterials(m_coremats);
-	m_SurfaceGroup->addChild(geode);
-	glay->addChild(geode);
+	const uint size = feat->NumEntities();
+	std::vector<const DLine2*> lines(size);
+	for (uint i = 0; i < size; i++)
+		lines[i] = &pSetLS->GetPolyLine(i);
 
-	vtGeomFactory mf(geode, osg::PrimitiveSet::LINE_STRIP, 0, 30000, m_yellow);
-	for (i = 0; i < size; i++)
-	{
-		const DLine2 &line = pSetLS->GetPolyLine(i);
-		AddSurfaceLineToMesh(&mf, line);
-	}
+	BuildSphericalLineSet(glay, lines, false);
 }
 
 void vtIcoGlobe::BuildSphericalPolygons(GlobeLayer *glay, float fSize)
@@ -619,25 +620,193 @@ void vtIcoGlobe::BuildSphericalPolygons(GlobeLayer *glay, float fSize)
 	if (!pSetPoly)
 		return;
 
-	int i, size;
-	size = feat->NumEntities();
+	const uint size = feat->NumEntities();
+	std::vector<const DLine2*> lines;
+	for (uint i = 0; i < size; i++)
+	{
+		const DPolygon2 &poly = pSetPoly->GetPolygon(i);
+		for (uint ring = 0; ring < poly.size(); ring++)
+			lines.push_back(&poly[ring]);
+	}
+	BuildSphericalLineSet(glay, lines, true);
+}
 
-	vtGeode *geode = new vtGeode;
-	geode->setName("spherical lines");
-	geode->SetMaterials(m_coremats);
-	m_SurfaceGroup->addChild(geode);
-	glay->addChild(geode);
+// The great-circle arcs of one line, tessellated and divided into runs
+//  which each lie on a single face of the icosahedron.
+struct GlobeArcs
+{
+	struct Run
+	{
+		int face;
+		uint first, count;	// range of points
+	};
+	std::vector<FPoint3> points;
+	std::vector<Run> runs;
+};
+
+// The face of the icosahedron a (unit) point is on, is the one whose center
+//  it is closest to.
+static int FaceOfPoint(const DPoint3 *centers, const DPoint3 &p)
+{
+	int face = 0;
+	double best = -2;
+	for (int i = 0; i < 20; i++)
+	{
+		const double dot = centers[i].Dot(p);
+		if (dot > best)
+		{
+			best = dot;
+			face = i;
+		}
+	}
+	return face;
+}
+
+// Tessellate the great-circle arcs between the points of a line, with each
+//  arc divided into just enough segments that none is longer than fMaxAngle.
+static void TessellateArcs(const DLine2 &line, bool bClose, double fMaxAngle,
+						   const DPoint3 *centers, GlobeArcs &arcs)
+{
+	const uint size = line.GetSize();
+	if (size < 2)
+		return;
+	const uint nsegs = bClose ? size : size - 1;
+
+	DPoint3 p1, p2, prev, cur;
+	int run_face = -1;
+	geo_to_xyz(1.0, line[0], p1);
+	prev = p1;
+	for (uint i = 0; i < nsegs; i++)
+	{
+		geo_to_xyz(1.0, line[(i + 1) % size], p2);
+
+		const double dot = p1.Dot(p2);
+		const double angle = acos(dot > 1.0 ? 1.0 : dot < -1.0 ? -1.0 : dot);
+		const double sin_angle = sin(angle);
+		int steps = (int) ceil(angle / fMaxAngle);
+		if (steps < 1 || sin_angle < 1E-12)
+			steps = 1;
+
+		for (int j = 1; j <= steps; j++)
+		{
+			// spherical interpolation along the arc
+			if (j == steps)
+				cur = p2;
+			else
+			{
+				const double t = (double) j / steps;
+				cur = p1 * (sin((1 - t) * angle) / sin_angle) +
+					  p2 * (sin(t * angle) / sin_angle);
+			}
+
+			// each segment goes to the face its midpoint is on
+			const int face = FaceOfPoint(centers, prev + cur);
+			if (face != run_face)
+			{
+				GlobeArcs::Run run;
+				run.face = face;
+				run.first = (uint) arcs.points.size();
+				run.count = 1;
+				arcs.runs.push_back(run);
+				arcs.points.push_back(prev * LINE_LIFT);
+				run_face = face;
+			}
+			arcs.points.push_back(cur * LINE_LIFT);
+			arcs.runs.back().count++;
+			prev = cur;
+		}
+		p1 = p2;
+	}
+}
 
-	vtGeomFactory mf(geode, osg::PrimitiveSet::LINE_STRIP, 0, 30000, m_yellow);
+/**
+ * Build the geometry for a set of lines on the globe.  The great-circle
+ * arcs are tessellated in parallel (if VTP_USE_OPENMP), each line on its
+ * own, then gathered into one line mesh for each face of the icosahedron.
+ * Each face's geometry is culled when it is on the far side of the globe.
+ */
+void vtIcoGlobe::BuildSphericalLineSet(GlobeLayer *glay,
+	const std::vector<const DLine2*> &lines, bool bClose)
+{
+	int i;
+	const int size = (int) lines.size();
+
+	DPoint3 centers[20];
+	for (i = 0; i < 20; i++)
+	{
+		centers[i] = m_face[i].center;
+		centers[i].Normalize();
+	}
+	// The longest segment which is within the allowed error
+	double fMaxAngle = 2 * acos(1.0 - m_fLineError);
+	if (!(fMaxAngle > 0))
+		fMaxAngle = 0.001;
+
+	std::vector<GlobeArcs> arcs(size);
+#pragma omp parallel for schedule(dynamic, 16)
+	for (i = 0; i < size; i++)
+		TessellateArcs(*lines[i], bClose, fMaxAngle, centers, arcs[i]);
+
+	// Count the vertices on each face, so each mesh is allocated once
+	uint count[20];
+	for (i = 0; i < 20; i++)
+		count[i] = 0;
 	for (i = 0; i < size; i++)
 	{
-		const DPolygon2 &poly = pSetPoly->GetPolygon(i);
-		for (uint ring = 0; ring < poly.size(); ring++)
+		for (uint r = 0; r < arcs[i].runs.size(); r++)
+			count[arcs[i].runs[r].face] += arcs[i].runs[r].count;
+	}
+	vtMesh *mesh[20];
+	for (i = 0; i < 20; i++)
+		mesh[i] = count[i] ? new vtMesh(osg::PrimitiveSet::LINES, 0, count[i]) : NULL;
+
+	for (i = 0; i < size; i++)
+	{
+		const GlobeArcs &a = arcs[i];
+		for (uint r = 0; r < a.runs.size(); r++)
 		{
-			const DLine2 &line = poly[ring];
-			AddSurfaceLineToMesh(&mf, line);
+			const GlobeArcs::Run &run = a.runs[r];
+			vtMesh *m = mesh[run.face];
+			int start = m->AddVertex(a.points[run.first]);
+			for (uint k = 1; k < run.count; k++)
+			{
+				m->AddVertex(a.points[run.first + k]);
+				m->AddLine(start + (int) k - 1, start + (int) k);
+			}
 		}
+		// Free as we go
+		GlobeArcs().points.swap(arcs[i].points);
+	}
+
+	int total = 0;
+	for (i = 0; i < 20; i++)
+	{
+		if (!mesh[i])
+			continue;
+		total += mesh[i]->NumVertices();
+
+		vtGeode *geode = new vtGeode;
+		geode->setName("spherical lines");
+		geode->SetMaterials(m_coremats);
+		geode->AddMesh(mesh[i], m_yellow);
+
+		// Cull when the whole face is turned away from the eye.  Every point
+		//  on it has a normal within this angle of the center's.
+		const DPoint3 &corner = m_verts[icosa_face_v[i][0]];
+		const double dot = centers[i].Dot(corner) / corner.Length();
+		const double spread = acos(dot > 1.0 ? 1.0 : dot);
+		const DPoint3 cp = centers[i] * LINE_LIFT;
+		osg::ClusterCullingCallback *cull = new osg::ClusterCullingCallback(
+			osg::Vec3(cp.x, cp.y, cp.z),
+			osg::Vec3(centers[i].x, centers[i].y, centers[i].z),
+			(float) -sin(spread));
+		cull->setRadius((float) ((corner - cp).Length()));
+		geode->setCullCallback(cull);
+
+		m_SurfaceGroup->addChild(geode);
+		glay->addChild(geode);
 	}
+	VTLOG("Globe lines: %d lines, %d vertices\n", size, total);
 }
 
 void vtIcoGlobe::BuildFlatFeatures(GlobeLayer *glay, float fSize)
@@ -1584,6 +1753,17 @@ void vtIcoGlobe::add_face_independent_meshes(int pair, int face, bool second)
 
 void GlobeLayer::DestructGeometry()
 {
+	// Our geometry is also in the globe's surface groups, so remove it there
+	for (uint i = 0; i < getNumChildren(); i++)
+	{
+		osg::Node *child = getChild(i);
+		osg::Node::ParentList parents = child->getParents();
+		for (uint j = 0; j < parents.size(); j++)
+		{
+			if (parents[j] != this)
+				parents[j]->removeChild(child);
+		}
+	}
 	removeChildren(0, getNumChildren());
 }
 
@@ -74,6 +74,13 @@ public:
 	GlobeLayerArray &GetGlobeLayers() { return m_GlobeLayers; }
 	int AddGlobeFeatures(const char *fname, float fSize);
 	void RemoveLayer(GlobeLayer *glay);
+	/**
+	 * Set how closely the lines of feature layers follow the great circles
+	 * between their points: the largest distance between an arc and the
+	 * straight segments which approximate it, as a fraction of the radius.
+	 * Applies to layers added after this call.
+	 */
+	void SetLineError(double fError) { m_fLineError = fError; }
 
 	void AddTerrainRectangles(vtTerrainScene *pTerrainScene);
 	double AddSurfaceLineToMesh(vtGeomFactory *pMF, const DPoint2 &g1, const DPoint2 &g2);
@@ -111,6 +118,8 @@ protected:
 	void BuildSphericalPoints(GlobeLayer *glay, float fSize);
 	void BuildSphericalLines(GlobeLayer *glay, float fSize);
 	void BuildSphericalPolygons(GlobeLayer *glay, float fSize);
+	void BuildSphericalLineSet(GlobeLayer *glay, const std::vector<const DLine2*> &lines,
+		bool bClose);
 	void BuildFlatFeatures(GlobeLayer *glay, float fSize);
 	void BuildFlatPoint(GlobeLayer *glay, int i, float fSize);
 
@@ -176,6 +185,7 @@ protected:
 
 	// Features (point, line, polygon..) draped on the globe
 	GlobeLayerArray	m_GlobeLayers;
+	double	m_fLineError;
 };
 
 vtMovGeode *CreateSimpleEarth(const vtString &strDataPath);
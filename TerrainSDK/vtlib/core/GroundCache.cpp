@@ -0,0 +1,197 @@
+//
+// GroundCache.cpp
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "vtlib/vtlib.h"
+#include "GroundCache.h"
+#include <limits.h>		// for INT_MIN
+#include <stdlib.h>		// for abs
+#include <algorithm>
+
+// The cache covers this many cells on a side, around the point.
+#define CACHE_SIDE		32
+// Look this many seconds ahead of the point's motion, but no further than
+//  a quarter of the cache, so that the point's own cell stays in the cache.
+#define LOOKAHEAD_TIME	0.5f
+#define LOOKAHEAD_CELLS	(CACHE_SIDE / 4)
+
+vtGroundCache::vtGroundCache()
+{
+	m_pHF = NULL;
+	m_iCultureFlags = CE_ALL;
+	m_fCellSize = 1.0f;
+	m_iProbesPerFrame = 8;
+	m_fMaxAge = 0.0f;
+	m_iRevision = 0;
+	m_Cells.resize(CACHE_SIDE * CACHE_SIDE);
+	Invalidate();
+}
+
+void vtGroundCache::SetHeightField(const vtHeightField3d *pHF)
+{
+	m_pHF = pHF;
+	Invalidate();
+}
+
+/**
+ * Set which kinds of culture to find the height of: CE_STRUCTURES, CE_ROADS,
+ * or CE_ALL (the default).
+ */
+void vtGroundCache::SetCultureFlags(int iFlags)
+{
+	m_iCultureFlags = iFlags;
+	Invalidate();
+}
+
+/**
+ * Set the size of the cells, in meters.  The default is 1 meter.  Smaller
+ * cells follow the edges of culture more closely, but the cache then covers
+ * a smaller area and takes longer to fill.
+ */
+void vtGroundCache::SetCellSize(float fMeters)
+{
+	m_fCellSize = fMeters;
+	Invalidate();
+}
+
+/**
+ * Forget everything in the cache.
+ */
+void vtGroundCache::Invalidate()
+{
+	for (uint i = 0; i < m_Cells.size(); i++)
+	{
+		m_Cells[i].m_x = INT_MIN;
+		m_Cells[i].m_z = INT_MIN;
+		m_Cells[i].m_bCulture = false;
+	}
+}
+
+/**
+ * Refresh the cache around a point.  Call this once a frame.
+ *
+ * \param pos The point, usually the camera, in world coordinates.
+ * \param velocity The velocity of the point, in meters per second.  Cells
+ *		are refreshed along the path ahead of the point's motion.
+ */
+void vtGroundCache::Update(const FPoint3 &pos, const FPoint3 &velocity)
+{
+	if (!m_pHF || !m_pHF->GetCulture())
+		return;
+
+	m_iRevision = m_pHF->GetCulture()->GetCultureRevision();
+	const float fNow = vtGetTime();
+	int probes = 0;
+
+	// The cell under the point comes first
+	int ix, iz;
+	CellIndex(pos.x, pos.z, ix, iz);
+	if (ProbeIfStale(ix, iz, fNow))
+		probes++;
+
+	// Then the cells along the path to where the point is heading, nearest
+	//  first, each with its neighbours, so that the path is three cells wide.
+	FPoint3 ahead = velocity * LOOKAHEAD_TIME;
+	const float fMaxAhead = m_fCellSize * LOOKAHEAD_CELLS;
+	if (ahead.Length() > fMaxAhead)
+		ahead *= (fMaxAhead / ahead.Length());
+	int cx, cz;
+	CellIndex(pos.x + ahead.x, pos.z + ahead.z, cx, cz);
+
+	const int steps = std::max(abs(cx - ix), abs(cz - iz));
+	for (int s = 0; s <= steps && probes < m_iProbesPerFrame; s++)
+	{
+		const float t = steps ? (float) s / steps : 0.0f;
+		const int x = ix + (int) floorf((cx - ix) * t + 0.5f);
+		const int z = iz + (int) floorf((cz - iz) * t + 0.5f);
+		for (int dz = -1; dz <= 1; dz++)
+		{
+			for (int dx = -1; dx <= 1 && probes < m_iProbesPerFrame; dx++)
+			{
+				if (ProbeIfStale(x + dx, z + dz, fNow))
+					probes++;
+			}
+		}
+	}
+}
+
+/**
+ * Find the height of the ground, including culture, at a point.  This uses
+ * the displayed (possibly exaggerated) elevation.  Culture which has not
+ * been probed yet is not included.
+ *
+ * \return true if the point is over the heightfield.
+ */
+bool vtGroundCache::FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude) const
+{
+	if (!m_pHF || !m_pHF->FindAltitudeAtPoint(p3, fAltitude))
+		return false;
+
+	int ix, iz;
+	CellIndex(p3.x, p3.z, ix, iz);
+	const Cell &cell = Slot(ix, iz);
+	if (cell.m_x == ix && cell.m_z == iz && cell.m_bCulture)
+		fAltitude += cell.m_fOffset;
+	return true;
+}
+
+void vtGroundCache::CellIndex(float x, float z, int &ix, int &iz) const
+{
+	ix = (int) floorf(x / m_fCellSize);
+	iz = (int) floorf(z / m_fCellSize);
+}
+
+// The cells wrap around, so that the cache can follow the point without
+//  moving anything.
+vtGroundCache::Cell &vtGroundCache::Slot(int ix, int iz)
+{
+	const int x = ((ix % CACHE_SIDE) + CACHE_SIDE) % CACHE_SIDE;
+	const int z = ((iz % CACHE_SIDE) + CACHE_SIDE) % CACHE_SIDE;
+	return m_Cells[z * CACHE_SIDE + x];
+}
+
+const vtGroundCache::Cell &vtGroundCache::Slot(int ix, int iz) const
+{
+	const int x = ((ix % CACHE_SIDE) + CACHE_SIDE) % CACHE_SIDE;
+	const int z = ((iz % CACHE_SIDE) + CACHE_SIDE) % CACHE_SIDE;
+	return m_Cells[z * CACHE_SIDE + x];
+}
+
+bool vtGroundCache::IsFresh(const Cell &cell, int ix, int iz, float fNow) const
+{
+	return (cell.m_x == ix && cell.m_z == iz &&
+			cell.m_revision == m_iRevision &&
+			(m_fMaxAge <= 0.0f || fNow - cell.m_time < m_fMaxAge));
+}
+
+bool vtGroundCache::ProbeIfStale(int ix, int iz, float fNow)
+{
+	if (IsFresh(Slot(ix, iz), ix, iz, fNow))
+		return false;
+	Probe(ix, iz, fNow);
+	return true;
+}
+
+void vtGroundCache::Probe(int ix, int iz, float fNow)
+{
+	const FPoint3 center((ix + 0.5f) * m_fCellSize, 0, (iz + 0.5f) * m_fCellSize);
+
+	Cell &cell = Slot(ix, iz);
+	cell.m_x = ix;
+	cell.m_z = iz;
+	cell.m_revision = m_iRevision;
+	cell.m_time = fNow;
+	cell.m_bCulture = false;
+
+	float fGround, fCulture;
+	if (m_pHF->FindAltitudeAtPoint(center, fGround) &&
+		m_pHF->GetCulture()->FindAltitudeOnCulture(center, fCulture, false,
+			m_iCultureFlags))
+	{
+		cell.m_bCulture = true;
+		cell.m_fOffset = fCulture - fGround;
+	}
+}
@@ -0,0 +1,86 @@
+//
+// GroundCache.h
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef GROUNDCACHEH
+#define GROUNDCACHEH
+
+#include "vtdata/HeightField.h"
+
+/** \addtogroup nav */
+/*@{*/
+
+/**
+ * A small cache of the height of culture (structures and roads) on the
+ * ground around a moving point, usually the camera.  Finding the height of
+ * culture means intersecting its geometry, which is slow over dense cities;
+ * the height of the heightfield itself is cheap to find.
+ *
+ * The ground is divided into square cells.  Each cell remembers whether it
+ * has culture, and how far above the heightfield the culture is, at the
+ * center of the cell.  Each frame, Update probes a limited number of cells,
+ * and only those which are missing or stale: first the one under the point,
+ * then those along the path where the point is heading, nearest first.
+ * FindAltitudeAtPoint only reads the cache, so it never waits for culture
+ * intersection.
+ *
+ * Cells are refreshed when the culture says it has been edited
+ * (CultureExtension::GetCultureRevision), when they have left the cache
+ * and come back, and optionally when they get old (SetMaxAge).  Until a
+ * cell is refreshed, its old value is used.
+ */
+class vtGroundCache
+{
+public:
+	vtGroundCache();
+
+	void SetHeightField(const vtHeightField3d *pHF);
+	void SetCultureFlags(int iFlags);
+	int GetCultureFlags() const { return m_iCultureFlags; }
+
+	void SetCellSize(float fMeters);
+	float GetCellSize() const { return m_fCellSize; }
+
+	/// Set the most culture intersections to do in a frame.
+	void SetProbesPerFrame(int iProbes) { m_iProbesPerFrame = iProbes; }
+	/// Set how long, in seconds, a cell is used before it is probed again.
+	/// The default, 0, means that cells don't get old.
+	void SetMaxAge(float fSeconds) { m_fMaxAge = fSeconds; }
+
+	void Invalidate();
+	void Update(const FPoint3 &pos, const FPoint3 &velocity);
+	bool FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude) const;
+
+protected:
+	struct Cell
+	{
+		int m_x, m_z;		// which cell of the ground this is
+		uint m_revision;	// culture revision when it was probed
+		float m_time;		// time when it was probed
+		bool m_bCulture;	// true if culture was found
+		float m_fOffset;	// height of the culture above the heightfield
+	};
+
+	void CellIndex(float x, float z, int &ix, int &iz) const;
+	Cell &Slot(int ix, int iz);
+	const Cell &Slot(int ix, int iz) const;
+	bool IsFresh(const Cell &cell, int ix, int iz, float fNow) const;
+	void Probe(int ix, int iz, float fNow);
+	bool ProbeIfStale(int ix, int iz, float fNow);
+
+	const vtHeightField3d *m_pHF;
+	int		m_iCultureFlags;
+	float	m_fCellSize;
+	int		m_iProbesPerFrame;
+	float	m_fMaxAge;
+	uint	m_iRevision;
+
+	std::vector<Cell> m_Cells;
+};
+
+/*@}*/	// Group nav
+
+#endif // GROUNDCACHEH
@@ -240,6 +240,7 @@ vtTerrainFlyer::vtTerrainFlyer(float fSpeed, bool bAllowRoll) :
 	vtFlyer(fSpeed, bAllowRoll)
 {
 	m_pHeightField = NULL;
+	m_pGroundCache = NULL;
 	m_bExag = false;
 }
 
@@ -250,11 +251,15 @@ void vtTerrainFlyer::Eval()
 		return;
 
 	vtFlyer::Eval();
-	if (m_bExag)
+	if (m_bExag && m_pHeightField)
 	{
 		FPoint3 pos = pTarget->GetTrans();
 		float fGroundAltitude;
-		bool bOverTerrain = m_pHeightField->FindAltitudeAtPoint(pos, fGroundAltitude);
+		bool bOverTerrain;
+		if (m_pGroundCache)
+			bOverTerrain = m_pGroundCache->FindAltitudeAtPoint(pos, fGroundAltitude);
+		else
+			bOverTerrain = m_pHeightField->FindAltitudeAtPoint(pos, fGroundAltitude);
 		if (bOverTerrain)
 		{
 			float fAboveGround = pos.y - fGroundAltitude;
@@ -694,10 +699,24 @@ vtHeightConstrain::vtHeightConstrain(float fMinHeight)
 	m_fMaintainHeight = 0;
 	m_bUseCulture = false;
 	m_bOnGround = false;
+	m_LastPos.Set(0, 0, 0);
+}
+
+void vtHeightConstrain::SetHeightField(const vtHeightField3d *pHF)
+{
+	m_pHF = pHF;
+	m_GroundCache.SetHeightField(pHF);
+}
+
+void vtHeightConstrain::SetUseCulture(bool set)
+{
+	m_bUseCulture = set;
+	m_GroundCache.Invalidate();
 }
 
 //
-// Keep the target above the the terrain surface.
+// Keep the target above the the terrain surface.  The height of culture,
+// which is slow to find, comes from the ground cache.
 //
 void vtHeightConstrain::Eval()
 {
@@ -710,10 +729,21 @@ void vtHeightConstrain::Eval()
 
 	FPoint3 pos = pTarget->GetTrans();
 
-	bool bTrue = false;		// use displayed elevation, not true elevation
+	// use displayed elevation, not true elevation
 	float fGroundAltitude;
-	bool bOverTerrain = m_pHF->FindAltitudeAtPoint(pos, fGroundAltitude,
-		bTrue, m_bUseCulture ? CE_ALL : 0);
+	bool bOverTerrain;
+	if (m_bUseCulture)
+	{
+		float elapsed = vtGetFrameTime();
+		FPoint3 velocity(0, 0, 0);
+		if (elapsed > 0)
+			velocity = (pos - m_LastPos) / elapsed;
+		m_GroundCache.Update(pos, velocity);
+		bOverTerrain = m_GroundCache.FindAltitudeAtPoint(pos, fGroundAltitude);
+	}
+	else
+		bOverTerrain = m_pHF->FindAltitudeAtPoint(pos, fGroundAltitude);
+	m_LastPos = pos;
 
 	m_bOnGround = false;
 	if (bOverTerrain)
@@ -13,6 +13,7 @@
 #include "vtdata/HeightField.h"
 #include "Engine.h"
 #include "Event.h"
+#include "GroundCache.h"
 
 /** \defgroup nav Navigation
  * These classes are used for navigation: moving a camera or similar object
@@ -97,6 +98,11 @@ public:
 	/// Set the heightfield on which to do the terrain following.
 	void SetHeightField(const vtHeightField3d *pHF) { m_pHeightField = pHF; }
 
+	/** Optionally, find the height of the ground, including culture, from
+		a cache which some other engine keeps up to date, such as the one of
+		vtHeightConstrain. */
+	void SetGroundCache(const vtGroundCache *pCache) { m_pGroundCache = pCache; }
+
 	// If true, exaggerate the speed of the view by height above ground
 	void SetExag(bool bDo) { m_bExag = bDo; }
 	bool GetExag() { return m_bExag; }
@@ -106,6 +112,7 @@ public:
 
 protected:
 	const vtHeightField3d *m_pHeightField;
+	const vtGroundCache *m_pGroundCache;
 	bool	m_bExag;		// exaggerate speed based on height
 
 protected:
@@ -234,7 +241,7 @@ public:
 	vtHeightConstrain(float fMinHeight);
 
 	/// Set the heightfield on which to do the terrain following.
-	void SetHeightField(const vtHeightField3d *pHF) { m_pHF = pHF; }
+	void SetHeightField(const vtHeightField3d *pHF);
 
 	/// Set the height above the terrain to allow.
 	void SetMinGroundOffset(float fMeters) { m_fMinGroundOffset = fMeters; }
@@ -243,7 +250,7 @@ public:
 	float GetMinGroundOffset() { return m_fMinGroundOffset; }
 
 	/// Set whether to use the height of culture for terrain following. Default is false.
-	void SetUseCulture(bool set) { m_bUseCulture = set; }
+	void SetUseCulture(bool set);
 
 	/// Get whether to use the height of culture for terrain following.
 	bool GetUseCulture() { return m_bUseCulture; }
@@ -257,6 +264,10 @@ public:
 
 	bool IsVerticallyMobile();
 
+	/** The cache of the height of culture, which is used when following
+		culture.  Its cells, probing rate and kinds of culture can be set. */
+	vtGroundCache &GetGroundCache() { return m_GroundCache; }
+
 	void Eval();
 
 protected:
@@ -266,6 +277,8 @@ protected:
 	float m_fMinGroundOffset;
 	bool	m_bUseCulture;
 	bool	m_bOnGround;
+	vtGroundCache m_GroundCache;
+	FPoint3	m_LastPos;
 
 protected:
 	~vtHeightConstrain() {}
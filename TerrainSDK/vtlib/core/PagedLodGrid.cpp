@@ -13,6 +13,7 @@
 #include "vtdata/vtLog.h"
 
 #include "PagedLodGrid.h"
+#include "Profiler.h"
 
 #include <algorithm>	// for sort
 
@@ -442,6 +443,7 @@ void vtPagedStructureLodGrid::RefreshPaging(vtStructureArray3d *pArray)
 void vtPagedStructureLodGrid::DoPaging(const FPoint3 &CamPos,
 									   int iMaxStructures, float fDeleteDistance)
 {
+	VTPROFILE("Structure paging");
 	static float last_cull = 0.0f, last_load = 0.0f, last_prioritize = 0.0f;
 	float current = vtGetTime();
 
@@ -503,6 +505,7 @@ void vtPagedStructureLodGrid::ConstructByIndex(vtPagedStructureLOD *pLOD,
 
 		// Keep track of overall number of loads
 		m_iLoadCount++;
+		VTCOUNT("Structures paged in", 1);
 	}
 	else
 	{
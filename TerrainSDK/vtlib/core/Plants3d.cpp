@@ -18,6 +18,7 @@
 
 #include "vtdata/vtLog.h"
 #include "vtdata/DataPath.h"
+#include "vtlib/core/Profiler.h"
 #include "vtdata/FilePath.h"
 #include "vtdata/HeightField.h"
 #include "Plants3d.h"
@@ -905,9 +906,14 @@ int vtPlantInstanceArray3d::CreatePlantShaderNodes(bool progress_dialog(int))
 {
 	VTLOG1(" Creating OpenGL shader based vegetation...\n");
 
-	FPoint3 p3;
 	uint num_plants = NumEntities();
 
+	// Drape all the plants at once
+	std::vector<FPoint3> p3(num_plants);
+	if (num_plants > 0)
+		m_pHeightField->ConvertEarthToSurfacePoints(GetAllPoints().GetData(),
+			&p3[0], num_plants);
+
 	// Create cell subdivision
 	osg::ref_ptr<PlantCell> cell = new PlantCell;
 	cell->reserveTrees(num_plants);
@@ -916,8 +922,7 @@ int vtPlantInstanceArray3d::CreatePlantShaderNodes(bool progress_dialog(int))
 	for (uint i = 0; i < num_plants; i++)
 	{
 		GetPlant(i, pi.m_size, pi.m_species_id);
-		m_pHeightField->ConvertEarthToSurfacePoint(GetPoint(i), p3);
-		pi.m_pos.set(p3.x, p3.y, p3.z);
+		pi.m_pos.set(p3[i].x, p3[i].y, p3[i].z);
 
 		cell->addTree(pi);
 	}
@@ -938,6 +943,8 @@ int vtPlantInstanceArray3d::CreatePlantShaderNodes(bool progress_dialog(int))
 
 bool vtPlantInstanceArray3d::CreatePlantNode(uint i)
 {
+	VTPROFILE("CreatePlantNode");
+
 	// If it was already constructed, destruct so we can build again
 	ReleasePlantGeometry(i);
 
@@ -1085,6 +1092,8 @@ void vtPlantInstanceArray3d::OffsetSelectedPlants(const DPoint2 &offset)
 void vtPlantInstanceArray3d::UpdateTransform(uint i)
 {
 	vtPlantInstance3d *inst3d = GetInstance3d(i);
+	if (!inst3d || !inst3d->m_pContainer)
+		return;
 
 	FPoint3 p3;
 	m_pHeightField->ConvertEarthToSurfacePoint(GetPoint(i), p3);
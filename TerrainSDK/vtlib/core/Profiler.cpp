@@ -0,0 +1,371 @@
+//
+// Profiler.cpp
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "vtlib/vtlib.h"
+#include "vtdata/FilePath.h"
+#include "vtdata/vtLog.h"
+#include "Profiler.h"
+
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <algorithm>
+
+#if defined(_MSC_VER)
+  #define VT_THREAD_LOCAL __declspec(thread)
+#else
+  #define VT_THREAD_LOCAL __thread
+#endif
+
+// Size of each thread's ring buffer, in events; must be a power of 2.
+#define RING_SIZE		32768
+#define RING_MASK		(RING_SIZE - 1)
+
+// Number of frames over which the rolling statistics are kept.
+#define STATS_FRAMES	120
+
+namespace {
+
+/**
+ * The events recorded by one thread.  Only the owning thread writes events
+ * and advances m_iWritten, so no lock is needed.  If the reader falls more
+ * than RING_SIZE events behind, the oldest are lost.
+ */
+struct ThreadRing
+{
+	ThreadRing(uint index) { m_iWritten = 0; m_iRead = 0; m_iIndex = index; }
+
+	vtProfiler::Event m_Events[RING_SIZE];
+	volatile uint m_iWritten;	// count of events written
+	uint m_iRead;				// count of events gathered by NextFrame
+	uint m_iIndex;
+};
+
+struct ZoneStats
+{
+	ZoneStats(const char *name)
+	{
+		m_name = name;
+		m_bCounter = false;
+		m_fFrame = 0.0;
+		m_iFrameCalls = 0;
+		m_iLastCalls = 0;
+		for (int i = 0; i < STATS_FRAMES; i++)
+			m_History[i] = 0.0;
+	}
+	double Average(uint frames) const
+	{
+		double sum = 0.0;
+		for (uint i = 0; i < frames; i++)
+			sum += m_History[i];
+		return frames ? sum / frames : 0.0;
+	}
+	double Maximum(uint frames) const
+	{
+		double m = 0.0;
+		for (uint i = 0; i < frames; i++)
+			if (m_History[i] > m) m = m_History[i];
+		return m;
+	}
+
+	vtString m_name;
+	bool m_bCounter;
+	double m_fFrame;		// this frame: time in ms, or the sum of the counter
+	uint m_iFrameCalls;
+	uint m_iLastCalls;
+	double m_History[STATS_FRAMES];
+};
+
+OpenThreads::Mutex s_Mutex;
+std::vector<ThreadRing*> s_Rings;
+std::vector<ZoneStats*> s_Zones;
+VT_THREAD_LOCAL ThreadRing *s_pRing = NULL;
+
+uint s_iFrames = 0;				// frames gathered
+osg::Timer_t s_FrameStart = 0;
+uint s_iFrameZone = 0;
+
+ThreadRing *GetRing()
+{
+	if (!s_pRing)
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_Mutex);
+		s_pRing = new ThreadRing(s_Rings.size());
+		s_Rings.push_back(s_pRing);
+	}
+	return s_pRing;
+}
+
+void Write(uint type, uint id, osg::Timer_t tick, double value)
+{
+	ThreadRing *ring = GetRing();
+	const uint n = ring->m_iWritten;
+	vtProfiler::Event &e = ring->m_Events[n & RING_MASK];
+	e.m_tick = tick;
+	e.m_value = value;
+	e.m_id = id;
+	e.m_type = type;
+	ring->m_iWritten = n + 1;
+}
+
+bool ZoneGreater(const ZoneStats *a, const ZoneStats *b)
+{
+	return a->m_fFrame > b->m_fFrame;
+}
+
+void WriteEscaped(FILE *fp, const char *str)
+{
+	for (const char *c = str; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			fputc('\\', fp);
+		fputc(*c, fp);
+	}
+}
+
+}	// namespace
+
+bool vtProfiler::s_bEnabled = false;
+float vtProfiler::s_fFrameTime = 0.0f;
+float vtProfiler::s_fSpikeFactor = 2.0f;
+
+void vtProfiler::SetEnabled(bool bOn)
+{
+	if (bOn && !s_bEnabled)
+	{
+		s_iFrameZone = Register("Frame");
+		s_FrameStart = 0;
+	}
+	s_bEnabled = bOn;
+}
+
+/**
+ * Get the id for a zone or counter name, registering it if it is new.
+ * Names are not expected to change, so this is normally called once for
+ * each place that is instrumented.
+ */
+uint vtProfiler::Register(const char *name)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_Mutex);
+	for (uint i = 0; i < s_Zones.size(); i++)
+		if (s_Zones[i]->m_name == name)
+			return i;
+	s_Zones.push_back(new ZoneStats(name));
+	return s_Zones.size() - 1;
+}
+
+const char *vtProfiler::GetName(uint id)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_Mutex);
+	return id < s_Zones.size() ? (const char *) s_Zones[id]->m_name : "";
+}
+
+void vtProfiler::Record(uint id, osg::Timer_t start, osg::Timer_t end)
+{
+	Write(EV_ZONE, id, start, (double) (end - start));
+}
+
+void vtProfiler::Count(uint id, double value)
+{
+	Write(EV_COUNTER, id, osg::Timer::instance()->tick(), value);
+}
+
+/**
+ * Mark the end of one frame and the start of the next.  The events of the
+ * frame just finished, from all threads, are added to the statistics.
+ */
+void vtProfiler::NextFrame()
+{
+	if (!s_bEnabled)
+		return;
+
+	osg::Timer *timer = osg::Timer::instance();
+	const osg::Timer_t now = timer->tick();
+	if (s_FrameStart == 0)
+	{
+		s_FrameStart = now;
+		return;
+	}
+	Write(EV_FRAME, s_iFrameZone, s_FrameStart, (double) (now - s_FrameStart));
+	s_FrameStart = now;
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_Mutex);
+
+	// Gather the new events
+	const double ms_per_tick = timer->getSecondsPerTick() * 1000.0;
+	for (uint r = 0; r < s_Rings.size(); r++)
+	{
+		ThreadRing *ring = s_Rings[r];
+		const uint written = ring->m_iWritten;
+		uint i = ring->m_iRead;
+		if (written - i > RING_SIZE)
+			i = written - RING_SIZE;
+		for (; i != written; i++)
+		{
+			const Event &e = ring->m_Events[i & RING_MASK];
+			if (e.m_id >= s_Zones.size())
+				continue;
+			ZoneStats *z = s_Zones[e.m_id];
+			if (e.m_type == EV_COUNTER)
+			{
+				z->m_bCounter = true;
+				z->m_fFrame += e.m_value;
+			}
+			else
+				z->m_fFrame += e.m_value * ms_per_tick;
+			z->m_iFrameCalls++;
+		}
+		ring->m_iRead = written;
+	}
+
+	// Look for a spike, compared to the frames before this one
+	ZoneStats *frame = s_Zones[s_iFrameZone];
+	const uint frames = std::min(s_iFrames, (uint) STATS_FRAMES);
+	const double avg = frame->Average(frames);
+	if (s_fSpikeFactor > 0 && frames >= 10 && frame->m_fFrame > avg * s_fSpikeFactor)
+	{
+		std::vector<ZoneStats*> zones;
+		for (uint i = 0; i < s_Zones.size(); i++)
+			if (i != s_iFrameZone && !s_Zones[i]->m_bCounter && s_Zones[i]->m_fFrame > 0)
+				zones.push_back(s_Zones[i]);
+		std::sort(zones.begin(), zones.end(), ZoneGreater);
+		VTLOG("Profiler: frame %d took %.1f ms (average %.1f ms):", s_iFrames,
+			frame->m_fFrame, avg);
+		for (uint i = 0; i < zones.size() && i < 4; i++)
+			VTLOG(" %s %.1f,", (const char *) zones[i]->m_name, zones[i]->m_fFrame);
+		VTLOG1("\n");
+	}
+	s_fFrameTime = (float) (frame->m_fFrame / 1000.0);
+
+	// Roll the statistics
+	const uint slot = s_iFrames % STATS_FRAMES;
+	for (uint i = 0; i < s_Zones.size(); i++)
+	{
+		ZoneStats *z = s_Zones[i];
+		z->m_History[slot] = z->m_fFrame;
+		z->m_iLastCalls = z->m_iFrameCalls;
+		z->m_fFrame = 0.0;
+		z->m_iFrameCalls = 0;
+	}
+	s_iFrames++;
+}
+
+/**
+ * Get a text summary of the statistics over the last few seconds: the frame
+ * time, the most expensive zones, and the counters.  Times are in
+ * milliseconds per frame.
+ */
+void vtProfiler::GetSummary(vtString &str, int iMaxZones)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_Mutex);
+
+	const uint frames = std::min(s_iFrames, (uint) STATS_FRAMES);
+	if (frames == 0 || s_iFrameZone >= s_Zones.size())
+	{
+		str = "No profile data\n";
+		return;
+	}
+	const ZoneStats *frame = s_Zones[s_iFrameZone];
+	const double avg = frame->Average(frames);
+	str.Format("Frame %.2f ms avg, %.2f ms max (%.1f fps)\n", avg,
+		frame->Maximum(frames), avg > 0 ? 1000.0 / avg : 0.0);
+
+	// Sort zones by their average
+	std::vector<ZoneStats*> zones, counters;
+	for (uint i = 0; i < s_Zones.size(); i++)
+	{
+		if (i == s_iFrameZone)
+			continue;
+		ZoneStats *z = s_Zones[i];
+		z->m_fFrame = z->Average(frames);	// scratch, until the next frame
+		if (z->m_bCounter)
+			counters.push_back(z);
+		else
+			zones.push_back(z);
+	}
+	std::sort(zones.begin(), zones.end(), ZoneGreater);
+
+	vtString line;
+	for (uint i = 0; i < zones.size() && (int) i < iMaxZones; i++)
+	{
+		const ZoneStats *z = zones[i];
+		line.Format("%-28s %7.2f ms avg %7.2f max %5d calls\n",
+			(const char *) z->m_name, z->m_fFrame, z->Maximum(frames),
+			z->m_iLastCalls);
+		str += line;
+	}
+	for (uint i = 0; i < counters.size(); i++)
+	{
+		const ZoneStats *z = counters[i];
+		line.Format("%-28s %10.0f avg %10.0f max\n", (const char *) z->m_name,
+			z->m_fFrame, z->Maximum(frames));
+		str += line;
+	}
+	for (uint i = 0; i < s_Zones.size(); i++)
+		s_Zones[i]->m_fFrame = 0.0;
+}
+
+/**
+ * Write the recent events of all threads, in the Chrome trace event format
+ * (JSON).  Open the file with chrome://tracing to see a timeline.
+ */
+bool vtProfiler::WriteChromeTrace(const char *fname)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_Mutex);
+
+	FILE *fp = vtFileOpen(fname, "wb");
+	if (!fp)
+		return false;
+
+	// Find the earliest event, to make times relative to it
+	osg::Timer *timer = osg::Timer::instance();
+	osg::Timer_t origin = 0;
+	for (uint r = 0; r < s_Rings.size(); r++)
+	{
+		const ThreadRing *ring = s_Rings[r];
+		const uint written = ring->m_iWritten;
+		const uint first = written > RING_SIZE ? written - RING_SIZE : 0;
+		for (uint i = first; i != written; i++)
+		{
+			const osg::Timer_t tick = ring->m_Events[i & RING_MASK].m_tick;
+			if (origin == 0 || tick < origin)
+				origin = tick;
+		}
+	}
+
+	const double us_per_tick = timer->getSecondsPerTick() * 1000000.0;
+	fprintf(fp, "{\"traceEvents\":[\n");
+	bool bFirst = true;
+	for (uint r = 0; r < s_Rings.size(); r++)
+	{
+		const ThreadRing *ring = s_Rings[r];
+		fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+			"\"args\":{\"name\":\"Thread %d\"}}", bFirst ? "" : ",\n",
+			ring->m_iIndex, ring->m_iIndex);
+		bFirst = false;
+
+		const uint written = ring->m_iWritten;
+		const uint first = written > RING_SIZE ? written - RING_SIZE : 0;
+		for (uint i = first; i != written; i++)
+		{
+			const Event &e = ring->m_Events[i & RING_MASK];
+			if (e.m_id >= s_Zones.size())
+				continue;
+			const double ts = timer->delta_u(origin, e.m_tick);
+			fprintf(fp, ",\n{\"name\":\"");
+			WriteEscaped(fp, s_Zones[e.m_id]->m_name);
+			if (e.m_type == EV_COUNTER)
+				fprintf(fp, "\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":0,\"tid\":%d,"
+					"\"args\":{\"value\":%g}}", ts, ring->m_iIndex, e.m_value);
+			else
+				fprintf(fp, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%d}",
+					ts, e.m_value * us_per_tick, ring->m_iIndex);
+		}
+	}
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+	return true;
+}
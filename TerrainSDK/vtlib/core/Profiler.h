@@ -0,0 +1,127 @@
+//
+// Profiler.h
+//
+// Lightweight instrumentation: scoped timers and named counters.
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTPROFILERH
+#define VTPROFILERH
+
+#include <osg/Timer>
+#include "vtdata/vtString.h"
+
+/** \addtogroup eng */
+/*@{*/
+
+/**
+ * A low-overhead profiler for finding where frame time goes.
+ *
+ * Code is instrumented with the VTPROFILE and VTCOUNT macros.  While the
+ * profiler is disabled (the default), each of these costs a single test of
+ * a flag.  While it is enabled, each timed scope or counter writes one
+ * event into a ring buffer belonging to the calling thread, so no locking
+ * is needed and events from other threads (such as the draw or tile
+ * loading threads) are recorded as well.
+ *
+ * Once per frame, vtScene calls NextFrame, which gathers the events of the
+ * frame from all threads into rolling statistics.  These can be shown with
+ * GetSummary, and unusually slow frames are logged with their most
+ * expensive zones.  The recent contents of the ring buffers can be written
+ * in the Chrome trace format (viewable with chrome://tracing) with
+ * WriteChromeTrace.
+ *
+ * Example:
+ \code
+	void MyClass::Expensive()
+	{
+		VTPROFILE("MyClass::Expensive");
+		...
+		VTCOUNT("Things made", iThings);
+	}
+ \endcode
+ */
+class vtProfiler
+{
+public:
+	enum EventType { EV_ZONE, EV_COUNTER, EV_FRAME };
+	struct Event
+	{
+		osg::Timer_t m_tick;	// start time
+		double m_value;			// duration in ticks, or counter value
+		uint m_id;
+		uint m_type;
+	};
+
+	/// Turn recording on or off.
+	static void SetEnabled(bool bOn);
+	static bool IsEnabled() { return s_bEnabled; }
+
+	static uint Register(const char *name);
+	static const char *GetName(uint id);
+
+	static void Record(uint id, osg::Timer_t start, osg::Timer_t end);
+	static void Count(uint id, double value);
+	static void NextFrame();
+
+	/// Time of the most recent complete frame, in seconds.
+	static float GetFrameTime() { return s_fFrameTime; }
+	/**
+	 * A frame which takes longer than this many times the average is logged
+	 * as a spike.  Default is 2; zero disables the logging.
+	 */
+	static void SetSpikeFactor(float f) { s_fSpikeFactor = f; }
+
+	static void GetSummary(vtString &str, int iMaxZones = 16);
+	static bool WriteChromeTrace(const char *fname);
+
+protected:
+	static bool s_bEnabled;
+	static float s_fFrameTime;
+	static float s_fSpikeFactor;
+};
+
+/**
+ * Records the time between its construction and destruction, as an event of
+ * a given zone.  Normally used through the VTPROFILE macro.
+ */
+class vtProfileScope
+{
+public:
+	vtProfileScope(uint id)
+	{
+		m_id = id;
+		if (vtProfiler::IsEnabled())
+			m_start = osg::Timer::instance()->tick();
+		else
+			m_start = 0;
+	}
+	~vtProfileScope()
+	{
+		if (m_start != 0 && vtProfiler::IsEnabled())
+			vtProfiler::Record(m_id, m_start, osg::Timer::instance()->tick());
+	}
+protected:
+	uint m_id;
+	osg::Timer_t m_start;
+};
+
+#define VTPROFILE_CONCAT2(a, b) a##b
+#define VTPROFILE_CONCAT(a, b) VTPROFILE_CONCAT2(a, b)
+
+/** Time the rest of the enclosing scope, under the given (literal) name. */
+#define VTPROFILE(name) \
+	static const uint VTPROFILE_CONCAT(_vtprof_id_, __LINE__) = vtProfiler::Register(name); \
+	vtProfileScope VTPROFILE_CONCAT(_vtprof_scope_, __LINE__)(VTPROFILE_CONCAT(_vtprof_id_, __LINE__))
+
+/** Add a value to the named counter, for this frame. */
+#define VTCOUNT(name, value) \
+	do { if (vtProfiler::IsEnabled()) { \
+		static const uint _vtprof_counter = vtProfiler::Register(name); \
+		vtProfiler::Count(_vtprof_counter, (double) (value)); } } while (0)
+
+/*@}*/	// Group eng
+
+#endif // VTPROFILERH
@@ -1132,7 +1132,6 @@ float vtRoadMap3d::GetLodDistance()
 
 void vtRoadMap3d::DrapeOnTerrain(vtHeightField3d *pHeightField)
 {
-	FPoint3 p;
 	NodeGeom *pN;
 
 #if 0
@@ -1168,9 +1167,23 @@ void vtRoadMap3d::DrapeOnTerrain(vtHeightField3d *pHeightField)
 		}
 	}
 #endif
+	// Gather the points of all the nodes and links, and drape them at once
+	DLine2 epos;
+	for (pN = GetFirstNode(); pN; pN = pN->GetNext())
+		epos.Append(pN->Pos());
+	LinkGeom *pL;
+	for (pL = GetFirstLink(); pL; pL = pL->GetNext())
+		epos.Append(*pL);
+
+	const uint num = epos.GetSize();
+	std::vector<FPoint3> p3(num);
+	if (num > 0)
+		pHeightField->ConvertEarthToSurfacePoints(epos.GetData(), &p3[0], num);
+
+	uint k = 0;
 	for (pN = GetFirstNode(); pN; pN = pN->GetNext())
 	{
-		pHeightField->ConvertEarthToSurfacePoint(pN->Pos(), pN->m_p3);
+		pN->m_p3 = p3[k++];
 #if 0
 		if (pN->NumLinks() > 0)
 		{
@@ -1179,14 +1192,12 @@ void vtRoadMap3d::DrapeOnTerrain(vtHeightField3d *pHeightField)
 		}
 #endif
 	}
-	for (LinkGeom *pL = GetFirstLink(); pL; pL = pL->GetNext())
+	for (pL = GetFirstLink(); pL; pL = pL->GetNext())
 	{
 		pL->m_centerline.SetSize(pL->GetSize());
 		for (uint j = 0; j < pL->GetSize(); j++)
-		{
-			pHeightField->ConvertEarthToSurfacePoint(pL->GetAt(j), p);
-			pL->m_centerline[j] = p;
-		}
+			pL->m_centerline[j] = p3[k++];
+
 		// ignore width from file - imply from properties
 		pL->EstimateWidth();
 	}
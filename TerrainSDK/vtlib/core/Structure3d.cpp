@@ -15,6 +15,7 @@
 #include "Fence3d.h"
 #include "Terrain.h"
 #include "PagedLodGrid.h"
+#include "Profiler.h"
 
 // Static members
 vtMaterialDescriptorArray3d vtStructure3d::s_MaterialDescriptors;
@@ -289,11 +290,13 @@ vtStructure3d *vtStructureArray3d::GetStructure3d(int i)
 
 bool vtStructureArray3d::ConstructStructure(vtStructure3d *str)
 {
+	VTPROFILE("ConstructStructure");
 	return str->CreateNode(m_pTerrain);
 }
 
 bool vtStructureArray3d::ConstructStructure(int index)
 {
+	VTPROFILE("ConstructStructure");
 	vtStructure3d *str = GetStructure3d(index);
 	if (str)
 		return str->CreateNode(m_pTerrain);
@@ -58,6 +58,7 @@ vtTerrain::vtTerrain()
 
 	m_pHeightField = NULL;
 	m_bPreserveInputGrid = false;
+	m_iCultureRevision = 0;
 	m_pScaledFeatures = NULL;
 	m_pFeatureLoader = NULL;
 
@@ -503,6 +504,7 @@ bool vtTerrain::_CreateDynamicTerrain()
 void vtTerrain::SetVerticalExag(float fExag)
 {
 	m_fVerticalExag = fExag;
+	m_iCultureRevision++;
 
 	if (m_pDynGeom != NULL)
 	{
@@ -675,7 +677,7 @@ void vtTerrain::CreateWaterHeightfield(const vtString &fname)
 
 	MakeWaterMaterial();
 	m_pWaterTin3d->SetMaterial(m_pEphemMats, m_idx_water);
-	vtGeode *wsgeom = m_pWaterTin3d->CreateGeometry(false);	// No shadow mesh.
+	vtGroup *wsgeom = m_pWaterTin3d->CreateGeometry(false);	// No shadow mesh.
 	wsgeom->setName("Water surface");
 	wsgeom->SetCastShadow(false);
 
@@ -761,10 +763,16 @@ bool vtTerrain::GetGeoExtentsFromMetadata()
 
 void vtTerrain::CreateStructures(vtStructureArray3d *structures)
 {
+	bool bPaging = m_Params.GetValueBool(STR_STRUCTURE_PAGING);
+
+	// Structures from a binary file are read near the camera as we page
+	//  (see DoStructurePaging), otherwise all of them now.
+	if (!bPaging && structures->HasUnreadBlocks())
+		structures->ReadBinaryBlocks(NULL);
+
 	int num_structs = structures->size();
 	VTLOG("CreateStructures, %d structs\n", num_structs);
 
-	bool bPaging = m_Params.GetValueBool(STR_STRUCTURE_PAGING);
 	if (bPaging)
 	{
 		// Don't construct geometry, just add to the paged structure grid
@@ -890,6 +898,7 @@ void vtTerrain::DeleteStructureFromTerrain(vtStructureLayer *st_layer, int index
 
 	RemoveNodeFromStructGrid(node);
 	str3d->DeleteNode();
+	m_iCultureRevision++;
 
 	// if there are any engines pointing to this node, inform them
 	vtGetScene()->TargetRemoved(node);
@@ -1910,9 +1919,9 @@ bool vtTerrain::CreateFromTIN()
 	bool bDropShadow = false;
 
 	// Make the TIN's geometry.
-	vtGeode *geode = m_pTin->CreateGeometry(bDropShadow);
-	geode->SetCastShadow(false);
-	m_pTerrainGroup->addChild(geode);
+	vtGroup *group = m_pTin->CreateGeometry(bDropShadow);
+	group->SetCastShadow(false);
+	m_pTerrainGroup->addChild(group);
 
 	return true;
 }
@@ -2779,6 +2788,26 @@ int vtTerrain::DoStructurePaging()
 	vtCamera *cam = vtGetScene()->GetCamera();
 	FPoint3 CamPos = cam->GetTrans();
 
+	// Read any blocks of structures from binary files which have come
+	//  within the paging distance.
+	DRECT area;
+	const LocalCS &conv = GetLocalCS();
+	conv.LocalToEarth(CamPos.x - m_fPagingStructureDist,
+		CamPos.z + m_fPagingStructureDist, area.left, area.bottom);
+	conv.LocalToEarth(CamPos.x + m_fPagingStructureDist,
+		CamPos.z - m_fPagingStructureDist, area.right, area.top);
+	for (uint i = 0; i < m_Layers.size(); i++)
+	{
+		vtStructureLayer *slay = dynamic_cast<vtStructureLayer*>(m_Layers[i].get());
+		if (!slay || !slay->HasUnreadBlocks())
+			continue;
+		// Even if a block was damaged, those read before it were added.
+		const uint previous = slay->size();
+		slay->ReadBinaryBlocks(&area);
+		for (uint j = previous; j < slay->size(); j++)
+			m_pPagedStructGrid->AppendToGrid(slay, j);
+	}
+
 	m_pPagedStructGrid->DoPaging(CamPos, m_iPagingStructureMax,
 		m_fPagingStructureDist);
 	return m_pPagedStructGrid->GetQueueSize();
@@ -2816,6 +2845,7 @@ public:
 		m_fRotSpeed = 0.0f;
 	}
 	void Eval();
+	bool IsIndependent() { return true; }	// only reads the terrain params
 
 	float m_fLastTime;
 	float m_fDir;		// radians
@@ -3055,10 +3085,7 @@ int vtTerrain::DeleteSelectedFeatures(vtAbstractLayer *alay)
 		for (uint j = 0; j < fset->NumEntities(); j++)
 		{
 			if (fset->IsDeleted(j))
-			{
-				vtFeature *f = fset->GetFeature(j);
-				alay->DeleteFeature(f);
-			}
+				alay->DeleteFeature(j);
 		}
 		// Then low-level
 		fset->ApplyDeletion();
@@ -3219,59 +3246,117 @@ void vtTerrain::UpdateElevation()
 	if (!sr)
 		return;
 	sr->ReInit(m_pElevGrid.get());
+	m_iCultureRevision++;
 }
 
 /**
- * Drape all the culture on the terrain again, to keep them on the surface
+ * Drape the culture on the terrain again, to keep it on the surface
  * in the case when the elevation values have changed.
  *
+ * The structures, plants and abstract features to re-drape are found with a
+ * spatial index (vtCultureRegistry), so re-draping a small area is fast even
+ * when there is a lot of culture.  Roads are not re-draped.
+ *
  * \param area You can speed up this function by passing the area to re-drape
  *		in.  Otherwise, simply pass an empty area, and all culture will be
  *		re-draped.
  */
 void vtTerrain::RedrapeCulture(const DRECT &area)
 {
-	// Tell the terrain to re-drape all its structure instances.
+	m_iCultureRevision++;
+	if (!m_CultureRegistry.IsCurrent(m_Layers))
+		m_CultureRegistry.Build(m_Layers);
+
+	// Find the culture in the area, and sort it by layer
+	std::vector<uint> found;
+	m_CultureRegistry.Query(area, found);
+
+	std::vector< std::vector<uint> > indices(m_Layers.size());
+	for (uint k = 0; k < found.size(); k++)
+	{
+		const vtCultureRegistry::Element &e = m_CultureRegistry.GetElement(found[k]);
+		indices[e.m_layer].push_back(e.m_index);
+	}
+	VTLOG("RedrapeCulture: %d elements\n", (int) found.size());
+
 	for (uint i = 0; i < m_Layers.size(); i++)
 	{
+		if (indices[i].empty())
+			continue;
+
 		vtStructureLayer *slay = dynamic_cast<vtStructureLayer *>(m_Layers[i].get());
 		if (slay)
-		{
-			for (uint j = 0; j < slay->size(); j++)
-			{
-				vtStructure *st = slay->at(j);
-				vtStructure3d *s3 = slay->GetStructure3d(j);
+			_RedrapeStructures(slay, indices[i]);
 
-				// If we were given an area, omit structures outside it
-				if (!area.IsEmpty() && !st->IsContainedBy(area))
-					continue;
+		vtVegLayer *vlay = dynamic_cast<vtVegLayer *>(m_Layers[i].get());
+		if (vlay)
+			_RedrapePlants(vlay, indices[i]);
 
-				// A fence might need re-draping, so we have to rebuild geometry
-				vtFence3d *f3 = dynamic_cast<vtFence3d*>(s3);
-				if (f3)
-					f3->CreateNode(this);
+		vtAbstractLayer *alay = dynamic_cast<vtAbstractLayer *>(m_Layers[i].get());
+		if (alay)
+			alay->RefreshFeatures(indices[i]);
+	}
+	// What else?  Roads, perhaps.
+}
 
-				// A building's geometry will not change, only move up or down
-				vtBuilding3d *b3 = dynamic_cast<vtBuilding3d*>(s3);
-				if (b3)
-					b3->AdjustHeight(m_pHeightField);
+void vtTerrain::_RedrapeStructures(vtStructureLayer *slay, const std::vector<uint> &indices)
+{
+	// A building's geometry will not change, only move up or down.  Finding
+	//  the new heights only reads the heightfield, so on a grid it can be
+	//  done in parallel; the scene graph is then changed on this thread.
+	std::vector<vtBuilding3d*> buildings;
+	for (uint k = 0; k < indices.size(); k++)
+	{
+		vtBuilding3d *b3 = dynamic_cast<vtBuilding3d*>(slay->GetStructure3d(indices[k]));
+		if (b3)
+			buildings.push_back(b3);
+	}
+	const int num = (int) buildings.size();
+	if (dynamic_cast<vtHeightFieldGrid3d*>(m_pHeightField) != NULL)
+	{
+#pragma omp parallel for schedule(dynamic, 64)
+		for (int k = 0; k < num; k++)
+			buildings[k]->UpdateWorldLocation(m_pHeightField);
+	}
+	else
+	{
+		for (int k = 0; k < num; k++)
+			buildings[k]->UpdateWorldLocation(m_pHeightField);
+	}
+	for (int k = 0; k < num; k++)
+		buildings[k]->ApplyWorldLocation();
 
-				// A instance's geometry will not change, only move up or down
-				vtStructInstance3d *si = dynamic_cast<vtStructInstance3d*>(s3);
-				if (si)
-					si->UpdateTransform(m_pHeightField);
+	for (uint k = 0; k < indices.size(); k++)
+	{
+		vtStructure3d *s3 = slay->GetStructure3d(indices[k]);
 
-			}
-		}
-		vtVegLayer *vlay = dynamic_cast<vtVegLayer *>(m_Layers[i].get());
-		if (vlay)
-		{
-			for (uint i = 0; i < vlay->NumEntities(); i++)
-			{
-				vlay->UpdateTransform(i);
-			}
-		}
+		// A fence might need re-draping, so we have to rebuild geometry
+		vtFence3d *f3 = dynamic_cast<vtFence3d*>(s3);
+		if (f3)
+			f3->CreateNode(this);
+
+		// A instance's geometry will not change, only move up or down
+		vtStructInstance3d *si = dynamic_cast<vtStructInstance3d*>(s3);
+		if (si)
+			si->UpdateTransform(m_pHeightField);
+	}
+}
+
+void vtTerrain::_RedrapePlants(vtVegLayer *vlay, const std::vector<uint> &indices)
+{
+	// Find the new positions with one query of the heightfield
+	const int num = (int) indices.size();
+	std::vector<DPoint2> epos(num);
+	std::vector<FPoint3> pos(num);
+	for (int k = 0; k < num; k++)
+		epos[k] = vlay->GetPoint(indices[k]);
+	if (num > 0)
+		m_pHeightField->ConvertEarthToSurfacePoints(&epos[0], &pos[0], num);
+	for (int k = 0; k < num; k++)
+	{
+		vtTransform *trans = vlay->GetPlantNode(indices[k]);
+		if (trans)
+			trans->SetTrans(pos[k]);
 	}
-	// What else?  Abstract Layers. Roads, perhaps.
 }
 
@@ -14,6 +14,7 @@
 #include "AbstractLayer.h"
 #include "AnimPath.h"	// for vtAnimContainer
 #include "Content3d.h"
+#include "CultureRegistry.h"
 #include "DynTerrain.h"
 #include "GeomUtil.h"	// for MeshFactory
 #include "Location.h"
@@ -318,6 +319,7 @@ public:
 	const vtProjection &GetProjection() const { return m_proj; }
 	bool IsGeographicCRS() const { return (m_proj.IsGeographic() == 1); }
 	virtual bool FindAltitudeOnCulture(const FPoint3 &p3, float &fAltitude, bool bTrue, int iCultureFlags) const;
+	virtual uint GetCultureRevision() const { return m_iCultureRevision; }
 	int GetShadowTextureUnit();
 
 	// Access the viewpoint(s) associated with this terrain
@@ -360,6 +362,8 @@ public:
 	vtElevationGrid	*GetInitialGrid() { return m_pElevGrid.get(); }
 	void UpdateElevation();
 	void RedrapeCulture(const DRECT &area);
+	/// Call this after moving culture, so that RedrapeCulture will find it.
+	void InvalidateCultureRegistry() { m_CultureRegistry.Clear(); m_iCultureRevision++; }
 
 	// Texture
 	void ReshadeTexture(vtTransform *pSunLight, bool progress_callback(int) = NULL);
@@ -386,6 +390,8 @@ protected:
 	void _CreateVegetation();
 	void _CreateStructures();
 	void _CreateRoads();
+	void _RedrapeStructures(vtStructureLayer *slay, const std::vector<uint> &indices);
+	void _RedrapePlants(vtVegLayer *vlay, const std::vector<uint> &indices);
 	void _SetupVegGrid(float fLODDistance);
 	void _SetupStructGrid(float fLODDistance);
 	void _CreateAbstractLayersFromParams();
@@ -453,6 +459,8 @@ protected:
 	// Layers
 	LayerSet		m_Layers;
 	vtLayer			*m_pActiveLayer;
+	vtCultureRegistry	m_CultureRegistry;
+	uint			m_iCultureRevision;
 
 	// built structures, e.g. buildings and fences
 	vtLodGrid		*m_pStructGrid;
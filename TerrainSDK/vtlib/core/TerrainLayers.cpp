@@ -52,7 +52,14 @@ bool vtStructureLayer::Load(bool progress_callback(int))
 	else
 		VTLOG("\tFound: %s\n", (const char *) building_path);
 
-	if (!ReadXML(building_path, progress_callback))
+	// Binary files are only indexed here; their structures are read when
+	//  they are needed, see vtTerrain::CreateStructures.
+	if (GetExtension(building_path).CompareNoCase(".vtsb") == 0)
+	{
+		if (!ReadBinaryIndex(building_path))
+			return false;
+	}
+	else if (!ReadXML(building_path, progress_callback))
 		return false;
 
 	// If the user wants it to start hidden, hide it
@@ -198,11 +205,11 @@ void vtElevLayer::MakeMaterials(bool bTextureCompression)
 vtTransform *vtElevLayer::CreateGeometry()
 {
 	bool drop_shadow = false;
-	m_pGeode = m_pTin->CreateGeometry(drop_shadow);
-	m_pGeode->SetCastShadow(false);
+	m_pGroup = m_pTin->CreateGeometry(drop_shadow);
+	m_pGroup->SetCastShadow(false);
 
 	m_pTransform = new vtTransform;
-	m_pTransform->addChild(m_pGeode);
+	m_pTransform->addChild(m_pGroup);
 
 	return m_pTransform;
 }
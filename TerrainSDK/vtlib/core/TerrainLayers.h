@@ -122,7 +122,7 @@ public:
 	vtTransform *GetTopNode() { return m_pTransform; }
 
 protected:
-	vtGeode *m_pGeode;
+	vtGroup *m_pGroup;
 	vtTransform *m_pTransform;
 
 	osg::ref_ptr<vtTin3d> m_pTin;
@@ -72,6 +72,9 @@ vtTerrainScene::vtTerrainScene()
 
 	m_fCatenaryFactor = 140.0;	// a default value
 
+	for (int i = 0; i < NUM_CREATE_STEPS; i++)
+		m_fCreateStepTime[i] = 0.0f;
+
 	vtSetGlobalContent(m_Content);	// Singleton
 }
 
@@ -224,13 +227,19 @@ void vtTerrainScene::AppendTerrain(vtTerrain *pTerrain)
  */
 vtGroup *vtTerrainScene::BuildTerrain(vtTerrain *pTerrain)
 {
+	for (int i = 0; i < NUM_CREATE_STEPS; i++)
+		m_fCreateStepTime[i] = 0.0f;
+	osg::Timer_t tick = osg::Timer::instance()->tick();
+
 	pTerrain->CreateStep1();
+	_StepDone(1, tick);
 
 	// connect the terrain's engines
 	m_pTerrainEngines->AddChild(pTerrain->GetEngineGroup());
 
 	if (!pTerrain->CreateStep2())
 		return NULL;
+	_StepDone(2, tick);
 
 	// Set time to that of the new terrain
 	m_pSkyDome->SetTime(pTerrain->GetInitialTime());
@@ -241,24 +250,42 @@ vtGroup *vtTerrainScene::BuildTerrain(vtTerrain *pTerrain)
 
 	if (!pTerrain->CreateStep3(m_pSunLight, m_pLightSource))
 		return NULL;
+	_StepDone(3, tick);
 
 	if (!pTerrain->CreateStep4())
 		return NULL;
+	_StepDone(4, tick);
 
 	if (!pTerrain->CreateStep5())
 		return NULL;
+	_StepDone(5, tick);
 
 	pTerrain->CreateStep6();
+	_StepDone(6, tick);
 	pTerrain->CreateStep7();
+	_StepDone(7, tick);
 	pTerrain->CreateStep8();
+	_StepDone(8, tick);
 	pTerrain->CreateStep9();
+	_StepDone(9, tick);
 	pTerrain->CreateStep10();
+	_StepDone(10, tick);
 	pTerrain->CreateStep11();
+	_StepDone(11, tick);
 	pTerrain->CreateStep12();
+	_StepDone(12, tick);
 
 	return pTerrain->GetTopGroup();
 }
 
+void vtTerrainScene::_StepDone(int iStep, osg::Timer_t &tick)
+{
+	osg::Timer_t now = osg::Timer::instance()->tick();
+	m_fCreateStepTime[iStep-1] = (float) osg::Timer::instance()->delta_s(tick, now);
+	VTLOG("CreateStep%d: %.3f seconds.\n", iStep, m_fCreateStepTime[iStep-1]);
+	tick = now;
+}
+
 void vtTerrainScene::RemoveTerrain(vtTerrain *pTerrain)
 {
 	for (uint i = 0; i < NumTerrains(); i++)
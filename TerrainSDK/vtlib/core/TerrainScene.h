@@ -8,10 +8,13 @@
 #ifndef TERRAINSCENEH
 #define TERRAINSCENEH
 
+#include <osg/Timer>
 #include "vtdata/FilePath.h"
 #include "TimeEngines.h"
 #include "Content3d.h"
 
+#define NUM_CREATE_STEPS	12
+
 // Forward references
 class vtSkyDome;
 class vtTerrain;
@@ -71,6 +74,12 @@ public:
 	void RemoveTerrain(vtTerrain *pTerrain);
 	void CleanupScene();
 
+	/**
+	 * The time, in seconds, which the last call to BuildTerrain spent in
+	 * each of the terrain's CreateStep methods (iStep from 1 to 12).
+	 */
+	float GetCreateStepTime(int iStep) const { return m_fCreateStepTime[iStep-1]; }
+
 	vtGroup *GetTop() { return m_pTop; }
 	vtSkyDome *GetSkyDome() { return m_pSkyDome; }
 	void UpdateSkydomeForTerrain(vtTerrain *pTerrain);
@@ -114,6 +123,7 @@ protected:
 
 	void _CreateSky();
 	void _CreateEngines();
+	void _StepDone(int iStep, osg::Timer_t &tick);
 
 	vtGroup		*m_pAtmosphereGroup;
 
@@ -133,6 +143,8 @@ protected:
 
 	vtLightSource	*m_pLightSource;
 	vtTransform		*m_pSunLight;
+
+	float		m_fCreateStepTime[NUM_CREATE_STEPS];
 };
 
 // global helper function
@@ -9,8 +9,11 @@
 #include "vtdata/FilePath.h"
 #include "vtdata/vtLog.h"
 #include "vtdata/TripDub.h"
+#include "Profiler.h"
 #include "TiledGeom.h"
 
+#include <algorithm>	// for sort
+
 #include <mini/mini.h>
 #include <mini/miniload.h>
 #include <mini/minicache.h>
@@ -837,7 +840,10 @@ databuf vtTiledGeom::FetchTile(const char *fname)
 	m_iTileLoads++;
 
 	// Load data buffer directly
+	VTPROFILE("Tile load");
 	result.loaddata(fname);
+	VTCOUNT("Tiles loaded", 1);
+	VTCOUNT("Tile bytes", result.bytes);
 
 	return result;
 }
@@ -1099,6 +1105,43 @@ bool vtTiledGeom::FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude,
 	return true;
 }
 
+/**
+ * Find the elevation at many points.  libMini is not asked from several
+ * threads at once, but the points are sorted by tile, so that the lookups
+ * in each tile are done together.
+ */
+int vtTiledGeom::FindAltitudesAtPoints(FPoint3 *points, uint count,
+	bool bTrue, int iCultureFlags) const
+{
+	if (iCultureFlags != 0 && m_pCulture != NULL)
+		return vtHeightField3d::FindAltitudesAtPoints(points, count, bTrue, iCultureFlags);
+
+	// Sort the points by tile
+	const float fTileWidth = m_WorldExtents.Width() / cols;
+	const float fTileDepth = fabs(m_WorldExtents.Height()) / rows;
+	std::vector< std::pair<int, uint> > order(count);
+	for (uint i = 0; i < count; i++)
+	{
+		const int col = (int) ((points[i].x - m_WorldExtents.left) / fTileWidth);
+		const int row = (int) ((m_WorldExtents.bottom - points[i].z) / fTileDepth);
+		order[i] = std::make_pair(row * cols + col, i);
+	}
+	std::sort(order.begin(), order.end());
+
+	int found = 0;
+	float fAltitude;
+	for (uint k = 0; k < count; k++)
+	{
+		FPoint3 &p3 = points[order[k].second];
+		if (vtTiledGeom::FindAltitudeAtPoint(p3, fAltitude, bTrue))
+		{
+			p3.y = fAltitude;
+			found++;
+		}
+	}
+	return found;
+}
+
 bool vtTiledGeom::CastRayToSurface(const FPoint3 &point, const FPoint3 &dir,
 	FPoint3 &result) const
 {
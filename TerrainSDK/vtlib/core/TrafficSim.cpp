@@ -0,0 +1,580 @@
+//
+// TrafficSim.cpp
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "vtlib/vtlib.h"
+#include "vtdata/vtLog.h"
+#include "TrafficSim.h"
+
+#include <algorithm>
+#include <map>
+
+// acceleration in meters per second^2
+#define TRAFFIC_ACCEL		3.0f
+
+// The vehicle index grid has at most this many cells on a side.
+#define MAX_GRID_CELLS		256
+#define MIN_CELL_SIZE		50.0f
+
+static FPoint3 XAXIS = FPoint3(1, 0, 0);
+
+// Simple linear congruential generator, so that each vehicle has its own
+//  repeatable sequence of choices.
+static inline uint NextRandom(uint &seed)
+{
+	seed = seed * 1664525 + 1013904223;
+	return seed >> 8;
+}
+
+/**
+ * Construct the simulation.  The lanes are taken from the road map, which
+ * must already have had its geometry generated.
+ */
+vtTrafficSim::vtTrafficSim(vtRoadMap3d *pRoadMap, vtHeightField3d *pHeightField)
+{
+	m_pRoadMap = pRoadMap;
+	m_pHeightField = pHeightField;
+	m_bSpinWheels = true;
+	m_fPrevTime = vtGetTime();
+	m_fGridX = m_fGridZ = 0.0f;
+	m_fCellSize = MIN_CELL_SIZE;
+	m_GridSize.Set(1, 1);
+
+	clock_t tm = clock();
+	BuildLanes();
+	VTLOG("vtTrafficSim: %d lanes, %d points, %.3f seconds\n",
+		(int) m_LaneLength.size(), (int) m_LanePoints.size(),
+		(float)(clock() - tm) / CLOCKS_PER_SEC);
+}
+
+void vtTrafficSim::BuildLanes()
+{
+	if (!m_pRoadMap)
+		return;
+
+	// Number the nodes
+	std::map<TNode*, int> node_index;
+	for (NodeGeom *pN = m_pRoadMap->GetFirstNode(); pN; pN = pN->GetNext())
+	{
+		const int index = (int) node_index.size();
+		node_index[pN] = index;
+	}
+
+	for (LinkGeom *pL = m_pRoadMap->GetFirstLink(); pL; pL = pL->GetNext())
+	{
+		if (pL->m_Surface == SURFT_TRAIL || pL->m_Surface == SURFT_RAILROAD)
+			continue;
+		if (pL->m_centerline.GetSize() < 2 || !pL->GetNode(0) || !pL->GetNode(1))
+			continue;
+
+		float fSpeed;	// meters per second
+		if (pL->m_iHwy > 0)
+			fSpeed = 25.0f;
+		else if (pL->m_Surface == SURFT_PAVED || pL->m_Surface == SURFT_STONE)
+			fSpeed = 13.0f;
+		else
+			fSpeed = 7.0f;
+
+		const int n0 = node_index[pL->GetNode(0)];
+		const int n1 = node_index[pL->GetNode(1)];
+
+		bool bForward = pL->GetFlag(RF_FORWARD) != 0;
+		bool bReverse = pL->GetFlag(RF_REVERSE) != 0;
+		if (!bForward && !bReverse)
+			bForward = bReverse = true;
+
+		const int iLanes = (int) pL->m_Lanes.size();
+		if (iLanes == 0 || pL->m_Lanes[0].GetSize() != pL->m_centerline.GetSize())
+		{
+			// No lane lines, drive down the middle
+			if (bForward)
+				AddLane(pL, pL->m_centerline, false, n0, n1, fSpeed);
+			if (bReverse)
+				AddLane(pL, pL->m_centerline, true, n1, n0, fSpeed);
+		}
+		else if (bForward && bReverse)
+		{
+			if (iLanes == 1)
+			{
+				AddLane(pL, pL->m_Lanes[0], false, n0, n1, fSpeed);
+				AddLane(pL, pL->m_Lanes[0], true, n1, n0, fSpeed);
+			}
+			else
+			{
+				// First half of the lanes go one way, second half the other
+				for (int i = 0; i < iLanes; i++)
+				{
+					if (i < iLanes / 2)
+						AddLane(pL, pL->m_Lanes[i], true, n1, n0, fSpeed);
+					else
+						AddLane(pL, pL->m_Lanes[i], false, n0, n1, fSpeed);
+				}
+			}
+		}
+		else
+		{
+			for (int i = 0; i < iLanes; i++)
+			{
+				if (bForward)
+					AddLane(pL, pL->m_Lanes[i], false, n0, n1, fSpeed);
+				else
+					AddLane(pL, pL->m_Lanes[i], true, n1, n0, fSpeed);
+			}
+		}
+	}
+
+	// Group the lanes by the node they start at
+	const uint iNodes = node_index.size();
+	const uint iLanes = m_LaneLength.size();
+	m_NodeFirstLane.assign(iNodes + 1, 0);
+	for (uint i = 0; i < iLanes; i++)
+		m_NodeFirstLane[m_LaneStartNode[i] + 1]++;
+	for (uint i = 0; i < iNodes; i++)
+		m_NodeFirstLane[i + 1] += m_NodeFirstLane[i];
+	m_NodeLanes.resize(iLanes);
+	std::vector<uint> fill(m_NodeFirstLane.begin(), m_NodeFirstLane.end() - 1);
+	for (uint i = 0; i < iLanes; i++)
+		m_NodeLanes[fill[m_LaneStartNode[i]]++] = i;
+
+	// Size the vehicle index grid to cover all the lanes
+	if (m_LanePoints.empty())
+		return;
+	FPoint2 lo = m_LanePoints[0], hi = m_LanePoints[0];
+	for (uint i = 1; i < m_LanePoints.size(); i++)
+	{
+		const FPoint2 &p = m_LanePoints[i];
+		if (p.x < lo.x) lo.x = p.x;
+		if (p.y < lo.y) lo.y = p.y;
+		if (p.x > hi.x) hi.x = p.x;
+		if (p.y > hi.y) hi.y = p.y;
+	}
+	const float fExtent = std::max(hi.x - lo.x, hi.y - lo.y);
+	m_fCellSize = std::max(MIN_CELL_SIZE, fExtent / MAX_GRID_CELLS);
+	m_fGridX = lo.x;
+	m_fGridZ = lo.y;
+	m_GridSize.x = (int) ((hi.x - lo.x) / m_fCellSize) + 1;
+	m_GridSize.y = (int) ((hi.y - lo.y) / m_fCellSize) + 1;
+}
+
+void vtTrafficSim::AddLane(LinkGeom *pLink, const FLine3 &line, bool bReverse,
+	int iStartNode, int iEndNode, float fSpeed)
+{
+	const uint size = line.GetSize();
+	const uint first = m_LanePoints.size();
+	float fLength = 0.0f;
+	for (uint j = 0; j < size; j++)
+	{
+		const FPoint3 &p = line[bReverse ? size - 1 - j : j];
+		const FPoint2 p2(p.x, p.z);
+		if (j > 0)
+			fLength += (p2 - m_LanePoints.back()).Length();
+		m_LanePoints.push_back(p2);
+		m_LaneDist.push_back(fLength);
+	}
+	if (fLength < 0.01f)
+	{
+		// Degenerate; don't use it
+		m_LanePoints.resize(first);
+		m_LaneDist.resize(first);
+		return;
+	}
+	m_LaneFirst.push_back(first);
+	m_LaneCount.push_back(size);
+	m_LaneStartNode.push_back(iStartNode);
+	m_LaneEndNode.push_back(iEndNode);
+	m_LaneLink.push_back(pLink);
+	m_LaneLength.push_back(fLength);
+	m_LaneSpeed.push_back(fSpeed);
+}
+
+/**
+ * Add a vehicle to the simulation.  It is placed at a random point on a
+ * random lane.
+ *
+ * \param pVehicle The vehicle, which should already be in the scene graph,
+ *	 with no transform above it.
+ * \param fSpeedFactor Multiplies the speed at which the vehicle drives, so
+ *	 that different vehicles can have different speeds.
+ * \return The index of the vehicle, or -1 if there are no lanes.
+ */
+int vtTrafficSim::AddVehicle(Vehicle *pVehicle, float fSpeedFactor)
+{
+	if (!HasLanes() || !pVehicle->m_pFrontLeft || !pVehicle->m_pFrontRight ||
+		!pVehicle->m_pRearLeft || !pVehicle->m_pRearRight)
+		return -1;
+
+	const int i = (int) m_Vehicles.size();
+	m_Vehicles.push_back(pVehicle);
+	m_Lane.push_back(0);
+	m_Segment.push_back(0);
+	m_Dist.push_back(0.0f);
+	m_Speed.push_back(0.0f);
+	m_SpeedFactor.push_back(fSpeedFactor);
+	m_Seed.push_back(i * 2654435761U + 1);
+	m_Moving.push_back(1);
+	m_Pos.push_back(FPoint3(0,0,0));
+	m_Dir.push_back(FPoint2(1,0));
+	m_Travelled.push_back(0.0f);
+	m_Matrix.push_back(osg::Matrix::identity());
+
+	// Measure the wheel positions, with the vehicle in its default pose
+	//  (forward is -Z).
+	pVehicle->Identity();
+	FSphere fL, fR, rL, rR;
+	pVehicle->m_pFrontLeft->GetBoundSphere(fL, true);
+	pVehicle->m_pFrontRight->GetBoundSphere(fR, true);
+	pVehicle->m_pRearLeft->GetBoundSphere(rL, true);
+	pVehicle->m_pRearRight->GetBoundSphere(rR, true);
+	float fFront = -(fL.center.z + fR.center.z) / 2;
+	float fRear = (rL.center.z + rR.center.z) / 2;
+	float fHalfTrack = (fR.center.x - fL.center.x + rR.center.x - rL.center.x) / 4;
+	if (fFront + fRear < 0.1f || fHalfTrack < 0.05f)
+	{
+		// Can't tell, guess the size of a typical car
+		fFront = fRear = 1.3f;
+		fHalfTrack = 0.75f;
+	}
+	m_Front.push_back(fFront);
+	m_Rear.push_back(fRear);
+	m_HalfTrack.push_back(fHalfTrack);
+
+	uint &seed = m_Seed[i];
+	const int lane = NextRandom(seed) % m_LaneLength.size();
+	const float fDist = (NextRandom(seed) & 0xffff) / 65536.0f * m_LaneLength[lane];
+	PlaceOnLane(i, lane, fDist);
+
+	return i;
+}
+
+void vtTrafficSim::PlaceOnLane(int i, int lane, float fDist)
+{
+	const uint first = m_LaneFirst[lane];
+	const uint count = m_LaneCount[lane];
+	uint seg = 0;
+	while (seg + 2 < count && m_LaneDist[first + seg + 1] < fDist)
+		seg++;
+
+	const FPoint2 &p0 = m_LanePoints[first + seg];
+	const FPoint2 &p1 = m_LanePoints[first + seg + 1];
+	const float d0 = m_LaneDist[first + seg];
+	const float fSegLen = m_LaneDist[first + seg + 1] - d0;
+	FPoint2 dir = p1 - p0;
+	if (fSegLen > 0.0f)
+		dir /= fSegLen;
+	else
+		dir = m_Dir[i];
+	const FPoint2 p = p0 + dir * (fDist - d0);
+
+	m_Lane[i] = lane;
+	m_Segment[i] = seg;
+	m_Dist[i] = fDist;
+	m_Pos[i].x = p.x;
+	m_Pos[i].z = p.y;
+	m_Dir[i] = dir;
+}
+
+/**
+ * Pick the lane to take after reaching the end of the current lane.  Turning
+ * back down the same link is only done at a dead end.
+ */
+int vtTrafficSim::ChooseNextLane(int i, int lane)
+{
+	const int node = m_LaneEndNode[lane];
+	const uint first = m_NodeFirstLane[node];
+	const uint count = m_NodeFirstLane[node + 1] - first;
+	if (count == 0)
+		return lane;	// Nowhere to go; start the same lane again
+
+	LinkGeom *pLink = m_LaneLink[lane];
+	uint others = 0;
+	for (uint j = 0; j < count; j++)
+		if (m_LaneLink[m_NodeLanes[first + j]] != pLink)
+			others++;
+
+	uint choice = NextRandom(m_Seed[i]) % (others ? others : count);
+	for (uint j = 0; j < count; j++)
+	{
+		const int next = m_NodeLanes[first + j];
+		if (others && m_LaneLink[next] == pLink)
+			continue;
+		if (choice == 0)
+			return next;
+		choice--;
+	}
+	return lane;
+}
+
+void vtTrafficSim::SetVehicleEnabled(int i, bool bEnabled)
+{
+	m_Moving[i] = bEnabled ? 1 : 0;
+	if (!bEnabled)
+		m_Speed[i] = 0.0f;
+}
+
+/**
+ * Move each vehicle along its lanes, for the given amount of time.
+ */
+void vtTrafficSim::Advance(float fDeltaTime)
+{
+	const int size = (int) m_Vehicles.size();
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < size; i++)
+	{
+		if (!m_Moving[i])
+			continue;
+
+		int lane = m_Lane[i];
+
+		// Approach the speed of the lane
+		const float fTarget = m_LaneSpeed[lane] * m_SpeedFactor[i];
+		const float fMaxChange = TRAFFIC_ACCEL * fDeltaTime;
+		float fSpeed = m_Speed[i];
+		if (fSpeed < fTarget)
+			fSpeed = std::min(fTarget, fSpeed + fMaxChange);
+		else
+			fSpeed = std::max(fTarget, fSpeed - fMaxChange);
+		m_Speed[i] = fSpeed;
+
+		const float fMove = fSpeed * fDeltaTime;
+		float fDist = m_Dist[i] + fMove;
+		uint seg = m_Segment[i];
+		while (fDist >= m_LaneLength[lane])
+		{
+			fDist -= m_LaneLength[lane];
+			lane = ChooseNextLane(i, lane);
+			seg = 0;
+		}
+
+		// Advance the current segment
+		const uint first = m_LaneFirst[lane];
+		const uint count = m_LaneCount[lane];
+		while (seg + 2 < count && m_LaneDist[first + seg + 1] < fDist)
+			seg++;
+
+		const FPoint2 &p0 = m_LanePoints[first + seg];
+		const FPoint2 &p1 = m_LanePoints[first + seg + 1];
+		const float d0 = m_LaneDist[first + seg];
+		const float fSegLen = m_LaneDist[first + seg + 1] - d0;
+		if (fSegLen > 0.0f)
+			m_Dir[i] = (p1 - p0) / fSegLen;
+		const FPoint2 p = p0 + m_Dir[i] * (fDist - d0);
+
+		m_Lane[i] = lane;
+		m_Segment[i] = seg;
+		m_Dist[i] = fDist;
+		m_Pos[i].x = p.x;
+		m_Pos[i].z = p.y;
+		m_Travelled[i] += fMove;
+	}
+}
+
+/**
+ * Find the ground height under the wheels of each vehicle, and from that,
+ * the transform of each vehicle.  The heightfield is asked for all the
+ * ground points in one batch, from this thread, since it may not be safe
+ * to query from several threads (such as vtTiledGeom).
+ */
+void vtTrafficSim::SampleGround()
+{
+	const int size = (int) m_Vehicles.size();
+	const float fOffset = m_pRoadMap->GetHeightOffGround();
+	int i;
+
+	// The four points on the ground: front, rear, left, right
+	m_Ground.resize(size * 4);
+#pragma omp parallel for schedule(static)
+	for (i = 0; i < size; i++)
+	{
+		const FPoint3 &c = m_Pos[i];
+		const FPoint3 forward(m_Dir[i].x, 0, m_Dir[i].y);
+		const FPoint3 right(-m_Dir[i].y, 0, m_Dir[i].x);
+
+		FPoint3 *ground = &m_Ground[i * 4];
+		ground[0] = c + forward * m_Front[i];
+		ground[1] = c - forward * m_Rear[i];
+		ground[2] = c - right * m_HalfTrack[i];
+		ground[3] = c + right * m_HalfTrack[i];
+	}
+	m_pHeightField->FindAltitudesAtPoints(&m_Ground[0], size * 4);
+
+#pragma omp parallel for schedule(static)
+	for (i = 0; i < size; i++)
+	{
+		const FPoint3 *ground = &m_Ground[i * 4];
+		const FPoint3 &f = ground[0];
+		const FPoint3 &r = ground[1];
+		const FPoint3 &left = ground[2];
+		const FPoint3 &rt = ground[3];
+
+		// Vehicle axes, in the convention that forward is -Z
+		FPoint3 F = f - r;
+		F.Normalize();
+		FPoint3 R = rt - left;
+		FPoint3 U = R.Cross(F);
+		U.Normalize();
+		R = F.Cross(U);
+
+		FPoint3 &pos = m_Pos[i];
+		pos.y = (f.y + r.y) / 2 + fOffset;
+
+		m_Matrix[i].set(R.x, R.y, R.z, 0,
+						U.x, U.y, U.z, 0,
+						-F.x, -F.y, -F.z, 0,
+						pos.x, pos.y, pos.z, 1);
+	}
+}
+
+/**
+ * Write the results back to the scene graph, in a single pass.
+ */
+void vtTrafficSim::ApplyTransforms()
+{
+	const int size = (int) m_Vehicles.size();
+	for (int i = 0; i < size; i++)
+	{
+		Vehicle *car = m_Vehicles[i].get();
+		car->setMatrix(m_Matrix[i]);
+
+		if (m_bSpinWheels && m_Travelled[i] != 0.0f)
+		{
+			const float radians = m_Travelled[i] / car->GetWheelRadius();
+			car->m_pFrontLeft->RotateLocal(XAXIS, -radians);
+			car->m_pFrontRight->RotateLocal(XAXIS, -radians);
+			car->m_pRearLeft->RotateLocal(XAXIS, -radians);
+			car->m_pRearRight->RotateLocal(XAXIS, -radians);
+		}
+		m_Travelled[i] = 0.0f;
+	}
+}
+
+IPoint2 vtTrafficSim::CellOf(float x, float z) const
+{
+	int cx = (int) ((x - m_fGridX) / m_fCellSize);
+	int cz = (int) ((z - m_fGridZ) / m_fCellSize);
+	if (cx < 0) cx = 0;
+	if (cz < 0) cz = 0;
+	if (cx >= m_GridSize.x) cx = m_GridSize.x - 1;
+	if (cz >= m_GridSize.y) cz = m_GridSize.y - 1;
+	return IPoint2(cx, cz);
+}
+
+/**
+ * Sort the vehicles into the cells of the grid (a counting sort).
+ */
+void vtTrafficSim::UpdateIndex()
+{
+	const int size = (int) m_Vehicles.size();
+	const uint cells = m_GridSize.x * m_GridSize.y;
+	m_CellFirst.assign(cells + 1, 0);
+
+	std::vector<uint> cell_of(size);
+	for (int i = 0; i < size; i++)
+	{
+		const IPoint2 c = CellOf(m_Pos[i].x, m_Pos[i].z);
+		cell_of[i] = c.y * m_GridSize.x + c.x;
+		m_CellFirst[cell_of[i] + 1]++;
+	}
+	for (uint c = 0; c < cells; c++)
+		m_CellFirst[c + 1] += m_CellFirst[c];
+
+	m_CellVehicles.resize(size);
+	std::vector<uint> fill(m_CellFirst.begin(), m_CellFirst.end() - 1);
+	for (int i = 0; i < size; i++)
+		m_CellVehicles[fill[cell_of[i]]++] = i;
+}
+
+/**
+ * Find the vehicle closest to a point.
+ *
+ * \param point The point, in world coordinates.
+ * \param fMaxDistance Vehicles farther than this are ignored.
+ * \param closest Receives the distance to the closest vehicle.
+ * \return The index of the closest vehicle, or -1 if there is none within
+ *	 fMaxDistance.
+ */
+int vtTrafficSim::FindClosestVehicle(const FPoint3 &point, float fMaxDistance,
+	float &closest) const
+{
+	closest = fMaxDistance;
+	int vehicle = -1;
+	const int size = (int) m_Vehicles.size();
+
+	if ((int) m_CellVehicles.size() != size)
+	{
+		// The index isn't up to date yet, just look at them all
+		for (int i = 0; i < size; i++)
+		{
+			const float dist = (point - m_Pos[i]).Length();
+			if (dist < closest)
+			{
+				closest = dist;
+				vehicle = i;
+			}
+		}
+		return vehicle;
+	}
+
+	// Look in rings of cells around the point, until the next ring can't
+	//  contain anything closer.
+	const IPoint2 center = CellOf(point.x, point.z);
+	const int iGridRings = std::max(m_GridSize.x, m_GridSize.y);
+	const int iMaxRing = (fMaxDistance / m_fCellSize < iGridRings) ?
+		(int) (fMaxDistance / m_fCellSize) + 1 : iGridRings;
+	for (int ring = 0; ring <= iMaxRing; ring++)
+	{
+		for (int cz = center.y - ring; cz <= center.y + ring; cz++)
+		{
+			if (cz < 0 || cz >= m_GridSize.y)
+				continue;
+			const bool edge = (cz == center.y - ring || cz == center.y + ring);
+			for (int cx = center.x - ring; cx <= center.x + ring;
+				cx += (edge || ring == 0) ? 1 : ring * 2)
+			{
+				if (cx < 0 || cx >= m_GridSize.x)
+					continue;
+				const uint cell = cz * m_GridSize.x + cx;
+				for (uint j = m_CellFirst[cell]; j < m_CellFirst[cell + 1]; j++)
+				{
+					const int i = m_CellVehicles[j];
+					const float dist = (point - m_Pos[i]).Length();
+					if (dist < closest)
+					{
+						closest = dist;
+						vehicle = i;
+					}
+				}
+			}
+		}
+		if (vehicle != -1 && closest <= ring * m_fCellSize)
+			break;
+	}
+	return vehicle;
+}
+
+void vtTrafficSim::Eval()
+{
+	const float t = vtGetTime();
+	float fDeltaTime = t - m_fPrevTime;
+	m_fPrevTime = t;
+
+	// Don't get too jumpy on low framerate, such as when the program is paused
+	if (fDeltaTime > 1.0f)
+		fDeltaTime = 1.0f;
+
+	if (m_Vehicles.empty())
+		return;
+
+	Advance(fDeltaTime);
+	SampleGround();
+	ApplyTransforms();
+	UpdateIndex();
+}
+
+void vtTrafficSim::IgnoreElapsedTime()
+{
+	m_fPrevTime = vtGetTime();
+}
@@ -0,0 +1,136 @@
+//
+// TrafficSim.h
+//
+// Copyright (c) 2013 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef TRAFFICSIMH
+#define TRAFFICSIMH
+
+#include "vtdata/HeightField.h"
+#include "Engine.h"
+#include "Roads.h"
+#include "Vehicles.h"
+
+/** \addtogroup transp */
+/*@{*/
+
+/**
+ * A simple traffic simulation, which drives a large number of vehicles
+ * along the lanes of a vtRoadMap3d.
+ *
+ * Unlike CarEngine, which is one engine per vehicle, this is a single engine
+ * for all the vehicles.  The state of the vehicles is kept in parallel
+ * arrays, and each frame is evaluated in passes over all of them: advance
+ * along the lanes, sample the ground under the wheels, then write the
+ * transforms.  The first two passes are multithreaded (if VTP_USE_OPENMP),
+ * except for the ground heights, which are found in one batch.
+ *
+ * At the end of each lane, a vehicle picks one of the lanes which leave the
+ * node it has arrived at, at random.  Vehicles don't interact with each
+ * other.
+ *
+ * Example:
+ \code
+	vtTrafficSim *sim = new vtTrafficSim(pTerr->GetRoadMap(), pTerr->GetHeightField());
+	for (int i = 0; i < 1000; i++)
+	{
+		Vehicle *car = manager.CreateVehicle("Hatchback", color);
+		pTerr->addNode(car);
+		sim->AddVehicle(car);
+	}
+	pTerr->AddEngine(sim);
+ \endcode
+ */
+class vtTrafficSim : public vtEngine
+{
+public:
+	vtTrafficSim(vtRoadMap3d *pRoadMap, vtHeightField3d *pHeightField);
+
+	bool HasLanes() const { return !m_LaneLength.empty(); }
+
+	int AddVehicle(Vehicle *pVehicle, float fSpeedFactor = 1.0f);
+	int NumVehicles() const { return (int) m_Vehicles.size(); }
+	Vehicle *GetVehicle(int i) const { return m_Vehicles[i].get(); }
+	const FPoint3 &GetVehiclePos(int i) const { return m_Pos[i]; }
+
+	void SetVehicleEnabled(int i, bool bEnabled);
+	bool GetVehicleEnabled(int i) const { return m_Moving[i] != 0; }
+
+	/// Set whether to spin the wheels of the vehicles as they move (default true).
+	void SetSpinWheels(bool bOn) { m_bSpinWheels = bOn; }
+	bool GetSpinWheels() const { return m_bSpinWheels; }
+
+	int FindClosestVehicle(const FPoint3 &point, float fMaxDistance, float &closest) const;
+
+	void Eval();
+	void IgnoreElapsedTime();
+
+protected:
+	void BuildLanes();
+	void AddLane(LinkGeom *pLink, const FLine3 &line, bool bReverse,
+		int iStartNode, int iEndNode, float fSpeed);
+	void PlaceOnLane(int i, int lane, float fDist);
+	int ChooseNextLane(int i, int lane);
+
+	void Advance(float fDeltaTime);
+	void SampleGround();
+	void ApplyTransforms();
+	void UpdateIndex();
+	IPoint2 CellOf(float x, float z) const;
+
+	vtRoadMap3d *m_pRoadMap;
+	vtHeightField3d *m_pHeightField;
+
+	// Lanes, flattened.  Each lane is a polyline in the direction of travel.
+	std::vector<uint> m_LaneFirst;		// index of first point
+	std::vector<uint> m_LaneCount;		// number of points
+	std::vector<int> m_LaneStartNode;
+	std::vector<int> m_LaneEndNode;
+	std::vector<LinkGeom*> m_LaneLink;
+	std::vector<float> m_LaneLength;
+	std::vector<float> m_LaneSpeed;		// meters per second
+	std::vector<FPoint2> m_LanePoints;	// (x, z)
+	std::vector<float> m_LaneDist;		// distance along the lane to each point
+
+	// The lanes which leave each node, in compressed row form.
+	std::vector<uint> m_NodeFirstLane;
+	std::vector<int> m_NodeLanes;
+
+	// Vehicles
+	std::vector<osg::ref_ptr<Vehicle> > m_Vehicles;
+	std::vector<int> m_Lane;
+	std::vector<uint> m_Segment;		// current segment of the lane
+	std::vector<float> m_Dist;			// distance along the lane
+	std::vector<float> m_Speed;
+	std::vector<float> m_SpeedFactor;
+	std::vector<uint> m_Seed;
+	std::vector<uchar> m_Moving;
+	std::vector<FPoint3> m_Pos;
+	std::vector<FPoint2> m_Dir;			// unit heading, in (x, z)
+	std::vector<float> m_Travelled;		// since the wheels were last turned
+	// Vehicle dimensions: distance from the center to the front and rear
+	//  axles, and half the distance between the left and right wheels.
+	std::vector<float> m_Front, m_Rear, m_HalfTrack;
+
+	// The ground points under the wheels, four per vehicle, and the
+	//  transform for each vehicle, computed by SampleGround
+	std::vector<FPoint3> m_Ground;
+	std::vector<osg::Matrix> m_Matrix;
+
+	// Spatial index of the vehicles: a uniform grid, in compressed row form.
+	float m_fGridX, m_fGridZ;	// corner of the grid
+	float m_fCellSize;
+	IPoint2 m_GridSize;
+	std::vector<uint> m_CellFirst;
+	std::vector<int> m_CellVehicles;
+
+	float m_fPrevTime;
+	bool m_bSpinWheels;
+};
+typedef osg::ref_ptr<vtTrafficSim> vtTrafficSimPtr;
+
+/*@}*/  // transp
+
+#endif // TRAFFICSIMH
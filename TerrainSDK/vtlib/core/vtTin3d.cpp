@@ -16,15 +16,22 @@
 #include "SurfaceTexture.h"		// For LoadColorMap
 #include "Light.h"
 
+#include <algorithm>	// for std::sort
+
 // We will split the TIN into chunks of geometry, each with no more than this many vertices.
-const int kMaxChunkVertices = 10000;
+//  Meshes use 32-bit indices, so this can be well over 65536.
+const uint kMaxChunkVertices = 131072;
+// The number of chunks (or groups of chunks) under each group of the culling hierarchy.
+const uint kChunkGroupSize = 4;
+// The size of the post-transform vertex cache that triangles are ordered for.
+const int kVertexCacheSize = 32;
 const int kColorMapTableSize = 8192;
 
 
 vtTin3d::vtTin3d()
 {
 	m_pMats = NULL;
-	m_pGeode = NULL;
+	m_pGroup = NULL;
 	m_pDropGeode = NULL;
 	m_pColorMap = NULL;
 }
@@ -202,17 +209,239 @@ vtMaterial *vtTin3d::GetSurfaceMaterial()
 	return NULL;
 }
 
-vtGeode *vtTin3d::CreateGeometry(bool bDropShadowMesh)
+/**
+ * Interleave the bits of two 16-bit values, giving a 32-bit Morton code.
+ */
+static uint MortonCode(uint x, uint y)
+{
+	x &= 0xffff;
+	x = (x | (x << 8)) & 0x00ff00ff;
+	x = (x | (x << 4)) & 0x0f0f0f0f;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+
+	y &= 0xffff;
+	y = (y | (y << 8)) & 0x00ff00ff;
+	y = (y | (y << 4)) & 0x0f0f0f0f;
+	y = (y | (y << 2)) & 0x33333333;
+	y = (y | (y << 1)) & 0x55555555;
+
+	return x | (y << 1);
+}
+
+// Scoring for OptimizeVertexCache
+static float VertexCacheScore(int cache_pos, int remaining)
+{
+	if (remaining == 0)
+		return -1.0f;	// No triangles left which use this vertex
+
+	float score = 0.0f;
+	if (cache_pos >= 0)
+	{
+		if (cache_pos < 3)
+		{
+			// Used by the last triangle; a fixed score so that the next
+			//  triangle doesn't simply reuse the same edge every time.
+			score = 0.75f;
+		}
+		else
+		{
+			const float scaler = 1.0f / (kVertexCacheSize - 3);
+			score = powf(1.0f - (cache_pos - 3) * scaler, 1.5f);
+		}
+	}
+	// Favor vertices with few triangles left, to finish them off
+	score += 2.0f * powf((float) remaining, -0.5f);
+	return score;
+}
+
+/**
+ * Reorder a list of triangles so that the GPU's post-transform vertex cache
+ * is used well.  This is Tom Forsyth's "Linear-Speed Vertex Cache
+ * Optimisation": triangles are added greedily, choosing each time the one
+ * whose vertices score highest, based on where they are in a simulated LRU
+ * cache and how many of their triangles remain.
+ *
+ * \param indices Three vertex indices per triangle; reordered in place.
+ * \param num_verts The number of vertices the indices refer to.
+ */
+static void OptimizeVertexCache(std::vector<uint> &indices, uint num_verts)
+{
+	const uint num_tris = indices.size() / 3;
+	if (num_tris < 2)
+		return;
+
+	uint i, k;
+
+	// The triangles which use each vertex
+	std::vector<uint> tri_start(num_verts + 1, 0);
+	for (i = 0; i < indices.size(); i++)
+		tri_start[indices[i] + 1]++;
+	for (i = 0; i < num_verts; i++)
+		tri_start[i + 1] += tri_start[i];
+	std::vector<uint> vert_tris(indices.size());
+	std::vector<uint> fill(tri_start.begin(), tri_start.end() - 1);
+	for (i = 0; i < indices.size(); i++)
+		vert_tris[fill[indices[i]]++] = i / 3;
+
+	std::vector<int> remaining(num_verts);
+	std::vector<int> cache_pos(num_verts, -1);
+	std::vector<float> vert_score(num_verts);
+	for (i = 0; i < num_verts; i++)
+	{
+		remaining[i] = tri_start[i + 1] - tri_start[i];
+		vert_score[i] = VertexCacheScore(-1, remaining[i]);
+	}
+	std::vector<float> tri_score(num_tris);
+	std::vector<bool> tri_added(num_tris, false);
+	int best = 0;
+	for (i = 0; i < num_tris; i++)
+	{
+		tri_score[i] = vert_score[indices[i*3]] + vert_score[indices[i*3+1]] +
+			vert_score[indices[i*3+2]];
+		if (tri_score[i] > tri_score[best])
+			best = i;
+	}
+
+	std::vector<uint> output;
+	output.reserve(indices.size());
+
+	// The cache holds vertices in LRU order; it has room for the three
+	//  vertices of the new triangle to push in at the front.
+	uint cache[kVertexCacheSize + 3], new_cache[kVertexCacheSize + 3];
+	int cache_used = 0;
+	uint next_unadded = 0;
+
+	while (output.size() < indices.size())
+	{
+		if (best == -1)
+		{
+			// Nothing in the cache has triangles left; start elsewhere
+			while (tri_added[next_unadded])
+				next_unadded++;
+			best = next_unadded;
+		}
+		tri_added[best] = true;
+
+		int used = 0;
+		for (k = 0; k < 3; k++)
+		{
+			const uint v = indices[best*3+k];
+			output.push_back(v);
+			remaining[v]--;
+			new_cache[used++] = v;
+		}
+		for (int c = 0; c < cache_used; c++)
+		{
+			const uint v = cache[c];
+			if (v != new_cache[0] && v != new_cache[1] && v != new_cache[2])
+				new_cache[used++] = v;
+		}
+
+		// Update the scores of everything which was in, or entered, the cache
+		for (int c = 0; c < used; c++)
+		{
+			const uint v = new_cache[c];
+			cache_pos[v] = (c < kVertexCacheSize) ? c : -1;
+			vert_score[v] = VertexCacheScore(cache_pos[v], remaining[v]);
+		}
+		best = -1;
+		float best_score = -1.0f;
+		for (int c = 0; c < used; c++)
+		{
+			const uint v = new_cache[c];
+			for (i = tri_start[v]; i < tri_start[v + 1]; i++)
+			{
+				const uint t = vert_tris[i];
+				if (tri_added[t])
+					continue;
+				tri_score[t] = vert_score[indices[t*3]] +
+					vert_score[indices[t*3+1]] + vert_score[indices[t*3+2]];
+				if (tri_score[t] > best_score)
+				{
+					best_score = tri_score[t];
+					best = t;
+				}
+			}
+		}
+		cache_used = (used < kVertexCacheSize) ? used : kVertexCacheSize;
+		for (int c = 0; c < cache_used; c++)
+			cache[c] = new_cache[c];
+	}
+	indices.swap(output);
+}
+
+/**
+ * Create a mesh for a chunk of triangles, with vertices shared between
+ * triangles.  The triangles are reordered for the vertex cache, and the
+ * vertices are stored in the order in which the triangles first use them.
+ *
+ * \param local A table with an entry for each vertex of the TIN, all -1.
+ *		It is used as scratch space, and left as it was found.
+ */
+vtMesh *vtTin3d::MakeIndexedChunk(const int *tris, uint num_tris,
+	int vert_type, std::vector<int> &local)
+{
+	uint i, k;
+
+	// Give each vertex which the chunk uses a temporary index
+	std::vector<int> verts;
+	std::vector<uint> indices(num_tris * 3);
+	for (i = 0; i < num_tris; i++)
+	{
+		for (k = 0; k < 3; k++)
+		{
+			const int v = m_tri[tris[i] * 3 + k];
+			if (local[v] == -1)
+			{
+				local[v] = verts.size();
+				verts.push_back(v);
+			}
+			indices[i*3+k] = local[v];
+		}
+	}
+	OptimizeVertexCache(indices, verts.size());
+
+	for (i = 0; i < verts.size(); i++)
+		local[verts[i]] = -1;
+
+	vtMesh *pMesh = new vtMesh(osg::PrimitiveSet::TRIANGLES, vert_type, verts.size());
+	DPoint3 ep;
+	FPoint3 wp;
+	for (i = 0; i < indices.size(); i++)
+	{
+		const int v = verts[indices[i]];
+		if (local[v] == -1)
+		{
+			ep.Set(m_vert[v].x, m_vert[v].y, m_z[v]);
+			m_LocalCS.EarthToLocal(ep, wp);
+			local[v] = pMesh->AddVertexN(wp, m_vert_normal[v]);
+		}
+		indices[i] = local[v];
+	}
+	for (i = 0; i < num_tris; i++)
+		pMesh->AddTri(indices[i*3], indices[i*3+1], indices[i*3+2]);
+
+	for (i = 0; i < verts.size(); i++)
+		local[verts[i]] = -1;
+
+	return pMesh;
+}
+
+vtGroup *vtTin3d::CreateGeometry(bool bDropShadowMesh)
 {
 	VTLOG1("vtTin3d::CreateGeometry\n");
+	clock_t c1 = clock();
 
 	uint iSurfTypes = m_surftypes.size();
 	bool bUseSurfaceTypes = (m_surfidx.size() > 0 && iSurfTypes > 0);
 	bool bExplicitNormals = HasVertexNormals();
-	bool bUseVertexColors = !bUseSurfaceTypes;
 
-	m_pGeode = new vtGeode;
-	m_pGeode->SetMaterials(m_pMats);
+	// Vertices can be shared between triangles only when they have a normal
+	//  of their own; otherwise each triangle has its own face normal.
+	bool bShareVertices = bExplicitNormals && !bUseSurfaceTypes;
+
+	m_pGroup = new vtGroup;
 
 	if (bUseSurfaceTypes)
 	{
@@ -233,64 +462,60 @@ vtGeode *vtTin3d::CreateGeometry(bool bDropShadowMesh)
 	rect.Grow(0.000001, 0.000001);
 
 	const DPoint2 EarthSize = rect.SizeExtents();
-
-	int divx, divy;		// number of x and y divisions
-	uint dsize = 0;
-	Bin *bins = NULL;
-	uint tris = NumTris();
-	vtArray<vtMesh *> pTypeMeshes;
-
+	const uint tris = NumTris();
 	uint i, j, k;
-	int divs = 4;
-	bool acceptable = false;
-	while (!acceptable)
+
+	// Sort the triangles along a Morton (Z-order) curve through their
+	//  centers, so that any run of consecutive triangles is compact.
+	std::vector< std::pair<uint, int> > order(tris);
+	for (i = 0; i < tris; i++)
 	{
-		// Take the smaller dimension and split it to ensure a minimum level
-		// of subdivision, with the larger dimension proportional
-		if (EarthSize.x < EarthSize.y)
-		{
-			divx = divs;
-			divy = (int) (divx * EarthSize.y / EarthSize.x);
-		}
-		else
+		j = i * 3;
+		const DPoint2 &gp = (m_vert[m_tri[j]] + m_vert[m_tri[j+1]] + m_vert[m_tri[j+2]]) / 3;
+		const uint qx = (uint) (65535 * (gp.x - rect.left) / EarthSize.x);
+		const uint qy = (uint) (65535 * (gp.y - rect.bottom) / EarthSize.y);
+		order[i].first = MortonCode(qx, qy);
+		order[i].second = i;
+	}
+	std::sort(order.begin(), order.end());
+	std::vector<int> sorted(tris);
+	for (i = 0; i < tris; i++)
+		sorted[i] = order[i].second;
+	order.clear();
+
+	// Split that sequence into chunks with no more than kMaxChunkVertices.
+	std::vector<int> local(bShareVertices ? NumVerts() : 0, -1);
+	std::vector<uint> chunk_start;
+	uint chunk_verts = 0;
+	for (i = 0; i < tris; i++)
+	{
+		const int tribase = sorted[i] * 3;
+		uint needed = 3;
+		if (bShareVertices)
 		{
-			divy = divs;
-			divx = (int) (divy * EarthSize.x / EarthSize.y);
+			// Count the vertices which aren't in this chunk yet
+			const int chunk = (int) chunk_start.size() - 1;
+			needed = 0;
+			for (k = 0; k < 3; k++)
+				if (local[m_tri[tribase + k]] != chunk)
+					needed++;
 		}
-
-		// Create a 2D array of Bins
-		dsize = divx*divy;
-		bins = new Bin[dsize];
-
-		// See how many triangles would go into each bin
-		uint most = 0;
-		for (i = 0; i < tris; i++)
+		if (i == 0 || chunk_verts + needed > kMaxChunkVertices)
 		{
-			j = i * 3;
-			const DPoint2 &gp = (m_vert[m_tri[j]] + m_vert[m_tri[j+1]] + m_vert[m_tri[j+2]]) / 3;
-			const int bx = (int) (divx * (gp.x - rect.left) / EarthSize.x);
-			const int by = (int) (divy * (gp.y - rect.bottom) / EarthSize.y);
-
-			Bin &bref = bins[bx * divy + by];
-			bref.push_back(i);
-			const uint newsize = bref.size();
-			if (newsize > most)
-				most = newsize;
+			chunk_start.push_back(i);
+			chunk_verts = 0;
+			needed = 3;
 		}
-		if (most > kMaxChunkVertices)
+		if (bShareVertices)
 		{
-			// Too many in one bin, increase the divisions and try again.
-			delete [] bins;
-			divs = divs * 3 / 2;
+			for (k = 0; k < 3; k++)
+				local[m_tri[tribase + k]] = (int) chunk_start.size() - 1;
 		}
-		else
-			acceptable = true;
+		chunk_verts += needed;
 	}
+	chunk_start.push_back(tris);
+	std::fill(local.begin(), local.end(), -1);
 
-	FPoint3 light_dir(0.5, 1, 0);
-	light_dir.Normalize();
-
-	uint in_bin;
 	int tri, vidx;
 
 	// If the material is textured, it will use TexGen so we don't need texture
@@ -302,12 +527,28 @@ vtGeode *vtTin3d::CreateGeometry(bool bDropShadowMesh)
 	// We always have normals for lighting
 	vert_type |= VT_Normals;
 
-	for (i = 0; i < dsize; i++)
+	std::vector<osg::Node*> nodes;
+	vtArray<vtMesh *> pTypeMeshes;
+	uint total_verts = 0, draw_calls = 0;
+	const uint chunks = chunk_start.size() - 1;
+	for (uint c = 0; c < chunks; c++)
 	{
-		Bin &bref = bins[i];
-		in_bin = bref.size();
-		if (!in_bin)
+		const uint first = chunk_start[c];
+		const uint in_chunk = chunk_start[c+1] - first;
+
+		vtGeode *geode = new vtGeode;
+		geode->SetMaterials(m_pMats);
+		nodes.push_back(geode);
+
+		if (bShareVertices)
+		{
+			vtMesh *pMesh = MakeIndexedChunk(&sorted[first], in_chunk, vert_type, local);
+			geode->AddMesh(pMesh, m_MatIndex);
+			m_Meshes.Append(pMesh);
+			total_verts += pMesh->NumVertices();
+			draw_calls++;
 			continue;
+		}
 
 		vtMesh *pMesh = NULL;
 		if (bUseSurfaceTypes)
@@ -318,13 +559,13 @@ vtGeode *vtTin3d::CreateGeometry(bool bDropShadowMesh)
 		}
 		else
 		{
-			// simple case: this whole bin goes into one mesh
-			pMesh = new vtMesh(osg::PrimitiveSet::TRIANGLES, vert_type, in_bin * 3);
+			// simple case: this whole chunk goes into one mesh
+			pMesh = new vtMesh(osg::PrimitiveSet::TRIANGLES, vert_type, in_chunk * 3);
 		}
 
-		for (j = 0; j < in_bin; j++)
+		for (j = 0; j < in_chunk; j++)
 		{
-			tri = bref[j];
+			tri = sorted[first + j];
 			int tribase = tri * 3;
 
 			for (k = 0; k < 3; k++)
@@ -335,10 +576,6 @@ vtGeode *vtTin3d::CreateGeometry(bool bDropShadowMesh)
 			}
 			norm = ComputeNormal(p[0], p[1], p[2]);
 
-			float shade = norm.Dot(light_dir);	// shading 0 (dark) to 1 (light)
-			if (shade < 0)
-				shade = -shade;
-
 			float fTiling;
 			if (bUseSurfaceTypes)
 			{
@@ -346,7 +583,7 @@ vtGeode *vtTin3d::CreateGeometry(bool bDropShadowMesh)
 				int surftype = m_surfidx[tri];
 				if (pTypeMeshes[surftype] == NULL)
 					pTypeMeshes[surftype] = new vtMesh(osg::PrimitiveSet::TRIANGLES,
-						vert_type, in_bin * 3);
+						vert_type, in_chunk * 3);
 				pMesh = pTypeMeshes[surftype];
 				fTiling = m_surftype_tiling[surftype];
 			}
@@ -378,21 +615,40 @@ vtGeode *vtTin3d::CreateGeometry(bool bDropShadowMesh)
 			{
 				if (pTypeMeshes[j] != NULL)
 				{
-					m_pGeode->AddMesh(pTypeMeshes[j], m_StartOfSurfaceMaterials + j);
+					geode->AddMesh(pTypeMeshes[j], m_StartOfSurfaceMaterials + j);
 					m_Meshes.Append(pTypeMeshes[j]);
+					total_verts += pTypeMeshes[j]->NumVertices();
+					draw_calls++;
 				}
 			}
 		}
 		else
 		{
 			// Simple case
-			m_pGeode->AddMesh(pMesh, m_MatIndex);
+			geode->AddMesh(pMesh, m_MatIndex);
 			m_Meshes.Append(pMesh);
+			total_verts += pMesh->NumVertices();
+			draw_calls++;
 		}
 	}
 
-	// Free up temp arrays
-	delete [] bins;
+	// Build a hierarchy of bounding groups over the chunks, for culling.
+	//  Because the chunks are in Morton order, each run of consecutive
+	//  chunks also covers a compact area.
+	while (nodes.size() > kChunkGroupSize)
+	{
+		std::vector<osg::Node*> parents;
+		for (i = 0; i < nodes.size(); i += kChunkGroupSize)
+		{
+			vtGroup *group = new vtGroup;
+			for (j = i; j < i + kChunkGroupSize && j < nodes.size(); j++)
+				group->addChild(nodes[j]);
+			parents.push_back(group);
+		}
+		nodes.swap(parents);
+	}
+	for (i = 0; i < nodes.size(); i++)
+		m_pGroup->addChild(nodes[i]);
 
 	if (bDropShadowMesh)
 	{
@@ -415,14 +671,22 @@ vtGeode *vtTin3d::CreateGeometry(bool bDropShadowMesh)
 		pBaseMesh->AddVertex(wp);
 
 		pBaseMesh->AddFan(0, 1, 2, 3);
-		m_pGeode->AddMesh(pBaseMesh, m_ShadowMatIndex);
+
+		m_pDropGeode = new vtGeode;
+		m_pDropGeode->SetMaterials(m_pMats);
+		m_pDropGeode->AddMesh(pBaseMesh, m_ShadowMatIndex);
+		m_pGroup->addChild(m_pDropGeode);
 	}
 
 	// The TIN is a large geometry which should not attempt to cast a shadow,
 	//  because shadow algos tend to support only small regions of casters.
-	m_pGeode->SetCastShadow(false);
+	m_pGroup->SetCastShadow(false);
 
-	return m_pGeode;
+	VTLOG(" %d triangles in %d chunks, %d draw calls, %d vertices%s: %.3f seconds.\n",
+		tris, chunks, draw_calls, total_verts, bShareVertices ? " (shared)" : "",
+		(float)(clock() - c1) / CLOCKS_PER_SEC);
+
+	return m_pGroup;
 }
 
 /**
@@ -487,6 +751,18 @@ bool vtTin3d::FindAltitudeAtPoint(const FPoint3 &input, float &fAltitude,
 #endif
 }
 
+/**
+ * Find the elevation at many points.  Culture is tested one point at a
+ * time; otherwise, the TIN is tested bin by bin, in parallel.
+ */
+int vtTin3d::FindAltitudesAtPoints(FPoint3 *points, uint count, bool bTrue,
+								   int iCultureFlags) const
+{
+	if (iCultureFlags != 0 && m_pCulture != NULL)
+		return vtHeightField3d::FindAltitudesAtPoints(points, count, bTrue, iCultureFlags);
+	return vtTin::FindAltitudesAtPoints(points, count, bTrue, iCultureFlags);
+}
+
 
 /*
  * Algorithm from 'Fast, Minimum Storage Ray-Triangle Intersection',
@@ -564,13 +840,13 @@ bool vtTin3d::CastRayToSurface(const FPoint3 &point, const FPoint3 &dir,
 			continue;
 		}
 
-		int tris = mesh->NumVertices() / 3;
+		int tris = mesh->NumIndices() / 3;
 		for (i = 0; i < tris; i++)
 		{
 			// get world points
-			wp1 = mesh->GetVtxPos(i*3+0);
-			wp2 = mesh->GetVtxPos(i*3+1);
-			wp3 = mesh->GetVtxPos(i*3+2);
+			wp1 = mesh->GetVtxPos(mesh->GetIndex(i*3+0));
+			wp2 = mesh->GetVtxPos(mesh->GetIndex(i*3+1));
+			wp3 = mesh->GetVtxPos(mesh->GetIndex(i*3+2));
 			if (intersect_triangle(point, dir, wp1, wp2, wp3, t, u, v))
 			{
 				if (t < closest)
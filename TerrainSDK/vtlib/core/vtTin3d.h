@@ -29,6 +29,9 @@
  vertex colors, no texturing.
  3. Or, add some surface types with vtTin::AddSurfaceType, and those
  types will be used
+
+ The geometry is built as a hierarchy of groups over spatially compact
+ chunks, each chunk being a geode with a few large meshes.
  */
 class vtTin3d : public vtTin, public osg::Referenced
 {
@@ -38,8 +41,8 @@ public:
 
 	bool Read(const char *fname, bool progress_callback(int) = NULL);
 
-	vtGeode *CreateGeometry(bool bDropShadowMesh);
-	vtGeode *GetGeometry() { return m_pGeode; }
+	vtGroup *CreateGeometry(bool bDropShadowMesh);
+	vtGroup *GetGeometry() { return m_pGroup; }
 
 	void SetMaterial(vtMaterialArray *pMats, int mat_idx);
 
@@ -50,6 +53,8 @@ public:
 	virtual bool FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude,
 		bool bTrue = false, int iCultureFlags = 0,
 		FPoint3 *vNormal = NULL) const;
+	virtual int FindAltitudesAtPoints(FPoint3 *points, uint count,
+		bool bTrue = false, int iCultureFlags = 0) const;
 	virtual bool CastRayToSurface(const FPoint3 &point, const FPoint3 &dir,
 		FPoint3 &result) const;
 
@@ -61,11 +66,13 @@ public:
 
 protected:
 	virtual void MakeSurfaceMaterials();
+	vtMesh *MakeIndexedChunk(const int *tris, uint num_tris, int vert_type,
+		std::vector<int> &local);
 
 	vtArray<vtMesh*> m_Meshes;
 	vtMaterialArrayPtr m_pMats;
 	int			 m_MatIndex, m_ShadowMatIndex;
-	vtGeode		*m_pGeode;
+	vtGroup		*m_pGroup;
 	vtGeode		*m_pDropGeode;
 	ColorMap	*m_pColorMap;
 	int			m_StartOfSurfaceMaterials;
@@ -96,29 +96,18 @@ static FPoint2 t[4] =
  */
 vtMesh::vtMesh(PrimType ePrimType, int VertType, int NumVertices)
 {
-#ifdef VTP_AVOID_OSG_INDICES
 	m_PrimType = ePrimType;
-#endif
 	m_iMatIdx = -1;
 
 	osg::Vec3Array *pVert = new osg::Vec3Array;
 	pVert->reserve(NumVertices);
 	setVertexArray(pVert);
 
-#ifndef VTP_AVOID_OSG_INDICES
-	osg::UIntArray *pIndex = new osg::UIntArray;
-	pIndex->reserve(NumVertices);
-	setVertexIndices(pIndex);
-#endif
-
 	if (VertType & VT_Normals)
 	{
 		osg::Vec3Array *pNorm = new osg::Vec3Array;
 		pNorm->reserve(NumVertices);
 		setNormalArray(pNorm);
-#ifndef VTP_AVOID_OSG_INDICES
-		setNormalIndices(pIndex);
-#endif
 		setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
 	}
 	if (VertType & VT_Colors)
@@ -126,9 +115,6 @@ vtMesh::vtMesh(PrimType ePrimType, int VertType, int NumVertices)
 		osg::Vec4Array *pColor = new osg::Vec4Array;
 		pColor->reserve(NumVertices);
 		setColorArray(pColor);
-#ifndef VTP_AVOID_OSG_INDICES
-		setColorIndices(pIndex);
-#endif
 		setColorBinding(osg::Geometry::BIND_PER_VERTEX);
 	}
 	if (VertType & VT_TexCoords)
@@ -136,78 +122,43 @@ vtMesh::vtMesh(PrimType ePrimType, int VertType, int NumVertices)
 		osg::Vec2Array *pTex = new osg::Vec2Array;
 		pTex->reserve(NumVertices);
 		setTexCoordArray(0, pTex);
-#ifndef VTP_AVOID_OSG_INDICES
-		setTexCoordIndices(0, pIndex);
-#endif
 	}
 
-#ifdef USE_OPENGL_BUFFER_OBJECTS
-	// This can only be done after the arrays have been set up
-	// The buffer objects will be compiled on the next rendering pass
-	// So if you change the contents of the vertex, normal, colour, or tex coord arrys
-	// after the next rendering pass you need to call the DirtyBufferObjects() function
-	// to cause them to recompile.
-	// Element Index buffer objects are handled slightly differently by OSG but the
-	// same constraint applies if you change any element indices. This occurs when
-	// you add geometry definitions to the mesh e.g by calling AddTriangle etc.
-	if (VertType & VT_VBO)
-		setUseVertexBufferObjects(true);
-#endif
-
-	osg::PrimitiveSet *pPrimSet;
-#ifndef VTP_AVOID_OSG_INDICES
+	// All primitives are drawn with a single primitive set.  Variable-length
+	//  primitives (strips, fans and polygons) are converted to lists of lines,
+	//  triangles or quads as they are added.
+	osg::PrimitiveSet *pPrimSet = NULL;
 	switch (ePrimType)
 	{
 	case osg::PrimitiveSet::POINTS:
-		pPrimSet = new osg::DrawArrays(osg::PrimitiveSet::POINTS, 0, NumVertices);
+		pPrimSet = new osg::DrawArrays(osg::PrimitiveSet::POINTS, 0, 0);
 		break;
 	case osg::PrimitiveSet::LINES:
-		pPrimSet = new osg::DrawArrays(osg::PrimitiveSet::LINES, 0, NumVertices);
-		break;
-	case osg::PrimitiveSet::TRIANGLES:
-		pPrimSet = new osg::DrawArrays(osg::PrimitiveSet::TRIANGLES, 0, NumVertices);
-		break;
-	case osg::PrimitiveSet::QUADS:
-		pPrimSet = new osg::DrawArrays(osg::PrimitiveSet::QUADS, 0, NumVertices);
-		break;
 	case osg::PrimitiveSet::LINE_STRIP:
-		pPrimSet = new osg::DrawArrayLengths(osg::PrimitiveSet::LINE_STRIP);
+		pPrimSet = new osg::DrawElementsUInt(osg::PrimitiveSet::LINES);
 		break;
+	case osg::PrimitiveSet::TRIANGLES:
 	case osg::PrimitiveSet::TRIANGLE_STRIP:
-		pPrimSet = new osg::DrawArrayLengths(osg::PrimitiveSet::TRIANGLE_STRIP);
-		break;
 	case osg::PrimitiveSet::TRIANGLE_FAN:
-		pPrimSet = new osg::DrawArrayLengths(osg::PrimitiveSet::TRIANGLE_FAN);
-		break;
 	case osg::PrimitiveSet::POLYGON:
-		pPrimSet = new osg::DrawArrayLengths(osg::PrimitiveSet::POLYGON);
-		break;
-	default:	// Keep picky compilers quiet.
-		break;
-	}
-	addPrimitiveSet(pPrimSet);
-#else
-	pPrimSet = NULL;
-	switch (ePrimType)
-	{
-	case osg::PrimitiveSet::POINTS:
-		pPrimSet = new osg::DrawArrays(osg::PrimitiveSet::POINTS, 0, NumVertices);
-		break;
-	case osg::PrimitiveSet::LINES:
-		pPrimSet = new osg::DrawElementsUShort(osg::PrimitiveSet::LINES);
-		break;
-	case osg::PrimitiveSet::TRIANGLES:
-		pPrimSet = new osg::DrawElementsUShort(osg::PrimitiveSet::TRIANGLES);
+		pPrimSet = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES);
 		break;
 	case osg::PrimitiveSet::QUADS:
-		pPrimSet = new osg::DrawElementsUShort(osg::PrimitiveSet::QUADS);
+	case osg::PrimitiveSet::QUAD_STRIP:
+		pPrimSet = new osg::DrawElementsUInt(osg::PrimitiveSet::QUADS);
 		break;
-	default:	// Keep picky compilers quiet.
+	default:
+		VTLOG("vtMesh: unsupported primitive type %d\n", ePrimType);
+		pPrimSet = new osg::DrawElementsUInt(ePrimType);
 		break;
 	}
-	if (NULL != pPrimSet)
-		addPrimitiveSet(pPrimSet);
-#endif
+	addPrimitiveSet(pPrimSet);
+
+	// Draw from vertex buffer objects rather than display lists.  The buffers
+	//  are compiled on the next rendering pass; any later change to the
+	//  vertices or primitives marks them dirty so they are sent again.
+	setUseDisplayList(false);
+	setUseVertexBufferObjects(true);
 }
 
 /**
@@ -939,37 +890,19 @@ void vtMesh::GetBoundBox(FBox3 &box) const
  */
 void vtMesh::AddTri(int p0, int p1, int p2)
 {
-#ifdef VTP_AVOID_OSG_INDICES
-	PrimType PrimType = getPrimType();
-	osg::DrawElements *pDrawElements;
-	if (PrimType == osg::PrimitiveSet::TRIANGLES)
-	{
-		pDrawElements = getPrimitiveSet(0)->getDrawElements();
-	}
-	else if (PrimType == osg::PrimitiveSet::TRIANGLE_STRIP || PrimType == osg::PrimitiveSet::TRIANGLE_FAN)
-	{
-		pDrawElements = new osg::DrawElementsUShort(PrimType, 3);
-		addPrimitiveSet(pDrawElements);
-	}
-	pDrawElements->addElement(p0);
-	pDrawElements->addElement(p1);
-	pDrawElements->addElement(p2);
-#else
-	osg::UIntArray *uia = getIndices();
-	uia->push_back(p0);
-	uia->push_back(p1);
-	uia->push_back(p2);
-
-	if (getPrimType() == osg::PrimitiveSet::TRIANGLES)
-	{
-		// OSG's "count" is the number of indices, not the number of primitives
-		getDrawArrays()->setCount(uia->size());
-	}
-	else if (getPrimType() == osg::PrimitiveSet::TRIANGLE_STRIP || getPrimType() == osg::PrimitiveSet::TRIANGLE_FAN)
+	if (IsStripType())
 	{
-		getDrawArrayLengths()->push_back(3);
+		m_StripIndices.push_back(p0);
+		m_StripIndices.push_back(p1);
+		m_StripIndices.push_back(p2);
+		_AddPrimitive(3);
+		return;
 	}
-#endif
+	osg::DrawElementsUInt *de = getElements();
+	de->push_back(p0);
+	de->push_back(p1);
+	de->push_back(p2);
+	de->dirty();
 }
 
 /**
@@ -979,34 +912,17 @@ void vtMesh::AddTri(int p0, int p1, int p2)
  */
 void vtMesh::AddFan(int p0, int p1, int p2, int p3, int p4, int p5)
 {
-#ifdef VTP_AVOID_OSG_INDICES
-	osg::DrawElements *pDrawElements;
-	pDrawElements = new osg::DrawElementsUShort(osg::PrimitiveSet::TRIANGLE_FAN);
-	pDrawElements->addElement(p0);
-	pDrawElements->addElement(p1);
-	if (p2 != -1)
-		pDrawElements->addElement(p2);
-	if (p3 != -1)
-		pDrawElements->addElement(p3);
-	if (p4 != -1)
-		pDrawElements->addElement(p4);
-	if (p5 != -1)
-		pDrawElements->addElement(p5);
-	addPrimitiveSet(pDrawElements);
-#else
 	int len = 2;
 
-	osg::UIntArray *uia = (osg::UIntArray*) getVertexIndices();
-	uia->push_back(p0);
-	uia->push_back(p1);
+	m_StripIndices.push_back(p0);
+	m_StripIndices.push_back(p1);
 
-	if (p2 != -1) { uia->push_back(p2); len = 3; }
-	if (p3 != -1) { uia->push_back(p3); len = 4; }
-	if (p4 != -1) { uia->push_back(p4); len = 5; }
-	if (p5 != -1) { uia->push_back(p5); len = 6; }
+	if (p2 != -1) { m_StripIndices.push_back(p2); len = 3; }
+	if (p3 != -1) { m_StripIndices.push_back(p3); len = 4; }
+	if (p4 != -1) { m_StripIndices.push_back(p4); len = 5; }
+	if (p5 != -1) { m_StripIndices.push_back(p5); len = 6; }
 
-	getDrawArrayLengths()->push_back(len);
-#endif
+	_AddPrimitive(len);
 }
 
 /**
@@ -1016,21 +932,8 @@ void vtMesh::AddFan(int p0, int p1, int p2, int p3, int p4, int p5)
  */
 void vtMesh::AddFan(int *idx, int iNVerts)
 {
-#ifdef VTP_AVOID_OSG_INDICES
-	osg::DrawElements *pDrawElements;
-	pDrawElements = new osg::DrawElementsUShort(osg::PrimitiveSet::TRIANGLE_FAN);
-	pDrawElements->reserveElements(iNVerts);
-	for (int i = 0; i < iNVerts; i++)
-		pDrawElements->addElement(idx[i]);
-	addPrimitiveSet(pDrawElements);
-#else
-	osg::UIntArray *uia = getIndices();
-
-	for (int i = 0; i < iNVerts; i++)
-		uia->push_back(idx[i]);
-
-	getDrawArrayLengths()->push_back(iNVerts);
-#endif
+	m_StripIndices.insert(m_StripIndices.end(), idx, idx + iNVerts);
+	_AddPrimitive(iNVerts);
 }
 
 /**
@@ -1041,32 +944,8 @@ void vtMesh::AddFan(int *idx, int iNVerts)
  */
 void vtMesh::AddStrip(int iNVerts, unsigned short *pIndices)
 {
-#ifdef VTP_AVOID_OSG_INDICES
-	osg::DrawElements *pDrawElements;
-	switch(m_PrimType)
-	{
-		case osg::PrimitiveSet::LINE_STRIP:
-			pDrawElements = new osg::DrawElementsUShort(osg::PrimitiveSet::LINE_STRIP);
-			break;
-		case osg::PrimitiveSet::TRIANGLE_STRIP:
-			pDrawElements = new osg::DrawElementsUShort(osg::PrimitiveSet::TRIANGLE_STRIP);
-			break;
-		case osg::PrimitiveSet::QUAD_STRIP:
-			pDrawElements = new osg::DrawElementsUShort(osg::PrimitiveSet::QUAD_STRIP);
-			break;
-	}
-	pDrawElements->reserveElements(iNVerts);
-	for (int i = 0; i < iNVerts; i++)
-		pDrawElements->addElement(pIndices[i]);
-	addPrimitiveSet(pDrawElements);
-#else
-	osg::UIntArray *uia = getIndices();
-
-	for (int i = 0; i < iNVerts; i++)
-		uia->push_back(pIndices[i]);
-
-	getDrawArrayLengths()->push_back(iNVerts);
-#endif
+	m_StripIndices.insert(m_StripIndices.end(), pIndices, pIndices + iNVerts);
+	_AddPrimitive(iNVerts);
 }
 
 /**
@@ -1075,36 +954,17 @@ void vtMesh::AddStrip(int iNVerts, unsigned short *pIndices)
  */
 void vtMesh::AddLine(int p0, int p1)
 {
-#ifdef VTP_AVOID_OSG_INDICES
-	PrimType PrimType = getPrimType();
-	osg::DrawElements *pDrawElements;
-	if (PrimType == osg::PrimitiveSet::LINES)
+	if (IsStripType())
 	{
-		pDrawElements = getPrimitiveSet(0)->getDrawElements();
-	}
-	else if (PrimType == osg::PrimitiveSet::LINE_STRIP)
-	{
-		// This seems a bit pointless
-		pDrawElements = new osg::DrawElementsUShort(PrimType, 2);
-		addPrimitiveSet(pDrawElements);
-	}
-	pDrawElements->addElement(p0);
-	pDrawElements->addElement(p1);
-#else
-	osg::UIntArray *uia = getIndices();
-
-	uia->push_back(p0);
-	uia->push_back(p1);
-
-	if (getPrimType() == osg::PrimitiveSet::LINES)
-	{
-		getDrawArrays()->setCount(uia->size());
-	}
-	else if (getPrimType() == osg::PrimitiveSet::LINE_STRIP)
-	{
-		getDrawArrayLengths()->push_back(2);
+		m_StripIndices.push_back(p0);
+		m_StripIndices.push_back(p1);
+		_AddPrimitive(2);
+		return;
 	}
-#endif
+	osg::DrawElementsUInt *de = getElements();
+	de->push_back(p0);
+	de->push_back(p1);
+	de->dirty();
 }
 
 /**
@@ -1121,27 +981,85 @@ int vtMesh::AddLine(const FPoint3 &pos1, const FPoint3 &pos2)
 }
 
 /**
- * Add a triangle.
- *  p0, p1, p2 are the indices of the vertices of the triangle.
+ * Add a quad.
+ *  p0, p1, p2, p3 are the indices of the vertices of the quad.
  */
 void vtMesh::AddQuad(int p0, int p1, int p2, int p3)
 {
-#ifdef VTP_AVOID_OSG_INDICES
-	osg::DrawElements *pDrawElements;
-	pDrawElements = getPrimitiveSet(0)->getDrawElements();
-	pDrawElements->addElement(p0);
-	pDrawElements->addElement(p1);
-	pDrawElements->addElement(p2);
-	pDrawElements->addElement(p3);
-#else
-	osg::UIntArray *uia = getIndices();
-
-	uia->push_back(p0);
-	uia->push_back(p1);
-	uia->push_back(p2);
-	uia->push_back(p3);
-	getDrawArrays()->setCount(uia->size());
-#endif
+	osg::DrawElementsUInt *de = getElements();
+	de->push_back(p0);
+	de->push_back(p1);
+	de->push_back(p2);
+	de->push_back(p3);
+	de->dirty();
+}
+
+/**
+ * The last iNVerts of m_StripIndices are a new variable-length primitive.
+ * Record its length, and convert it to the lines, triangles or quads which
+ * are actually drawn.
+ */
+void vtMesh::_AddPrimitive(int iNVerts)
+{
+	m_StripLengths.push_back(iNVerts);
+	if (iNVerts < 2)
+		return;
+
+	const uint *idx = &m_StripIndices[m_StripIndices.size() - iNVerts];
+	osg::DrawElementsUInt *de = getElements();
+	int i;
+	switch (m_PrimType)
+	{
+	case osg::PrimitiveSet::LINE_STRIP:
+		for (i = 0; i < iNVerts-1; i++)
+		{
+			de->push_back(idx[i]);
+			de->push_back(idx[i+1]);
+		}
+		break;
+	case osg::PrimitiveSet::TRIANGLE_STRIP:
+		for (i = 0; i < iNVerts-2; i++)
+		{
+			// Skip the degenerate triangles which are used to join strips
+			if (idx[i] == idx[i+1] || idx[i+1] == idx[i+2] || idx[i] == idx[i+2])
+				continue;
+			// Every second triangle of a strip has its winding reversed
+			if (i & 1)
+			{
+				de->push_back(idx[i+1]);
+				de->push_back(idx[i]);
+			}
+			else
+			{
+				de->push_back(idx[i]);
+				de->push_back(idx[i+1]);
+			}
+			de->push_back(idx[i+2]);
+		}
+		break;
+	case osg::PrimitiveSet::TRIANGLE_FAN:
+	case osg::PrimitiveSet::POLYGON:
+		// Polygons are assumed convex, as OpenGL does
+		for (i = 0; i < iNVerts-2; i++)
+		{
+			de->push_back(idx[0]);
+			de->push_back(idx[i+1]);
+			de->push_back(idx[i+2]);
+		}
+		break;
+	case osg::PrimitiveSet::QUAD_STRIP:
+		for (i = 0; i < iNVerts-3; i += 2)
+		{
+			de->push_back(idx[i]);
+			de->push_back(idx[i+1]);
+			de->push_back(idx[i+3]);
+			de->push_back(idx[i+2]);
+		}
+		break;
+	default:	// Keep picky compilers quiet.
+		break;
+	}
+	de->dirty();
 }
 
 uint vtMesh::NumVertices() const
@@ -1162,25 +1080,10 @@ void vtMesh::SetVtxPos(uint i, const FPoint3 &p)
 	if (i >= (int)getVerts()->size())
 		getVerts()->resize(i + 1);
 	getVerts()->at(i) = s;
-
-#ifdef VTP_AVOID_OSG_INDICES
-	if (getPrimType() == osg::PrimitiveSet::POINTS)
-		getDrawArrays()->setCount(getVerts()->size());
-#ifdef USE_OPENGL_BUFFER_OBJECTS
 	getVerts()->dirty();
-#endif
-#else
-	if (getPrimType() == GL_POINTS)
-	{
-		osg::UIntArray *uia = getIndices();
 
-		if (i >= (int) uia->size())
-			uia->resize(i + 1);
-
-		uia->at(i) = i;
+	if (m_PrimType == osg::PrimitiveSet::POINTS)
 		getDrawArrays()->setCount(getVerts()->size());
-	}
-#endif
 }
 
 /**
@@ -1210,9 +1113,7 @@ void vtMesh::SetVtxNormal(uint i, const FPoint3 &norm)
 		getNormals()->resize(i + 1);
 
 	getNormals()->at(i) = s;
-#ifdef USE_OPENGL_BUFFER_OBJECTS
 	getNormals()->dirty();
-#endif
 }
 
 /**
@@ -1245,9 +1146,7 @@ void vtMesh::SetVtxColor(uint i, const RGBAf &color)
 		getColors()->resize(i + 1);
 
 	getColors()->at(i) = s;
-#ifdef USE_OPENGL_BUFFER_OBJECTS
 	getColors()->dirty();
-#endif
 }
 
 /**
@@ -1286,9 +1185,7 @@ void vtMesh::SetVtxTexCoord(uint i, const FPoint2 &uv)
 		getTexCoords()->resize(i + 1);
 
 	getTexCoords()->at(i) = s;
-#ifdef USE_OPENGL_BUFFER_OBJECTS
 	getTexCoords()->dirty();
-#endif
 }
 
 /**
@@ -1307,29 +1204,84 @@ FPoint2 vtMesh::GetVtxTexCoord(uint i) const
 
 int vtMesh::NumPrims() const
 {
+	if (IsStripType())
+		return m_StripLengths.size();
 	return getPrimSet()->getNumPrimitives();
 }
 
+/**
+ * The number of vertex indices in the mesh.  For strips, fans and polygons,
+ *	this is the number of indices as they were added, not as they are drawn.
+ */
+int vtMesh::NumIndices() const
+{
+	if (IsStripType())
+		return m_StripIndices.size();
+	if (m_PrimType == osg::PrimitiveSet::POINTS)
+		return NumVertices();
+	return getElements()->size();
+}
+
+/**
+ * Get a vertex index of the mesh.  For strips, fans and polygons, the
+ *	indices are in the order they were added, so that each primitive starts
+ *	at the sum of the lengths (see GetPrimLen) of the previous primitives.
+ */
+int vtMesh::GetIndex(int i) const
+{
+	if (IsStripType())
+		return m_StripIndices[i];
+	if (m_PrimType == osg::PrimitiveSet::POINTS)
+		return i;
+	return getElements()->at(i);
+}
+
+/**
+ * Get the number of vertices in a primitive.
+ */
+int vtMesh::GetPrimLen(int i) const
+{
+	if (IsStripType())
+		return m_StripLengths[i];
+	switch (m_PrimType)
+	{
+	case osg::PrimitiveSet::LINES:		return 2;
+	case osg::PrimitiveSet::TRIANGLES:	return 3;
+	case osg::PrimitiveSet::QUADS:		return 4;
+	default:							return 1;
+	}
+}
+
 /**
  * Set whether to allow rendering optimization of this mesh.  With OpenGL,
- *	this optimization is called a "display list", which increases the speed
- *	of rendering by creating a special representation of the mesh the first
- *	time it is drawn.  The tradeoff is that subsequent changes to the mesh
- *	are not applied unless you call ReOptimize().
+ *	the mesh is drawn from "vertex buffer objects", which increases the speed
+ *	of rendering by keeping the vertices and indices in graphics memory.
+ *	Changes to the mesh are sent again to the graphics card on the next
+ *	frame, so for a mesh which changes every frame it may be faster to
+ *	disallow this.
  *
  *	\param bAllow	True to allow optimization.  The default is true.
  */
 void vtMesh::AllowOptimize(bool bAllow)
 {
-	setUseDisplayList(bAllow);
+	setUseVertexBufferObjects(bAllow);
 }
 
 /**
  * For a mesh with rendering optimization enabled, forces an update of the
- *	optimized representation.
+ *	optimized representation.  This is only needed if the vertex arrays
+ *	were changed directly, rather than through the methods of vtMesh.
  */
 void vtMesh::ReOptimize()
 {
+	getVerts()->dirty();
+	if (hasVertexNormals())
+		getNormals()->dirty();
+	if (hasVertexColors())
+		getColors()->dirty();
+	if (hasVertexTexCoords())
+		getTexCoords()->dirty();
+	getPrimSet()->dirty();
 	dirtyDisplayList();
 	dirtyBound();
 }
@@ -1386,58 +1338,24 @@ void vtMesh::SetNormalsFromPrimitives()
 
 void vtMesh::_AddStripNormals()
 {
-#ifdef VTP_AVOID_OSG_INDICES
-	uint i, j, len;
-	uint NumPrimitiveSets = getNumPrimitiveSets();
-	unsigned short v0 = 0, v1 = 0, v2 = 0;
-	osg::Vec3 p0, p1, p2, d0, d1, norm;
-	osg::Vec3Array *norms = getNormals();
-
-	for (i = 0; i < NumPrimitiveSets; i++)
-	{
-		osg::DrawElements *pDrawElements = getPrimitiveSet(i)->getDrawElements();
-		len = pDrawElements->getNumIndices(); // This actually just returns the size of the element list in this case
-		for (j = 0; j < len; j++)
-		{
-			v0 = v1; p0 = p1;
-			v1 = v2; p1 = p2;
-			v2 = pDrawElements->index(j);
-			p2 = getVerts()->at(v2);
-			if (j >= 2)
-			{
-				d0 = (p1 - p0);
-				d1 = (p2 - p0);
-				d0.normalize();
-				d1.normalize();
-
-				norm = d0^d1;
-
-				norms->at(v0) += norm;
-				norms->at(v1) += norm;
-				norms->at(v2) += norm;
-			}
-		}
-	}
-#else
-	osg::DrawArrayLengths *dal = getDrawArrayLengths();
 	int prims = NumPrims();
 	int i, j, len, idx;
-	unsigned short v0 = 0, v1 = 0, v2 = 0;
+	uint v0 = 0, v1 = 0, v2 = 0;
 	osg::Vec3 p0, p1, p2, d0, d1, norm;
 
-	osg::UIntArray *uia = getIndices();
+	const osg::Vec3Array *verts = getVerts();
 	osg::Vec3Array *norms = getNormals();
 
 	idx = 0;
 	for (i = 0; i < prims; i++)
 	{
-		len = dal->at(i);
+		len = m_StripLengths[i];
 		for (j = 0; j < len; j++)
 		{
 			v0 = v1; p0 = p1;
 			v1 = v2; p1 = p2;
-			v2 = uia->at(idx);
-			p2 = getVerts()->at(v2);
+			v2 = m_StripIndices[idx];
+			p2 = verts->at(v2);
 			if (j >= 2)
 			{
 				d0 = (p1 - p0);
@@ -1454,71 +1372,31 @@ void vtMesh::_AddStripNormals()
 			idx++;
 		}
 	}
-#endif
 }
 
 void vtMesh::_AddPolyNormals()
 {
-#ifdef VTP_AVOID_OSG_INDICES
-	uint i, j, len;
-	uint NumPrimitiveSets = getNumPrimitiveSets();
-	unsigned short v0 = 0, v1 = 0, v2 = 0;
-	osg::Vec3 p0, p1, p2, d0, d1, norm;
-	osg::Vec3Array *norms = getNormals();
-
-	for (i = 0; i < NumPrimitiveSets; i++)
-	{
-		osg::DrawElements *pDrawElements = getPrimitiveSet(i)->getDrawElements();
-		len = pDrawElements->getNumIndices(); // This actually just returns the size of the element list in this case
-		// ensure this poly has enough verts to define a surface
-		if (len >= 3)
-		{
-			v0 = pDrawElements->index(0);
-			v1 = pDrawElements->index(1);
-			v2 = pDrawElements->index(2);
-			p0 = getVerts()->at(v0);
-			p1 = getVerts()->at(v1);
-			p2 = getVerts()->at(v2);
-
-			d0 = (p1 - p0);
-			d1 = (p2 - p0);
-			d0.normalize();
-			d1.normalize();
-
-			norm = d0^d1;
-
-			for (j = 0; j < len; j++)
-			{
-				uint v = pDrawElements->index(j);
-				getNormals()->at(v) += norm;
-			}
-		}
-	}
-#else
-	osg::DrawArrayLengths *dal = getDrawArrayLengths();
-	if (!dal)
-		return;
-
 	int prims = NumPrims();
 	int i, j, len, idx;
-	unsigned short v0 = 0, v1 = 0, v2 = 0;
+	uint v0 = 0, v1 = 0, v2 = 0;
 	osg::Vec3 p0, p1, p2, d0, d1, norm;
 
-	osg::UIntArray *uia = getIndices();
+	const osg::Vec3Array *verts = getVerts();
+	osg::Vec3Array *norms = getNormals();
 
 	idx = 0;
 	for (i = 0; i < prims; i++)
 	{
-		len = dal->at(i);
+		len = m_StripLengths[i];
 		// ensure this poly has enough verts to define a surface
 		if (len >= 3)
 		{
-			v0 = uia->at(idx);
-			v1 = uia->at(idx+1);
-			v2 = uia->at(idx+2);
-			p0 = getVerts()->at(v0);
-			p1 = getVerts()->at(v1);
-			p2 = getVerts()->at(v2);
+			v0 = m_StripIndices[idx];
+			v1 = m_StripIndices[idx+1];
+			v2 = m_StripIndices[idx+2];
+			p0 = verts->at(v0);
+			p1 = verts->at(v1);
+			p2 = verts->at(v2);
 
 			d0 = (p1 - p0);
 			d1 = (p2 - p0);
@@ -1528,60 +1406,30 @@ void vtMesh::_AddPolyNormals()
 			norm = d0^d1;
 
 			for (j = 0; j < len; j++)
-			{
-				int v = uia->at(idx + j);
-				getNormals()->at(v) += norm;
-			}
+				norms->at(m_StripIndices[idx + j]) += norm;
 		}
 		idx += len;
 	}
-#endif
 }
 
 void vtMesh::_AddTriangleNormals()
 {
-#ifdef VTP_AVOID_OSG_INDICES
-	int tris = NumPrims();
-	unsigned short v0, v1, v2;
-	osg::Vec3 p0, p1, p2, d0, d1, norm;
-
-	osg::DrawElements *pDrawElements = getPrimitiveSet(0)->getDrawElements();
-
-	for (int i = 0; i < tris; i++)
-	{
-		v0 = pDrawElements->index(i*3);
-		v1 = pDrawElements->index(i*3+1);
-		v2 = pDrawElements->index(i*3+2);
-		p0 = getVerts()->at(v0);
-		p1 = getVerts()->at(v1);
-		p2 = getVerts()->at(v2);
-
-		d0 = (p1 - p0);
-		d1 = (p2 - p0);
-		d0.normalize();
-		d1.normalize();
-
-		norm = d0^d1;
-
-		getNormals()->at(v0) += norm;
-		getNormals()->at(v1) += norm;
-		getNormals()->at(v2) += norm;
-	}
-#else
 	int tris = NumPrims();
-	unsigned short v0, v1, v2;
+	uint v0, v1, v2;
 	osg::Vec3 p0, p1, p2, d0, d1, norm;
 
-	osg::UIntArray *uia = getIndices();
+	const osg::DrawElementsUInt *de = getElements();
+	const osg::Vec3Array *verts = getVerts();
+	osg::Vec3Array *norms = getNormals();
 
 	for (int i = 0; i < tris; i++)
 	{
-		v0 = uia->at(i*3);
-		v1 = uia->at(i*3+1);
-		v2 = uia->at(i*3+2);
-		p0 = getVerts()->at(v0);
-		p1 = getVerts()->at(v1);
-		p2 = getVerts()->at(v2);
+		v0 = de->at(i*3);
+		v1 = de->at(i*3+1);
+		v2 = de->at(i*3+2);
+		p0 = verts->at(v0);
+		p1 = verts->at(v1);
+		p2 = verts->at(v2);
 
 		d0 = (p1 - p0);
 		d1 = (p2 - p0);
@@ -1590,33 +1438,31 @@ void vtMesh::_AddTriangleNormals()
 
 		norm = d0^d1;
 
-		getNormals()->at(v0) += norm;
-		getNormals()->at(v1) += norm;
-		getNormals()->at(v2) += norm;
+		norms->at(v0) += norm;
+		norms->at(v1) += norm;
+		norms->at(v2) += norm;
 	}
-#endif
 }
 
 void vtMesh::_AddQuadNormals()
 {
-#ifdef VTP_AVOID_OSG_INDICES
 	int quads = NumPrims();
-	unsigned short v0, v1, v2, v3;
+	uint v0, v1, v2, v3;
 	osg::Vec3 p0, p1, p2, d0, d1, norm;
 
+	const osg::DrawElementsUInt *de = getElements();
+	const osg::Vec3Array *verts = getVerts();
 	osg::Vec3Array *norms = getNormals();
 
-	osg::DrawElements *pDrawElements = getPrimitiveSet(0)->getDrawElements();
-
 	for (int i = 0; i < quads; i++)
 	{
-		v0 = pDrawElements->index(i*4);
-		v1 = pDrawElements->index(i*4+1);
-		v2 = pDrawElements->index(i*4+2);
-		v3 = pDrawElements->index(i*4+3);
-		p0 = getVerts()->at(v0);
-		p1 = getVerts()->at(v1);
-		p2 = getVerts()->at(v2);
+		v0 = de->at(i*4);
+		v1 = de->at(i*4+1);
+		v2 = de->at(i*4+2);
+		v3 = de->at(i*4+3);
+		p0 = verts->at(v0);
+		p1 = verts->at(v1);
+		p2 = verts->at(v2);
 
 		d0 = (p1 - p0);
 		d1 = (p2 - p0);
@@ -1630,37 +1476,6 @@ void vtMesh::_AddQuadNormals()
 		norms->at(v2) += norm;
 		norms->at(v3) += norm;
 	}
-#else
-	int quads = NumPrims();
-	unsigned short v0, v1, v2, v3;
-	osg::Vec3 p0, p1, p2, d0, d1, norm;
-
-	osg::UIntArray *uia = getIndices();
-	osg::Vec3Array *norms = getNormals();
-
-	for (int i = 0; i < quads; i++)
-	{
-		v0 = uia->at(i*4);
-		v1 = uia->at(i*4+1);
-		v2 = uia->at(i*4+2);
-		v3 = uia->at(i*4+3);
-		p0 = getVerts()->at(v0);
-		p1 = getVerts()->at(v1);
-		p2 = getVerts()->at(v2);
-
-		d0 = (p1 - p0);
-		d1 = (p2 - p0);
-		d0.normalize();
-		d1.normalize();
-
-		norm = d0^d1;
-
-		norms->at(v0) += norm;
-		norms->at(v1) += norm;
-		norms->at(v2) += norm;
-		norms->at(v3) += norm;
-	}
-#endif
 }
 
 
@@ -14,10 +14,6 @@
 #include <osgText/Font>
 #include <osgText/Text>
 
-#ifdef VTP_AVOID_OSG_INDICES
-//#define USE_OPENGL_BUFFER_OBJECTS
-#endif
-
 // Shorthand
 #define FAB		osg::Material::FRONT_AND_BACK
 
@@ -25,9 +21,6 @@
 #define VT_Normals		1
 #define VT_Colors		2
 #define VT_TexCoords	4
-#ifdef USE_OPENGL_BUFFER_OBJECTS
-#define VT_VBO			8
-#endif
 class vtImage;
 
 /** \addtogroup sg */
@@ -41,6 +34,12 @@ class vtImage;
  * functions useful for creating and dynamically changing Meshes.
  * To add the vtMesh to the visible scene graph, add it to a vtGeode node.
  * \par
+ * Internally, all the primitives of a mesh are drawn with a single indexed
+ * primitive set (osg::DrawElementsUInt) from vertex buffer objects.  Strips,
+ * fans and polygons are converted to a list of triangles (and line strips
+ * to a list of lines) as they are added, but their original indices and
+ * lengths are kept so that they can still be queried with GetIndex() and
+ * GetPrimLen().
  */
 class vtMesh : public osg::Geometry
 {
@@ -64,11 +63,7 @@ public:
 	void AddQuad(int p0, int p1, int p2, int p3);
 
 	// Accessors
-#ifdef VTP_AVOID_OSG_INDICES
 	PrimType getPrimType() const { return m_PrimType; }
-#else
-	PrimType getPrimType() const { return (PrimType) getPrimSet()->getMode(); }
-#endif
 
 	void SetMatIndex(int i) { m_iMatIdx = i; }
 	int GetMatIndex() const { return m_iMatIdx; }
@@ -140,15 +135,15 @@ public:
 		SetVtxNormal(i, norm);
 	}
 
-	// Control rendering optimization ("display lists")
+	// Control rendering optimization ("vertex buffer objects")
 	void ReOptimize();
 	void AllowOptimize(bool bAllow);
 
 	// Access values
 	int NumPrims() const;
-	int NumIndices() const { return getVertexIndices()->getNumElements(); }
-	short GetIndex(int i) const { return getIndices()->at(i); }
-	int GetPrimLen(int i) const { return dynamic_cast<const osg::DrawArrayLengths*>(getPrimitiveSet(0))->at(i); }
+	int NumIndices() const;
+	int GetIndex(int i) const;
+	int GetPrimLen(int i) const;
 
 	void SetNormalsFromPrimitives();
 
@@ -162,19 +157,28 @@ protected:
 	void _AddPolyNormals();
 	void _AddTriangleNormals();
 	void _AddQuadNormals();
+	void _AddPrimitive(int iNVerts);
+
+	// True for the primitive types which have a variable length, and are
+	//  converted to a list of lines or triangles for drawing.
+	bool IsStripType() const
+	{
+		return (m_PrimType == osg::PrimitiveSet::LINE_STRIP ||
+				m_PrimType == osg::PrimitiveSet::TRIANGLE_STRIP ||
+				m_PrimType == osg::PrimitiveSet::TRIANGLE_FAN ||
+				m_PrimType == osg::PrimitiveSet::QUAD_STRIP ||
+				m_PrimType == osg::PrimitiveSet::POLYGON);
+	}
 
 	osg::PrimitiveSet *getPrimSet() { return getPrimitiveSet(0); }
 	const osg::PrimitiveSet *getPrimSet() const { return getPrimitiveSet(0); }
 
-	// might not need dynamic_cast here; could be simpler/faster with static cast?
-	osg::DrawArrays *getDrawArrays() { return dynamic_cast<osg::DrawArrays*>(getPrimitiveSet(0)); }
-	osg::DrawArrayLengths *getDrawArrayLengths() { return dynamic_cast<osg::DrawArrayLengths*>(getPrimitiveSet(0)); }
-
-	const osg::DrawArrays *getDrawArrays() const { return dynamic_cast<const osg::DrawArrays*>(getPrimitiveSet(0)); }
-	const osg::DrawArrayLengths *getDrawArrayLengths() const { return dynamic_cast<const osg::DrawArrayLengths*>(getPrimitiveSet(0)); }
+	// The primitive set is created by the constructor, so its type is known
+	osg::DrawArrays *getDrawArrays() { return static_cast<osg::DrawArrays*>(getPrimitiveSet(0)); }
+	const osg::DrawArrays *getDrawArrays() const { return static_cast<const osg::DrawArrays*>(getPrimitiveSet(0)); }
 
-	osg::UIntArray *getIndices() { return (osg::UIntArray*) getVertexIndices(); }
-	const osg::UIntArray *getIndices() const { return (const osg::UIntArray*) getVertexIndices(); }
+	osg::DrawElementsUInt *getElements() { return static_cast<osg::DrawElementsUInt*>(getPrimitiveSet(0)); }
+	const osg::DrawElementsUInt *getElements() const { return static_cast<const osg::DrawElementsUInt*>(getPrimitiveSet(0)); }
 
 	osg::Vec3Array *getVerts() { return (osg::Vec3Array*) getVertexArray(); }
 	const osg::Vec3Array *getVerts() const { return (const osg::Vec3Array*) getVertexArray(); }
@@ -189,9 +193,11 @@ protected:
 	const osg::Vec2Array *getTexCoords() const { return (const osg::Vec2Array*) getTexCoordArray(0); }
 
 	int m_iMatIdx;
-#ifdef VTP_AVOID_OSG_INDICES
 	PrimType m_PrimType;
-#endif
+
+	// For strip types, the indices and length of each primitive as given
+	std::vector<uint> m_StripIndices;
+	std::vector<uint> m_StripLengths;
 };
 
 /** A Font for use with vtTextMesh. */
@@ -10,6 +10,7 @@
 #include "vtlib/vtlib.h"
 #include "vtdata/vtLog.h"
 #include "vtdata/vtString.h"
+#include "vtlib/core/Profiler.h"
 
 #if VTLISPSM
 #include "LightSpacePerspectiveShadowTechnique.h"
@@ -1645,7 +1646,11 @@ void OsgDynMesh::drawImplementation(osg::RenderInfo& renderInfo) const
 		m_pDynGeom->m_cullPlanes[i++].Set(-pvec.x(), -pvec.y(), -pvec.z(), -pvec.w());
 	}
 
-	m_pDynGeom->DoCull(pVtCamera.get());
+	{
+		VTPROFILE("DynGeom DoCull");
+		m_pDynGeom->DoCull(pVtCamera.get());
+	}
+	VTPROFILE("DynGeom DoRender");
 	m_pDynGeom->DoRender();
 }
 
@@ -22,6 +22,7 @@
 
 #include <iostream>			// For redirecting OSG's stdout messages
 #include "vtdata/vtLog.h"	// to the VTP log.
+#include "vtlib/core/Profiler.h"
 
 /** A way to catch OSG messages */
 class OsgMsgTrap : public std::streambuf
@@ -53,6 +54,8 @@ vtScene::vtScene()
 	m_pRoot = NULL;
 	m_pRootEngine = NULL;
 	m_pRootEnginePostDraw = NULL;
+	m_bParallelEngines = true;
+	m_bEngineTiming = false;
 	m_piKeyState = NULL;
 	m_pDefaultCamera = NULL;
 	m_pDefaultWindow = NULL;
@@ -68,6 +71,7 @@ vtScene::~vtScene()
 	// Cleanup engines.  They are in a tree, connected by ref_ptr, so we only need
 	//  to release the top of the tree.
 	m_pRootEngine = NULL;
+	m_pSchedule = NULL;
 
 	m_pOsgViewer = NULL;	// derefs
 
@@ -263,6 +267,8 @@ void vtScene::Shutdown()
 
 	m_pRoot = NULL;
 	m_pRootEnginePostDraw = NULL;
+	m_pSchedule = NULL;
+	m_pPostDrawSchedule = NULL;
 	m_piKeyState = NULL;
 
 	// remove our hold on refcounted objects
@@ -277,10 +283,10 @@ void vtScene::Shutdown()
 void vtScene::OnMouse(vtMouseEvent &event, vtWindow *pWindow)
 {
 	// Pass event to Engines
-	vtEngineArray list(m_pRootEngine);
-	for (uint i = 0; i < list.size(); i++)
+	vtEngineSchedulePtr sched = CurrentSchedule(m_pRootEngine.get(), m_pSchedule);
+	for (uint i = 0; i < sched->Size(); i = sched->Next(i))
 	{
-		vtEngine *pEng = list[i];
+		vtEngine *pEng = sched->Get(i);
 		if (pEng->GetEnabled() &&
 			(pEng->GetWindow() == NULL || pEng->GetWindow() == pWindow))
 			pEng->OnMouse(event);
@@ -290,10 +296,10 @@ void vtScene::OnMouse(vtMouseEvent &event, vtWindow *pWindow)
 void vtScene::OnKey(int key, int flags, vtWindow *pWindow)
 {
 	// Pass event to Engines
-	vtEngineArray list(m_pRootEngine);
-	for (uint i = 0; i < list.size(); i++)
+	vtEngineSchedulePtr sched = CurrentSchedule(m_pRootEngine.get(), m_pSchedule);
+	for (uint i = 0; i < sched->Size(); i = sched->Next(i))
 	{
-		vtEngine *pEng = list[i];
+		vtEngine *pEng = sched->Get(i);
 		if (pEng->GetEnabled() &&
 			(pEng->GetWindow() == NULL || pEng->GetWindow() == pWindow))
 			pEng->OnKey(key, flags);
@@ -315,16 +321,23 @@ IPoint2 vtScene::GetWindowSize(vtWindow *pWindow)
 	return pWindow->GetSize();
 }
 
-void vtScene::DoEngines(vtEngine *eng)
+/**
+ * Return the flattened engine tree starting at eng, building it again only
+ * if the tree has changed since it was cached.
+ */
+vtEngineSchedule *vtScene::CurrentSchedule(vtEngine *eng, vtEngineSchedulePtr &schedule)
 {
-	// Evaluate Engines
-	vtEngineArray list(eng);
-	for (uint i = 0; i < list.size(); i++)
-	{
-		vtEngine *pEng = list[i];
-		if (pEng->GetEnabled())
-			pEng->Eval();
-	}
+	if (!schedule.valid() || !schedule->IsCurrent(eng))
+		schedule = new vtEngineSchedule(eng);
+	return schedule.get();
+}
+
+void vtScene::DoEngines(vtEngine *eng, vtEngineSchedulePtr &schedule)
+{
+	// Evaluate Engines.  Hold a reference, in case an engine changes the
+	//  tree and the cached schedule is replaced during evaluation.
+	vtEngineSchedulePtr sched = CurrentSchedule(eng, schedule);
+	sched->Eval(m_bParallelEngines, m_bEngineTiming);
 }
 
 // (for backward compatibility only)
@@ -339,11 +352,11 @@ void vtScene::AddEngine(vtEngine *ptr)
 void vtScene::TargetRemoved(osg::Referenced *tar)
 {
 	// Look at all Engines
-	vtEngineArray list(m_pRootEngine);
-	for (uint i = 0; i < list.size(); i++)
+	vtEngineSchedulePtr sched = CurrentSchedule(m_pRootEngine.get(), m_pSchedule);
+	for (uint i = 0; i < sched->Size(); i++)
 	{
 		// If this engine targets something that is no longer there
-		vtEngine *pEng = list[i];
+		vtEngine *pEng = sched->Get(i);
 		for (uint j = 0; j < pEng->NumTargets(); j++)
 		{
 			// Then remove it
@@ -387,13 +400,13 @@ void vtScene::UpdateBegin()
 void vtScene::UpdateEngines()
 {
 	if (!m_bInitialized) return;
-	DoEngines(m_pRootEngine);
+	DoEngines(m_pRootEngine.get(), m_pSchedule);
 }
 
 void vtScene::PostDrawEngines()
 {
 	if (!m_bInitialized) return;
-	DoEngines(m_pRootEnginePostDraw);
+	DoEngines(m_pRootEnginePostDraw, m_pPostDrawSchedule);
 }
 
 void vtScene::UpdateWindow(vtWindow *pWindow)
@@ -484,11 +497,20 @@ void vtScene::ComputeViewMatrix(FMatrix4 &mat)
 
 void vtScene::DoUpdate()
 {
+	vtProfiler::NextFrame();
+
 	UpdateBegin();
-	UpdateEngines();
-	UpdateWindow(GetWindow(0));
+	{
+		VTPROFILE("UpdateEngines");
+		UpdateEngines();
+	}
+	{
+		VTPROFILE("UpdateWindow");
+		UpdateWindow(GetWindow(0));
+	}
 
 	// Some engines need to run after the cull-draw phase
+	VTPROFILE("PostDrawEngines");
 	PostDrawEngines();
 }
 
@@ -619,10 +641,10 @@ void vtScene::SetWindowSize(int w, int h, vtWindow *pWindow)
 	pWindow->SetSize(w, h);
 
 	// Pass event to Engines
-	vtEngineArray list(m_pRootEngine);
-	for (uint i = 0; i < list.size(); i++)
+	vtEngineSchedulePtr sched = CurrentSchedule(m_pRootEngine.get(), m_pSchedule);
+	for (uint i = 0; i < sched->Size(); i = sched->Next(i))
 	{
-		vtEngine *pEng = list[i];
+		vtEngine *pEng = sched->Get(i);
 		if (pEng->GetEnabled() &&
 			(pEng->GetWindow() == NULL || pEng->GetWindow() == pWindow))
 			pEng->OnWindowSize(w, h);
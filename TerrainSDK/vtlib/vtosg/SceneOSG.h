@@ -108,13 +108,13 @@ public:
 	void WorldToScreen(const FPoint3 &point, IPoint2 &result);
 
 	/// Set the top engine in the Engine graph
-	void SetRootEngine(vtEngine *ptr) { m_pRootEngine = ptr; }
+	void SetRootEngine(vtEngine *ptr) { m_pRootEngine = ptr; m_pSchedule = NULL; }
 
 	/// Get the top engine in the Engine graph
 	vtEngine *GetRootEngine() { return m_pRootEngine.get(); }
 
 	/// Set the top engine in the Engine graph
-	void SetPostDrawEngine(vtEngine *ptr) { m_pRootEnginePostDraw = ptr; }
+	void SetPostDrawEngine(vtEngine *ptr) { m_pRootEnginePostDraw = ptr; m_pPostDrawSchedule = NULL; }
 
 	/// Get the top engine in the Engine graph
 	vtEngine *GetPostDrawEngine() { return m_pRootEnginePostDraw; }
@@ -122,6 +122,16 @@ public:
 	/// Add an Engine to the scene. (for backward compatibility only)
 	void AddEngine(vtEngine *ptr);
 
+	/** If true (the default), engines which declare themselves independent
+	 * (see vtEngine::IsIndependent) may be evaluated in parallel. */
+	void SetParallelEngines(bool bOn) { m_bParallelEngines = bOn; }
+	bool GetParallelEngines() { return m_bParallelEngines; }
+
+	/** If true, the time taken by each engine's Eval is measured; see
+	 * vtEngine::GetEvalTime.  Default is false. */
+	void SetEngineTiming(bool bOn) { m_bEngineTiming = bOn; }
+	bool GetEngineTiming() { return m_bEngineTiming; }
+
 	/// Inform all engines in the scene that a target no longer exists
 	void TargetRemoved(osg::Referenced *tar);
 
@@ -184,13 +194,18 @@ public:
 #endif
 
 protected:
-	void DoEngines(vtEngine *eng);
+	void DoEngines(vtEngine *eng, vtEngineSchedulePtr &schedule);
+	static vtEngineSchedule *CurrentSchedule(vtEngine *eng, vtEngineSchedulePtr &schedule);
 
 	vtArray<vtWindow*> m_Windows;
 	vtCamera	*m_pCamera;
 	vtGroup		*m_pRoot;
 	vtEnginePtr	m_pRootEngine;
 	vtEngine	*m_pRootEnginePostDraw;
+	vtEngineSchedulePtr	m_pSchedule;
+	vtEngineSchedulePtr	m_pPostDrawSchedule;
+	bool		m_bParallelEngines;
+	bool		m_bEngineTiming;
 	bool		*m_piKeyState;
 	vtHUD		*m_pHUD;
 
@@ -352,10 +352,7 @@ void FeatureTableDlg::OnDeleteHighlighted( wxCommandEvent &event )
 		for (uint i = 0; i < m_pFeatures->NumEntities(); i++)
 		{
 			if (m_pFeatures->IsDeleted(i))
-			{
-				vtFeature *f = m_pFeatures->GetFeature(i);
-				OnFeatureDelete(f);
-			}
+				OnFeatureDelete(i);
 		}
 		// Then low-level
 		m_pFeatures->ApplyDeletion();
@@ -42,7 +42,7 @@ public:
 
 	virtual void OnModified() {}
 	virtual void RefreshViz() {}
-	virtual void OnFeatureDelete(vtFeature *f) {}
+	virtual void OnFeatureDelete(uint iIndex) {}
 	virtual void OnFieldEdited(uint iIndex) {}
 	virtual void OnEditEnd() {}
 
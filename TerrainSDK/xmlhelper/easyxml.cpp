@@ -126,6 +126,11 @@ public:
 	virtual const char * getName (int i) const;
 	virtual const char * getValue (int i) const;
 
+	// Look up names directly in Expat's array, which is faster than the
+	//  generic implementation's virtual calls for each attribute.
+	virtual int findAttribute (const char * name) const;
+	virtual const char * getValue (const char * name) const;
+
 private:
 	const char ** _atts;
 };
@@ -148,6 +153,24 @@ const char *ExpatAtts::getValue (int i) const
 	return _atts[i*2+1];
 }
 
+int ExpatAtts::findAttribute (const char * name) const
+{
+	for (int i = 0; _atts[i] != 0; i += 2) {
+		if (strcmp(name, _atts[i]) == 0)
+			return i / 2;
+	}
+	return -1;
+}
+
+const char *ExpatAtts::getValue (const char * name) const
+{
+	for (int i = 0; _atts[i] != 0; i += 2) {
+		if (strcmp(name, _atts[i]) == 0)
+			return _atts[i+1];
+	}
+	return 0;
+}
+
 
 ////////////////////////////////////////////////////////////////////////
 // Static callback functions for Expat.
@@ -408,3 +431,31 @@ void readCompressedXML (gzFile fp, XMLVisitor &visitor, const string& path,
 	XML_ParserFree(parser);
 }
 
+/**
+ * Read and parse the XML from a buffer in memory, which holds the whole
+ * document.
+ */
+void readXMLBuffer (const char *buf, int iLength, XMLVisitor &visitor,
+					const string &path)
+{
+	XML_Parser parser = XML_ParserCreate(0);
+	XML_SetUserData(parser, &visitor);
+	XML_SetElementHandler(parser, start_element, end_element);
+	XML_SetCharacterDataHandler(parser, character_data);
+	XML_SetProcessingInstructionHandler(parser, processing_instruction);
+
+	visitor.startXML();
+
+	// The whole document is available, so parse it in one call.
+	if (!XML_Parse(parser, buf, iLength, true))
+	{
+		const XML_LChar *message = XML_ErrorString(XML_GetErrorCode(parser));
+		int line = XML_GetCurrentLineNumber(parser);
+		int col = XML_GetCurrentColumnNumber(parser);
+		XML_ParserFree(parser);
+		throw xh_io_exception(message, xh_location(path, line, col),
+			"XML Parser");
+	}
+
+	XML_ParserFree(parser);
+}
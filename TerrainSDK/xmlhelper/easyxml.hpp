@@ -382,5 +382,25 @@ extern void readXML (const string &path, XMLVisitor &visitor,
 					 bool progress_callback(int) = NULL);
 
 
+/**
+ * @relates XMLVisitor
+ * Read an XML document which is already in memory.
+ *
+ * This is the fastest way to parse a document, as the parser sees
+ * all of it at once.  The buffer does not need to be terminated.
+ *
+ * @param buf The bytes of the XML document.
+ * @param iLength The number of bytes in the buffer.
+ * @param visitor An object that contains callbacks for XML parsing
+ * events.
+ * @param path A string describing the original path of the resource.
+ * @exception Throws xh_io_exception if there is a problem parsing
+ * the document.
+ * @see XMLVisitor
+ */
+extern void readXMLBuffer (const char *buf, int iLength, XMLVisitor &visitor,
+						   const string &path = "");
+
+
 #endif // __EASYXML_HPP
 